@@ -5,6 +5,7 @@
 #include "graphics/sdlinterface.hpp"
 #include "graphics/sdlimage.hpp"
 #include "graphics/memoryimage.hpp"
+#include "graphics/spriteanimator.hpp"
 #include "widget/dialog.hpp"
 #include "imagelib/imagelib.hpp"
 #include "audio/openalsoundmanager.hpp"
@@ -12,6 +13,7 @@
 #include "math/rect.hpp"
 #include "resources/propertiesparser.hpp"
 #include "debug/perftimer.hpp"
+#include "debug/framestats.hpp"
 #include "math/mtrand.hpp"
 #include "readwrite/modval.hpp"
 #ifdef _WIN32
@@ -28,6 +30,9 @@
 #include "audio/bassmusicinterface.hpp"
 #include "audio/bass.h"
 #include "misc/autocrit.hpp"
+#include "misc/registrystore.hpp"
+#include "resources/hotreloader.hpp"
+#include "misc/asyncio.hpp"
 #include "debug/debug.hpp"
 #include "debug/errorhandler.hpp"
 #include "paklib/pakinterface.hpp"
@@ -145,7 +150,6 @@ AppBase::AppBase()
 	mLoadingThreadStarted = false;
 	mAutoStartLoadingThread = true;
 	mLoadingThreadCompleted = false;
-	mCursorThreadRunning = false;
 	mNumLoadingThreadTasks = 0;
 	mCompletedLoadingThreadTasks = 0;
 	mLastDrawTick = SDL_GetTicks();
@@ -162,12 +166,26 @@ AppBase::AppBase()
 	mInitialized = false;
 	mLastShutdownWasGraceful = true;
 	mReadFromRegistry = false;
+	mRegistry = new RegistryStore();
+	mAsyncIO = new AsyncIO();
+	mBinaryRegistry = false;
 	mCmdLineParsed = false;
 	mSkipSignatureChecks = false;
 	mCtrlDown = false;
 	mAltDown = false;
 	mStepMode = 0;
+	mRecordingDemo = false;
+	mPlayingDemo = false;
+	mDemoLoaded = false;
+	mHeadless = false;
+	mBenchmark = false;
+	mBenchmarkStartNS = 0;
+	mTextureBudgetMB = 0;
+	mHotReload = false;
+	mSoftwareRender = false;
+	mHotReloader = nullptr;
 	mCleanupSharedImages = false;
+	mSharedImageGeneration = 0;
 	mStandardWordWrap = true;
 	mbAllowExtendedChars = true;
 	mEnableMaximizeButton = false;
@@ -366,14 +384,17 @@ AppBase::~AppBase()
 
 	delete mWidgetManager;
 	delete mResourceManager;
+	delete mRegistry;
+	delete mAsyncIO;
 	delete gFPSImage;
 	gFPSImage = nullptr;
 
+	mSharedImageIndex.Clear();
 	SharedImageMap::iterator aSharedImageItr = mSharedImageMap.begin();
 	while (aSharedImageItr != mSharedImageMap.end())
 	{
 		SharedImage *aSharedImage = &aSharedImageItr->second;
-		DBG_ASSERTE(aSharedImage->mRefCount == 0);
+		DBG_ASSERTE(aSharedImage->mRefCount <= 0);
 		delete aSharedImage->mImage;
 		mSharedImageMap.erase(aSharedImageItr++);
 	}
@@ -1000,52 +1021,41 @@ double AppBase::GetLoadingThreadProgress()
 	return std::min(mCompletedLoadingThreadTasks / (double)mNumLoadingThreadTasks, 1.0);
 }
 
-bool AppBase::RegistryWrite(const std::string &theValueName, JSON_RTYPE theType, const uchar *theValue, ulong theLength)
+RegistryStore *AppBase::GetRegistry()
 {
 	// H522
-	std::filesystem::path config = GetAppDataFolder() + mRegKey + "/registry.json"; // always registry.json
-	std::filesystem::create_directories(config.parent_path());
-	//SDL_Log("%s", config.string().c_str());
+	mRegistry->SetDir(GetAppDataFolder() + mRegKey + "/");
+	mRegistry->SetFormat(mBinaryRegistry ? RegistryStore::FORMAT_BINARY : RegistryStore::FORMAT_JSON);
+	return mRegistry;
+}
 
-	nlohmann::json j;
-	std::ifstream inFile(config);
-	if (inFile)
-	{
-		try
-		{
-			inFile >> j;
-		}
-		catch (...)
-		{
-		}
-	}
+bool AppBase::RegistryWrite(const std::string &theValueName, JSON_RTYPE theType, const uchar *theValue, ulong theLength)
+{
+	nlohmann::json aValue;
 
 	switch (theType)
 	{
 	case JSON_STRING:
-		j[theValueName] = std::string(reinterpret_cast<const char *>(theValue), theLength);
+		aValue = std::string(reinterpret_cast<const char *>(theValue), theLength);
 		break;
 	case JSON_INTEGER:
-		if (theLength == sizeof(int))
-			j[theValueName] = *reinterpret_cast<const int *>(theValue);
+		if (theLength != sizeof(int))
+			return true;
+		aValue = *reinterpret_cast<const int *>(theValue);
 		break;
 	case JSON_BOOLEAN:
-		if (theLength == sizeof(int))
-			j[theValueName] = (*reinterpret_cast<const int *>(theValue)) != 0;
+		if (theLength != sizeof(int))
+			return true;
+		aValue = (*reinterpret_cast<const int *>(theValue)) != 0;
 		break;
-	case JSON_DATA: {
-		std::vector<uchar> bin(theValue, theValue + theLength);
-		j[theValueName] = bin;
+	case JSON_DATA:
+		aValue = std::vector<uchar>(theValue, theValue + theLength);
 		break;
-	}
 	default:
 		return false;
 	}
 
-	std::ofstream outFile(config);
-	if (outFile)
-		outFile << j.dump(4);
-
+	GetRegistry()->Write(theValueName, aValue);
 	return true;
 }
 
@@ -1085,52 +1095,30 @@ void AppBase::WriteToRegistry()
 
 bool AppBase::RegistryEraseKey(const PopString &_theKeyName)
 {
+	// our own key may have writes that haven't been flushed yet
+	if (_theKeyName == mRegKey)
+		return GetRegistry()->Clear();
+
 	std::filesystem::path basePath = GetAppDataFolder();
-	std::filesystem::path keyPath = basePath / _theKeyName / "registry.json";
+	bool success = true;
 
-	if (std::filesystem::exists(keyPath))
+	for (const char *aFileName : {"registry.json", "registry.bin"})
 	{
-		std::error_code ec;
-		std::filesystem::remove(keyPath, ec);
-		return !ec;
+		std::filesystem::path keyPath = basePath / _theKeyName / aFileName;
+		if (std::filesystem::exists(keyPath))
+		{
+			std::error_code ec;
+			std::filesystem::remove(keyPath, ec);
+			success = success && !ec;
+		}
 	}
 
-	return true;
+	return success;
 }
 
 void AppBase::RegistryEraseValue(const PopString &_theValueName)
 {
-	// H522
-	std::filesystem::path configPath = GetAppDataFolder() + mRegKey + "/registry.json";
-	std::string keyName = _theValueName;
-
-	if (!std::filesystem::exists(configPath))
-		return;
-
-	nlohmann::json j;
-	std::ifstream inFile(configPath);
-	if (inFile)
-	{
-		try
-		{
-			inFile >> j;
-		}
-		catch (...)
-		{
-			return;
-		}
-	}
-
-	if (j.contains(keyName))
-	{
-		j.erase(keyName);
-
-		std::ofstream outFile(configPath);
-		if (outFile)
-			outFile << j.dump(4);
-	}
-
-	return;
+	GetRegistry()->Erase(_theValueName);
 }
 
 bool AppBase::RegistryGetSubKeys(const std::string &theKeyName, StringVector *theSubKeys)
@@ -1146,32 +1134,17 @@ bool AppBase::RegistryRead(const std::string &theValueName, JSON_RTYPE *theType,
 bool AppBase::RegistryReadKey(const std::string &theValueName, JSON_RTYPE *theType, uchar *theValue, ulong *theLength,
 							  ulong theKey)
 {
-	// H522
-	std::filesystem::path configPath = GetAppDataFolder() + mRegKey + "/registry.json";
-	if (!std::filesystem::exists(configPath) || !theType || !theValue || !theLength)
-		return false;
-
-	nlohmann::json j;
-	std::ifstream inFile(configPath);
-	if (!inFile)
+	if (!theType || !theValue || !theLength)
 		return false;
-	try
-	{
-		inFile >> j;
-	}
-	catch (...)
-	{
-		return false;
-	}
 
-	if (!j.contains(theValueName))
+	nlohmann::json entry;
+	if (!GetRegistry()->Read(theValueName, &entry))
 		return false;
 
-	auto &entry = j[theValueName];
 	// JSON_STRING
 	if (entry.is_string())
 	{
-		std::string s = entry.get<std::string>();
+		const std::string &s = entry.get_ref<const std::string &>();
 		if (s.size() > *theLength)
 			return false;
 		std::memcpy(theValue, s.data(), s.size());
@@ -1219,121 +1192,59 @@ bool AppBase::RegistryReadKey(const std::string &theValueName, JSON_RTYPE *theTy
 
 bool AppBase::RegistryReadString(const std::string &theKey, std::string *theString)
 {
-	// H522
-	std::filesystem::path configPath = GetAppDataFolder() + mRegKey + "/registry.json";
-	if (!std::filesystem::exists(configPath) || !theString)
+	if (!theString)
 		return false;
 
-	nlohmann::json j;
-	std::ifstream inFile(configPath);
-	if (!inFile)
-		return false;
-	try
-	{
-		inFile >> j;
-	}
-	catch (...)
-	{
+	nlohmann::json aValue;
+	if (!GetRegistry()->Read(theKey, &aValue) || !aValue.is_string())
 		return false;
-	}
 
-	if (j.contains(theKey) && j[theKey].is_string())
-	{
-		*theString = j[theKey].get<std::string>();
-		return true;
-	}
-	return false;
+	*theString = aValue.get<std::string>();
+	return true;
 }
 
 bool AppBase::RegistryReadInteger(const std::string &theKey, int *theValue)
 {
-	// H522
 	if (!theValue)
 		return false;
 
-	std::string s;
-
-	nlohmann::json j;
-	std::filesystem::path configPath = GetAppDataFolder() + mRegKey + "/registry.json";
-	std::ifstream inFile(configPath);
-	if (!inFile)
-		return false;
-	try
-	{
-		inFile >> j;
-	}
-	catch (...)
-	{
+	nlohmann::json aValue;
+	if (!GetRegistry()->Read(theKey, &aValue) || !aValue.is_number_integer())
 		return false;
-	}
 
-	if (j.contains(theKey) && j[theKey].is_number_integer())
-	{
-		*theValue = j[theKey].get<int>();
-		return true;
-	}
-	return false;
+	*theValue = aValue.get<int>();
+	return true;
 }
 
 bool AppBase::RegistryReadBoolean(const std::string &theKey, bool *theValue)
 {
-	// H522
 	if (!theValue)
 		return false;
 
-	nlohmann::json j;
-	std::filesystem::path configPath = GetAppDataFolder() + mRegKey + "/registry.json";
-	std::ifstream inFile(configPath);
-	if (!inFile)
-		return false;
-	try
-	{
-		inFile >> j;
-	}
-	catch (...)
-	{
+	nlohmann::json aValue;
+	if (!GetRegistry()->Read(theKey, &aValue) || !aValue.is_boolean())
 		return false;
-	}
 
-	if (j.contains(theKey) && j[theKey].is_boolean())
-	{
-		*theValue = j[theKey].get<bool>();
-		return true;
-	}
-	return false;
+	*theValue = aValue.get<bool>();
+	return true;
 }
 
 bool AppBase::RegistryReadData(const std::string &theKey, uchar *theValue, ulong *theLength)
 {
-	// H522
 	if (!theValue || !theLength)
 		return false;
 
-	nlohmann::json j;
-	std::filesystem::path configPath = GetAppDataFolder() + mRegKey + "/registry.json";
-	std::ifstream inFile(configPath);
-	if (!inFile)
-		return false;
-	try
-	{
-		inFile >> j;
-	}
-	catch (...)
-	{
+	nlohmann::json aValue;
+	if (!GetRegistry()->Read(theKey, &aValue) || !aValue.is_array())
 		return false;
-	}
 
-	if (j.contains(theKey) && j[theKey].is_array())
-	{
-		size_t size = j[theKey].size();
-		if (size > *theLength)
-			return false;
-		for (size_t i = 0; i < size; ++i)
-			theValue[i] = static_cast<uchar>(j[theKey][i].get<int>());
-		*theLength = static_cast<ulong>(size);
-		return true;
-	}
-	return false;
+	size_t size = aValue.size();
+	if (size > *theLength)
+		return false;
+	for (size_t i = 0; i < size; ++i)
+		theValue[i] = static_cast<uchar>(aValue[i].get<int>());
+	*theLength = static_cast<ulong>(size);
+	return true;
 }
 
 void AppBase::ReadFromRegistry()
@@ -1483,12 +1394,6 @@ void AppBase::Shutdown()
 		mShutdown = true;
 		ShutdownHook();
 
-		// Blah
-		while (mCursorThreadRunning)
-		{
-			SDL_Delay(10);
-		}
-
 		if (mMusicInterface != nullptr)
 			mMusicInterface->StopAllMusic();
 
@@ -1496,6 +1401,10 @@ void AppBase::Shutdown()
 
 		if (mReadFromRegistry)
 			WriteToRegistry();
+
+		mRegistry->Flush();
+
+		SetHotReload(false);
 	}
 }
 
@@ -1515,6 +1424,7 @@ void AppBase::DoExit(int theCode)
 
 extern bool demoWind;
 extern bool debugWind;
+extern bool profilerWind;
 
 void AppBase::UpdateFrames()
 {
@@ -1522,12 +1432,19 @@ void AppBase::UpdateFrames()
 
 	if (!mMinimized)
 	{
+		SpriteAnimator::UpdateAll(mFrameTime);
+
 		if (mWidgetManager->UpdateFrame())
 			++mFPSDirtyCount;
 	}
 
 	mMusicInterface->Update();
 	CleanSharedImages();
+
+	// animated cursors step through their cels, each one was only made into a cursor once
+	Image *aCursorImage = mCursorImages[mCursorNum];
+	if ((aCursorImage != nullptr) && (aCursorImage->mAnimInfo != nullptr))
+		EnforceCursor();
 }
 
 void AppBase::DoUpdateFramesF(float theFrac)
@@ -1543,15 +1460,22 @@ bool AppBase::DoUpdateFrames()
 	if (gScreenSaverActive)
 		return false;
 
-	if ((mLoadingThreadCompleted) && (!mLoaded))
+	// during playback the app finishes loading on the same update it did while recording
+	bool loadingDone = mPlayingDemo ? mDemoLoaded : mLoadingThreadCompleted;
+	if ((loadingDone) && (!mLoaded))
 	{
+		if (mRecordingDemo)
+			mDemoBuffer.WriteMarker(mUpdateCount, DEMO_LOADED);
+
 		SDL_SetCurrentThreadPriority(SDL_THREAD_PRIORITY_NORMAL);
 		mLoaded = true;
 		mYieldMainThread = false;
 		LoadingThreadCompleted();
 	}
 
+	uint64_t anUpdateStartNS = SDL_GetTicksNS();
 	UpdateFrames();
+	FrameStats::Add(FRAMESTAT_UPDATE_TIME, (SDL_GetTicksNS() - anUpdateStartNS) / 1000000.0);
 	return true;
 }
 
@@ -1658,6 +1582,7 @@ static void UpdateScreenSaverInfo(uint32_t theTick)
 
 bool AppBase::DrawDirtyStuff()
 {
+	Perf::MarkFrame();
 	AUTO_PERF("AppBase::DrawDirtyStuff");
 	MTAutoDisallowRand aDisallowRand;
 
@@ -1700,9 +1625,11 @@ bool AppBase::DrawDirtyStuff()
 		return false;
 	}
 
+	uint64_t aDrawStartNS = SDL_GetTicksNS();
 	mIsDrawing = true;
 	bool drewScreen = mWidgetManager->DrawScreen();
 	mIsDrawing = false;
+	FrameStats::Add(FRAMESTAT_DRAW_TIME, (SDL_GetTicksNS() - aDrawStartNS) / 1000000.0);
 
 	if ((drewScreen || (aStartTime - mLastDrawTick >= 1000) || (mCustomCursorDirty)) &&
 		((int)(aStartTime - mNextDrawTick) >= 0))
@@ -1734,7 +1661,9 @@ bool AppBase::DrawDirtyStuff()
 		uint32_t aPreScreenBltTime = SDL_GetTicks();
 		mLastDrawTick = aPreScreenBltTime;
 
+		uint64_t aPresentStartNS = SDL_GetTicksNS();
 		Redraw(nullptr);
+		FrameStats::Add(FRAMESTAT_PRESENT_TIME, (SDL_GetTicksNS() - aPresentStartNS) / 1000000.0);
 
 		// This is our one UpdateFTimeAcc if we are vsynched
 		UpdateFTimeAcc();
@@ -1743,6 +1672,11 @@ bool AppBase::DrawDirtyStuff()
 
 		mScreenBltTime = aEndTime - aPreScreenBltTime;
 
+		FrameStats::Set(FRAMESTAT_TEXTURE_MEMORY, (double)SDLTextureData::GetTotalMemSize());
+		if (mSoundManager != nullptr)
+			FrameStats::Set(FRAMESTAT_SOUNDS_PLAYING, mSoundManager->GetNumPlayingSounds());
+		FrameStats::EndFrame();
+
 #ifdef _DEBUG
 		/*if (mFPSTime >= 5000) // Show FPS about every 5 seconds
 		{
@@ -2159,6 +2093,13 @@ bool AppBase::DebugKeyDown(int theKey)
 		else
 			debugWind = true;
 	}
+	else if (theKey == SDLK_8)
+	{
+		if (profilerWind)
+			profilerWind = false;
+		else
+			profilerWind = true;
+	}
 	else if (theKey == SDLK_F2)
 	{
 		bool isPerfOn = !Perf::IsPerfOn();
@@ -2194,123 +2135,139 @@ void AppBase::CloseRequestAsync()
 //  it won't keep crashing and stuff
 bool AppBase::ProcessDeferredMessages(bool singleMessage)
 {
+	if (mPlayingDemo)
+		ProcessDemo();
+
 	SDL_Event event;
 	if (SDL_PollEvent(&event))
 	{
 		ImGui_ImplSDL3_ProcessEvent(&event);
 
-		switch (event.type)
+		// live input is ignored while a demo is replaying
+		if (!mPlayingDemo || !DemoBuffer::IsInputEvent(event))
 		{
-		case SDL_EVENT_QUIT:
-			Shutdown();
-			break;
-		case SDL_EVENT_WINDOW_FOCUS_GAINED:
-			mActive = true;
-			RehupFocus();
-			if (!mIsWindowed)
-				mWidgetManager->MarkAllDirty();
-			if (mIsOpeningURL && !mActive)
-				URLOpenSucceeded(mOpeningURL);
-			break;
-		case SDL_EVENT_WINDOW_FOCUS_LOST:
-			mActive = false;
-			RehupFocus();
-			if (mIsOpeningURL && mActive)
-				URLOpenFailed(mOpeningURL);
-			break;
-		case SDL_EVENT_WINDOW_MINIMIZED:
-			mMinimized = true;
-			if (mMuteOnLostFocus)
-				Mute(true);
-			break;
-		case SDL_EVENT_WINDOW_RESTORED:
-			mMinimized = false;
-			if (mMuteOnLostFocus)
-				Unmute(true);
-			mWidgetManager->MarkAllDirty();
-			break;
-		case SDL_EVENT_MOUSE_MOTION:
-			if (!gInAssert && !mSEHOccured)
-			{
-				int x = event.motion.x;
-				int y = event.motion.y;
-				mWidgetManager->RemapMouse(x, y);
-				mLastUserInputTick = mLastTimerTime;
-				mWidgetManager->MouseMove(x, y);
-				if (!mMouseIn)
-				{
-					mMouseIn = true;
-					EnforceCursor();
-				}
-			}
-			break;
-		case SDL_EVENT_MOUSE_BUTTON_DOWN:
-		case SDL_EVENT_MOUSE_BUTTON_UP:
-			if (!gInAssert && !mSEHOccured)
-			{
-				int btnCode = 0;
-				bool down = event.type == SDL_EVENT_MOUSE_BUTTON_DOWN;
+			if (mRecordingDemo)
+				mDemoBuffer.WriteEvent(mUpdateCount, event);
 
-				switch (event.button.button)
-				{
-				case SDL_BUTTON_LEFT:
-					btnCode = 1;
-					break;
-				case SDL_BUTTON_RIGHT:
-					btnCode = -1;
-					break;
-				case SDL_BUTTON_MIDDLE:
-					btnCode = 3;
-					break;
-				}
-
-				int x = event.button.x;
-				int y = event.button.y;
+			HandleSDLEvent(event);
+		}
+	}
 
-				int renderWidth, renderHeight;
-				SDL_GetCurrentRenderOutputSize(mSDLInterface->mRenderer, &renderWidth, &renderHeight);
+	return SDL_HasEvents(SDL_EVENT_FIRST, SDL_EVENT_LAST);
+}
 
-				int scaledX = static_cast<int>(event.button.x * ((float)mWidth / renderWidth));
-				int scaledY = static_cast<int>(event.button.y * ((float)mHeight / renderHeight));
+void AppBase::HandleSDLEvent(const SDL_Event &theEvent)
+{
+	switch (theEvent.type)
+	{
+	case SDL_EVENT_QUIT:
+		Shutdown();
+		break;
+	case SDL_EVENT_WINDOW_FOCUS_GAINED:
+		mActive = true;
+		RehupFocus();
+		if (!mIsWindowed)
+			mWidgetManager->MarkAllDirty();
+		if (mIsOpeningURL && !mActive)
+			URLOpenSucceeded(mOpeningURL);
+		break;
+	case SDL_EVENT_WINDOW_FOCUS_LOST:
+		mActive = false;
+		RehupFocus();
+		if (mIsOpeningURL && mActive)
+			URLOpenFailed(mOpeningURL);
+		break;
+	case SDL_EVENT_WINDOW_MINIMIZED:
+		mMinimized = true;
+		if (mMuteOnLostFocus)
+			Mute(true);
+		break;
+	case SDL_EVENT_WINDOW_RESTORED:
+		mMinimized = false;
+		if (mMuteOnLostFocus)
+			Unmute(true);
+		mWidgetManager->MarkAllDirty();
+		break;
+	case SDL_EVENT_MOUSE_MOTION:
+		if (!gInAssert && !mSEHOccured)
+		{
+			int x = theEvent.motion.x;
+			int y = theEvent.motion.y;
+			mSDLInterface->SetCursorPos(x, y);
+			mWidgetManager->RemapMouse(x, y);
+			mLastUserInputTick = mLastTimerTime;
+			mWidgetManager->MouseMove(x, y);
+			if (!mMouseIn)
+			{
+				mMouseIn = true;
+				EnforceCursor();
+			}
+		}
+		break;
+	case SDL_EVENT_MOUSE_BUTTON_DOWN:
+	case SDL_EVENT_MOUSE_BUTTON_UP:
+		if (!gInAssert && !mSEHOccured)
+		{
+			int btnCode = 0;
+			bool down = theEvent.type == SDL_EVENT_MOUSE_BUTTON_DOWN;
 
-				if (down)
-					mWidgetManager->MouseDown(scaledX, scaledY, btnCode);
-				else
-					mWidgetManager->MouseUp(scaledX, scaledY, btnCode);
+			switch (theEvent.button.button)
+			{
+			case SDL_BUTTON_LEFT:
+				btnCode = 1;
+				break;
+			case SDL_BUTTON_RIGHT:
+				btnCode = -1;
+				break;
+			case SDL_BUTTON_MIDDLE:
+				btnCode = 3;
+				break;
 			}
-			break;
-		case SDL_EVENT_MOUSE_WHEEL:
-			mWidgetManager->MouseWheel(event.wheel.y);
 
-			break;
-		case SDL_EVENT_KEY_DOWN:
-		case SDL_EVENT_KEY_UP: {
-			bool isDown = event.type == SDL_EVENT_KEY_DOWN;
-			SDL_Keycode key = event.key.key;
+			int x = theEvent.button.x;
+			int y = theEvent.button.y;
 
-			mLastUserInputTick = mLastTimerTime;
+			int renderWidth, renderHeight;
+			SDL_GetCurrentRenderOutputSize(mSDLInterface->mRenderer, &renderWidth, &renderHeight);
 
-			if (isDown && mDebugKeysEnabled && DebugKeyDown(key))
-				break;
+			int scaledX = static_cast<int>(theEvent.button.x * ((float)mWidth / renderWidth));
+			int scaledY = static_cast<int>(theEvent.button.y * ((float)mHeight / renderHeight));
 
-			if (isDown)
-				mWidgetManager->KeyDown(GetKeyCodeFromSDLKeycode(key));
+			if (down)
+				mWidgetManager->MouseDown(scaledX, scaledY, btnCode);
 			else
-				mWidgetManager->KeyUp(GetKeyCodeFromSDLKeycode(key));
+				mWidgetManager->MouseUp(scaledX, scaledY, btnCode);
 		}
 		break;
-		case SDL_EVENT_TEXT_INPUT: {
-			mLastUserInputTick = mLastTimerTime;
+	case SDL_EVENT_MOUSE_WHEEL:
+		mWidgetManager->MouseWheel(theEvent.wheel.y);
+
+		break;
+	case SDL_EVENT_KEY_DOWN:
+	case SDL_EVENT_KEY_UP: {
+		bool isDown = theEvent.type == SDL_EVENT_KEY_DOWN;
+		SDL_Keycode key = theEvent.key.key;
 
-			PopChar aChar = event.text.text[0]; // assumes UTF-8 safe
+		mLastUserInputTick = mLastTimerTime;
 
-			mWidgetManager->KeyChar((PopChar)aChar);
+		if (isDown && mDebugKeysEnabled && DebugKeyDown(key))
 			break;
-		}
-		}
+
+		if (isDown)
+			mWidgetManager->KeyDown(GetKeyCodeFromSDLKeycode(key));
+		else
+			mWidgetManager->KeyUp(GetKeyCodeFromSDLKeycode(key));
 	}
+	break;
+	case SDL_EVENT_TEXT_INPUT: {
+		mLastUserInputTick = mLastTimerTime;
 
-	return SDL_HasEvents(SDL_EVENT_FIRST, SDL_EVENT_LAST);
+		PopChar aChar = theEvent.text.text[0]; // assumes UTF-8 safe
+
+		mWidgetManager->KeyChar((PopChar)aChar);
+		break;
+	}
+	}
 }
 
 void AppBase::Done3dTesting()
@@ -2328,6 +2285,8 @@ void AppBase::MakeWindow()
 	if (mSDLInterface == nullptr)
 	{
 		mSDLInterface = new SDLInterface(this);
+		mSDLInterface->SetTextureBudget((int64_t)mTextureBudgetMB * 1024 * 1024);
+		mSDLInterface->mSoftwareRender = mSoftwareRender;
 
 		// Enable 3d setting
 		bool is3D = false;
@@ -2420,6 +2379,7 @@ int AppBase::LoadingThreadProcStub(void *theArg)
 {
 	AppBase *aPopLibApp = (AppBase *)theArg;
 
+	Perf::SetThreadName("LoadingThread");
 	aPopLibApp->LoadingThreadProc();
 
 	char aStr[256];
@@ -2442,72 +2402,6 @@ void AppBase::StartLoadingThread()
 		SDL_DetachThread(aThread);
 	}
 }
-void AppBase::CursorThreadProc()
-{
-	SDL_SetCurrentThreadPriority(SDL_THREAD_PRIORITY_HIGH);
-	SDL_Point aLastCursorPos = {0, 0};
-	int aLastDrawCount = 0;
-
-	while (!mShutdown)
-	{
-
-		SDL_Point aCursorPos;
-
-		float x, y;
-
-		SDL_GetMouseState(&x, &y);
-
-		aCursorPos.x = (int)x;
-		aCursorPos.y = (int)y;
-
-		if (aLastDrawCount != mDrawCount)
-		{
-			// We did a draw so we may have committed a pending mNextCursorX/Y
-			aLastCursorPos.x = mSDLInterface->mCursorX;
-			aLastCursorPos.y = mSDLInterface->mCursorY;
-		}
-
-		if ((aCursorPos.x != aLastCursorPos.x) || (aCursorPos.y != aLastCursorPos.y))
-		{
-			Uint32 aTimeNow = SDL_GetTicks();
-			if (aTimeNow - mNextDrawTick > mSDLInterface->mMillisecondsPerFrame + 5)
-			{
-				// Do the special drawing if we are rendering at less than full framerate
-				mSDLInterface->SetCursorPos(aCursorPos.x, aCursorPos.y);
-				aLastCursorPos = aCursorPos;
-			}
-			else
-			{
-				// Set them up to get assigned in the next screen redraw
-				mSDLInterface->mNextCursorX = aCursorPos.x;
-				mSDLInterface->mNextCursorY = aCursorPos.y;
-			}
-		}
-
-		SDL_Delay(10);
-	}
-
-	mCursorThreadRunning = false;
-}
-
-int AppBase::CursorThreadProcStub(void *theArg)
-{
-	AppBase *aPopLibApp = (AppBase *)theArg;
-	aPopLibApp->CursorThreadProc();
-	return 0;
-}
-
-void AppBase::StartCursorThread()
-{
-	if (!mCursorThreadRunning)
-	{
-		mCursorThreadRunning = true;
-		SDL_SetCurrentThreadPriority(SDL_THREAD_PRIORITY_HIGH);
-		SDL_Thread *aThread = SDL_CreateThread(CursorThreadProcStub, "CursorThread", (void *)this);
-		SDL_DetachThread(aThread);
-	}
-}
-
 void AppBase::SwitchScreenMode(bool wantWindowed, bool is3d, bool force)
 {
 	if (mForceFullscreen)
@@ -2622,7 +2516,10 @@ void AppBase::EnforceCursor()
 		}
 		else
 		{
-			if (mSDLInterface->SetCursorImage(mCursorImages[mCursorNum]))
+			Image *aCursorImage = mCursorImages[mCursorNum];
+			int aCel = (aCursorImage->mAnimInfo != nullptr) ? aCursorImage->GetAnimCel((int)(SDL_GetTicks() / 10)) : 0;
+
+			if (mSDLInterface->SetCursorImage(aCursorImage, aCel))
 				mCustomCursorDirty = true;
 
 			wantSysCursor = false;
@@ -2934,6 +2831,22 @@ bool AppBase::UpdateAppStep(bool *updated)
 		if (!ProcessDeferredMessages(true))
 		{
 			mUpdateAppState = UPDATESTATE_PROCESS_1;
+
+			// settings written since the last pass get saved in the background
+			mRegistry->Update();
+
+			// files that changed on disk are swapped in between frames
+			if (mHotReloader != nullptr)
+				mHotReloader->Update();
+
+			// and so are M() values reparsed on the worker threads
+			UpdateModValues();
+
+			mAsyncIO->Update();
+
+			// the loading thread has the resource manager to itself until it's done
+			if (!mLoadingThreadStarted || mLoadingThreadCompleted)
+				mResourceManager->Update();
 		}
 	}
 	else
@@ -2954,6 +2867,12 @@ bool AppBase::UpdateAppStep(bool *updated)
 				DrawDirtyStuff();
 			}
 		}
+		else if (mPlayingDemo)
+		{
+			ProcessDemoStep();
+			if (updated != nullptr)
+				*updated = true;
+		}
 		else
 		{
 			int anOldUpdateCnt = mUpdateCount;
@@ -3013,8 +2932,6 @@ void AppBase::Start()
 	if (mShutdown)
 		return;
 
-	StartCursorThread();
-
 	if (mAutoStartLoadingThread)
 		StartLoadingThread();
 
@@ -3029,12 +2946,20 @@ void AppBase::Start()
 	mLastTime = aStartTime;
 	mLastUserInputTick = aStartTime;
 	mLastTimerTime = aStartTime;
+	mBenchmarkStartNS = SDL_GetTicksNS();
 
 	DoMainLoop();
 	ProcessSafeDeleteList();
 
 	mRunning = false;
 
+	if (mRecordingDemo)
+	{
+		mRecordingDemo = false;
+		if (!mDemoBuffer.Save(mDemoFileName, mUpdateCount))
+			SDL_Log("Unable to save demo %s\r\n", mDemoFileName.c_str());
+	}
+
 	WaitForLoadingThread();
 
 	SDL_Log("Seconds       = %g\r\n", (SDL_GetTicks() - aStartTime) / 1000.0);
@@ -3090,8 +3015,11 @@ bool AppBase::LoadProperties(const std::string &theFileName, bool required, bool
 		Popup(aPropertiesParser.GetErrorText());
 		return false;
 	}
-	else
-		return true;
+
+	if (!checkSig && std::find(mPropertiesFiles.begin(), mPropertiesFiles.end(), theFileName) == mPropertiesFiles.end())
+		mPropertiesFiles.push_back(theFileName);
+
+	return true;
 }
 
 bool AppBase::LoadProperties()
@@ -3100,6 +3028,22 @@ bool AppBase::LoadProperties()
 	return LoadProperties("properties/default.xml", true, false);
 }
 
+void AppBase::SetHotReload(bool enable)
+{
+	mHotReload = enable;
+
+	if (!enable)
+	{
+		delete mHotReloader;
+		mHotReloader = nullptr;
+	}
+	else if (mHotReloader == nullptr)
+	{
+		mHotReloader = new HotReloader(this);
+		mHotReloader->Start();
+	}
+}
+
 void AppBase::LoadResourceManifest()
 {
 	if (!mResourceManager->ParseResourcesFile("properties/resources.xml"))
@@ -3306,6 +3250,30 @@ void AppBase::ParseCmdLine(const std::string &theCmdLine)
 	}
 }
 
+void AppBase::ParseCmdLine(int argc, char *argv[])
+{
+	std::string aCmdLine;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string anArg = argv[i];
+		if (anArg.find(' ') != std::string::npos)
+		{
+			size_t anEqualsPos = anArg.find('=');
+			if (anEqualsPos != std::string::npos)
+				anArg = anArg.substr(0, anEqualsPos + 1) + "\"" + anArg.substr(anEqualsPos + 1) + "\"";
+			else
+				anArg = "\"" + anArg + "\"";
+		}
+
+		if (!aCmdLine.empty())
+			aCmdLine += " ";
+		aCmdLine += anArg;
+	}
+
+	ParseCmdLine(aCmdLine);
+	mCmdLineParsed = true;
+}
+
 static int GetMaxDemoFileNum(const std::string &theDemoPrefix, int theMaxToKeep, bool doErase)
 {
 	typedef std::set<int> IntSet;
@@ -3342,6 +3310,127 @@ static int GetMaxDemoFileNum(const std::string &theDemoPrefix, int theMaxToKeep,
     return *aSet.rbegin(); // last (max) value
 }
 
+bool AppBase::InitDemo()
+{
+	if (mDemoFileName.empty())
+	{
+		// demo1.dmo, demo2.dmo... keeping the last 10 recordings
+		int aDemoNum = GetMaxDemoFileNum("demo", 10, mRecordingDemo);
+		if (mRecordingDemo)
+			aDemoNum++;
+		mDemoFileName = StrFormat("demo%d.dmo", aDemoNum);
+	}
+
+	if (mPlayingDemo)
+	{
+		mRecordingDemo = false;
+		if (!mDemoBuffer.Load(mDemoFileName))
+		{
+			SDL_Log("Unable to load demo %s\r\n", mDemoFileName.c_str());
+			return false;
+		}
+
+		mRandSeed = mDemoBuffer.mRandSeed;
+		mDemoLoaded = false;
+
+		if (mBenchmark)
+			FrameStats::SetHistorySize(1 << 16);
+	}
+	else
+	{
+		mDemoBuffer.StartRecording(mRandSeed);
+	}
+
+	return true;
+}
+
+void AppBase::ProcessDemo()
+{
+	while (mPlayingDemo && mDemoBuffer.HasRecord(mUpdateCount))
+	{
+		SDL_Event anEvent;
+		switch (mDemoBuffer.ReadRecord(&anEvent))
+		{
+		case DEMO_EVENT:
+			HandleSDLEvent(anEvent);
+			break;
+		case DEMO_LOADED:
+			// the recording finished loading here, so playback has to wait for it
+			WaitForLoadingThread();
+			mDemoLoaded = true;
+			break;
+		case DEMO_END:
+		case DEMO_NONE:
+			DemoPlaybackDone();
+			break;
+		}
+	}
+}
+
+void AppBase::ProcessDemoStep()
+{
+	// demos are replayed one update per step so recorded input lands on the update it was recorded on
+	uint64_t aStepStart = SDL_GetTicks();
+
+	DoUpdateFrames();
+	DoUpdateFramesF(1.0f);
+	ProcessSafeDeleteList();
+
+	mHasPendingDraw = true;
+	mNextDrawTick = 0;
+	DrawDirtyStuff();
+	mUpdateAppState = UPDATESTATE_PROCESS_DONE;
+
+	if (!mBenchmark)
+	{
+		int aTimeLeft = mFrameTime - (int)(SDL_GetTicks() - aStepStart);
+		if (aTimeLeft > 0)
+			SDL_Delay(aTimeLeft);
+	}
+}
+
+void AppBase::DemoPlaybackDone()
+{
+	mPlayingDemo = false;
+
+	if (mBenchmark)
+	{
+		WriteBenchmarkReport();
+		Shutdown();
+	}
+}
+
+void AppBase::WriteBenchmarkReport()
+{
+	double aSeconds = (SDL_GetTicksNS() - mBenchmarkStartNS) / 1000000000.0;
+
+	SDL_Log("Benchmark %s: %d updates, %d frames in %.3fs\r\n", mDemoFileName.c_str(), mUpdateCount,
+			FrameStats::GetFrameCount(), aSeconds);
+
+	static const FrameStat aTimeStats[] = {FRAMESTAT_UPDATE_TIME, FRAMESTAT_DRAW_TIME, FRAMESTAT_PRESENT_TIME};
+	for (FrameStat aStat : aTimeStats)
+	{
+		SDL_Log("  %-14s p50 %.3f  p95 %.3f  p99 %.3f\r\n", FrameStats::GetStatName(aStat),
+				FrameStats::GetPercentile(aStat, 50), FrameStats::GetPercentile(aStat, 95),
+				FrameStats::GetPercentile(aStat, 99));
+	}
+
+	if (mBenchmarkFileName.empty())
+		return;
+
+	nlohmann::json aReport;
+	aReport["demo"] = mDemoFileName;
+	aReport["seconds"] = aSeconds;
+	aReport["updates"] = mUpdateCount;
+	aReport["frames"] = FrameStats::GetFrameCount();
+	aReport["headless"] = mHeadless;
+	aReport["frame_stats"] = nlohmann::json::parse(FrameStats::GetJSON());
+
+	std::string aJSON = aReport.dump(4);
+	if (!WriteBytesToFile(mBenchmarkFileName, aJSON.c_str(), aJSON.length()))
+		SDL_Log("Unable to write benchmark report %s\r\n", mBenchmarkFileName.c_str());
+}
+
 void AppBase::HandleCmdLineParam(const std::string &theParamName, const std::string &theParamValue)
 {
 	if (theParamName == "-crash")
@@ -3358,6 +3447,48 @@ void AppBase::HandleCmdLineParam(const std::string &theParamName, const std::str
 	{
 		mChangeDirTo = theParamValue;
 	}
+	else if (theParamName == "-record")
+	{
+		mRecordingDemo = true;
+	}
+	else if (theParamName == "-play")
+	{
+		mPlayingDemo = true;
+	}
+	else if (theParamName == "-demofile")
+	{
+		mDemoFileName = theParamValue;
+	}
+	else if (theParamName == "-benchmark")
+	{
+		mPlayingDemo = true;
+		mBenchmark = true;
+		mBenchmarkFileName = theParamValue;
+	}
+	else if (theParamName == "-texturebudget")
+	{
+		mTextureBudgetMB = std::max(0, atoi(theParamValue.c_str()));
+	}
+	else if (theParamName == "-hotreload")
+	{
+		mHotReload = true;
+	}
+	else if (theParamName == "-software")
+	{
+		mSoftwareRender = true;
+	}
+	else if (theParamName == "-headless")
+	{
+		mHeadless = true;
+		mNoSoundNeeded = true;
+
+		// the window doesn't exist yet, so the video subsystem can still be restarted on another driver
+		SDL_QuitSubSystem(SDL_INIT_VIDEO);
+		SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+		SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+		if (!SDL_InitSubSystem(SDL_INIT_VIDEO))
+			SDL_Log("Headless video init failed: %s\r\n", SDL_GetError());
+	}
 	else
 	{
 		Popup(GetString("INVALID_COMMANDLINE_PARAM", "Invalid command line parameter: ") + theParamName);
@@ -3401,6 +3532,7 @@ void AppBase::InitHook()
 void AppBase::Init()
 {
 	mPrimaryThreadId = SDL_GetCurrentThreadID();
+	Perf::SetThreadName("Main");
 	mErrorHandler = new ErrorHandler(this);
 
 	if (mShutdown)
@@ -3425,6 +3557,12 @@ void AppBase::Init()
 	mMutex = new std::mutex();
 
 	mRandSeed = SDL_GetTicks();
+	if ((mRecordingDemo || mPlayingDemo) && !InitDemo())
+	{
+		mRecordingDemo = false;
+		mPlayingDemo = false;
+		mBenchmark = false;
+	}
 	SRand(mRandSeed);
 
 	srand(SDL_GetTicks());
@@ -3438,7 +3576,7 @@ void AppBase::Init()
 	mWidgetManager->Resize(Rect(0, 0, mWidth, mHeight), Rect(0, 0, mWidth, mHeight));
 
 	// Check to see if we CAN run windowed or not...
-	if (mIsWindowed && !mFullScreenWindow)
+	if (mIsWindowed && !mFullScreenWindow && !mHeadless)
 	{
 		// How can we be windowed if our screen isn't even big enough?
 		SDL_DisplayID displayID = SDL_GetPrimaryDisplay();
@@ -3469,6 +3607,9 @@ void AppBase::Init()
 		SetCursor(CURSOR_NONE);
 	}
 
+	if (mHotReload)
+		SetHotReload(true);
+
 	InitHook();
 
 	mInitialized = true;
@@ -3548,6 +3689,7 @@ PopLib::SDLImage *AppBase::GetImage(const std::string &theFileName, bool commitB
 	SDLImage *anImage = new SDLImage(mSDLInterface);
 	anImage->mFilePath = theFileName;
 	anImage->SetBits((uint32_t*)aLoadedImage->GetBits(), aLoadedImage->GetWidth(), aLoadedImage->GetHeight(), commitBits);
+	anImage->mFileBitsChangedCount = anImage->mBitsChangedCount;
 	delete aLoadedImage;
 
 	return anImage;
@@ -4141,6 +4283,9 @@ void AppBase::RemoveMemoryImage(MemoryImage *theMemoryImage)
 	if (anItr != mMemoryImageSet.end())
 		mMemoryImageSet.erase(anItr);
 
+	if (mSDLInterface != nullptr)
+		mSDLInterface->RemoveCursorImage(theMemoryImage);
+
 	Remove3DData(theMemoryImage);
 }
 
@@ -4204,29 +4349,61 @@ void AppBase::Set3DAcclerated(bool is3D, bool reinit)
 
 SharedImageRef AppBase::GetSharedImage(const std::string &theFileName, const std::string &theVariant, bool *isNew)
 {
-	std::string anUpperFileName = StringToUpper(theFileName);
-	std::string anUpperVariant = StringToUpper(theVariant);
+	// images that are already loaded are found without locking or allocating
+	SharedImage *aSharedImage = mSharedImageIndex.Find(theFileName, theVariant);
+	if (aSharedImage != nullptr && aSharedImage->TryAddRef())
+	{
+		SharedImageRef aSharedImageRef(aSharedImage);
+		aSharedImage->mRefCount--;
+
+		if (isNew != nullptr)
+			*isNew = false;
+
+		return aSharedImageRef;
+	}
 
-	std::pair<SharedImageMap::iterator, bool> aResultPair;
+	bool aNew;
 	SharedImageRef aSharedImageRef;
 
 	{
 		AutoCrit anAutoCrit(mSDLInterface->mCritSect);
-		aResultPair = mSharedImageMap.insert(
-			SharedImageMap::value_type(SharedImageMap::key_type(anUpperFileName, anUpperVariant), SharedImage()));
-		aSharedImageRef = &aResultPair.first->second;
+
+		std::string anUpperFileName = StringToUpper(theFileName);
+		std::string anUpperVariant = StringToUpper(theVariant);
+
+		auto aResultPair = mSharedImageMap.try_emplace(SharedImageMap::key_type(anUpperFileName, anUpperVariant));
+		aSharedImage = &aResultPair.first->second;
+		aNew = aResultPair.second;
+
+		if (aNew)
+		{
+			aSharedImage->mFileName = anUpperFileName;
+			aSharedImage->mVariant = anUpperVariant;
+			aSharedImage->mHash = SharedImageIndex::Hash(anUpperFileName, anUpperVariant);
+			mSharedImageIndex.Add(aSharedImage);
+		}
+		else if (aSharedImage->mRefCount < 0)
+		{
+			// freed by CleanSharedImages, load it again
+			aSharedImage->mRefCount = 0;
+			aNew = true;
+		}
+
+		aSharedImageRef = aSharedImage;
 	}
 
 	if (isNew != nullptr)
-		*isNew = aResultPair.second;
+		*isNew = aNew;
 
-	if (aResultPair.second)
+	if (aNew)
 	{
 		// Pass in a '!' as the first char of the file name to create a new image
 		if ((theFileName.length() > 0) && (theFileName[0] == '!'))
 			aSharedImageRef.mSharedImage->mImage = new SDLImage(mSDLInterface);
 		else
 			aSharedImageRef.mSharedImage->mImage = GetImage(theFileName, false);
+
+		mSharedImageGeneration++;
 	}
 
 	return aSharedImageRef;
@@ -4243,17 +4420,18 @@ void AppBase::CleanSharedImages()
 		//  through the SharedImageRef returned by GetSharedImage, but also by calling GetSharedImage
 		//  again with the same params -- so we can have instances where we do the 'final' deref on
 		//  an image but immediately re-request it via GetSharedImage
-		SharedImageMap::iterator aSharedImageItr = mSharedImageMap.begin();
-		while (aSharedImageItr != mSharedImageMap.end())
+		// The entries themselves stay, mSharedImageIndex may be read at the same time. Marking the
+		//  refcount -1 makes TryAddRef fail, so nobody can grab the image while it's deleted
+		for (SharedImageMap::iterator anItr = mSharedImageMap.begin(); anItr != mSharedImageMap.end(); ++anItr)
 		{
-			SharedImage *aSharedImage = &aSharedImageItr->second;
-			if (aSharedImage->mRefCount == 0)
+			SharedImage *aSharedImage = &anItr->second;
+			int aRefCount = 0;
+			if (aSharedImage->mRefCount.compare_exchange_strong(aRefCount, -1))
 			{
 				delete aSharedImage->mImage;
-				mSharedImageMap.erase(aSharedImageItr++);
+				aSharedImage->mImage = nullptr;
+				mSharedImageGeneration++;
 			}
-			else
-				++aSharedImageItr;
 		}
 
 		mCleanupSharedImages = false;
@@ -10,10 +10,12 @@
 #include "widget/buttonlistener.hpp"
 #include "widget/dialoglistener.hpp"
 #include "misc/buffer.hpp"
+#include "misc/demobuffer.hpp"
 #include "misc/critsect.hpp"
 #include "graphics/sharedimage.hpp"
 #include "math/ratio.hpp"
 #include <mutex>
+#include <atomic>
 
 #include <SDL3/SDL.h>
 #include <SDL3_ttf/SDL_ttf.h>
@@ -55,6 +57,9 @@ class ImGuiManager;
 class Dialog;
 
 class ResourceManager;
+class RegistryStore;
+class HotReloader;
+class AsyncIO;
 
 class WidgetSafeDeleteInfo
 {
@@ -247,6 +252,10 @@ class AppBase : public ButtonListener, public DialogListener
 	MusicInterface *mMusicInterface;
 	/// @brief TBA
 	bool mReadFromRegistry;
+	/// @brief (RegistryStore) in-memory registry, flushed in the background
+	RegistryStore *mRegistry;
+	/// @brief save the registry as registry.bin (CBOR) instead of registry.json
+	bool mBinaryRegistry;
 	/// @brief TBA
 	std::string mRegisterLink;
 	/// @brief the game(product) version
@@ -283,8 +292,12 @@ class AppBase : public ButtonListener, public DialogListener
 	MemoryImageSet mMemoryImageSet;
 	/// @brief TBA
 	SharedImageMap mSharedImageMap;
+	/// @brief lock free lookup into mSharedImageMap
+	SharedImageIndex mSharedImageIndex;
 	/// @brief TBA
 	bool mCleanupSharedImages;
+	/// @brief bumped whenever a shared image is loaded or freed
+	std::atomic<uint32_t> mSharedImageGeneration;
 
 	/// @brief TBA
 	int mNonDrawCount;
@@ -335,6 +348,35 @@ class AppBase : public ButtonListener, public DialogListener
 	/// @brief current step mode. 0 = off, 1 = step, 2 = waiting for step
 	int mStepMode;
 
+	/// @brief the demo being recorded or played back
+	DemoBuffer mDemoBuffer;
+	/// @brief the demo file, picked automatically if empty
+	std::string mDemoFileName;
+	/// @brief true if recording input into mDemoBuffer
+	bool mRecordingDemo;
+	/// @brief true if replaying input from mDemoBuffer
+	bool mPlayingDemo;
+	/// @brief true once playback reached the update the recording finished loading on
+	bool mDemoLoaded;
+	/// @brief true if running on SDL's offscreen video driver with the software renderer
+	bool mHeadless;
+	/// @brief true if the demo is replayed as fast as possible and frame statistics are reported
+	bool mBenchmark;
+	/// @brief where the benchmark report is written, log only if empty
+	std::string mBenchmarkFileName;
+	/// @brief when benchmark playback started
+	uint64_t mBenchmarkStartNS;
+	/// @brief texture memory in MB the SDLInterface tries to stay under, 0 for no limit
+	int mTextureBudgetMB;
+	/// @brief true if files should be reloaded when they change, set with -hotreload
+	bool mHotReload;
+	/// @brief true if the screen is drawn on the CPU by a SWInterface, set with -software
+	bool mSoftwareRender;
+	/// @brief watches loaded files while mHotReload is set
+	HotReloader *mHotReloader;
+	/// @brief loads files in the background, its callbacks run between frames
+	AsyncIO *mAsyncIO;
+
 	/// @brief cursor number
 	int mCursorNum;
 	/// @brief (SoundManager) app sound manager
@@ -389,8 +431,6 @@ class AppBase : public ButtonListener, public DialogListener
 	bool mYieldMainThread;
 	/// @brief true if loading failed
 	bool mLoadingFailed;
-	/// @brief true if cursor thread running
-	bool mCursorThreadRunning;
 	/// @brief true if has system cursor
 	bool mSysCursor;
 	/// @brief true if custom cursors are enabled
@@ -462,6 +502,8 @@ class AppBase : public ButtonListener, public DialogListener
 	StringDoubleMap mDoubleProperties;
 	/// @brief TBA
 	StringStringVectorMap mStringVectorProperties;
+	/// @brief files LoadProperties read without a signature check, in load order
+	StringVector mPropertiesFiles;
 	/// @brief (ResourceManager) the app resource manager
 	ResourceManager *mResourceManager;
 
@@ -479,6 +521,20 @@ class AppBase : public ButtonListener, public DialogListener
 	/// @param singleMessage 
 	/// @return true if success
 	bool ProcessDeferredMessages(bool singleMessage);
+	/// @brief dispatches a single SDL event, used for both live and replayed input
+	/// @param theEvent 
+	void HandleSDLEvent(const SDL_Event &theEvent);
+	/// @brief replays the demo records due on the current update
+	void ProcessDemo();
+	/// @brief runs one fixed update and draw, used while playing a demo
+	void ProcessDemoStep();
+	/// @brief opens the demo file for recording or playback
+	/// @return true if success
+	bool InitDemo();
+	/// @brief called when demo playback reaches the end of the recording
+	virtual void DemoPlaybackDone();
+	/// @brief logs the benchmark results and writes them to mBenchmarkFileName
+	void WriteBenchmarkReport();
 	/// @brief TBA
 	void UpdateFTimeAcc();
 	/// @brief process
@@ -511,15 +567,6 @@ class AppBase : public ButtonListener, public DialogListener
 	/// @brief stub for loading thread
 	static int LoadingThreadProcStub(void *theArg);
 
-	// Cursor thread methods
-
-	/// @brief TBA
-	void CursorThreadProc();
-	/// @brief stub for cursor thread
-	static int CursorThreadProcStub(void *theArg);
-	/// @brief TBA
-	void StartCursorThread();
-
 	/// @brief TBA
 	void WaitForLoadingThread();
 	/// @brief TBA
@@ -562,6 +609,9 @@ class AppBase : public ButtonListener, public DialogListener
 	/// @param theLength 
 	/// @return true if success
 	bool RegistryWrite(const std::string &theValueName, JSON_RTYPE theType, const uchar *theValue, ulong theLength);
+	/// @brief gets the registry store of mRegKey
+	/// @return RegistryStore
+	RegistryStore *GetRegistry();
 
   public:
 	/// @brief constructor
@@ -655,6 +705,10 @@ class AppBase : public ButtonListener, public DialogListener
 	/// @brief parses an command line argument
 	/// @param theCmdLine 
 	virtual void ParseCmdLine(const std::string &theCmdLine);
+	/// @brief parses the arguments given to main, call before Init
+	/// @param argc 
+	/// @param argv 
+	void ParseCmdLine(int argc, char *argv[]);
 	/// @brief TBA
 	/// @param theParamName 
 	/// @param theParamValue 
@@ -971,6 +1025,9 @@ class AppBase : public ButtonListener, public DialogListener
 	/// @brief loads properties
 	/// @return true if success
 	bool LoadProperties();
+	/// @brief starts or stops reloading images, sounds, fonts, properties and M() values when their files change
+	/// @param enable
+	void SetHotReload(bool enable);
 	/// @brief initalize properties hook
 	virtual void InitPropertiesHook();
 
@@ -1,6 +1,7 @@
 #include "bassmusicinterface.hpp"
 #include "bass.h"
 #include "paklib/pakinterface.hpp"
+#include "misc/mappedfile.hpp"
 
 using namespace PopLib;
 
@@ -52,7 +53,7 @@ BassMusicInfo::BassMusicInfo()
 	mVolumeCap = 1.0;
 	mStopOnFade = false;
 	mHMusic = NULL;
-	mStream = {NULL, NULL};
+	mStream = {nullptr, NULL};
 }
 
 BassMusicInterface::BassMusicInterface()
@@ -80,34 +81,34 @@ bool BassMusicInterface::LoadMusic(int theSongId, const std::string &theFileName
 	if (aDotPos != std::string::npos)
 		anExt = StringToLower(theFileName.substr(aDotPos + 1));
 
-	PFILE *aFP = p_fopen(theFileName.c_str(), "rb");
-	if (!aFP)
+	MappedFile *aFile = new MappedFile();
+	if (!aFile->Open(theFileName))
+	{
+		delete aFile;
 		return false;
-
-	p_fseek(aFP, 0, SEEK_END);
-	int aSize = p_ftell(aFP);
-	p_fseek(aFP, 0, SEEK_SET);
-
-	uchar *aData = new uchar[aSize];
-	p_fread(aData, 1, aSize, aFP);
-	p_fclose(aFP);
+	}
 
 	if (anExt == "wav" || anExt == "ogg" || anExt == "mp3")
-		aStream = BASS_StreamCreateFile(TRUE, aData, 0, aSize, BASS_SAMPLE_LOOP);
+		aStream = BASS_StreamCreateFile(TRUE, aFile->GetData(), 0, aFile->GetSize(), BASS_SAMPLE_LOOP);
 	else
 	{
-		aHMusic = BASS_MusicLoad(TRUE, aData, 0, aSize, BASS_MUSIC_LOOP | BASS_MUSIC_RAMP, 0);
-		delete[] aData;
+		// bass keeps its own copy of modules
+		aHMusic = BASS_MusicLoad(TRUE, aFile->GetData(), 0, aFile->GetSize(), BASS_MUSIC_LOOP | BASS_MUSIC_RAMP, 0);
+		delete aFile;
+		aFile = nullptr;
 	}
 
 	int anErrCode = BASS_ErrorGetCode();
 	if ((!aHMusic && !aStream )|| anErrCode != BASS_OK)
+	{
+		delete aFile;
 		return false;
+	}
 
 	BassMusicInfo aMusicInfo;
 	aMusicInfo.mHMusic = aHMusic;
 	aMusicInfo.mStream.mHStream = aStream;
-	aMusicInfo.mStream.mStreamData = aData;
+	aMusicInfo.mStream.mStreamFile = aFile;
 	mMusicMap.insert(BassMusicMap::value_type(theSongId, aMusicInfo));
 
 	return true;
@@ -173,7 +174,10 @@ void BassMusicInterface::UnloadMusic(int theSongId)
 	{
 		BassMusicInfo *aMusicInfo = &anItr->second;
 		if (aMusicInfo->mStream.mHStream)
+		{
 			BASS_StreamFree(aMusicInfo->mStream.mHStream);
+			delete aMusicInfo->mStream.mStreamFile;
+		}
 		else if (aMusicInfo->mHMusic)
 			BASS_MusicFree(aMusicInfo->mHMusic);
 
@@ -190,7 +194,7 @@ void BassMusicInterface::UnloadAllMusic()
 		if (aMusicInfo->mStream.mHStream)
 		{
 			BASS_StreamFree(aMusicInfo->mStream.mHStream);
-			delete[] aMusicInfo->mStream.mStreamData;
+			delete aMusicInfo->mStream.mStreamFile;
 		}
 		else if (aMusicInfo->mHMusic)
 			BASS_MusicFree(aMusicInfo->mHMusic);
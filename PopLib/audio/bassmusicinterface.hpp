@@ -11,11 +11,12 @@ namespace PopLib
 {
 
 class AppBase;
+class MappedFile;
 
 struct StreamData
 {
-	/// @brief data that is streamed to mHStream
-	uchar* mStreamData;
+	/// @brief file that is streamed to mHStream, bass reads it for as long as the stream plays
+	MappedFile *mStreamFile;
 	/// @brief stream object
 	HSTREAM mHStream;
 };
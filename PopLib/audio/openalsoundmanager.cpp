@@ -1,6 +1,7 @@
 ﻿#include "openalsoundmanager.hpp"
 #include "openalsoundinstance.hpp"
 #include "paklib/pakinterface.hpp"
+#include "misc/mappedfile.hpp"
 #include "common.hpp"
 #include "aureader.hpp"
 
@@ -158,26 +159,17 @@ bool OpenALSoundManager::LoadSound(unsigned int theSfxID, const std::string &the
 
 	for (std::string aExt : aFileExtensions)
 	{
-		PFILE *fp = p_fopen((theFilename + aExt).c_str(), "rb");
-		if (!fp)
+		// decoded straight from the pak or the mapped file
+		MappedFile aFile;
+		if (!aFile.Open(theFilename + aExt))
 			continue;
 
-		p_fseek(fp, 0, SEEK_END);
-		size_t fileSize = p_ftell(fp);
-		p_fseek(fp, 0, SEEK_SET);
-		uint8_t *data = new uint8_t[fileSize];
-		p_fread(data, 1, fileSize, fp);
-		p_fclose(fp);
-
-		mSourceDataSizes[theSfxID] = fileSize;
+		mSourceDataSizes[theSfxID] = aFile.GetSize();
 
 		ma_decoder decoder;
-		ma_result result = ma_decoder_init_memory(data, fileSize, NULL, &decoder);
+		ma_result result = ma_decoder_init_memory(aFile.GetData(), aFile.GetSize(), NULL, &decoder);
 		if (result != MA_SUCCESS)
-		{
-			delete[] data;
 			continue;
-		}
 
 		const size_t bufferSize = 1024 * 1024;
 		std::vector<float> pcmData(bufferSize);
@@ -185,7 +177,6 @@ bool OpenALSoundManager::LoadSound(unsigned int theSfxID, const std::string &the
 		ma_result decoder_result = ma_decoder_read_pcm_frames(&decoder, pcmData.data(), pcmData.size(), NULL);
 		if (decoder_result != MA_SUCCESS)
 		{
-			delete[] data;
 			ma_decoder_uninit(&decoder);
 			continue;
 		}
@@ -196,7 +187,6 @@ bool OpenALSoundManager::LoadSound(unsigned int theSfxID, const std::string &the
 
 		mSourceSounds[theSfxID] = buffer;
 
-		delete[] data;
 		ma_decoder_uninit(&decoder);
 		return true;
 	}
@@ -316,23 +306,13 @@ bool OpenALSoundManager::LoadOGGSound(unsigned int theSfxID, const std::string &
 
 bool OpenALSoundManager::LoadAUSound(unsigned int theSfxID, const std::string &theFilename)
 {
-	PFILE *fp = p_fopen(theFilename.c_str(), "rb");
-	if (!fp)
+	MappedFile aFile;
+	if (!aFile.Open(theFilename))
 		return false;
 
-	p_fseek(fp, 0, SEEK_END);
-	size_t fileSize = p_ftell(fp);
-	p_fseek(fp, 0, SEEK_SET);
-	uint8_t *data = new uint8_t[fileSize];
-	p_fread(data, 1, fileSize, fp);
-	p_fclose(fp);
-
 	AuFile aAUFile;
-	if (!LoadAU(data, fileSize, aAUFile))
-	{
-		delete[] data;
+	if (!LoadAU(aFile.GetData(), aFile.GetSize(), aAUFile))
 		return false;
-	}
 
 	mSourceDataSizes[theSfxID] = aAUFile.mSamples.size();
 
@@ -345,8 +325,6 @@ bool OpenALSoundManager::LoadAUSound(unsigned int theSfxID, const std::string &t
 
 	mSourceSounds[theSfxID] = buffer;
 
-	delete[] data;
-
 	return true;
 }
 
@@ -396,6 +374,42 @@ int OpenALSoundManager::GetNumSounds()
 	return aCount;
 }
 
+int OpenALSoundManager::GetNumPlayingSounds()
+{
+	int aCount = 0;
+	for (int i = 0; i < MAX_CHANNELS; i++)
+	{
+		if (mPlayingSounds[i] != NULL && mPlayingSounds[i]->IsPlaying())
+			aCount++;
+	}
+
+	return aCount;
+}
+
+int64_t OpenALSoundManager::GetSoundSize(unsigned int theSfxID)
+{
+	if ((theSfxID < 0) || (theSfxID >= MAX_SOURCE_SOUNDS) || !mSourceSounds[theSfxID])
+		return 0;
+
+	ALint aSize = 0;
+	alGetBufferi(mSourceSounds[theSfxID], AL_SIZE, &aSize);
+	return aSize;
+}
+
+bool OpenALSoundManager::IsSoundInUse(unsigned int theSfxID)
+{
+	if ((theSfxID < 0) || (theSfxID >= MAX_SOURCE_SOUNDS) || !mSourceSounds[theSfxID])
+		return false;
+
+	for (int i = 0; i < MAX_CHANNELS; i++)
+	{
+		if (mPlayingSounds[i] != NULL && mPlayingSounds[i]->mSourceSoundBuffer == mSourceSounds[theSfxID])
+			return true;
+	}
+
+	return false;
+}
+
 void OpenALSoundManager::ForceReleaseSources(ALuint theBuffer)
 {
 	for (int i = 0; i < MAX_CHANNELS; i++)
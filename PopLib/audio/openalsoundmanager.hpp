@@ -66,6 +66,9 @@ class OpenALSoundManager : public SoundManager
 	virtual void StopAllSounds();
 	virtual int GetFreeSoundId();
 	virtual int GetNumSounds();
+	virtual int GetNumPlayingSounds();
+	virtual int64_t GetSoundSize(unsigned int theSfxID);
+	virtual bool IsSoundInUse(unsigned int theSfxID);
 	virtual void ForceReleaseSources(ALuint theBuffer);
 };
 
@@ -42,6 +42,12 @@ class SoundManager
 	virtual void StopAllSounds() = 0;
 	virtual int GetFreeSoundId() = 0;
 	virtual int GetNumSounds() = 0;
+	virtual int GetNumPlayingSounds() = 0;
+
+	/// @brief bytes of decoded sound data held for a sound
+	virtual int64_t GetSoundSize(unsigned int theSfxID) = 0;
+	/// @brief does a sound instance made from this sound still exist?
+	virtual bool IsSoundInUse(unsigned int theSfxID) = 0;
 };
 
 } // namespace PopLib
@@ -30,9 +30,11 @@
 #endif
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <set>
 #include <map>
+#include <unordered_map>
 #include <list>
 #include <algorithm>
 #include <cstdlib>
@@ -306,6 +308,17 @@ struct StringLessNoCase
 	}
 };
 
+// lets unordered maps keyed on std::string be searched with a string_view or const char *
+struct StringHash
+{
+	using is_transparent = void;
+
+	size_t operator()(std::string_view theString) const
+	{
+		return std::hash<std::string_view>()(theString);
+	}
+};
+
 } // namespace PopLib
 
 #endif
\ No newline at end of file
@@ -0,0 +1,256 @@
+#include "framestats.hpp"
+#include <json.hpp>
+
+using namespace PopLib;
+
+static const char *gFrameStatNames[NUM_FRAMESTATS] = {
+	"Update (ms)", "Draw (ms)", "Present (ms)", "Draw Calls", "Texture Uploads (bytes)", "Texture Memory (bytes)",
+	"Textures Evicted", "Widgets Drawn", "Sounds Playing"};
+
+static const char *gFrameStatKeys[NUM_FRAMESTATS] = {"update_ms",		 "draw_ms",		   "present_ms",
+													  "draw_calls",		 "texture_upload",   "texture_memory",
+													  "textures_evicted", "widgets_drawn", "sounds_playing"};
+
+static double gFrameCurrent[NUM_FRAMESTATS];
+static std::vector<float> gFrameHistory[NUM_FRAMESTATS];
+static std::vector<int> gFrameScreens;
+static int gFrameHistorySize = 0;
+static int gFrameHistoryPos = 0;
+static int gFrameHistoryCount = 0;
+
+static std::vector<std::string> gFrameScreenNames;
+static int gFrameScreenIndex = -1;
+
+static int GetScreenIndex(const std::string &theScreenName)
+{
+	for (int i = 0; i < (int)gFrameScreenNames.size(); i++)
+		if (gFrameScreenNames[i] == theScreenName)
+			return i;
+
+	gFrameScreenNames.push_back(theScreenName);
+	return (int)gFrameScreenNames.size() - 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void FrameStats::SetHistorySize(int theFrameCount)
+{
+	gFrameHistorySize = std::max(theFrameCount, 1);
+	for (int i = 0; i < NUM_FRAMESTATS; i++)
+		gFrameHistory[i].assign(gFrameHistorySize, 0.0f);
+	gFrameScreens.assign(gFrameHistorySize, 0);
+
+	gFrameHistoryPos = 0;
+	gFrameHistoryCount = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+int FrameStats::GetHistorySize()
+{
+	if (gFrameHistorySize == 0)
+		SetHistorySize(DEFAULT_HISTORY_SIZE);
+
+	return gFrameHistorySize;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void FrameStats::Add(FrameStat theStat, double theValue)
+{
+	gFrameCurrent[theStat] += theValue;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void FrameStats::Set(FrameStat theStat, double theValue)
+{
+	gFrameCurrent[theStat] = theValue;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void FrameStats::EndFrame()
+{
+	if (gFrameScreenIndex < 0)
+		gFrameScreenIndex = GetScreenIndex("");
+
+	int aHistorySize = GetHistorySize();
+	for (int i = 0; i < NUM_FRAMESTATS; i++)
+	{
+		gFrameHistory[i][gFrameHistoryPos] = (float)gFrameCurrent[i];
+		gFrameCurrent[i] = 0;
+	}
+	gFrameScreens[gFrameHistoryPos] = gFrameScreenIndex;
+
+	gFrameHistoryPos = (gFrameHistoryPos + 1) % aHistorySize;
+	if (gFrameHistoryCount < aHistorySize)
+		gFrameHistoryCount++;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void FrameStats::SetScreenName(const std::string &theScreenName)
+{
+	gFrameScreenIndex = GetScreenIndex(theScreenName);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+const std::string &FrameStats::GetScreenName()
+{
+	if (gFrameScreenIndex < 0)
+		gFrameScreenIndex = GetScreenIndex("");
+
+	return gFrameScreenNames[gFrameScreenIndex];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+const char *FrameStats::GetStatName(FrameStat theStat)
+{
+	return gFrameStatNames[theStat];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+int FrameStats::GetFrameCount()
+{
+	return gFrameHistoryCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+double FrameStats::GetLast(FrameStat theStat)
+{
+	if (gFrameHistoryCount == 0)
+		return 0;
+
+	return gFrameHistory[theStat][(gFrameHistoryPos + gFrameHistorySize - 1) % gFrameHistorySize];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+double FrameStats::GetPercentile(FrameStat theStat, double thePercentile, const std::string *theScreenName)
+{
+	int aScreenIndex = -1;
+	if (theScreenName != nullptr)
+	{
+		for (int i = 0; i < (int)gFrameScreenNames.size(); i++)
+			if (gFrameScreenNames[i] == *theScreenName)
+				aScreenIndex = i;
+
+		if (aScreenIndex < 0)
+			return 0;
+	}
+
+	static std::vector<float> aValues;
+	aValues.clear();
+	for (int i = 0; i < gFrameHistoryCount; i++)
+	{
+		if (aScreenIndex < 0 || gFrameScreens[i] == aScreenIndex)
+			aValues.push_back(gFrameHistory[theStat][i]);
+	}
+
+	if (aValues.empty())
+		return 0;
+
+	int anIndex = (int)(thePercentile / 100.0 * (aValues.size() - 1) + 0.5);
+	anIndex = std::max(0, std::min(anIndex, (int)aValues.size() - 1));
+	std::nth_element(aValues.begin(), aValues.begin() + anIndex, aValues.end());
+	return aValues[anIndex];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+const float *FrameStats::GetHistory(FrameStat theStat, int *theCount, int *theOffset)
+{
+	int aHistorySize = GetHistorySize();
+	*theCount = gFrameHistoryCount;
+	*theOffset = gFrameHistoryCount < aHistorySize ? 0 : gFrameHistoryPos;
+	return gFrameHistory[theStat].data();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+std::string FrameStats::GetCSV()
+{
+	std::string aResult = "frame,screen";
+	for (int aStat = 0; aStat < NUM_FRAMESTATS; aStat++)
+		aResult += StrFormat(",%s", gFrameStatKeys[aStat]);
+	aResult += "\n";
+
+	int aHistorySize = GetHistorySize();
+	int anOldest = gFrameHistoryCount < aHistorySize ? 0 : gFrameHistoryPos;
+	for (int i = 0; i < gFrameHistoryCount; i++)
+	{
+		int anIndex = (anOldest + i) % aHistorySize;
+		aResult += StrFormat("%d,%s", i, gFrameScreenNames[gFrameScreens[anIndex]].c_str());
+		for (int aStat = 0; aStat < NUM_FRAMESTATS; aStat++)
+			aResult += StrFormat(",%g", gFrameHistory[aStat][anIndex]);
+		aResult += "\n";
+	}
+
+	return aResult;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+std::string FrameStats::GetJSON()
+{
+	nlohmann::json aScreens = nlohmann::json::object();
+
+	for (int aScreen = 0; aScreen < (int)gFrameScreenNames.size(); aScreen++)
+	{
+		const std::string &aName = gFrameScreenNames[aScreen];
+
+		int aFrameCount = 0;
+		for (int i = 0; i < gFrameHistoryCount; i++)
+			if (gFrameScreens[i] == aScreen)
+				aFrameCount++;
+
+		if (aFrameCount == 0)
+			continue;
+
+		nlohmann::json aStats = nlohmann::json::object();
+		for (int aStat = 0; aStat < NUM_FRAMESTATS; aStat++)
+		{
+			aStats[gFrameStatKeys[aStat]] = {{"p50", GetPercentile((FrameStat)aStat, 50, &aName)},
+											 {"p95", GetPercentile((FrameStat)aStat, 95, &aName)},
+											 {"p99", GetPercentile((FrameStat)aStat, 99, &aName)}};
+		}
+
+		aScreens[aName.empty() ? "default" : aName] = {{"frames", aFrameCount}, {"stats", aStats}};
+	}
+
+	nlohmann::json aRoot;
+	aRoot["screens"] = aScreens;
+	return aRoot.dump(4);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+static bool WriteStringToFile(const std::string &theFileName, const std::string &theString)
+{
+	FILE *aFile = fopen(theFileName.c_str(), "wb");
+	if (aFile == nullptr)
+		return false;
+
+	bool success = fwrite(theString.data(), 1, theString.size(), aFile) == theString.size();
+	fclose(aFile);
+	return success;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool FrameStats::WriteCSV(const std::string &theFileName)
+{
+	return WriteStringToFile(theFileName, GetCSV());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool FrameStats::WriteJSON(const std::string &theFileName)
+{
+	return WriteStringToFile(theFileName, GetJSON());
+}
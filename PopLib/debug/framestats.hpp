@@ -0,0 +1,110 @@
+#ifndef __FRAMESTATS_HPP__
+#define __FRAMESTATS_HPP__
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "common.hpp"
+
+namespace PopLib
+{
+
+/**
+ * @brief the per-frame metrics tracked by FrameStats
+ */
+enum FrameStat
+{
+	FRAMESTAT_UPDATE_TIME,			///< ms spent in UpdateFrames since the last drawn frame
+	FRAMESTAT_DRAW_TIME,			///< ms spent drawing widgets
+	FRAMESTAT_PRESENT_TIME,			///< ms spent in SDLInterface::Redraw
+	FRAMESTAT_DRAW_CALLS,			///< SDL render calls issued
+	FRAMESTAT_TEXTURE_UPLOAD_BYTES, ///< bytes passed to SDL_UpdateTexture
+	FRAMESTAT_TEXTURE_MEMORY,		///< bytes held by all SDLTextureData
+	FRAMESTAT_TEXTURES_EVICTED,		///< textures released to stay under the texture budget
+	FRAMESTAT_WIDGETS_DRAWN,		///< widgets whose Draw was called
+	FRAMESTAT_SOUNDS_PLAYING,		///< sound instances currently playing
+	NUM_FRAMESTATS
+};
+
+/**
+ * @brief rolling per-frame metrics
+ *
+ * counters are accumulated with Add/Set on the main thread and committed
+ * into a fixed-size history by EndFrame, which AppBase calls once per
+ * presented frame. every frame is tagged with the current screen name so
+ * budgets can be checked per screen.
+ */
+class FrameStats
+{
+  public:
+	/// @brief number of frames kept in the history by default
+	static const int DEFAULT_HISTORY_SIZE = 600;
+
+	/// @brief resizes the history, clearing it
+	/// @param theFrameCount
+	static void SetHistorySize(int theFrameCount);
+	/// @brief gets the capacity of the history
+	/// @return int
+	static int GetHistorySize();
+
+	/// @brief adds to a counter for the current frame
+	/// @param theStat
+	/// @param theValue
+	static void Add(FrameStat theStat, double theValue = 1.0);
+	/// @brief sets a gauge for the current frame
+	/// @param theStat
+	/// @param theValue
+	static void Set(FrameStat theStat, double theValue);
+	/// @brief commits the current frame into the history and resets the counters
+	static void EndFrame();
+
+	/// @brief tags the following frames with a screen name
+	/// @param theScreenName
+	static void SetScreenName(const std::string &theScreenName);
+	/// @brief gets the current screen name
+	/// @return string
+	static const std::string &GetScreenName();
+
+	/// @brief gets the display name of a stat
+	/// @param theStat
+	/// @return name
+	static const char *GetStatName(FrameStat theStat);
+	/// @brief gets the number of frames in the history
+	/// @return int
+	static int GetFrameCount();
+	/// @brief gets the value of the last committed frame
+	/// @param theStat
+	/// @return double
+	static double GetLast(FrameStat theStat);
+	/// @brief gets a percentile over the history
+	/// @param theStat
+	/// @param thePercentile 0 to 100
+	/// @param theScreenName only count frames of this screen, nullptr for all
+	/// @return double
+	static double GetPercentile(FrameStat theStat, double thePercentile, const std::string *theScreenName = nullptr);
+	/// @brief gets the history ring of a stat, for ImGui::PlotLines
+	/// @param theStat
+	/// @param theCount number of valid values
+	/// @param theOffset index of the oldest value
+	/// @return pointer to GetHistorySize() floats
+	static const float *GetHistory(FrameStat theStat, int *theCount, int *theOffset);
+
+	/// @brief gets the history as CSV, one row per frame
+	/// @return string
+	static std::string GetCSV();
+	/// @brief gets p50/p95/p99 per screen as JSON
+	/// @return string
+	static std::string GetJSON();
+	/// @brief writes GetCSV to a file
+	/// @param theFileName
+	/// @return true if success
+	static bool WriteCSV(const std::string &theFileName);
+	/// @brief writes GetJSON to a file
+	/// @param theFileName
+	/// @return true if success
+	static bool WriteJSON(const std::string &theFileName);
+};
+
+} // namespace PopLib
+
+#endif
@@ -1,4 +1,6 @@
 #include "perftimer.hpp"
+#include "misc/autocrit.hpp"
+#include <json.hpp>
 #include <map>
 #include <SDL3/SDL.h>
 
@@ -75,20 +77,79 @@ int PerfTimer::GetCPUSpeedMHz()
 	return (int)(gCPUSpeed / 1000000);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// Every thread that records a zone gets its own PerfThreadBuffer. Only the
+// owning thread writes to it, so recording is a plain store plus a release of
+// the write index. Readers copy entries out and then discard anything the
+// writer may have lapped while they were copying. Buffers of threads that
+// exited are handed to new threads once the session they recorded is over.
+static const int PERF_RING_SIZE = 16384; // must be a power of two
+static const int PERF_MAX_DEPTH = 64;
+static const int PERF_FRAME_RING_SIZE = 256;
+
+struct PerfOpenZone
+{
+	const char *mName;
+	uint64_t mStartNS;
+};
+
+struct PerfThreadBuffer
+{
+	std::string mName;
+	PerfZone mZones[PERF_RING_SIZE];
+	std::atomic<uint64_t> mWriteIndex;
+
+	PerfOpenZone mStack[PERF_MAX_DEPTH];
+	int mDepth;
+	int mOverflow;
+	uint32_t mGeneration;
+	bool mFree;
+
+	PerfThreadBuffer() : mWriteIndex(0), mDepth(0), mOverflow(0), mGeneration(0), mFree(false)
+	{
+	}
+};
+
+// gives the thread's buffer back when the thread exits
+struct PerfThreadOwner
+{
+	PerfThreadBuffer *mBuffer;
+
+	PerfThreadOwner() : mBuffer(nullptr)
+	{
+	}
+
+	~PerfThreadOwner();
+};
+
+typedef std::vector<PerfThreadBuffer *> PerfThreadBufferVector;
+
+std::atomic<bool> PopLib::gPerfOn(false);
+static std::atomic<uint32_t> gPerfGeneration(0);
+static CritSect gPerfCritSect;
+static PerfThreadBufferVector gPerfThreads;
+static thread_local PerfThreadBuffer *gThreadPerfBuffer = nullptr;
+static thread_local PerfThreadOwner gThreadPerfOwner;
+static thread_local std::string gThreadPerfName;
+
+static uint64_t gSessionStartNS = 0;
+static uint64_t gSessionEndNS = 0;
+static double gDuration = 0;
+
+static uint64_t gFrameMarks[PERF_FRAME_RING_SIZE];
+static std::atomic<uint64_t> gFrameMarkCount(0);
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 struct PerfInfo
 {
 	const char *mPerfName;
-	mutable int64_t mStartTime;
-	mutable int64_t mDuration;
-	mutable double mMillisecondDuration;
-	mutable double mLongestCall;
-	mutable int mStartCount;
+	mutable uint64_t mDuration;
+	mutable uint64_t mLongestCall;
 	mutable int mCallCount;
 
-	PerfInfo(const char *theName)
-		: mPerfName(theName), mStartTime(0), mDuration(0), mStartCount(0), mCallCount(0), mLongestCall(0)
+	PerfInfo(const char *theName) : mPerfName(theName), mDuration(0), mLongestCall(0), mCallCount(0)
 	{
 	}
 
@@ -102,156 +163,263 @@ struct PerfInfo
 	}
 };
 
-///////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////
 typedef std::set<PerfInfo> PerfInfoSet;
 static PerfInfoSet gPerfInfoSet;
-static bool gPerfOn = false;
-static int64_t gStartTime;
-static int64_t gCollateTime;
-double gDuration = 0;
-int gStartCount = 0;
-int gPerfRecordTop = 0;
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
-struct PerfRecord
+PerfThreadOwner::~PerfThreadOwner()
 {
-	const char *mName;
-	int64_t mTime;
-	bool mStart;
+	if (mBuffer == nullptr)
+		return;
+
+	AutoCrit anAutoCrit(gPerfCritSect);
+	mBuffer->mFree = true;
+	gThreadPerfBuffer = nullptr;
+}
 
-	PerfRecord()
+static PerfThreadBuffer *GetThreadPerfBuffer()
+{
+	PerfThreadBuffer *aBuffer = gThreadPerfBuffer;
+	if (aBuffer == nullptr)
 	{
+		AutoCrit anAutoCrit(gPerfCritSect);
+
+		// a free buffer that recorded this session still holds zones we want to report, leave it be.
+		// older zones fall outside the session and are filtered out by CopyZones
+		uint32_t aGeneration = gPerfGeneration.load(std::memory_order_relaxed);
+		int anIndex = 0;
+		for (; anIndex < (int)gPerfThreads.size(); anIndex++)
+		{
+			if (gPerfThreads[anIndex]->mFree && gPerfThreads[anIndex]->mGeneration != aGeneration)
+				break;
+		}
+
+		if (anIndex < (int)gPerfThreads.size())
+		{
+			aBuffer = gPerfThreads[anIndex];
+			aBuffer->mFree = false;
+		}
+		else
+		{
+			aBuffer = new PerfThreadBuffer();
+			gPerfThreads.push_back(aBuffer);
+		}
+
+		if (gThreadPerfName.empty())
+			aBuffer->mName = StrFormat("Thread %d", anIndex);
+		else
+			aBuffer->mName = gThreadPerfName;
+		gThreadPerfBuffer = aBuffer;
+		gThreadPerfOwner.mBuffer = aBuffer;
 	}
-	PerfRecord(const char *theName, bool start) : mName(theName), mStart(start), mTime(SDL_GetPerformanceFrequency()){};
-};
-typedef std::vector<PerfRecord> PerfRecordVector;
-PerfRecordVector gPerfRecordVector;
+
+	uint32_t aGeneration = gPerfGeneration.load(std::memory_order_relaxed);
+	if (aBuffer->mGeneration != aGeneration)
+	{
+		// zones left open from a previous session are meaningless now
+		aBuffer->mDepth = 0;
+		aBuffer->mOverflow = 0;
+		aBuffer->mGeneration = aGeneration;
+	}
+
+	return aBuffer;
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
-static inline void InsertPerfRecord(PerfRecord &theRecord)
+static void CopyZones(PerfThreadBuffer *theBuffer, uint64_t theStartNS, uint64_t theEndNS, PerfZoneVector &theZones)
 {
-	if (theRecord.mStart)
-	{
-		PerfInfoSet::iterator anItr = gPerfInfoSet.insert(PerfInfo(theRecord.mName)).first;
-		anItr->mCallCount++;
+	uint64_t anEnd = theBuffer->mWriteIndex.load(std::memory_order_acquire);
+	uint64_t aBegin = anEnd > (uint64_t)PERF_RING_SIZE ? anEnd - PERF_RING_SIZE : 0;
 
-		if (++anItr->mStartCount == 1)
-			anItr->mStartTime = theRecord.mTime;
-	}
-	else
+	size_t aFirst = theZones.size();
+	for (uint64_t i = aBegin; i < anEnd; i++)
+		theZones.push_back(theBuffer->mZones[i & (PERF_RING_SIZE - 1)]);
+
+	// anything the writer lapped while we were copying may be torn, drop it. the slot at aNewEnd
+	// may be mid-write too, and it aliases aNewEnd + 1 - PERF_RING_SIZE
+	uint64_t aNewEnd = theBuffer->mWriteIndex.load(std::memory_order_acquire);
+	uint64_t aValidBegin = aNewEnd >= (uint64_t)PERF_RING_SIZE ? aNewEnd + 1 - PERF_RING_SIZE : 0;
+	size_t aTorn = aValidBegin > aBegin ? (size_t)std::min(aValidBegin - aBegin, anEnd - aBegin) : 0;
+
+	size_t aDest = aFirst;
+	for (size_t i = aFirst + aTorn; i < theZones.size(); i++)
 	{
-		PerfInfoSet::iterator anItr = gPerfInfoSet.find(theRecord.mName);
-		if (anItr != gPerfInfoSet.end())
-		{
-			if (--anItr->mStartCount == 0)
-			{
-				int64_t aDuration = theRecord.mTime - anItr->mStartTime;
-				anItr->mDuration += aDuration;
-
-				if (aDuration > anItr->mLongestCall)
-					anItr->mLongestCall = (double)aDuration;
-			}
-		}
+		const PerfZone &aZone = theZones[i];
+		if (aZone.mEndNS > theStartNS && aZone.mStartNS < theEndNS)
+			theZones[aDest++] = aZone;
 	}
+	theZones.resize(aDest);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
-static inline void CollatePerfRecords()
+void Perf::BeginPerf(bool measurePerfOverhead)
 {
-	int64_t aTime1, aTime2;
-	aTime1 = SDL_GetPerformanceCounter();
+	gPerfInfoSet.clear();
+	gDuration = 0;
 
-	for (int i = 0; i < gPerfRecordTop; i++)
-		InsertPerfRecord(gPerfRecordVector[i]);
+	gSessionStartNS = SDL_GetTicksNS();
+	gSessionEndNS = 0;
+	gPerfGeneration.fetch_add(1, std::memory_order_relaxed);
 
-	gPerfRecordTop = 0;
-	aTime2 = SDL_GetPerformanceCounter();
-	gCollateTime += aTime2 - aTime1;
+	if (!measurePerfOverhead)
+		gPerfOn.store(true, std::memory_order_release);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
-static inline void PushPerfRecord(PerfRecord &theRecord)
+void Perf::EndPerf()
 {
-	if (gPerfRecordTop >= (int)gPerfRecordVector.size())
-		gPerfRecordVector.push_back(theRecord);
-	else
-		gPerfRecordVector[gPerfRecordTop] = theRecord;
+	gPerfOn.store(false, std::memory_order_release);
+	gSessionEndNS = SDL_GetTicksNS();
+	gDuration = (double)(gSessionEndNS - gSessionStartNS) / 1000000.0;
+
+	gPerfInfoSet.clear();
+
+	PerfZoneVector aZones;
+	int aThreadCount = GetThreadCount();
+	for (int aThread = 0; aThread < aThreadCount; aThread++)
+	{
+		aZones.clear();
+		GetZones(aThread, gSessionStartNS, gSessionEndNS, aZones);
 
-	++gPerfRecordTop;
+		for (const PerfZone &aZone : aZones)
+		{
+			PerfInfoSet::iterator anItr = gPerfInfoSet.insert(PerfInfo(aZone.mName)).first;
+			uint64_t aDuration = aZone.mEndNS - aZone.mStartNS;
+			anItr->mCallCount++;
+			anItr->mDuration += aDuration;
+			if (aDuration > anItr->mLongestCall)
+				anItr->mLongestCall = aDuration;
+		}
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
-bool Perf::IsPerfOn()
+void Perf::StartTiming(const char *theName)
 {
-	return gPerfOn;
+	if (!IsPerfOn())
+		return;
+
+	PerfThreadBuffer *aBuffer = GetThreadPerfBuffer();
+	if (aBuffer->mDepth >= PERF_MAX_DEPTH)
+	{
+		aBuffer->mOverflow++;
+		return;
+	}
+
+	PerfOpenZone &aZone = aBuffer->mStack[aBuffer->mDepth++];
+	aZone.mName = theName;
+	aZone.mStartNS = SDL_GetTicksNS();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
-void Perf::BeginPerf(bool measurePerfOverhead)
+void Perf::StopTiming(const char *theName)
 {
-	gPerfInfoSet.clear();
-	gPerfRecordTop = 0;
-	gStartCount = 0;
-	gCollateTime = 0;
+	PerfThreadBuffer *aBuffer = gThreadPerfBuffer;
+	if (aBuffer == nullptr || aBuffer->mGeneration != gPerfGeneration.load(std::memory_order_relaxed))
+		return;
 
-	if (!measurePerfOverhead)
-		gPerfOn = true;
+	if (aBuffer->mOverflow > 0)
+	{
+		aBuffer->mOverflow--;
+		return;
+	}
+
+	// find the innermost open zone with this name, zones opened above it were never closed
+	int aDepth = aBuffer->mDepth - 1;
+	for (; aDepth >= 0; aDepth--)
+	{
+		const char *anOpenName = aBuffer->mStack[aDepth].mName;
+		if (anOpenName == theName || strcmp(anOpenName, theName) == 0)
+			break;
+	}
+
+	if (aDepth < 0)
+		return;
+
+	uint64_t anIndex = aBuffer->mWriteIndex.load(std::memory_order_relaxed);
+	PerfZone &aZone = aBuffer->mZones[anIndex & (PERF_RING_SIZE - 1)];
+	aZone.mName = aBuffer->mStack[aDepth].mName;
+	aZone.mStartNS = aBuffer->mStack[aDepth].mStartNS;
+	aZone.mEndNS = SDL_GetTicksNS();
+	aZone.mDepth = aDepth;
+	aBuffer->mWriteIndex.store(anIndex + 1, std::memory_order_release);
 
-	gStartTime = SDL_GetPerformanceCounter();
+	aBuffer->mDepth = aDepth;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
-void Perf::EndPerf()
+void Perf::MarkFrame()
 {
-	int64_t anEndTime = SDL_GetPerformanceCounter();
-
-	CollatePerfRecords();
+	uint64_t aCount = gFrameMarkCount.load(std::memory_order_relaxed);
+	gFrameMarks[aCount % PERF_FRAME_RING_SIZE] = SDL_GetTicksNS();
+	gFrameMarkCount.store(aCount + 1, std::memory_order_release);
+}
 
-	gPerfOn = false;
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool Perf::GetLastFrame(uint64_t *theStartNS, uint64_t *theEndNS)
+{
+	uint64_t aCount = gFrameMarkCount.load(std::memory_order_acquire);
+	if (aCount < 2)
+		return false;
 
-	int64_t aFreq = SDL_GetPerformanceFrequency();
+	*theStartNS = gFrameMarks[(aCount - 2) % PERF_FRAME_RING_SIZE];
+	*theEndNS = gFrameMarks[(aCount - 1) % PERF_FRAME_RING_SIZE];
+	return *theEndNS >= *theStartNS;
+}
 
-	gDuration = ((double)(anEndTime - gStartTime - gCollateTime)) * 1000 / aFreq;
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void Perf::SetThreadName(const std::string &theName)
+{
+	gThreadPerfName = theName;
 
-	for (PerfInfoSet::iterator anItr = gPerfInfoSet.begin(); anItr != gPerfInfoSet.end(); ++anItr)
+	if (gThreadPerfBuffer != nullptr)
 	{
-		const PerfInfo &anInfo = *anItr;
-		anInfo.mMillisecondDuration = (double)anInfo.mDuration * 1000 / aFreq;
-		anInfo.mLongestCall = anInfo.mLongestCall * 1000 / aFreq;
+		AutoCrit anAutoCrit(gPerfCritSect);
+		gThreadPerfBuffer->mName = theName;
 	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
-void Perf::StartTiming(const char *theName)
+int Perf::GetThreadCount()
 {
-	if (gPerfOn)
-	{
-		++gStartCount;
-		PerfRecord rec(theName, true);
-		PushPerfRecord(rec);
-	}
+	AutoCrit anAutoCrit(gPerfCritSect);
+	return (int)gPerfThreads.size();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
-void Perf::StopTiming(const char *theName)
+std::string Perf::GetThreadName(int theThreadIndex)
 {
-	if (gPerfOn)
+	AutoCrit anAutoCrit(gPerfCritSect);
+	if (theThreadIndex < 0 || theThreadIndex >= (int)gPerfThreads.size())
+		return "";
+
+	return gPerfThreads[theThreadIndex]->mName;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void Perf::GetZones(int theThreadIndex, uint64_t theStartNS, uint64_t theEndNS, PerfZoneVector &theZones)
+{
+	PerfThreadBuffer *aBuffer = nullptr;
 	{
-		PerfRecord rec(theName, false);
-		PushPerfRecord(rec);
-		if (--gStartCount == 0)
-			CollatePerfRecords();
+		AutoCrit anAutoCrit(gPerfCritSect);
+		if (theThreadIndex < 0 || theThreadIndex >= (int)gPerfThreads.size())
+			return;
+		aBuffer = gPerfThreads[theThreadIndex];
 	}
+
+	CopyZones(aBuffer, theStartNS, theEndNS, theZones);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -266,11 +434,65 @@ std::string Perf::GetResults()
 	for (PerfInfoSet::iterator anItr = gPerfInfoSet.begin(); anItr != gPerfInfoSet.end(); ++anItr)
 	{
 		const PerfInfo &anInfo = *anItr;
+		double aMillisecondDuration = (double)anInfo.mDuration / 1000000.0;
+		double aLongestCall = (double)anInfo.mLongestCall / 1000000.0;
 		sprintf(aBuf, "%s (%d calls, %%%.2f time): %.2f (%.2f avg, %.2f longest)\n", anInfo.mPerfName,
-				anInfo.mCallCount, anInfo.mMillisecondDuration / gDuration * 100, anInfo.mMillisecondDuration,
-				anInfo.mMillisecondDuration / anInfo.mCallCount, anInfo.mLongestCall);
+				anInfo.mCallCount, gDuration > 0 ? aMillisecondDuration / gDuration * 100 : 0.0, aMillisecondDuration,
+				aMillisecondDuration / anInfo.mCallCount, aLongestCall);
 		aResult += aBuf;
 	}
 
 	return aResult;
 }
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+std::string Perf::GetChromeTrace()
+{
+	uint64_t aStartNS = gSessionStartNS;
+	uint64_t anEndNS = (IsPerfOn() || gSessionEndNS == 0) ? SDL_GetTicksNS() : gSessionEndNS;
+
+	nlohmann::json anEvents = nlohmann::json::array();
+	PerfZoneVector aZones;
+
+	int aThreadCount = GetThreadCount();
+	for (int aThread = 0; aThread < aThreadCount; aThread++)
+	{
+		anEvents.push_back({{"name", "thread_name"},
+							{"ph", "M"},
+							{"pid", 1},
+							{"tid", aThread},
+							{"args", {{"name", GetThreadName(aThread)}}}});
+
+		aZones.clear();
+		GetZones(aThread, aStartNS, anEndNS, aZones);
+		for (const PerfZone &aZone : aZones)
+		{
+			anEvents.push_back({{"name", aZone.mName},
+								{"ph", "X"},
+								{"pid", 1},
+								{"tid", aThread},
+								{"ts", (double)(aZone.mStartNS - aStartNS) / 1000.0},
+								{"dur", (double)(aZone.mEndNS - aZone.mStartNS) / 1000.0}});
+		}
+	}
+
+	nlohmann::json aTrace;
+	aTrace["traceEvents"] = anEvents;
+	aTrace["displayTimeUnit"] = "ms";
+	return aTrace.dump();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool Perf::WriteChromeTrace(const std::string &theFileName)
+{
+	FILE *aFile = fopen(theFileName.c_str(), "wb");
+	if (aFile == nullptr)
+		return false;
+
+	std::string aTrace = GetChromeTrace();
+	bool success = fwrite(aTrace.data(), 1, aTrace.size(), aFile) == aTrace.size();
+	fclose(aFile);
+	return success;
+}
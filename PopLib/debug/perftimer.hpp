@@ -5,6 +5,7 @@
 #endif
 
 #include "common.hpp"
+#include <atomic>
 
 #ifdef _WIN32
 #include <time.h>
@@ -39,17 +40,91 @@ class PerfTimer
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief a completed profiler zone
+ */
+struct PerfZone
+{
+	/// @brief the zone name, must outlive the profiler (string literals)
+	const char *mName;
+	/// @brief start time in nanoseconds (SDL_GetTicksNS)
+	uint64_t mStartNS;
+	/// @brief end time in nanoseconds (SDL_GetTicksNS)
+	uint64_t mEndNS;
+	/// @brief nesting depth, 0 is the outermost zone
+	int mDepth;
+};
+
+typedef std::vector<PerfZone> PerfZoneVector;
+
+/// @brief true while the profiler is recording, checked inline by the PERF macros
+extern std::atomic<bool> gPerfOn;
+
+/**
+ * @brief hierarchical profiler
+ *
+ * every thread records its zones into its own lock-free ring buffer, so
+ * StartTiming/StopTiming never take a lock or allocate. when the profiler is
+ * off the PERF macros cost a single relaxed load.
+ */
 class Perf
 {
   public:
+	/// @brief starts recording
+	/// @param measurePerfOverhead
 	static void BeginPerf(bool measurePerfOverhead = false);
+	/// @brief stops recording and collates the results for GetResults
 	static void EndPerf();
-	static bool IsPerfOn();
+	/// @brief is the profiler recording?
+	/// @return true if yes
+	static inline bool IsPerfOn()
+	{
+		return gPerfOn.load(std::memory_order_relaxed);
+	}
 
+	/// @brief opens a zone on the calling thread
+	/// @param theName
 	static void StartTiming(const char *theName);
+	/// @brief closes the innermost zone named theName on the calling thread
+	/// @param theName
 	static void StopTiming(const char *theName);
 
+	/// @brief marks a frame boundary, called by AppBase once per drawn frame
+	static void MarkFrame();
+	/// @brief names the calling thread in the trace
+	/// @param theName
+	static void SetThreadName(const std::string &theName);
+
+	/// @brief gets the summary of the last BeginPerf/EndPerf session
+	/// @return string
 	static std::string GetResults();
+
+	/// @brief gets the recorded zones as a chrome://tracing (Trace Event Format) document
+	/// @return json string
+	static std::string GetChromeTrace();
+	/// @brief writes GetChromeTrace to a file
+	/// @param theFileName
+	/// @return true if success
+	static bool WriteChromeTrace(const std::string &theFileName);
+
+	/// @brief gets the number of threads that have recorded zones
+	/// @return int
+	static int GetThreadCount();
+	/// @brief gets the name of a recording thread
+	/// @param theThreadIndex
+	/// @return string
+	static std::string GetThreadName(int theThreadIndex);
+	/// @brief copies the zones of a thread that overlap [theStartNS, theEndNS)
+	/// @param theThreadIndex
+	/// @param theStartNS
+	/// @param theEndNS
+	/// @param theZones
+	static void GetZones(int theThreadIndex, uint64_t theStartNS, uint64_t theEndNS, PerfZoneVector &theZones);
+	/// @brief gets the bounds of the last completed frame
+	/// @param theStartNS
+	/// @param theEndNS
+	/// @return true if a full frame has been recorded
+	static bool GetLastFrame(uint64_t *theStartNS, uint64_t *theEndNS);
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -60,14 +135,14 @@ class AutoPerf
 	const char *mName;
 	bool mIsStarted;
 
-	AutoPerf(const char *theName) : mName(theName), mIsStarted(true)
+	AutoPerf(const char *theName) : mName(theName), mIsStarted(false)
 	{
-		Perf::StartTiming(theName);
+		Start();
 	}
-	AutoPerf(const char *theName, bool doStart) : mIsStarted(doStart), mName(theName)
+	AutoPerf(const char *theName, bool doStart) : mName(theName), mIsStarted(false)
 	{
 		if (doStart)
-			Perf::StartTiming(theName);
+			Start();
 	}
 
 	~AutoPerf()
@@ -77,7 +152,7 @@ class AutoPerf
 
 	void Start()
 	{
-		if (!mIsStarted)
+		if (!mIsStarted && Perf::IsPerfOn())
 		{
 			mIsStarted = true;
 			Perf::StartTiming(mName);
@@ -101,43 +176,43 @@ class AutoPerf
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
-// #define PERF_ENABLED
-#if defined(PERF_ENABLED) && !defined(RELEASEFINAL)
+// The profiler is always compiled in and switched at runtime with Perf::BeginPerf/EndPerf.
+// #define PERF_DISABLED to strip every zone from a translation unit.
+#ifndef PERF_DISABLED
 
-#define PERF_BEGIN(theName) Perf::StartTiming(theName)
-#define PERF_END(theName) Perf::StopTiming(theName)
-#define AUTO_PERF_MULTI(theName, theSuffix) AutoPerf anAutoPerf##theSuffix(theName)
+#define PERF_BEGIN(theName) (PopLib::Perf::IsPerfOn() ? PopLib::Perf::StartTiming(theName) : (void)0)
+#define PERF_END(theName) (PopLib::Perf::IsPerfOn() ? PopLib::Perf::StopTiming(theName) : (void)0)
+#define AUTO_PERF_MULTI(theName, theSuffix) PopLib::AutoPerf anAutoPerf##theSuffix(theName)
 #define AUTO_PERF_2(theName, theSuffix) AUTO_PERF_MULTI(theName, theSuffix)
-#define AUTO_PERFL(theName)                                                                                    \
+#define AUTO_PERFL(theName)                                                                                            \
 	AUTO_PERF_2(theName, __LINE__) // __LINE__ doesn't work correctly if Edit-and-Continue (/ZI) is enabled
 #define AUTO_PERF(theName) AUTO_PERF_2(theName, UNIQUE)
 
-#define PERF_BEGIN_COND(theName, theCond)                                                                      \
-	if (theCond)                                                                                                       \
-	Perf::StartTiming(theName)
-#define PERF_END_COND(theName, theCond)                                                                        \
-	if (theCond)                                                                                                       \
-	Perf::StopTiming(theName)
-#define AUTO_PERF_MULTI_COND(theName, theSuffix, theCond)                                                      \
-	AutoPerf anAutoPerf##theSuffix(theName, theCond);
-#define AUTO_PERF_COND_2(theName, theSuffix, theCond) AUTO_PERF_MULTI_COND(theName, theSuffix, theCond);
-#define AUTO_PERF_CONDL(theName) AUTO_PERF_COND_2(theName, __LINE__, theCond)
-#define AUTO_PERF_COND(theName) AUTO_PERF_COND_2(theName, UNIQUE, theCond)
+#define PERF_BEGIN_COND(theName, theCond)                                                                              \
+	(((theCond) && PopLib::Perf::IsPerfOn()) ? PopLib::Perf::StartTiming(theName) : (void)0)
+#define PERF_END_COND(theName, theCond)                                                                                \
+	(((theCond) && PopLib::Perf::IsPerfOn()) ? PopLib::Perf::StopTiming(theName) : (void)0)
+#define AUTO_PERF_MULTI_COND(theName, theSuffix, theCond) PopLib::AutoPerf anAutoPerf##theSuffix(theName, theCond)
+#define AUTO_PERF_COND_2(theName, theSuffix, theCond) AUTO_PERF_MULTI_COND(theName, theSuffix, theCond)
+#define AUTO_PERF_CONDL(theName, theCond) AUTO_PERF_COND_2(theName, __LINE__, theCond)
+#define AUTO_PERF_COND(theName, theCond) AUTO_PERF_COND_2(theName, UNIQUE, theCond)
 
 #else
 
 #define PERF_BEGIN(theName)
 #define PERF_END(theName)
 #define AUTO_PERF_MULTI(theName, theSuffix)
+#define AUTO_PERFL(theName)
 #define AUTO_PERF(theName)
 
 #define PERF_BEGIN_COND(theName, theCond)
 #define PERF_END_COND(theName, theCond)
 #define AUTO_PERF_MULTI_COND(theName, theSuffix, theCond)
-#define AUTO_PERF_COND(theName)
+#define AUTO_PERF_CONDL(theName, theCond)
+#define AUTO_PERF_COND(theName, theCond)
 
 #endif
 
 #pragma warning(pop)
 
-#endif
\ No newline at end of file
+#endif
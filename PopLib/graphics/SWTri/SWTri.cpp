@@ -5,8 +5,9 @@
 
 using namespace PopLib;
 
-static SWHelper::XYZStruct vertexReservoir[64];
-static unsigned int vertexReservoirUsed = 0;
+// per thread, so triangles can be clipped on several threads at once
+static thread_local SWHelper::XYZStruct vertexReservoir[64];
+static thread_local unsigned int vertexReservoirUsed = 0;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1,6 +1,8 @@
 #include "font.hpp"
 #include "image.hpp"
 
+#include <atomic>
+
 using namespace PopLib;
 
 Font::Font()
@@ -9,18 +11,27 @@ Font::Font()
 	mHeight = 0;
 	mAscentPadding = 0;
 	mLineSpacingOffset = 0;
+	LayoutChanged();
 }
 
 Font::Font(const Font &theFont)
 	: mAscent(theFont.mAscent), mHeight(theFont.mHeight), mAscentPadding(theFont.mAscentPadding),
 	  mLineSpacingOffset(theFont.mLineSpacingOffset)
 {
+	// a copy can be changed on its own
+	LayoutChanged();
 }
 
 Font::~Font()
 {
 }
 
+void Font::LayoutChanged()
+{
+	static std::atomic<int> aNextLayoutId(0);
+	mLayoutId = ++aNextLayoutId;
+}
+
 int Font::GetAscent()
 {
 	return mAscent;
@@ -20,6 +20,7 @@ class Font
 	int mAscentPadding; // How much space is above the avg uppercase char
 	int mHeight;
 	int mLineSpacingOffset; // This plus height should get added between lines
+	int mLayoutId;			// Unique to this font and its current metrics, see TextLayoutCache
 
   public:
 	Font();
@@ -40,6 +41,9 @@ class Font
 							const Rect &theClipRect);
 
 	virtual Font *Duplicate() {return new Font(*this);};
+
+	/// @brief call when the font's metrics change so cached text layouts aren't reused
+	void LayoutChanged();
 };
 
 } // namespace PopLib
@@ -2,6 +2,8 @@
 #include "font.hpp"
 #include "sdlimage.hpp"
 #include "memoryimage.hpp"
+#include "vertexbatch.hpp"
+#include "textlayout.hpp"
 #include "math/matrix.hpp"
 #include <math.h>
 
@@ -264,8 +266,8 @@ void Graphics::PFInsert(int i, int y) // append edge i to end of active list
 
 void Graphics::PolyFill(const Point *theVertexList, int theNumVertices, bool convex)
 {
-	if (convex &&
-		mDestImage->PolyFill3D(theVertexList, theNumVertices, &mClipRect, mColor, mDrawMode, mTransX, mTransY, convex))
+	// images that can tessellate on the GPU handle concave polygons too
+	if (mDestImage->PolyFill3D(theVertexList, theNumVertices, &mClipRect, mColor, mDrawMode, mTransX, mTransY, convex))
 		return;
 
 	Span aSpans[MAX_TEMP_SPANS];
@@ -361,8 +363,8 @@ void Graphics::PolyFill(const Point *theVertexList, int theNumVertices, bool con
 
 void Graphics::PolyFillAA(const Point *theVertexList, int theNumVertices, bool convex)
 {
-	if (convex &&
-		mDestImage->PolyFill3D(theVertexList, theNumVertices, &mClipRect, mColor, mDrawMode, mTransX, mTransY, convex))
+	if (mDestImage->PolyFill3D(theVertexList, theNumVertices, &mClipRect, mColor, mDrawMode, mTransX, mTransY, convex,
+							   true))
 		return;
 
 	int i;
@@ -946,6 +948,23 @@ void Graphics::DrawTrianglesTex(Image *theTexture, const TriVertex theVertices[]
 								mColorizeImages ? mColor : Color::White, mDrawMode, mTransX, mTransY, mLinearBlend);
 }
 
+void Graphics::DrawMesh(Image *theTexture, const TriVertex theVertices[], int theNumVertices, const int theIndices[],
+						int theNumIndices)
+{
+	Color aColor = theTexture == nullptr || mColorizeImages ? mColor : Color::White;
+	mDestImage->BltMesh(theTexture, theVertices, theNumVertices, theIndices, theNumIndices, mClipRect, aColor,
+						mDrawMode, mTransX, mTransY, mLinearBlend);
+}
+
+void Graphics::DrawMesh(Image *theTexture, const VertexBatch &theBatch)
+{
+	if (theBatch.IsEmpty())
+		return;
+
+	DrawMesh(theTexture, theBatch.mVertices.data(), (int)theBatch.mVertices.size(), theBatch.mIndices.data(),
+			 (int)theBatch.mIndices.size());
+}
+
 void Graphics::ClearClipRect()
 {
 	mClipRect = Rect(0, 0, mDestImage->GetWidth(), mDestImage->GetHeight());
@@ -1208,11 +1227,26 @@ int Graphics::WriteWordWrapped(const Rect &theRect, const PopString &theLine, in
 	if ((anOrigColorInt & 0xFF000000) == 0xFF000000)
 		anOrigColorInt &= ~0xFF000000;
 
+	Font *aFont = GetFont();
+
+	if (theMaxChars < 0 && theLastWidth == nullptr)
+	{
+		// the whole text from the left edge, replay the cached layout instead of measuring it again
+		std::shared_ptr<const TextLayout> aLayout = TextLayoutCache::Get(
+			aFont, theLine, theRect.mWidth, theLineSpacing, theJustification, mWriteColoredString);
+		aLayout->Draw(this, theRect.mX, theRect.mY, anOrigColorInt);
+
+		SetColor(anOrigColor);
+
+		if (theMaxWidth != nullptr)
+			*theMaxWidth = aLayout->mMaxWidth;
+
+		return aLayout->mHeight;
+	}
+
 	if (theMaxChars < 0)
 		theMaxChars = (int)theLine.length();
 
-	Font *aFont = GetFont();
-
 	int aYOffset = aFont->GetAscent() - aFont->GetAscentPadding();
 
 	if (theLineSpacing == -1)
@@ -1377,9 +1411,11 @@ int Graphics::DrawStringWordWrapped(const PopString &theLine, int theX, int theY
 
 int Graphics::GetWordWrappedHeight(int theWidth, const PopString &theLine, int theLineSpacing, int *theMaxWidth)
 {
-	Graphics aTestG;
-	aTestG.SetFont(mFont);
-	int aHeight = aTestG.WriteWordWrapped(Rect(0, 0, theWidth, 0), theLine, theLineSpacing, -1, theMaxWidth);
+	std::shared_ptr<const TextLayout> aLayout =
+		TextLayoutCache::Get(mFont, theLine, theWidth, theLineSpacing, -1, true);
+
+	if (theMaxWidth != nullptr)
+		*theMaxWidth = aLayout->mMaxWidth;
 
-	return aHeight;
+	return aLayout->mHeight;
 }
@@ -16,6 +16,7 @@ namespace PopLib
 class Font;
 class Matrix3;
 class Transform;
+class VertexBatch;
 
 const int MAX_TEMP_SPANS = 8192;
 
@@ -155,6 +156,9 @@ class Graphics : public GraphicsState
 							 float y = 0);
 	void DrawTriangleTex(Image *theTexture, const TriVertex &v1, const TriVertex &v2, const TriVertex &v3);
 	void DrawTrianglesTex(Image *theTexture, const TriVertex theVertices[][3], int theNumTriangles);
+	void DrawMesh(Image *theTexture, const TriVertex theVertices[], int theNumVertices, const int theIndices[] = NULL,
+				  int theNumIndices = 0);
+	void DrawMesh(Image *theTexture, const VertexBatch &theBatch);
 
 	void DrawImageCel(Image *theImageStrip, int theX, int theY, int theCel);
 	void DrawImageCel(Image *theImageStrip, const Rect &theDestRect, int theCel);
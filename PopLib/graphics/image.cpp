@@ -252,7 +252,7 @@ void Image::FillScanLinesWithCoverage(Span *theSpans, int theSpanCount, const Co
 }
 
 bool Image::PolyFill3D(const Point theVertices[], int theNumVertices, const Rect *theClipRect, const Color &theColor,
-					   int theDrawMode, int tx, int ty, bool convex)
+					   int theDrawMode, int tx, int ty, bool convex, bool antiAlias)
 {
 	return false;
 }
@@ -287,6 +287,12 @@ void Image::BltTrianglesTex(Image *theTexture, const TriVertex theVertices[][3],
 {
 }
 
+void Image::BltMesh(Image *theTexture, const TriVertex theVertices[], int theNumVertices, const int theIndices[],
+					int theNumIndices, const Rect &theClipRect, const Color &theColor, int theDrawMode, float tx,
+					float ty, bool blend)
+{
+}
+
 void Image::BltMirror(Image *theImage, int theX, int theY, const Rect &theSrcRect, const Color &theColor,
 					  int theDrawMode)
 {
@@ -84,7 +84,8 @@ class Image
 	Graphics *GetGraphics();
 
 	virtual bool PolyFill3D(const Point theVertices[], int theNumVertices, const Rect *theClipRect,
-							const Color &theColor, int theDrawMode, int tx, int ty, bool convex);
+							const Color &theColor, int theDrawMode, int tx, int ty, bool convex,
+							bool antiAlias = false);
 
 	virtual void FillRect(const Rect &theRect, const Color &theColor, int theDrawMode);
 	virtual void DrawRect(const Rect &theRect, const Color &theColor, int theDrawMode);
@@ -111,6 +112,9 @@ class Image
 	virtual void BltTrianglesTex(Image *theTexture, const TriVertex theVertices[][3], int theNumTriangles,
 								 const Rect &theClipRect, const Color &theColor, int theDrawMode, float tx, float ty,
 								 bool blend);
+	virtual void BltMesh(Image *theTexture, const TriVertex theVertices[], int theNumVertices, const int theIndices[],
+						 int theNumIndices, const Rect &theClipRect, const Color &theColor, int theDrawMode, float tx,
+						 float ty, bool blend);
 
 	virtual void BltMirror(Image *theImage, int theX, int theY, const Rect &theSrcRect, const Color &theColor,
 						   int theDrawMode);
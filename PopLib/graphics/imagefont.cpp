@@ -6,6 +6,8 @@
 #include "sdlimage.hpp"
 #include "misc/autocrit.hpp"
 
+#include <tuple>
+
 using namespace PopLib;
 
 DataElement::DataElement() : mIsList(false)
@@ -133,6 +135,8 @@ FontData::FontData()
 
 FontData::~FontData()
 {
+	ScaledFontLayer::RemoveFontData(this);
+
 	DataElementMap::iterator anItr = mDefineMap.begin();
 	while (anItr != mDefineMap.end())
 	{
@@ -1071,18 +1075,269 @@ bool FontData::LoadLegacy(Image *theFontImage, const std::string &theFontDescFil
 
 ////
 
+// the largest texture every renderer is sure to take
+static const int SCALED_FONT_PAGE_SIZE = 2048;
+
+typedef std::tuple<FontLayer *, double, double, bool> ScaledFontLayerKey;
+typedef std::map<ScaledFontLayerKey, ScaledFontLayer *> ScaledFontLayerMap;
+typedef std::list<ScaledFontLayer *> ScaledFontLayerList;
+
+static CritSect gScaledFontLayerCritSect;
+static ScaledFontLayerMap gScaledFontLayerMap;
+static ScaledFontLayerList gUnusedScaledFontLayers; // least recently used first
+static int gUnusedScaledFontLayerSize = 0;
+static int gMaxUnusedScaledFontLayerSize = 4 * 1024 * 1024;
+
+void ScaledFontLayer::TrimUnused()
+{
+	while (gUnusedScaledFontLayerSize > gMaxUnusedScaledFontLayerSize && !gUnusedScaledFontLayers.empty())
+	{
+		ScaledFontLayer *aScaledLayer = gUnusedScaledFontLayers.front();
+		gUnusedScaledFontLayers.pop_front();
+
+		gScaledFontLayerMap.erase(ScaledFontLayerKey(aScaledLayer->mBaseFontLayer, aScaledLayer->mPointSize,
+													 aScaledLayer->mLayerPointSize, aScaledLayer->mForceWhite));
+		RemoveUnused(aScaledLayer);
+	}
+}
+
+ScaledFontLayer::ScaledFontLayer(FontLayer *theFontLayer, double thePointSize, double theLayerPointSize,
+								 bool forceWhite)
+{
+	mBaseFontLayer = theFontLayer;
+	mPointSize = thePointSize;
+	mLayerPointSize = theLayerPointSize;
+	mForceWhite = forceWhite;
+	mRefCount = 0;
+
+	MemoryImage *aSourceImage = theFontLayer->mImage;
+	mSourceBitsChangedCount = aSourceImage != nullptr ? aSourceImage->mBitsChangedCount : 0;
+
+	int aCharNum;
+	int anArea = 0;
+	int aMaxWidth = 0;
+	for (aCharNum = 0; aCharNum < 256; aCharNum++)
+	{
+		Rect *anOrigRect = &theFontLayer->mCharData[aCharNum].mImageRect;
+
+		Rect &aScaledRect = mCharImageRects[aCharNum];
+		aScaledRect = Rect(0, 0, (int)((anOrigRect->mWidth * thePointSize) / theLayerPointSize),
+						   (int)((anOrigRect->mHeight * thePointSize) / theLayerPointSize));
+		mCharPage[aCharNum] = 0;
+		mCharReady[aCharNum] = false;
+
+		anArea += aScaledRect.mWidth * aScaledRect.mHeight;
+		aMaxWidth = std::max(aMaxWidth, aScaledRect.mWidth);
+	}
+
+	// shelves of glyphs, tallest first, on pages about as wide as they are tall
+	int anOrder[256];
+	for (aCharNum = 0; aCharNum < 256; aCharNum++)
+		anOrder[aCharNum] = aCharNum;
+	std::stable_sort(anOrder, anOrder + 256,
+					 [this](int a, int b) { return mCharImageRects[a].mHeight > mCharImageRects[b].mHeight; });
+
+	int aPageWidth = std::max(std::min((int)ceil(sqrt((double)anArea)), SCALED_FONT_PAGE_SIZE), aMaxWidth);
+
+	std::vector<int> aPageHeights;
+	int aCurX = 0;
+	int aCurY = 0;
+	int aShelfHeight = 0;
+	for (int i = 0; i < 256; i++)
+	{
+		Rect &aScaledRect = mCharImageRects[anOrder[i]];
+		if (aScaledRect.mWidth <= 0 || aScaledRect.mHeight <= 0)
+			continue;
+
+		if (aPageHeights.empty())
+			aPageHeights.push_back(0);
+
+		if (aCurX + aScaledRect.mWidth > aPageWidth)
+		{
+			aCurX = 0;
+			aCurY += aShelfHeight;
+			aShelfHeight = 0;
+		}
+
+		if (aCurY > 0 && aCurY + aScaledRect.mHeight > SCALED_FONT_PAGE_SIZE)
+		{
+			aPageHeights.push_back(0);
+			aCurY = 0;
+		}
+
+		aScaledRect.mX = aCurX;
+		aScaledRect.mY = aCurY;
+		mCharPage[anOrder[i]] = (uchar)(aPageHeights.size() - 1);
+
+		aCurX += aScaledRect.mWidth;
+		aShelfHeight = std::max(aShelfHeight, aScaledRect.mHeight);
+		aPageHeights.back() = std::max(aPageHeights.back(), aCurY + aShelfHeight);
+	}
+
+	// the bits aren't made until a glyph is scaled into them
+	for (int aPageHeight : aPageHeights)
+	{
+		MemoryImage *aPage = new MemoryImage(theFontLayer->mFontData->mApp);
+		aPage->Create(aPageWidth, aPageHeight);
+		mPages.push_back(aPage);
+	}
+}
+
+ScaledFontLayer::~ScaledFontLayer()
+{
+	for (MemoryImage *aPage : mPages)
+		delete aPage;
+}
+
+int ScaledFontLayer::GetMemorySize()
+{
+	int aSize = 0;
+	for (MemoryImage *aPage : mPages)
+		aSize += aPage->mWidth * aPage->mHeight * 4;
+	return aSize;
+}
+
+ScaledFontLayer *ScaledFontLayer::Get(FontLayer *theFontLayer, double thePointSize, double theLayerPointSize,
+									  bool forceWhite)
+{
+	AutoCrit anAutoCrit(gScaledFontLayerCritSect);
+
+	ScaledFontLayerKey aKey(theFontLayer, thePointSize, theLayerPointSize, forceWhite);
+	ScaledFontLayerMap::iterator anItr = gScaledFontLayerMap.find(aKey);
+
+	ScaledFontLayer *aScaledLayer;
+	if (anItr != gScaledFontLayerMap.end())
+	{
+		aScaledLayer = anItr->second;
+		if (aScaledLayer->mRefCount == 0)
+		{
+			gUnusedScaledFontLayers.remove(aScaledLayer);
+			gUnusedScaledFontLayerSize -= aScaledLayer->GetMemorySize();
+		}
+	}
+	else
+	{
+		aScaledLayer = new ScaledFontLayer(theFontLayer, thePointSize, theLayerPointSize, forceWhite);
+		gScaledFontLayerMap.insert(ScaledFontLayerMap::value_type(aKey, aScaledLayer));
+	}
+
+	aScaledLayer->mRefCount++;
+	return aScaledLayer;
+}
+
+void ScaledFontLayer::RemoveFontData(FontData *theFontData)
+{
+	AutoCrit anAutoCrit(gScaledFontLayerCritSect);
+
+	// the fonts using theFontData are gone, so are their references
+	ScaledFontLayerMap::iterator anItr = gScaledFontLayerMap.begin();
+	while (anItr != gScaledFontLayerMap.end())
+	{
+		ScaledFontLayer *aScaledLayer = anItr->second;
+		if (aScaledLayer->mBaseFontLayer->mFontData == theFontData && aScaledLayer->mRefCount == 0)
+		{
+			gUnusedScaledFontLayers.remove(aScaledLayer);
+			gScaledFontLayerMap.erase(anItr++);
+			RemoveUnused(aScaledLayer);
+		}
+		else
+			++anItr;
+	}
+}
+
+void ScaledFontLayer::RemoveUnused(ScaledFontLayer *theScaledLayer)
+{
+	gUnusedScaledFontLayerSize -= theScaledLayer->GetMemorySize();
+	delete theScaledLayer;
+}
+
+void ScaledFontLayer::SetUnusedCacheSize(int theBytes)
+{
+	AutoCrit anAutoCrit(gScaledFontLayerCritSect);
+
+	gMaxUnusedScaledFontLayerSize = theBytes;
+	TrimUnused();
+}
+
+void ScaledFontLayer::Ref()
+{
+	AutoCrit anAutoCrit(gScaledFontLayerCritSect);
+
+	mRefCount++;
+}
+
+void ScaledFontLayer::DeRef()
+{
+	AutoCrit anAutoCrit(gScaledFontLayerCritSect);
+
+	if (--mRefCount > 0)
+		return;
+
+	gUnusedScaledFontLayers.push_back(this);
+	gUnusedScaledFontLayerSize += GetMemorySize();
+	TrimUnused();
+}
+
+Image *ScaledFontLayer::PrepareChar(uchar theChar)
+{
+	const Rect &aScaledRect = mCharImageRects[theChar];
+	if (aScaledRect.mWidth <= 0 || aScaledRect.mHeight <= 0)
+		return nullptr;
+
+	AutoCrit anAutoCrit(gScaledFontLayerCritSect);
+
+	MemoryImage *aPage = mPages[mCharPage[theChar]];
+	MemoryImage *aSourceImage = mBaseFontLayer->mImage;
+	if (aSourceImage == nullptr)
+		return aPage;
+
+	if (aSourceImage->mBitsChangedCount != mSourceBitsChangedCount)
+	{
+		// the layer's image was reloaded, everything scaled from it so far is stale
+		for (MemoryImage *anOldPage : mPages)
+			anOldPage->Create(anOldPage->mWidth, anOldPage->mHeight);
+		for (int aCharNum = 0; aCharNum < 256; aCharNum++)
+			mCharReady[aCharNum] = false;
+		mSourceBitsChangedCount = aSourceImage->mBitsChangedCount;
+	}
+
+	if (mCharReady[theChar])
+		return aPage;
+
+	Graphics g(aPage);
+	g.DrawImage(aSourceImage, aScaledRect, mBaseFontLayer->mCharData[theChar].mImageRect);
+
+	if (mForceWhite)
+	{
+		ulong *aBits = aPage->GetBits();
+		for (int y = aScaledRect.mY; y < aScaledRect.mY + aScaledRect.mHeight; y++)
+		{
+			ulong *aRow = aBits + y * aPage->mWidth;
+			for (int x = aScaledRect.mX; x < aScaledRect.mX + aScaledRect.mWidth; x++)
+				aRow[x] |= 0x00FFFFFF;
+		}
+		aPage->BitsChanged();
+	}
+
+	mCharReady[theChar] = true;
+	return aPage;
+}
+
+////
+
 ActiveFontLayer::ActiveFontLayer()
 {
+	mBaseFontLayer = nullptr;
 	mScaledImage = nullptr;
-	mOwnsImage = false;
+	mScaledLayer = nullptr;
 }
 
 ActiveFontLayer::ActiveFontLayer(const ActiveFontLayer &theActiveFontLayer)
 	: mBaseFontLayer(theActiveFontLayer.mBaseFontLayer), mScaledImage(theActiveFontLayer.mScaledImage),
-	  mOwnsImage(theActiveFontLayer.mOwnsImage)
+	  mScaledLayer(theActiveFontLayer.mScaledLayer)
 {
-	if (mOwnsImage)
-		mScaledImage = mBaseFontLayer->mFontData->mApp->CopyImage(mScaledImage);
+	if (mScaledLayer != nullptr)
+		mScaledLayer->Ref();
 
 	for (int aCharNum = 0; aCharNum < 256; aCharNum++)
 		mScaledCharImageRects[aCharNum] = theActiveFontLayer.mScaledCharImageRects[aCharNum];
@@ -1090,8 +1345,36 @@ ActiveFontLayer::ActiveFontLayer(const ActiveFontLayer &theActiveFontLayer)
 
 ActiveFontLayer::~ActiveFontLayer()
 {
-	if (mOwnsImage)
-		delete mScaledImage;
+	if (mScaledLayer != nullptr)
+		mScaledLayer->DeRef();
+}
+
+ActiveFontLayer &ActiveFontLayer::operator=(const ActiveFontLayer &theActiveFontLayer)
+{
+	if (this == &theActiveFontLayer)
+		return *this;
+
+	if (mScaledLayer != nullptr)
+		mScaledLayer->DeRef();
+
+	mBaseFontLayer = theActiveFontLayer.mBaseFontLayer;
+	mScaledImage = theActiveFontLayer.mScaledImage;
+	mScaledLayer = theActiveFontLayer.mScaledLayer;
+	if (mScaledLayer != nullptr)
+		mScaledLayer->Ref();
+
+	for (int aCharNum = 0; aCharNum < 256; aCharNum++)
+		mScaledCharImageRects[aCharNum] = theActiveFontLayer.mScaledCharImageRects[aCharNum];
+
+	return *this;
+}
+
+Image *ActiveFontLayer::GetCharImage(uchar theChar)
+{
+	if (mScaledLayer != nullptr)
+		return mScaledLayer->PrepareChar(theChar);
+
+	return mScaledImage;
 }
 
 ////
@@ -1162,6 +1445,8 @@ CharData *FontLayer::GetCharData(PopChar value)
 
 ImageFont::~ImageFont()
 {
+	// the layers point into the font data
+	mActiveLayerList.clear();
 	mFontData->DeRef();
 }
 
@@ -1228,7 +1513,6 @@ void ImageFont::GenerateActiveFontLayers()
 				if ((mScale == 1.0) && ((aFontLayer->mPointSize == 0) || (mPointSize == aFontLayer->mPointSize)))
 				{
 					anActiveFontLayer->mScaledImage = aFontLayer->mImage;
-					anActiveFontLayer->mOwnsImage = false;
 
 					// Use the specified point size
 
@@ -1243,55 +1527,13 @@ void ImageFont::GenerateActiveFontLayers()
 						aPointSize = mPointSize * mScale;
 					}
 
-					// Resize font elements
-					int aCharNum;
-
-					MemoryImage *aMemoryImage = new MemoryImage(mFontData->mApp);
-
-					int aCurX = 0;
-					int aMaxHeight = 0;
-
-					for (aCharNum = 0; aCharNum < 256; aCharNum++)
-					{
-						Rect *anOrigRect = &aFontLayer->mCharData[aCharNum].mImageRect;
-
-						Rect aScaledRect(aCurX, 0, (int)((anOrigRect->mWidth * aPointSize) / aLayerPointSize),
-										 (int)((anOrigRect->mHeight * aPointSize) / aLayerPointSize));
-
-						anActiveFontLayer->mScaledCharImageRects[aCharNum] = aScaledRect;
-
-						if (aScaledRect.mHeight > aMaxHeight)
-							aMaxHeight = aScaledRect.mHeight;
-
-						aCurX += aScaledRect.mWidth;
-					}
-
-					anActiveFontLayer->mScaledImage = aMemoryImage;
-					anActiveFontLayer->mOwnsImage = true;
-
-					// Create the image now
-
-					aMemoryImage->Create(aCurX, aMaxHeight);
-
-					Graphics g(aMemoryImage);
-
-					for (aCharNum = 0; aCharNum < 256; aCharNum++)
-					{
-						if ((Image *)aFontLayer->mImage != nullptr)
-							g.DrawImage(aFontLayer->mImage, anActiveFontLayer->mScaledCharImageRects[aCharNum],
-										aFontLayer->mCharData[aCharNum].mImageRect);
-					}
-
-					if (mForceScaledImagesWhite)
-					{
-						int aCount = aMemoryImage->mWidth * aMemoryImage->mHeight;
-						ulong *aBits = aMemoryImage->GetBits();
-
-						for (int i = 0; i < aCount; i++)
-							*(aBits++) = *aBits | 0x00FFFFFF;
-					}
+					// shared with the other fonts drawing this layer at this size, glyphs are scaled as they're drawn
+					anActiveFontLayer->mScaledLayer =
+						ScaledFontLayer::Get(aFontLayer, aPointSize, aLayerPointSize, mForceScaledImagesWhite);
 
-					aMemoryImage->Palletize();
+					for (int aCharNum = 0; aCharNum < 256; aCharNum++)
+						anActiveFontLayer->mScaledCharImageRects[aCharNum] =
+							anActiveFontLayer->mScaledLayer->mCharImageRects[aCharNum];
 				}
 
 				int aLayerAscent = (aFontLayer->mAscent * aPointSize) / aLayerPointSize;
@@ -1542,7 +1784,7 @@ void ImageFont::DrawStringEx(Graphics *g, int theX, int theY, const PopString &t
 
 			RenderCommand *aRenderCommand = &gRenderCommandPool[aCurPoolIdx++];
 
-			aRenderCommand->mImage = anActiveFontLayer->mScaledImage;
+			aRenderCommand->mImage = anActiveFontLayer->GetCharImage((uchar)aChar);
 			aRenderCommand->mColor = aColor;
 			aRenderCommand->mDest[0] = anImageX;
 			aRenderCommand->mDest[1] = anImageY;
@@ -1683,12 +1925,14 @@ void ImageFont::SetPointSize(int thePointSize)
 {
 	mPointSize = thePointSize;
 	mActiveListValid = false;
+	LayoutChanged();
 }
 
 void ImageFont::SetScale(double theScale)
 {
 	mScale = theScale;
 	mActiveListValid = false;
+	LayoutChanged();
 }
 
 int ImageFont::GetPointSize()
@@ -1709,6 +1953,7 @@ bool ImageFont::AddTag(const std::string &theTagName)
 	std::string aTagName = StringToUpper(theTagName);
 	mTagVector.push_back(aTagName);
 	mActiveListValid = false;
+	LayoutChanged();
 	return true;
 }
 
@@ -1722,6 +1967,7 @@ bool ImageFont::RemoveTag(const std::string &theTagName)
 
 	mTagVector.erase(anItr);
 	mActiveListValid = false;
+	LayoutChanged();
 	return true;
 }
 
@@ -1741,6 +1987,23 @@ std::string ImageFont::GetDefine(const std::string &theName)
 	return mFontData->DataElementToString(aDataElement);
 }
 
+void ImageFont::SetFontData(FontData *theFontData)
+{
+	theFontData->Ref();
+
+	bool hasDefaultSize = mPointSize == mFontData->mDefaultPointSize;
+	mActiveLayerList.clear();
+	mFontData->DeRef();
+	mFontData = theFontData;
+
+	if (hasDefaultSize)
+		mPointSize = mFontData->mDefaultPointSize;
+
+	mActiveListValid = false;
+	Prepare();
+	LayoutChanged();
+}
+
 void ImageFont::Prepare()
 {
 	if (!mActiveListValid)
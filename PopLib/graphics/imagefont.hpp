@@ -95,19 +95,83 @@ class FontData : public DescParser
 	bool LoadLegacy(Image *theFontImage, const std::string &theFontDescFileName);
 };
 
+/**
+ * @brief a FontLayer scaled to one size, shared by every ImageFont drawing the layer at that size
+ *
+ * the glyphs are packed into pages no bigger than SCALED_FONT_PAGE_SIZE and
+ * only scaled the first time they're drawn. sizes no font uses anymore are
+ * kept around until they take more than the unused cache size, the least
+ * recently used go first.
+ */
+class ScaledFontLayer
+{
+  public:
+	FontLayer *mBaseFontLayer;
+	double mPointSize;
+	double mLayerPointSize;
+	bool mForceWhite;
+	int mRefCount;
+
+	std::vector<MemoryImage *> mPages;
+	Rect mCharImageRects[256];
+	uchar mCharPage[256];
+	bool mCharReady[256];
+	int mSourceBitsChangedCount; ///< of the layer's image when the glyphs were scaled, they're redone if it's reloaded
+
+  protected:
+	ScaledFontLayer(FontLayer *theFontLayer, double thePointSize, double theLayerPointSize, bool forceWhite);
+	~ScaledFontLayer();
+
+	int GetMemorySize();
+
+	static void RemoveUnused(ScaledFontLayer *theScaledLayer);
+	static void TrimUnused();
+
+  public:
+	/// @brief finds or makes the layer scaled to a size, with a reference to it
+	/// @param theFontLayer
+	/// @param thePointSize
+	/// @param theLayerPointSize the glyphs are scaled by thePointSize / theLayerPointSize
+	/// @param forceWhite true to make the glyphs white, keeping their alpha
+	/// @return the scaled layer, DeRef it when done
+	static ScaledFontLayer *Get(FontLayer *theFontLayer, double thePointSize, double theLayerPointSize,
+								bool forceWhite);
+	/// @brief deletes the unused sizes of every layer in theFontData
+	/// @param theFontData
+	static void RemoveFontData(FontData *theFontData);
+	/// @brief sets how many bytes of sizes no font uses are kept, 4 MB by default
+	/// @param theBytes
+	static void SetUnusedCacheSize(int theBytes);
+
+	void Ref();
+	void DeRef();
+
+	/// @brief scales the glyph if it wasn't already
+	/// @param theChar
+	/// @return the page the glyph is on, nullptr if the glyph is empty
+	Image *PrepareChar(uchar theChar);
+};
+
 class ActiveFontLayer
 {
   public:
 	FontLayer *mBaseFontLayer;
 
-	Image *mScaledImage;
-	bool mOwnsImage;
+	Image *mScaledImage;		   ///< the layer's own image, if it's drawn at its own size
+	ScaledFontLayer *mScaledLayer; ///< otherwise
 	Rect mScaledCharImageRects[256];
 
   public:
 	ActiveFontLayer();
 	ActiveFontLayer(const ActiveFontLayer &theActiveFontLayer);
 	virtual ~ActiveFontLayer();
+
+	ActiveFontLayer &operator=(const ActiveFontLayer &theActiveFontLayer);
+
+	/// @brief the image to draw a glyph from, scaling it first if needed
+	/// @param theChar
+	/// @return the image mScaledCharImageRects[theChar] is in
+	Image *GetCharImage(uchar theChar);
 };
 
 typedef std::list<ActiveFontLayer> ActiveFontLayerList;
@@ -171,6 +235,13 @@ class ImageFont : public Font
 
 	PopChar GetMappedChar(char value);
 
+	/// @brief switches to other font data, like a reloaded descriptor
+	///
+	/// tags and a point size set by hand are kept. fonts duplicated from
+	/// this one keep using the old data.
+	/// @param theFontData
+	void SetFontData(FontData *theFontData);
+
 	virtual void Prepare();
 };
 
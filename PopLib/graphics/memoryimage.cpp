@@ -4,6 +4,7 @@
 #include "graphics.hpp"
 #include "nativedisplay.hpp"
 #include "sdlinterface.hpp"
+#include "swinterface.hpp"
 #include "debug/debug.hpp"
 #include "quantize.hpp"
 #include "debug/perftimer.hpp"
@@ -40,6 +41,7 @@ MemoryImage::MemoryImage(const MemoryImage &theMemoryImage)
 	  mImageFlags(theMemoryImage.mImageFlags), mBitsChangedCount(theMemoryImage.mBitsChangedCount), mD3DData(nullptr)
 {
 	bool deleteBits = false;
+	mFileBitsChangedCount = -1;
 
 	MemoryImage *aNonConstMemoryImage = (MemoryImage *)&theMemoryImage;
 
@@ -117,8 +119,17 @@ MemoryImage::MemoryImage(const MemoryImage &theMemoryImage)
 	mApp->AddMemoryImage(this);
 }
 
+// the software renderer reads images when the frame is flushed, so draws still
+// waiting on this one have to go out before its bits change or it's deleted
+static void FlushPendingDraws(AppBase *theApp, MemoryImage *theImage)
+{
+	if (theApp != nullptr && theApp->mSDLInterface != nullptr && theApp->mSDLInterface->mSWInterface != nullptr)
+		theApp->mSDLInterface->mSWInterface->ImageChanged(theImage);
+}
+
 MemoryImage::~MemoryImage()
 {
+	FlushPendingDraws(mApp, this);
 	mApp->RemoveMemoryImage(this);
 
 	delete[] mBits;
@@ -147,6 +158,7 @@ void MemoryImage::Init()
 	mD3DData = nullptr;
 	mImageFlags = 0;
 	mBitsChangedCount = 0;
+	mFileBitsChangedCount = -1;
 
 	mPurgeBits = false;
 	mWantPal = false;
@@ -156,6 +168,8 @@ void MemoryImage::Init()
 
 void MemoryImage::BitsChanged()
 {
+	FlushPendingDraws(mApp, this);
+
 	mBitsChanged = true;
 	mBitsChangedCount++;
 
@@ -1144,6 +1158,27 @@ void MemoryImage::ReInit()
 		PurgeBits();
 }
 
+int64_t MemoryImage::GetMemSize()
+{
+	int64_t aPixels = (int64_t)mWidth * mHeight;
+	int64_t aSize = 0;
+
+	if (mBits != nullptr)
+		aSize += (aPixels + 1) * sizeof(ulong);
+	if (mColorTable != nullptr)
+		aSize += 256 * sizeof(ulong);
+	if (mColorIndices != nullptr)
+		aSize += aPixels;
+	if (mNativeAlphaData != nullptr)
+		aSize += (mColorTable != nullptr ? 256 : aPixels) * sizeof(ulong);
+	if (mRLAlphaData != nullptr)
+		aSize += aPixels;
+	if (mRLAdditiveData != nullptr)
+		aSize += aPixels;
+
+	return aSize;
+}
+
 void MemoryImage::DeleteNativeData()
 {
 	if ((mBits == nullptr) && (mColorIndices == nullptr))
@@ -1166,7 +1201,7 @@ void MemoryImage::SetBits(ulong *theBits, int theWidth, int theHeight, bool comm
 		delete[] mColorTable;
 		mColorTable = nullptr;
 
-		if (theWidth != mWidth || theHeight != mHeight)
+		if (mBits == nullptr || theWidth != mWidth || theHeight != mHeight)
 		{
 			delete[] mBits;
 			mBits = new ulong[theWidth * theHeight + 1];
@@ -1803,6 +1838,21 @@ void MemoryImage::BltTrianglesTexHelper(Image *theTexture, const TriVertex theVe
 				vertexColor = true;
 		}
 
+		if (anImage == nullptr)
+		{
+			// SWTri only fills untextured triangles from their vertex colors, so give them the draw color
+			for (int j = 0; j < 3; j++)
+			{
+				ulong aDiffuse = vertexColor ? aVerts[j].mDiffuse : 0xFFFFFFFF;
+				ulong aModulated = 0;
+				for (int aShift = 0; aShift < 32; aShift += 8)
+					aModulated |= ((((aDiffuse >> aShift) & 0xFF) * (((ulong)aColor >> aShift) & 0xFF)) / 255)
+								  << aShift;
+				aVerts[j].mDiffuse = aModulated;
+			}
+			vertexColor = true;
+		}
+
 		SWHelper::SWDrawShape(aVerts, 3, anImage, theColor, theDrawMode, theClipRect, theSurface, theBytePitch,
 							  thePixelFormat, blend, vertexColor);
 	}
@@ -1850,7 +1900,8 @@ void MemoryImage::BltTrianglesTex(Image *theTexture, const TriVertex theVertices
 								  const Rect &theClipRect, const Color &theColor, int theDrawMode, float tx, float ty,
 								  bool blend)
 {
-	theTexture->mDrawn = true;
+	if (theTexture != nullptr)
+		theTexture->mDrawn = true;
 
 	ulong *aSurface = GetBits();
 
@@ -1864,6 +1915,40 @@ void MemoryImage::BltTrianglesTex(Image *theTexture, const TriVertex theVertices
 	BitsChanged();
 }
 
+void MemoryImage::BltMesh(Image *theTexture, const TriVertex theVertices[], int theNumVertices, const int theIndices[],
+						  int theNumIndices, const Rect &theClipRect, const Color &theColor, int theDrawMode, float tx,
+						  float ty, bool blend)
+{
+	if (theIndices == nullptr)
+	{
+		BltTrianglesTex(theTexture, (const TriVertex(*)[3])theVertices, theNumVertices / 3, theClipRect, theColor,
+						theDrawMode, tx, ty, blend);
+		return;
+	}
+
+	// the software rasterizer only takes triangle lists, so expand the indices, per thread as any of them can draw.
+	// triangles pointing past the vertices are skipped
+	static thread_local std::vector<TriVertex> aTriangles;
+	aTriangles.clear();
+	for (int i = 0; i + 2 < theNumIndices; i += 3)
+	{
+		const int *aTri = theIndices + i;
+		if ((unsigned)aTri[0] >= (unsigned)theNumVertices || (unsigned)aTri[1] >= (unsigned)theNumVertices ||
+			(unsigned)aTri[2] >= (unsigned)theNumVertices)
+			continue;
+
+		aTriangles.push_back(theVertices[aTri[0]]);
+		aTriangles.push_back(theVertices[aTri[1]]);
+		aTriangles.push_back(theVertices[aTri[2]]);
+	}
+
+	if (aTriangles.empty())
+		return;
+
+	BltTrianglesTex(theTexture, (const TriVertex(*)[3])aTriangles.data(), (int)aTriangles.size() / 3, theClipRect,
+					theColor, theDrawMode, tx, ty, blend);
+}
+
 bool MemoryImage::Palletize()
 {
 	CommitBits();
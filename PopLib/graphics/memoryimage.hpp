@@ -24,6 +24,7 @@ class MemoryImage : public Image
   public:
 	ulong *mBits;
 	int mBitsChangedCount;
+	int mFileBitsChangedCount; // mBitsChangedCount right after loading mFilePath, -1 if not loaded from a file
 	void *mD3DData;
 	uint32_t mImageFlags; // see D3DInterface.h for possible values
 
@@ -56,6 +57,9 @@ class MemoryImage : public Image
 	virtual void Delete3DBuffers();
 	virtual void DeleteExtraBuffers();
 	virtual void ReInit();
+	/// @brief bytes of system memory taken by the pixels and the buffers made from them, textures not included
+	/// @return the size
+	virtual int64_t GetMemSize();
 
 	virtual void BitsChanged();
 	virtual void CommitBits();
@@ -124,6 +128,9 @@ class MemoryImage : public Image
 	virtual void BltTrianglesTex(Image *theTexture, const TriVertex theVertices[][3], int theNumTriangles,
 								 const Rect &theClipRect, const Color &theColor, int theDrawMode, float tx, float ty,
 								 bool blend);
+	virtual void BltMesh(Image *theTexture, const TriVertex theVertices[], int theNumVertices, const int theIndices[],
+						 int theNumIndices, const Rect &theClipRect, const Color &theColor, int theDrawMode, float tx,
+						 float ty, bool blend);
 
 	virtual void SetImageMode(bool hasTrans, bool hasAlpha);
 	virtual void SetVolatile(bool isVolatile);
@@ -0,0 +1,213 @@
+#include "polytessellator.hpp"
+#include "vertexbatch.hpp"
+
+#include <math.h>
+
+using namespace PopLib;
+
+static float Cross(float ax, float ay, float bx, float by, float cx, float cy)
+{
+	return (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+}
+
+PolyTessellator::PolyTessellator()
+{
+}
+
+PolyTessellator::~PolyTessellator()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool PolyTessellator::Tessellate(const Point theVertices[], int theNumVertices, uint32_t theColor, bool convex,
+								 bool antiAlias, VertexBatch *theBatch)
+{
+	// drop repeated points, they'd make zero length edges
+	mX.clear();
+	mY.clear();
+	for (int i = 0; i < theNumVertices; i++)
+	{
+		float x = (float)theVertices[i].mX;
+		float y = (float)theVertices[i].mY;
+		if (!mX.empty() && mX.back() == x && mY.back() == y)
+			continue;
+
+		mX.push_back(x);
+		mY.push_back(y);
+	}
+
+	while (mX.size() > 1 && mX.front() == mX.back() && mY.front() == mY.back())
+	{
+		mX.pop_back();
+		mY.pop_back();
+	}
+
+	int aCount = (int)mX.size();
+	if (aCount < 3)
+		return false;
+
+	float anArea = 0;
+	for (int i = 0, j = aCount - 1; i < aCount; j = i++)
+		anArea += mX[j] * mY[i] - mX[i] * mY[j];
+
+	if (anArea == 0)
+		return false;
+
+	float anOrientation = anArea > 0 ? 1.0f : -1.0f;
+
+	mTriangles.clear();
+	if (convex)
+		TriangulateFan();
+	else
+		TriangulateEars(anOrientation);
+
+	int aBase = (int)theBatch->mVertices.size();
+	theBatch->Reserve(antiAlias ? aCount * 2 : aCount, (int)mTriangles.size() + (antiAlias ? aCount * 6 : 0));
+
+	if (!antiAlias)
+	{
+		for (int i = 0; i < aCount; i++)
+			theBatch->AddVertex(TriVertex(mX[i], mY[i], 0, 0, theColor));
+
+		for (int anIndex : mTriangles)
+			theBatch->AddIndex(aBase + anIndex);
+
+		return true;
+	}
+
+	// a color of 0 would mean "use the draw color", keep the fringe transparent
+	uint32_t anOuterColor = theColor & 0x00FFFFFF;
+	if (anOuterColor == 0)
+		anOuterColor = 1;
+
+	// every vertex gets an inner copy half a pixel in and an outer copy half a pixel out
+	for (int i = 0; i < aCount; i++)
+	{
+		int aPrev = i == 0 ? aCount - 1 : i - 1;
+		int aNext = i == aCount - 1 ? 0 : i + 1;
+
+		float aNormals[2][2];
+		int anEdges[2][2] = {{aPrev, i}, {i, aNext}};
+		for (int anEdge = 0; anEdge < 2; anEdge++)
+		{
+			float dx = mX[anEdges[anEdge][1]] - mX[anEdges[anEdge][0]];
+			float dy = mY[anEdges[anEdge][1]] - mY[anEdges[anEdge][0]];
+			float aLength = sqrtf(dx * dx + dy * dy);
+			aNormals[anEdge][0] = dy / aLength * anOrientation;
+			aNormals[anEdge][1] = -dx / aLength * anOrientation;
+		}
+
+		// miter, clamped so sharp spikes don't shoot out
+		float nx = (aNormals[0][0] + aNormals[1][0]) * 0.5f;
+		float ny = (aNormals[0][1] + aNormals[1][1]) * 0.5f;
+		float aLengthSq = nx * nx + ny * ny;
+		float aScale = 0.5f / std::max(aLengthSq, 0.25f);
+		nx *= aScale;
+		ny *= aScale;
+
+		theBatch->AddVertex(TriVertex(mX[i] - nx, mY[i] - ny, 0, 0, theColor));
+		theBatch->AddVertex(TriVertex(mX[i] + nx, mY[i] + ny, 0, 0, anOuterColor));
+	}
+
+	for (int anIndex : mTriangles)
+		theBatch->AddIndex(aBase + anIndex * 2);
+
+	for (int i = 0; i < aCount; i++)
+	{
+		int aNext = i == aCount - 1 ? 0 : i + 1;
+		int anInner0 = aBase + i * 2, anOuter0 = anInner0 + 1;
+		int anInner1 = aBase + aNext * 2, anOuter1 = anInner1 + 1;
+
+		theBatch->AddIndex(anInner0);
+		theBatch->AddIndex(anOuter0);
+		theBatch->AddIndex(anOuter1);
+		theBatch->AddIndex(anInner0);
+		theBatch->AddIndex(anOuter1);
+		theBatch->AddIndex(anInner1);
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void PolyTessellator::TriangulateFan()
+{
+	for (int i = 1; i < (int)mX.size() - 1; i++)
+	{
+		mTriangles.push_back(0);
+		mTriangles.push_back(i);
+		mTriangles.push_back(i + 1);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void PolyTessellator::TriangulateEars(float theOrientation)
+{
+	int aCount = (int)mX.size();
+	mRemaining.resize(aCount);
+	for (int i = 0; i < aCount; i++)
+		mRemaining[i] = i;
+
+	int aCur = 0;
+	int aTries = 0;
+	while (aCount > 3)
+	{
+		int aPrev = aCur == 0 ? aCount - 1 : aCur - 1;
+		int aNext = aCur == aCount - 1 ? 0 : aCur + 1;
+
+		// if a whole lap found no ear the outline crosses itself, clip anyway so we always finish
+		if (aTries > aCount || IsEar(mRemaining[aPrev], mRemaining[aCur], mRemaining[aNext], theOrientation))
+		{
+			mTriangles.push_back(mRemaining[aPrev]);
+			mTriangles.push_back(mRemaining[aCur]);
+			mTriangles.push_back(mRemaining[aNext]);
+
+			mRemaining.erase(mRemaining.begin() + aCur);
+			aCount--;
+			aTries = 0;
+			if (aCur >= aCount)
+				aCur = 0;
+		}
+		else
+		{
+			aCur = aNext;
+			aTries++;
+		}
+	}
+
+	mTriangles.push_back(mRemaining[0]);
+	mTriangles.push_back(mRemaining[1]);
+	mTriangles.push_back(mRemaining[2]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool PolyTessellator::IsEar(int thePrev, int theCur, int theNext, float theOrientation) const
+{
+	float ax = mX[thePrev], ay = mY[thePrev];
+	float bx = mX[theCur], by = mY[theCur];
+	float cx = mX[theNext], cy = mY[theNext];
+
+	// reflex or flat corners aren't ears
+	if (Cross(ax, ay, bx, by, cx, cy) * theOrientation <= 0)
+		return false;
+
+	for (int anIndex : mRemaining)
+	{
+		if (anIndex == thePrev || anIndex == theCur || anIndex == theNext)
+			continue;
+
+		float px = mX[anIndex], py = mY[anIndex];
+		if ((px == ax && py == ay) || (px == bx && py == by) || (px == cx && py == cy))
+			continue;
+
+		if (Cross(ax, ay, bx, by, px, py) * theOrientation >= 0 &&
+			Cross(bx, by, cx, cy, px, py) * theOrientation >= 0 && Cross(cx, cy, ax, ay, px, py) * theOrientation >= 0)
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,54 @@
+#ifndef __POLYTESSELLATOR_HPP__
+#define __POLYTESSELLATOR_HPP__
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "common.hpp"
+#include "math/point.hpp"
+
+namespace PopLib
+{
+
+class VertexBatch;
+
+/**
+ * @brief turns a polygon into triangles for the GPU
+ *
+ * convex polygons become a fan, everything else is ear clipped, so concave
+ * shapes like radial menu slices work too. with antiAlias a half pixel wide
+ * fringe that fades to transparent is added around the outline, which looks
+ * like the software coverage fill without touching any pixels on the CPU.
+ * self intersecting polygons don't break it, but aren't filled even-odd.
+ */
+class PolyTessellator
+{
+  public:
+	PolyTessellator();
+	virtual ~PolyTessellator();
+
+	/// @brief appends the triangles of a polygon to a batch
+	/// @param theVertices outline, either winding
+	/// @param theNumVertices
+	/// @param theColor ARGB
+	/// @param convex if true the polygon is trusted to be convex and drawn as a fan
+	/// @param antiAlias if true adds the fringe
+	/// @param theBatch
+	/// @return false if the polygon has no area
+	bool Tessellate(const Point theVertices[], int theNumVertices, uint32_t theColor, bool convex, bool antiAlias,
+					VertexBatch *theBatch);
+
+  protected:
+	std::vector<float> mX;
+	std::vector<float> mY;
+	std::vector<int> mRemaining;
+	std::vector<int> mTriangles;
+
+	void TriangulateFan();
+	void TriangulateEars(float theOrientation);
+	bool IsEar(int thePrev, int theCur, int theNext, float theOrientation) const;
+};
+
+} // namespace PopLib
+
+#endif
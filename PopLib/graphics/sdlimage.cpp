@@ -40,9 +40,9 @@ void SDLImage::Create(int theWidth, int theHeight)
 }
 
 bool SDLImage::PolyFill3D(const Point theVertices[], int theNumVertices, const Rect *theClipRect, const Color &theColor,
-						  int theDrawMode, int tx, int ty)
+						  int theDrawMode, int tx, int ty, bool convex, bool antiAlias)
 {
-	mInterface->FillPoly(theVertices, theNumVertices, theClipRect, theColor, theDrawMode, tx, ty);
+	mInterface->FillPoly(theVertices, theNumVertices, theClipRect, theColor, theDrawMode, tx, ty, convex, antiAlias);
 	return true;
 }
 
@@ -131,6 +131,17 @@ void SDLImage::BltTrianglesTex(Image *theTexture, const TriVertex theVertices[][
 	mInterface->DrawTrianglesTex(theVertices, theNumTriangles, theColor, theDrawMode, theTexture, tx, ty, blend);
 }
 
+void SDLImage::BltMesh(Image *theTexture, const TriVertex theVertices[], int theNumVertices, const int theIndices[],
+					   int theNumIndices, const Rect &theClipRect, const Color &theColor, int theDrawMode, float tx,
+					   float ty, bool blend)
+{
+	if (theTexture != nullptr)
+		theTexture->mDrawn = true;
+
+	mInterface->DrawMesh(theVertices, theNumVertices, theIndices, theNumIndices, theColor, theDrawMode, theTexture,
+						 &theClipRect, tx, ty);
+}
+
 void SDLImage::BltMirror(Image *theImage, int theX, int theY, const Rect &theSrcRect, const Color &theColor,
 								  int theDrawMode)
 {
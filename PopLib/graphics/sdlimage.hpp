@@ -35,7 +35,8 @@ class SDLImage : public MemoryImage
 	virtual void Create(int theWidth, int theHeight);
 
 	virtual bool PolyFill3D(const Point theVertices[], int theNumVertices, const Rect *theClipRect,
-							const Color &theColor, int theDrawMode, int tx, int ty);
+							const Color &theColor, int theDrawMode, int tx, int ty, bool convex,
+							bool antiAlias = false);
 	virtual void FillRect(const Rect &theRect, const Color &theColor, int theDrawMode);
 	virtual void DrawLine(double theStartX, double theStartY, double theEndX, double theEndY, const Color &theColor,
 						  int theDrawMode);
@@ -55,6 +56,9 @@ class SDLImage : public MemoryImage
 	virtual void BltTrianglesTex(Image *theTexture, const TriVertex theVertices[][3], int theNumTriangles,
 								 const Rect &theClipRect, const Color &theColor, int theDrawMode, float tx, float ty,
 								 bool blend);
+	virtual void BltMesh(Image *theTexture, const TriVertex theVertices[], int theNumVertices, const int theIndices[],
+						 int theNumIndices, const Rect &theClipRect, const Color &theColor, int theDrawMode, float tx,
+						 float ty, bool blend);
 
 	virtual void BltMirror(Image *theImage, int theX, int theY, const Rect &theSrcRect, const Color &theColor,
 						   int theDrawMode);
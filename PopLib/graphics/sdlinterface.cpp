@@ -1,12 +1,18 @@
 #include "sdlinterface.hpp"
 #include "sdlimage.hpp"
+#include "swinterface.hpp"
 #include "appbase.hpp"
 #include "misc/autocrit.hpp"
 #include "misc/critsect.hpp"
 #include "graphics.hpp"
 #include "memoryimage.hpp"
 #include "imgui/imguimanager.hpp"
+#include "debug/framestats.hpp"
+#include "resources/resourcemanager.hpp"
 #include <SDL3_ttf/SDL_ttf.h>
+#include <algorithm>
+#include <atomic>
+#include <climits>
 
 using namespace PopLib;
 
@@ -30,7 +36,15 @@ SDLInterface::SDLInterface(AppBase *theApp)
 	mHasInitiated = false;
 	mCursorX = 0;
 	mCursorY = 0;
+	mCursorImage = nullptr;
+	mCursorCel = 0;
+	mCursorHotX = -1;
+	mCursorHotY = -1;
+	for (int i = 0; i < SDL_SYSTEM_CURSOR_COUNT; i++)
+		mSystemCursors[i] = nullptr;
 	mIs3D = false;
+	mSoftwareRender = false;
+	mSWInterface = nullptr;
 	mMillisecondsPerFrame = 0;
 	mNextCursorX = 0;
 	mNextCursorY = 0;
@@ -38,11 +52,21 @@ SDLInterface::SDLInterface(AppBase *theApp)
 	mRenderer = nullptr;
 	mScreenTexture = nullptr;
 	mWindow = nullptr;
+	mTextureBudget = 0;
+	mFrameNum = 0;
 }
 
 SDLInterface::~SDLInterface()
 {
 	Cleanup();
+
+	for (SDLCursorMap::iterator anItr = mCursorMap.begin(); anItr != mCursorMap.end(); ++anItr)
+		SDL_DestroyCursor(anItr->second.mCursor);
+	mCursorMap.clear();
+
+	for (int i = 0; i < SDL_SYSTEM_CURSOR_COUNT; i++)
+		SDL_DestroyCursor(mSystemCursors[i]);
+
 	SDL_Quit();
 }
 
@@ -58,6 +82,10 @@ void SDLInterface::Cleanup()
 	}
 	mImageSet.clear();
 
+	// its texture belongs to the renderer
+	delete mSWInterface;
+	mSWInterface = nullptr;
+
 	SDL_DestroyRenderer(mRenderer);
 	SDL_DestroyWindow(mWindow);
 	mHasInitiated = false;
@@ -91,8 +119,11 @@ void SDLInterface::Remove3DData(MemoryImage *theImage)
 	}
 }
 
-SDLImage *SDLInterface::GetScreenImage()
+MemoryImage *SDLInterface::GetScreenImage()
 {
+	if (mSWInterface != nullptr)
+		return mSWInterface->GetScreenImage();
+
 	return mScreenImage;
 }
 
@@ -210,13 +241,19 @@ bool SDLInterface::Redraw(Rect *theClipRect)
 
 	SDL_SetRenderClipRect(mRenderer, &clipRect);
 
-	PopLib::gSDLInterfacePreDrawError = (SDL_RenderTexture(mRenderer, mScreenTexture, nullptr, nullptr) < 0);
+	if (mSWInterface != nullptr)
+		PopLib::gSDLInterfacePreDrawError = !mSWInterface->Present(mRenderer);
+	else
+		PopLib::gSDLInterfacePreDrawError = (SDL_RenderTexture(mRenderer, mScreenTexture, nullptr, nullptr) < 0);
 
 	if (ImGui::GetDrawData() != nullptr)
 		ImGui_ImplSDLRenderer3_RenderDrawData(ImGui::GetDrawData(), mRenderer);
 
 	SDL_RenderPresent(mRenderer);
 
+	mFrameNum++;
+	EnforceTextureBudget();
+
 	return !PopLib::gSDLInterfacePreDrawError;
 }
 
@@ -235,6 +272,12 @@ void SDLInterface::SetVideoOnlyDraw(bool videoOnly)
 	mScreenImage->mWidth = mWidth;
 	mScreenImage->mHeight = mHeight;
 	mScreenImage->SetImageMode(false, false);
+
+	if (mSoftwareRender)
+	{
+		delete mSWInterface;
+		mSWInterface = new SWInterface(mApp, mWidth, mHeight);
+	}
 }
 
 /// <summary>
@@ -253,29 +296,74 @@ void SDLInterface::SetCursorPos(int theCursorX, int theCursorY)
 /// </summary>
 /// <param name="theImage"></param>
 /// <returns></returns>
-bool SDLInterface::SetCursorImage(Image *theImage)
+bool SDLInterface::SetCursorImage(Image *theImage, int theCel, int theHotX, int theHotY)
 {
 	AutoCrit anAutoCrit(mCritSect);
 
-	if (mCursorImage != theImage)
+	MemoryImage *aMemoryImage = (MemoryImage *)theImage;
+	SDLCursorKey aKey = {theImage, theCel, theHotX, theHotY};
+	SDLCursorMap::iterator anItr = mCursorMap.find(aKey);
+
+	bool changed =
+		mCursorImage != theImage || mCursorCel != theCel || mCursorHotX != theHotX || mCursorHotY != theHotY;
+	bool stale = theImage != nullptr &&
+				 (anItr == mCursorMap.end() || anItr->second.mBitsChangedCount != aMemoryImage->mBitsChangedCount);
+
+	if (!changed && !stale)
+		return false;
+
+	mCursorImage = theImage;
+	mCursorCel = theCel;
+	mCursorHotX = theHotX;
+	mCursorHotY = theHotY;
+
+	if (theImage == nullptr)
+		return true;
+
+	if (stale)
 	{
-		mCursorImage = theImage;
-		if (theImage == nullptr)
+		// point the surface at the cel inside the image's bits instead of copying them
+		Rect aCelRect = theImage->GetCelRect(theCel);
+		ulong *aBits = aMemoryImage->GetBits() + aCelRect.mY * theImage->mWidth + aCelRect.mX;
+
+		SDL_Surface *aSurface = SDL_CreateSurfaceFrom(aCelRect.mWidth, aCelRect.mHeight, SDL_PIXELFORMAT_ARGB8888,
+													  aBits, theImage->mWidth * sizeof(ulong));
+		SDL_Cursor *aCursor =
+			SDL_CreateColorCursor(aSurface, (theHotX < 0) ? aCelRect.mWidth / 2 : theHotX,
+								  (theHotY < 0) ? aCelRect.mHeight / 2 : theHotY);
+		SDL_DestroySurface(aSurface);
+
+		if (anItr != mCursorMap.end())
+		{
+			SDL_DestroyCursor(anItr->second.mCursor);
+			mCursorMap.erase(anItr);
+		}
+
+		if (aCursor == nullptr)
 			return true;
-		SDL_Surface *aSurface =
-			SDL_CreateSurfaceFrom(theImage->mWidth, theImage->mHeight, SDL_PIXELFORMAT_ARGB8888,
-								  ((MemoryImage *)mCursorImage)->GetBits(), theImage->mWidth * sizeof(ulong));
 
-		SDL_Cursor *aCursor = SDL_CreateColorCursor(aSurface, mCursorImage->mWidth / 2, mCursorImage->mHeight / 2);
+		SDLCursorData aData = {aCursor, aMemoryImage->mBitsChangedCount};
+		anItr = mCursorMap.insert(SDLCursorMap::value_type(aKey, aData)).first;
+	}
 
-		SDL_SetCursor(aCursor);
+	SDL_SetCursor(anItr->second.mCursor);
 
-		SDL_DestroySurface(aSurface);
+	return true;
+}
 
-		return true;
+void SDLInterface::RemoveCursorImage(Image *theImage)
+{
+	AutoCrit anAutoCrit(mCritSect);
+
+	SDLCursorMap::iterator anItr = mCursorMap.lower_bound(SDLCursorKey{theImage, INT_MIN, INT_MIN, INT_MIN});
+	while (anItr != mCursorMap.end() && anItr->first.mImage == theImage)
+	{
+		SDL_DestroyCursor(anItr->second.mCursor);
+		anItr = mCursorMap.erase(anItr);
 	}
 
-	return false;
+	if (mCursorImage == theImage)
+		mCursorImage = nullptr;
 }
 
 bool SDLInterface::UpdateWindowIcon(Image *theImage)
@@ -296,9 +384,15 @@ bool SDLInterface::UpdateWindowIcon(Image *theImage)
 
 void SDLInterface::SetCursor(SDL_SystemCursor theCursorType)
 {
-	SDL_Cursor *aCursor = SDL_CreateSystemCursor(theCursorType);
-	SDL_SetCursor(aCursor);
-	//SDL_DestroyCursor(aCursor);
+	if (theCursorType < 0 || theCursorType >= SDL_SYSTEM_CURSOR_COUNT)
+		return;
+
+	SDL_Cursor *&aCursor = mSystemCursors[theCursorType];
+	if (aCursor == nullptr)
+		aCursor = SDL_CreateSystemCursor(theCursorType);
+
+	if (aCursor != nullptr && SDL_GetCursor() != aCursor)
+		SDL_SetCursor(aCursor);
 }
 
 void SDLInterface::MakeSimpleMessageBox(const char *theTitle, const char *theMessage, SDL_MessageBoxFlags flags)
@@ -352,7 +446,14 @@ bool SDLInterface::CreateImageTexture(MemoryImage *theImage)
 	}
 
 	SDLTextureData *aData = static_cast<SDLTextureData *>(theImage->mD3DData);
+	if (aData->mTexture == nullptr && aData->mBitsChangedCount == theImage->mBitsChangedCount)
+	{
+		// evicted by the texture budget, the bits were only brought back to upload them again
+		wantPurge = theImage->mPurgeBits;
+	}
+
 	aData->CheckCreateTextures(theImage);
+	aData->mLastUsedFrame = mFrameNum;
 
 	if (wantPurge)
 		theImage->PurgeBits();
@@ -369,20 +470,82 @@ bool SDLInterface::RecoverBits(MemoryImage *theImage)
 	if (aData->mBitsChangedCount != theImage->mBitsChangedCount) // bits have changed since texture was created
 		return false;
 
+	if (aData->mTexture == nullptr)
+	{
+		// the texture was evicted, load the image again instead. through the resource manager, which
+		// also puts back what an image resource composed into it when loading
+		if (theImage->mFileBitsChangedCount != theImage->mBitsChangedCount || mApp->mResourceManager == nullptr)
+			return false;
+
+		return mApp->mResourceManager->ReloadImageBits(theImage);
+	}
+
 	// Reverse the process: copy texture data to theImage
 	float aWidth;
 	float aHeight;
 	void *pixels;
 	int pitch;
 
-	if (SDL_LockTexture(aData->mTexture, nullptr, &pixels, &pitch) &&
-		SDL_GetTextureSize(aData->mTexture, &aWidth, &aHeight))
+	if (!SDL_LockTexture(aData->mTexture, nullptr, &pixels, &pitch) ||
+		!SDL_GetTextureSize(aData->mTexture, &aWidth, &aHeight))
+		return false;
+
+	theImage->SetBits((ulong *)pixels, (int)aWidth, (int)aHeight);
+	SDL_UnlockTexture(aData->mTexture);
+
+	return true;
+}
+
+void SDLInterface::SetTextureBudget(int64_t theBytes)
+{
+	mTextureBudget = theBytes;
+}
+
+bool SDLInterface::CanEvictTexture(MemoryImage *theImage)
+{
+	// the render target or something still holding its pixels in the texture only
+	if (theImage == mScreenImage)
+		return false;
+
+	if (theImage->mBits != nullptr || theImage->mColorTable != nullptr)
+		return true;
+
+	return theImage->mFileBitsChangedCount == theImage->mBitsChangedCount && !theImage->mFilePath.empty();
+}
+
+void SDLInterface::EnforceTextureBudget()
+{
+	if (mTextureBudget <= 0 || SDLTextureData::GetTotalMemSize() <= mTextureBudget)
+		return;
+
+	AutoCrit anAutoCrit(mCritSect);
+
+	std::vector<MemoryImage *> aCandidates;
+	aCandidates.reserve(mImageSet.size());
+	for (MemoryImage *anImage : mImageSet)
 	{
-		theImage->SetBits((ulong *)pixels, (int)aWidth, (int)aHeight);
-		SDL_UnlockTexture(aData->mTexture);
+		SDLTextureData *aData = (SDLTextureData *)anImage->mD3DData;
+
+		// anything drawn in the frame just presented is likely needed in the next one too
+		if (aData == nullptr || aData->mTexture == nullptr || aData->mLastUsedFrame + 1 >= mFrameNum)
+			continue;
+
+		if (CanEvictTexture(anImage))
+			aCandidates.push_back(anImage);
 	}
 
-	return true;
+	std::sort(aCandidates.begin(), aCandidates.end(), [](MemoryImage *a, MemoryImage *b) {
+		return ((SDLTextureData *)a->mD3DData)->mLastUsedFrame < ((SDLTextureData *)b->mD3DData)->mLastUsedFrame;
+	});
+
+	for (MemoryImage *anImage : aCandidates)
+	{
+		if (SDLTextureData::GetTotalMemSize() <= mTextureBudget)
+			break;
+
+		((SDLTextureData *)anImage->mD3DData)->ReleaseTextures();
+		FrameStats::Add(FRAMESTAT_TEXTURES_EVICTED);
+	}
 }
 
 SDL_BlendMode SDLInterface::ChooseBlendMode(int theBlendMode)
@@ -406,10 +569,13 @@ SDLTextureData::SDLTextureData(SDL_Renderer *theRenderer)
 	mWidth = 0;
 	mHeight = 0;
 	mBitsChangedCount = 0;
+	mLastUsedFrame = 0;
 	mRenderer = theRenderer;
 	mTexture = nullptr;
 }
 
+static std::atomic<int64_t> gTextureMemSize(0);
+
 SDLTextureData::~SDLTextureData()
 {
 	ReleaseTextures();
@@ -418,7 +584,11 @@ SDLTextureData::~SDLTextureData()
 void SDLTextureData::ReleaseTextures()
 {
 	if (mTexture != nullptr)
+	{
+		gTextureMemSize -= GetMemSize();
 		SDL_DestroyTexture(mTexture);
+		mTexture = nullptr;
+	}
 }
 
 void SDLTextureData::CreateTextures(MemoryImage *theImage)
@@ -428,8 +598,9 @@ void SDLTextureData::CreateTextures(MemoryImage *theImage)
 
 	bool createTexture = false;
 
-	// only recreate the texture if the dimensions or image data have changed
-	if (mWidth != theImage->mWidth || mHeight != theImage->mHeight || mBitsChangedCount != theImage->mBitsChangedCount)
+	// only recreate the texture if the dimensions or image data have changed, or it was evicted
+	if (mTexture == nullptr || mWidth != theImage->mWidth || mHeight != theImage->mHeight ||
+		mBitsChangedCount != theImage->mBitsChangedCount)
 	{
 		ReleaseTextures();
 		createTexture = true;
@@ -454,6 +625,7 @@ void SDLTextureData::CreateTextures(MemoryImage *theImage)
 			if (bits)
 			{
 				SDL_UpdateTexture(mTexture, nullptr, bits, aWidth * SDL_BYTESPERPIXEL(SDL_PIXELFORMAT_ARGB8888));
+				FrameStats::Add(FRAMESTAT_TEXTURE_UPLOAD_BYTES, (double)aWidth * aHeight * SDL_BYTESPERPIXEL(SDL_PIXELFORMAT_ARGB8888));
 			}
 			else
 			{
@@ -471,6 +643,7 @@ void SDLTextureData::CreateTextures(MemoryImage *theImage)
 		if (bits)
 		{
 			SDL_UpdateTexture(mTexture, nullptr, bits, aWidth * SDL_BYTESPERPIXEL(SDL_PIXELFORMAT_ARGB8888));
+			FrameStats::Add(FRAMESTAT_TEXTURE_UPLOAD_BYTES, (double)aWidth * aHeight * SDL_BYTESPERPIXEL(SDL_PIXELFORMAT_ARGB8888));
 		}
 		else
 		{
@@ -481,6 +654,9 @@ void SDLTextureData::CreateTextures(MemoryImage *theImage)
 	mWidth = theImage->mWidth;
 	mHeight = theImage->mHeight;
 	mBitsChangedCount = theImage->mBitsChangedCount;
+
+	if (createTexture && mTexture != nullptr)
+		gTextureMemSize += GetMemSize();
 }
 
 void SDLTextureData::CheckCreateTextures(MemoryImage *theImage)
@@ -495,13 +671,14 @@ void SDLTextureData::CheckCreateTextures(MemoryImage *theImage)
 	CreateTextures(theImage);
 }
 
-int SDLTextureData::GetMemSize()
+int64_t SDLTextureData::GetTotalMemSize()
 {
-	int aSize = 0;
-
-	aSize = (SDL_BYTESPERPIXEL(SDL_PIXELFORMAT_ARGB8888) / 8) * mWidth * mHeight;
+	return gTextureMemSize;
+}
 
-	return aSize;
+int64_t SDLTextureData::GetMemSize()
+{
+	return (int64_t)SDL_BYTESPERPIXEL(SDL_PIXELFORMAT_ARGB8888) * mWidth * mHeight;
 }
 
 /////////////////////////////////////////////////////////////////
@@ -528,6 +705,7 @@ void SDLInterface::Blt(Image *theImage, int theX, int theY, const Rect &theSrcRe
 	SDL_FRect dstF = {(float)theX, (float)theY, (float)theSrcRect.mWidth, (float)theSrcRect.mHeight};
 
 	bool ok = SDL_RenderTexture(mRenderer, texture, &srcF, &dstF);
+	FrameStats::Add(FRAMESTAT_DRAW_CALLS);
 	if (ok)
 		SDL_SetRenderTarget(mRenderer, nullptr);
 
@@ -563,6 +741,7 @@ void SDLInterface::BltClipF(Image *theImage, float theX, float theY, const Rect
 
 	SDL_SetTextureBlendMode(aTexture, ChooseBlendMode(theDrawMode));
 	SDL_RenderTexture(mRenderer, aTexture, &srcRect, &destRect);
+	FrameStats::Add(FRAMESTAT_DRAW_CALLS);
 	SDL_SetRenderClipRect(mRenderer, nullptr);
 	SDL_SetRenderTarget(mRenderer, nullptr);
 }
@@ -589,6 +768,7 @@ void SDLInterface::BltMirror(Image *theImage, float theX, float theY, const Rect
 	SDL_SetTextureBlendMode(aTexture, ChooseBlendMode(theDrawMode));
 
 	SDL_RenderTextureRotated(mRenderer, aTexture, &srcRect, &destRect, 0, nullptr, SDL_FLIP_HORIZONTAL);
+	FrameStats::Add(FRAMESTAT_DRAW_CALLS);
 	SDL_SetRenderTarget(mRenderer, nullptr);
 }
 
@@ -623,6 +803,7 @@ void SDLInterface::StretchBlt(Image *theImage, const Rect &theDestRect, const Re
 	SDL_SetTextureBlendMode(aTexture, ChooseBlendMode(theDrawMode));
 	SDL_RenderTextureRotated(mRenderer, aTexture, &srcRect, &destRect, 0.0, nullptr,
 							 mirror ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE);
+	FrameStats::Add(FRAMESTAT_DRAW_CALLS);
 	SDL_SetRenderClipRect(mRenderer, nullptr);
 	SDL_SetRenderTarget(mRenderer, nullptr);
 }
@@ -660,6 +841,7 @@ void SDLInterface::BltRotated(Image *theImage, float theX, float theY, const Rec
 
 	SDL_SetTextureBlendMode(aTexture, ChooseBlendMode(theDrawMode));
 	SDL_RenderTextureRotated(mRenderer, aTexture, &srcRect, &destRect, theRot, &rotationCenter, SDL_FLIP_NONE);
+	FrameStats::Add(FRAMESTAT_DRAW_CALLS);
 	SDL_SetRenderClipRect(mRenderer, nullptr);
 	SDL_SetRenderTarget(mRenderer, nullptr);
 }
@@ -722,6 +904,7 @@ void SDLInterface::BltTransformed(Image *theImage, const Rect *theClipRect, cons
 	int indices[] = {0, 1, 2, 1, 3, 2};
 
 	SDL_RenderGeometry(mRenderer, aTexture, vertices, 4, indices, 6);
+	FrameStats::Add(FRAMESTAT_DRAW_CALLS);
 	SDL_SetRenderClipRect(mRenderer, nullptr);
 	SDL_SetRenderTarget(mRenderer, nullptr);
 }
@@ -738,6 +921,7 @@ void SDLInterface::DrawLine(double theStartX, double theStartY, double theEndX,
 	SDL_SetRenderDrawColor(mRenderer, theColor.mRed, theColor.mGreen, theColor.mBlue, theColor.mAlpha);
 
 	SDL_RenderLine(mRenderer, theStartX, theStartY, theEndX, theEndY);
+	FrameStats::Add(FRAMESTAT_DRAW_CALLS);
 
 	SDL_SetRenderDrawBlendMode(mRenderer, ChooseBlendMode(Graphics::DRAWMODE_NORMAL));
 	SDL_SetRenderTarget(mRenderer, nullptr);
@@ -756,6 +940,7 @@ void SDLInterface::FillRect(const Rect &theRect, const Color &theColor, int theD
 
 	SDL_SetRenderDrawBlendMode(mRenderer, ChooseBlendMode(theDrawMode));
 	SDL_RenderFillRect(mRenderer, &theSDLRect);
+	FrameStats::Add(FRAMESTAT_DRAW_CALLS);
 
 	SDL_SetRenderDrawBlendMode(mRenderer, ChooseBlendMode(Graphics::DRAWMODE_NORMAL));
 	SDL_SetRenderTarget(mRenderer, nullptr);
@@ -775,6 +960,7 @@ void SDLInterface::DrawTriangle(const TriVertex &p1, const TriVertex &p2, const
 							  {SDL_FPoint{p3.x, p3.y}, aColor, {p3.u, p3.v}}};
 
 	SDL_RenderGeometry(mRenderer, nullptr, vertices, 3, indices, 3);
+	FrameStats::Add(FRAMESTAT_DRAW_CALLS);
 	SDL_SetRenderTarget(mRenderer, nullptr);
 }
 
@@ -804,132 +990,126 @@ void SDLInterface::DrawTriangleTex(const TriVertex &p1, const TriVertex &p2, con
 							  {SDL_FPoint{p3.x, p3.y}, aColor, {p3.u, p3.v}}};
 
 	SDL_RenderGeometry(mRenderer, aTexture, vertices, 3, indices, 3);
+	FrameStats::Add(FRAMESTAT_DRAW_CALLS);
 	SDL_SetRenderTarget(mRenderer, nullptr);
 }
 
 void SDLInterface::DrawTrianglesTex(const TriVertex theVertices[][3], int theNumTriangles, const Color &theColor,
 									int theDrawMode, Image *theTexture, float tx, float ty, bool blend)
 {
-	MemoryImage *aSrcMemoryImage = (MemoryImage *)theTexture;
+	DrawMesh(&theVertices[0][0], theNumTriangles * 3, nullptr, 0, theColor, theDrawMode, theTexture, nullptr, tx, ty);
+}
 
-	if (!CreateImageTexture(aSrcMemoryImage))
+void SDLInterface::DrawTrianglesTexStrip(const TriVertex theVertices[], int theNumTriangles, const Color &theColor,
+										 int theDrawMode, Image *theTexture, float tx, float ty, bool blend)
+{
+	if (theNumTriangles < 3)
 		return;
 
-	SDLTextureData *aData = (SDLTextureData *)aSrcMemoryImage->mD3DData;
-
-	SDL_SetRenderTarget(mRenderer, mScreenTexture);
-
-	SDL_Texture *aTexture = aData->mTexture;
-	SDL_SetTextureColorMod(aTexture, theColor.GetRed(), theColor.GetGreen(), theColor.GetBlue());
-	SDL_SetTextureAlphaMod(aTexture, theColor.GetAlpha());
-	SDL_SetTextureBlendMode(aTexture, ChooseBlendMode(theDrawMode));
-
-	for (int aTriangleNum = 0; aTriangleNum < theNumTriangles; aTriangleNum++)
+	// theNumTriangles is the number of strip vertices, every one after the second adds a triangle
+	mMeshIndices.clear();
+	for (int i = 2; i < theNumTriangles; i++)
 	{
-		TriVertex theCurrentVertex[3];
-		theCurrentVertex[0] = theVertices[aTriangleNum][0];
-		theCurrentVertex[1] = theVertices[aTriangleNum][1];
-		theCurrentVertex[2] = theVertices[aTriangleNum][2];
-
-		SDL_Vertex vertices[3];
-
-		SDL_FColor aColor[3];
-		aColor[0].r = (theCurrentVertex[0].color >> 16) & 0xFF;
-		aColor[0].g = (theCurrentVertex[0].color >> 8) & 0xFF;
-		aColor[0].b = theCurrentVertex[0].color & 0xFF;
-		aColor[0].a = (theCurrentVertex[0].color >> 24) & 0xFF; // alpha extraction
-
-		aColor[1].r = (theCurrentVertex[1].color >> 16) & 0xFF;
-		aColor[1].g = (theCurrentVertex[1].color >> 8) & 0xFF;
-		aColor[1].b = theCurrentVertex[1].color & 0xFF;
-		aColor[1].a = (theCurrentVertex[1].color >> 24) & 0xFF;
-
-		aColor[2].r = (theCurrentVertex[2].color >> 16) & 0xFF;
-		aColor[2].g = (theCurrentVertex[2].color >> 8) & 0xFF;
-		aColor[2].b = theCurrentVertex[2].color & 0xFF;
-		aColor[2].a = (theCurrentVertex[2].color >> 24) & 0xFF;
-
-		vertices[0].position.x = theCurrentVertex[0].x + tx;
-		vertices[0].position.y = theCurrentVertex[0].y + ty;
-		vertices[1].position.x = theCurrentVertex[1].x + tx;
-		vertices[1].position.y = theCurrentVertex[1].y + ty;
-		vertices[2].position.x = theCurrentVertex[2].x + tx;
-		vertices[2].position.y = theCurrentVertex[2].y + ty;
-		vertices[0].color = aColor[0];
-		vertices[1].color = aColor[1];
-		vertices[2].color = aColor[2];
-
-		SDL_RenderGeometry(mRenderer, aTexture, vertices, 3, nullptr, 3);
+		mMeshIndices.push_back(i - 2);
+		mMeshIndices.push_back(i - 1);
+		mMeshIndices.push_back(i);
 	}
 
-	SDL_SetRenderTarget(mRenderer, nullptr);
+	DrawMesh(theVertices, theNumTriangles, mMeshIndices.data(), (int)mMeshIndices.size(), theColor, theDrawMode,
+			 theTexture, nullptr, tx, ty);
 }
 
-void SDLInterface::DrawTrianglesTexStrip(const TriVertex theVertices[], int theNumTriangles, const Color &theColor,
-										 int theDrawMode, Image *theTexture, float tx, float ty, bool blend)
+void SDLInterface::DrawMesh(const TriVertex theVertices[], int theNumVertices, const int theIndices[],
+							int theNumIndices, const Color &theColor, int theDrawMode, Image *theTexture,
+							const Rect *theClipRect, float tx, float ty)
 {
-	if (theNumTriangles < 3)
+	if (!mRenderer || theNumVertices <= 0)
 		return;
 
-	MemoryImage *aSrcMemoryImage = (MemoryImage *)theTexture;
-	if (!CreateImageTexture(aSrcMemoryImage))
-		return;
-	SDLTextureData *aData = (SDLTextureData *)aSrcMemoryImage->mD3DData;
-	SDL_Texture *aTexture = aData->mTexture;
+	SDL_Texture *aTexture = nullptr;
+	if (theTexture != nullptr)
+	{
+		MemoryImage *aSrcMemoryImage = (MemoryImage *)theTexture;
+		if (!CreateImageTexture(aSrcMemoryImage))
+			return;
 
-	std::vector<float> positions;
-	std::vector<SDL_FColor> colors;
-	std::vector<float> uvs;
+		aTexture = ((SDLTextureData *)aSrcMemoryImage->mD3DData)->mTexture;
+	}
+
+	// a vertex color of 0 means "use theColor"; textured meshes get theColor through the color mod instead
+	SDL_FColor aDefaultColor = {1.0f, 1.0f, 1.0f, 1.0f};
+	if (aTexture == nullptr)
+		aDefaultColor = {theColor.mRed / 255.0f, theColor.mGreen / 255.0f, theColor.mBlue / 255.0f,
+						 theColor.mAlpha / 255.0f};
 
-	for (int i = 0; i < theNumTriangles; ++i)
+	mMeshPositions.resize(theNumVertices * 2);
+	mMeshUVs.resize(theNumVertices * 2);
+	mMeshColors.resize(theNumVertices);
+
+	float *aPosition = mMeshPositions.data();
+	float *aUV = mMeshUVs.data();
+	SDL_FColor *aColor = mMeshColors.data();
+	for (int i = 0; i < theNumVertices; i++)
 	{
-		const TriVertex &v = theVertices[i];
-		positions.push_back(v.x + tx);
-		positions.push_back(v.y + ty);
-		uvs.push_back(v.u);
-		uvs.push_back(v.v);
-
-		SDL_FColor color = {(v.color >> 16) & 0xFF, (v.color >> 8) & 0xFF, v.color & 0xFF, (v.color >> 24) & 0xFF};
-		colors.push_back(color);
+		const TriVertex &aVertex = theVertices[i];
+		*aPosition++ = aVertex.x + tx;
+		*aPosition++ = aVertex.y + ty;
+		*aUV++ = aVertex.u;
+		*aUV++ = aVertex.v;
+
+		uint32_t aPacked = aVertex.color;
+		if (aPacked == 0)
+			*aColor++ = aDefaultColor;
+		else
+			*aColor++ = {((aPacked >> 16) & 0xFF) / 255.0f, ((aPacked >> 8) & 0xFF) / 255.0f, (aPacked & 0xFF) / 255.0f,
+						 ((aPacked >> 24) & 0xFF) / 255.0f};
 	}
 
 	SDL_SetRenderTarget(mRenderer, mScreenTexture);
-	SDL_SetTextureBlendMode(aTexture, ChooseBlendMode(theDrawMode));
-	SDL_SetTextureColorMod(aTexture, theColor.GetRed(), theColor.GetGreen(), theColor.GetBlue());
-	SDL_SetTextureAlphaMod(aTexture, theColor.GetAlpha());
 
-	SDL_RenderGeometryRaw(mRenderer, aTexture, positions.data(), sizeof(float) * 2, colors.data(), sizeof(SDL_FColor),
-						  uvs.data(), sizeof(float) * 2, positions.size() / 2, nullptr, 0, 0);
+	if (theClipRect != nullptr)
+	{
+		SDL_Rect clipRect = {theClipRect->mX, theClipRect->mY, theClipRect->mWidth, theClipRect->mHeight};
+		SDL_SetRenderClipRect(mRenderer, &clipRect);
+	}
+
+	if (aTexture != nullptr)
+	{
+		SDL_SetTextureColorMod(aTexture, theColor.GetRed(), theColor.GetGreen(), theColor.GetBlue());
+		SDL_SetTextureAlphaMod(aTexture, theColor.GetAlpha());
+		SDL_SetTextureBlendMode(aTexture, ChooseBlendMode(theDrawMode));
+	}
+	else
+		SDL_SetRenderDrawBlendMode(mRenderer, ChooseBlendMode(theDrawMode));
 
+	SDL_RenderGeometryRaw(mRenderer, aTexture, mMeshPositions.data(), sizeof(float) * 2, mMeshColors.data(),
+						  sizeof(SDL_FColor), mMeshUVs.data(), sizeof(float) * 2, theNumVertices, theIndices,
+						  theIndices != nullptr ? theNumIndices : 0, sizeof(int));
+	FrameStats::Add(FRAMESTAT_DRAW_CALLS);
+
+	if (aTexture == nullptr)
+		SDL_SetRenderDrawBlendMode(mRenderer, ChooseBlendMode(Graphics::DRAWMODE_NORMAL));
+	if (theClipRect != nullptr)
+		SDL_SetRenderClipRect(mRenderer, nullptr);
 	SDL_SetRenderTarget(mRenderer, nullptr);
 }
 
 void SDLInterface::FillPoly(const Point theVertices[], int theNumVertices, const Rect *theClipRect,
-							const Color &theColor, int theDrawMode, int tx, int ty)
+							const Color &theColor, int theDrawMode, int tx, int ty, bool convex, bool antiAlias)
 {
-	if (theNumVertices < 3)
-		if (theNumVertices == 2)
-		{
-			DrawLine(theVertices[0].mX + tx, theVertices[0].mY + ty, theVertices[1].mX + tx, theVertices[1].mY + ty, theColor, theDrawMode);
-			return;
-		}
-			
-
-	if (theClipRect != nullptr)
+	if (theNumVertices == 2)
 	{
-		SDL_Rect clipRect;
-		clipRect = {theClipRect->mX, theClipRect->mY, theClipRect->mWidth, theClipRect->mHeight};
-		SDL_SetRenderClipRect(mRenderer, &clipRect);
+		DrawLine(theVertices[0].mX + tx, theVertices[0].mY + ty, theVertices[1].mX + tx, theVertices[1].mY + ty,
+				 theColor, theDrawMode);
+		return;
 	}
 
-	for (int i = 0; i < theNumVertices - 1; i++)
-		DrawLine(theVertices[i].mX + tx, theVertices[i].mY + ty, theVertices[i + 1].mX + tx, theVertices[i + 1].mY + ty, theColor,
-				 theDrawMode);
-
-	DrawLine(theVertices[theNumVertices - 1].mX + tx, theVertices[theNumVertices - 1].mY + ty, theVertices[0].mX + tx,
-			 theVertices[0].mY + ty, theColor, theDrawMode);
+	mPolyBatch.Clear();
+	if (!mPolyTessellator.Tessellate(theVertices, theNumVertices, theColor.ToInt(), convex, antiAlias, &mPolyBatch))
+		return;
 
-	SDL_SetRenderClipRect(mRenderer, nullptr);
+	DrawMesh(mPolyBatch.mVertices.data(), (int)mPolyBatch.mVertices.size(), mPolyBatch.mIndices.data(),
+			 (int)mPolyBatch.mIndices.size(), theColor, theDrawMode, nullptr, theClipRect, (float)tx, (float)ty);
 }
 
 void SDLInterface::BltTexture(SDL_Texture *theTexture, const SDL_FRect &theSrcRect, const SDL_FRect &theDestRect,
@@ -942,6 +1122,7 @@ void SDLInterface::BltTexture(SDL_Texture *theTexture, const SDL_FRect &theSrcRe
 
 	SDL_SetTextureBlendMode(theTexture, ChooseBlendMode(theDrawMode));
 	SDL_RenderTexture(mRenderer, theTexture, &theSrcRect, &theDestRect);
+	FrameStats::Add(FRAMESTAT_DRAW_CALLS);
 
 	SDL_SetTextureBlendMode(theTexture, SDL_BLENDMODE_NONE);
 
@@ -11,14 +11,18 @@
 #include "math/rect.hpp"
 #include "math/ratio.hpp"
 #include "math/matrix.hpp"
+#include "polytessellator.hpp"
+#include "vertexbatch.hpp"
 
 #include <SDL3/SDL.h>
+#include <tuple>
 
 namespace PopLib
 {
 
 class AppBase;
 class SDLImage;
+class SWInterface;
 class Matrix3;
 class TriVertex;
 
@@ -26,6 +30,27 @@ typedef std::set<SDLImage *> SDLImageSet;
 typedef std::set<MemoryImage *> ImageSet;
 typedef std::list<Matrix3> TransformStack;
 
+struct SDLCursorKey
+{
+	Image *mImage;
+	int mCel;
+	int mHotX;
+	int mHotY;
+
+	bool operator<(const SDLCursorKey &theKey) const
+	{
+		return std::tie(mImage, mCel, mHotX, mHotY) < std::tie(theKey.mImage, theKey.mCel, theKey.mHotX, theKey.mHotY);
+	}
+};
+
+struct SDLCursorData
+{
+	SDL_Cursor *mCursor;
+	int mBitsChangedCount;
+};
+
+typedef std::map<SDLCursorKey, SDLCursorData> SDLCursorMap;
+
 enum SDLImageFlags
 {
 	SDLImageFlag_NearestFiltering = 0x0001, // Uses nearest filtering for the texture
@@ -43,6 +68,7 @@ struct SDLTextureData
 	int mWidth;
 	int mHeight;
 	int mBitsChangedCount;
+	uint64_t mLastUsedFrame;
 	SDL_Renderer *mRenderer;
 
 	SDLTextureData(SDL_Renderer *theRenderer);
@@ -53,7 +79,8 @@ struct SDLTextureData
 	void CreateTextures(MemoryImage *theImage);
 	void CheckCreateTextures(MemoryImage *theImage);
 
-	int GetMemSize();
+	int64_t GetMemSize();
+	static int64_t GetTotalMemSize();
 };
 
 class SDLInterface : public NativeDisplay
@@ -81,14 +108,24 @@ class SDLInterface : public NativeDisplay
 
 	bool mIs3D;
 	bool mHasInitiated;
+	/// @brief draw the screen on the CPU with a SWInterface instead of the renderer, set before Init
+	bool mSoftwareRender;
+	SWInterface *mSWInterface;
 
 	Rect mPresentationRect;
 	int mRefreshRate;
 	int mMillisecondsPerFrame;
 
 	Image *mCursorImage;
+	int mCursorCel;
+	int mCursorHotX;
+	int mCursorHotY;
 	SDLImage *mScreenImage;
 
+	// every cursor made so far, so switching back and forth or animating doesn't create new ones
+	SDLCursorMap mCursorMap;
+	SDL_Cursor *mSystemCursors[SDL_SYSTEM_CURSOR_COUNT];
+
 	int mNextCursorX;
 	int mNextCursorY;
 	int mCursorX;
@@ -96,8 +133,20 @@ class SDLInterface : public NativeDisplay
 
 	ImageSet mImageSet;
 	SDLImageSet mSDLImageSet;
+	/// @brief bytes of texture memory to stay under, 0 for no limit
+	int64_t mTextureBudget;
+	/// @brief number of presented frames, used to find textures that weren't drawn lately
+	uint64_t mFrameNum;
 	TransformStack mTransformStack;
 
+	// reused by DrawMesh so submitting geometry doesn't allocate every frame
+	std::vector<float> mMeshPositions;
+	std::vector<float> mMeshUVs;
+	std::vector<SDL_FColor> mMeshColors;
+	std::vector<int> mMeshIndices;
+	PolyTessellator mPolyTessellator;
+	VertexBatch mPolyBatch;
+
   public:
 	SDL_Renderer *mRenderer;
 	SDL_Window *mWindow;
@@ -113,7 +162,7 @@ class SDLInterface : public NativeDisplay
 	virtual ~SDLInterface();
 	void Cleanup();
 
-	SDLImage *GetScreenImage();
+	MemoryImage *GetScreenImage();
 	void UpdateViewport();
 	int Init(bool IsWindowed);
 
@@ -125,9 +174,24 @@ class SDLInterface : public NativeDisplay
 
 	void SetCursorPos(int theCursorX, int theCursorY);
 
-	bool SetCursorImage(Image *theImage);
+	/// @brief shows a cel of an image as the cursor, or nothing if theImage is nullptr
+	///
+	/// cursors are cached per image, cel and hot spot and only made again
+	/// when the image's bits change, so animating through the cels of an
+	/// image doesn't allocate anything after the first loop.
+	/// @param theImage
+	/// @param theCel
+	/// @param theHotX hot spot inside the cel, -1 for its center
+	/// @param theHotY hot spot inside the cel, -1 for its center
+	/// @return true if the cursor changed
+	bool SetCursorImage(Image *theImage, int theCel = 0, int theHotX = -1, int theHotY = -1);
+	/// @brief destroys the cached cursors made from an image
+	/// @param theImage
+	void RemoveCursorImage(Image *theImage);
 	bool UpdateWindowIcon(Image *theImage);
 
+	/// @brief shows a system cursor, each kind is only created once
+	/// @param theCursorType
 	void SetCursor(SDL_SystemCursor theCursorType);
 
 	void MakeSimpleMessageBox(const char *theTitle, const char *theMessage, SDL_MessageBoxFlags flags);
@@ -142,6 +206,21 @@ class SDLInterface : public NativeDisplay
 	bool CreateImageTexture(MemoryImage *theImage);
 	bool RecoverBits(MemoryImage *theImage);
 
+	/// @brief sets the texture memory budget
+	///
+	/// once more than theBytes are resident, the textures drawn least recently
+	/// are released after each presented frame. they're uploaded again the
+	/// next time they're drawn, from the bits the image still has or by
+	/// loading mFilePath again for images whose bits were purged.
+	/// @param theBytes 0 for no limit
+	void SetTextureBudget(int64_t theBytes);
+	/// @brief releases least recently used textures until under the budget
+	void EnforceTextureBudget();
+	/// @brief can the texture be released and created again later?
+	/// @param theImage
+	/// @return true if the image's pixels can be restored without the texture
+	bool CanEvictTexture(MemoryImage *theImage);
+
 	SDL_BlendMode ChooseBlendMode(int theBlendMode);
 
 	// Draw Funcs
@@ -169,8 +248,11 @@ class SDLInterface : public NativeDisplay
 						  Image *theTexture, float tx = 0, float ty = 0, bool blend = true);
 	void DrawTrianglesTexStrip(const TriVertex theVertices[], int theNumTriangles, const Color &theColor,
 							   int theDrawMode, Image *theTexture, float tx = 0, float ty = 0, bool blend = true);
+	void DrawMesh(const TriVertex theVertices[], int theNumVertices, const int theIndices[], int theNumIndices,
+				  const Color &theColor, int theDrawMode, Image *theTexture, const Rect *theClipRect, float tx = 0,
+				  float ty = 0);
 	void FillPoly(const Point theVertices[], int theNumVertices, const Rect *theClipRect, const Color &theColor,
-				  int theDrawMode, int tx, int ty);
+				  int theDrawMode, int tx, int ty, bool convex = false, bool antiAlias = false);
 
 	void BltTexture(SDL_Texture *theTexture, const SDL_FRect &theSrcRect, const SDL_FRect &theDestRect,
 					const Color &theColor, int theDrawMode);
@@ -8,6 +8,127 @@ SharedImage::SharedImage()
 {
 	mImage = nullptr;
 	mRefCount = 0;
+	mHash = 0;
+}
+
+bool SharedImage::TryAddRef()
+{
+	int aRefCount = mRefCount.load(std::memory_order_acquire);
+	while (aRefCount >= 0)
+	{
+		if (mRefCount.compare_exchange_weak(aRefCount, aRefCount + 1, std::memory_order_acq_rel))
+			return true;
+	}
+
+	return false;
+}
+
+SharedImageIndex::SharedImageIndex()
+{
+	mTable = nullptr;
+	mCount = 0;
+}
+
+SharedImageIndex::~SharedImageIndex()
+{
+	Clear();
+}
+
+uint64_t SharedImageIndex::Hash(const std::string &theFileName, const std::string &theVariant)
+{
+	// FNV-1a over the upper case characters
+	uint64_t aHash = 14695981039346656037ULL;
+	for (char aChar : theFileName)
+		aHash = (aHash ^ (uint8_t)toupper((uint8_t)aChar)) * 1099511628211ULL;
+
+	aHash = (aHash ^ 0xFF) * 1099511628211ULL;
+	for (char aChar : theVariant)
+		aHash = (aHash ^ (uint8_t)toupper((uint8_t)aChar)) * 1099511628211ULL;
+
+	return aHash;
+}
+
+static bool EqualsUpper(const std::string &theString, const std::string &theUpper)
+{
+	if (theString.length() != theUpper.length())
+		return false;
+
+	for (size_t i = 0; i < theString.length(); i++)
+	{
+		if (toupper((uint8_t)theString[i]) != (uint8_t)theUpper[i])
+			return false;
+	}
+
+	return true;
+}
+
+SharedImage *SharedImageIndex::Find(const std::string &theFileName, const std::string &theVariant) const
+{
+	Table *aTable = mTable.load(std::memory_order_acquire);
+	if (aTable == nullptr)
+		return nullptr;
+
+	uint64_t aHash = Hash(theFileName, theVariant);
+	for (size_t aSlot = aHash & aTable->mMask;; aSlot = (aSlot + 1) & aTable->mMask)
+	{
+		SharedImage *aSharedImage = aTable->mSlots[aSlot].load(std::memory_order_acquire);
+		if (aSharedImage == nullptr)
+			return nullptr;
+
+		if (aSharedImage->mHash == aHash && EqualsUpper(theFileName, aSharedImage->mFileName) &&
+			EqualsUpper(theVariant, aSharedImage->mVariant))
+			return aSharedImage;
+	}
+}
+
+void SharedImageIndex::Insert(Table *theTable, SharedImage *theSharedImage)
+{
+	size_t aSlot = theSharedImage->mHash & theTable->mMask;
+	while (theTable->mSlots[aSlot].load(std::memory_order_relaxed) != nullptr)
+		aSlot = (aSlot + 1) & theTable->mMask;
+
+	theTable->mSlots[aSlot].store(theSharedImage, std::memory_order_release);
+}
+
+void SharedImageIndex::Add(SharedImage *theSharedImage)
+{
+	Table *aTable = mTable.load(std::memory_order_relaxed);
+
+	// stay at most half full so probes end quickly
+	if (aTable == nullptr || (mCount + 1) * 2 > aTable->mMask + 1)
+	{
+		size_t aSize = aTable == nullptr ? 256 : (aTable->mMask + 1) * 2;
+
+		std::unique_ptr<Table> aNewTable(new Table());
+		aNewTable->mMask = aSize - 1;
+		aNewTable->mSlots.reset(new std::atomic<SharedImage *>[aSize]);
+		for (size_t i = 0; i < aSize; i++)
+			aNewTable->mSlots[i].store(nullptr, std::memory_order_relaxed);
+
+		if (aTable != nullptr)
+		{
+			for (size_t i = 0; i <= aTable->mMask; i++)
+			{
+				SharedImage *aSharedImage = aTable->mSlots[i].load(std::memory_order_relaxed);
+				if (aSharedImage != nullptr)
+					Insert(aNewTable.get(), aSharedImage);
+			}
+		}
+
+		aTable = aNewTable.get();
+		mTables.push_back(std::move(aNewTable));
+		mTable.store(aTable, std::memory_order_release);
+	}
+
+	Insert(aTable, theSharedImage);
+	mCount++;
+}
+
+void SharedImageIndex::Clear()
+{
+	mTable.store(nullptr, std::memory_order_release);
+	mTables.clear();
+	mCount = 0;
 }
 
 SharedImageRef::SharedImageRef(const SharedImageRef &theSharedImageRef)
@@ -6,6 +6,9 @@
 
 #include "common.hpp"
 
+#include <atomic>
+#include <memory>
+
 namespace PopLib
 {
 
@@ -17,13 +20,65 @@ class SharedImage
 {
   public:
 	SDLImage *mImage;
-	int mRefCount;
+	/// @brief -1 once CleanSharedImages freed the image
+	std::atomic<int> mRefCount;
+	/// @brief upper case key, used by SharedImageIndex
+	std::string mFileName;
+	std::string mVariant;
+	uint64_t mHash;
 
 	SharedImage();
+
+	/// @brief adds a reference unless the image was freed
+	/// @return false if it was
+	bool TryAddRef();
 };
 
 typedef std::map<std::pair<std::string, std::string>, SharedImage> SharedImageMap;
 
+/**
+ * @brief finds shared images without taking a lock
+ *
+ * an open addressed hash table of SharedImage pointers, keyed on the file name
+ * and variant without regard to case, so looking up an image that's already
+ * loaded neither allocates nor touches the SDLInterface critical section.
+ * Add must be called with that lock held. growing publishes a new table and
+ * keeps the old one alive until Clear, since readers may still be probing it.
+ * entries are never removed; freed images stay as entries with a refcount of
+ * -1 and get reloaded in place.
+ */
+class SharedImageIndex
+{
+  public:
+	SharedImageIndex();
+	virtual ~SharedImageIndex();
+
+	/// @brief hashes a key the same way regardless of case
+	static uint64_t Hash(const std::string &theFileName, const std::string &theVariant);
+
+	/// @brief looks up a shared image, safe to call from any thread
+	/// @return nullptr if there's no entry
+	SharedImage *Find(const std::string &theFileName, const std::string &theVariant) const;
+	/// @brief adds an entry, mFileName, mVariant and mHash have to be set
+	/// @param theSharedImage
+	void Add(SharedImage *theSharedImage);
+	/// @brief forgets every entry, nobody may be reading
+	void Clear();
+
+  protected:
+	struct Table
+	{
+		size_t mMask;
+		std::unique_ptr<std::atomic<SharedImage *>[]> mSlots;
+	};
+
+	std::atomic<Table *> mTable;
+	std::vector<std::unique_ptr<Table>> mTables;
+	size_t mCount;
+
+	static void Insert(Table *theTable, SharedImage *theSharedImage);
+};
+
 class SharedImageRef
 {
   public:
@@ -50,4 +105,4 @@ class SharedImageRef
 
 } // namespace PopLib
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,261 @@
+#include "spriteanimator.hpp"
+#include "graphics.hpp"
+#include "image.hpp"
+
+using namespace PopLib;
+
+// animations longer than this (in 1/100s) look their cels up through AnimInfo
+static const int MAX_CEL_TABLE_SIZE = 1 << 16;
+
+static std::vector<SpriteAnimator *> gAutoUpdateAnimators;
+
+SpriteAnimator::SpriteAnimator(bool autoUpdate)
+{
+	mAutoUpdate = autoUpdate;
+	if (mAutoUpdate)
+		gAutoUpdateAnimators.push_back(this);
+}
+
+SpriteAnimator::~SpriteAnimator()
+{
+	if (mAutoUpdate)
+		gAutoUpdateAnimators.erase(std::find(gAutoUpdateAnimators.begin(), gAutoUpdateAnimators.end(), this));
+}
+
+void SpriteAnimator::UpdateAll(int theElapsed)
+{
+	for (SpriteAnimator *anAnimator : gAutoUpdateAnimators)
+		anAnimator->Update(theElapsed);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void SpriteAnimator::BuildSheet(Sheet &theSheet)
+{
+	Image *anImage = theSheet.mImage;
+	theSheet.mAnimInfo = anImage->mAnimInfo;
+	theSheet.mWidth = anImage->mWidth;
+	theSheet.mHeight = anImage->mHeight;
+
+	int aNumCels = std::max(anImage->mNumRows * anImage->mNumCols, 1);
+	theSheet.mCelRects.resize(aNumCels);
+	for (int aCel = 0; aCel < aNumCels; aCel++)
+		theSheet.mCelRects[aCel] = anImage->GetCelRect(aCel);
+
+	// AnimInfo::GetCel is a modulo and a walk through the frame delays, do it once per moment instead
+	theSheet.mCelAtTime.clear();
+
+	AnimInfo *anAnimInfo = theSheet.mAnimInfo;
+	if (anAnimInfo != nullptr && anAnimInfo->mTotalAnimTime > 0 && anAnimInfo->mTotalAnimTime <= MAX_CEL_TABLE_SIZE)
+	{
+		theSheet.mCelAtTime.resize(anAnimInfo->mTotalAnimTime);
+		for (int aTime = 0; aTime < anAnimInfo->mTotalAnimTime; aTime++)
+			theSheet.mCelAtTime[aTime] = std::min(anAnimInfo->GetCel(aTime), aNumCels - 1);
+	}
+}
+
+int SpriteAnimator::GetSheet(Image *theImage)
+{
+	auto anItr = mSheetMap.find(theImage);
+	if (anItr != mSheetMap.end())
+	{
+		// an unused sheet may belong to a deleted image that had the same address
+		Sheet &aSheet = mSheets[anItr->second];
+		if (aSheet.mNumSprites == 0)
+			BuildSheet(aSheet);
+
+		return anItr->second;
+	}
+
+	int aSheetNum = (int)mSheets.size();
+	mSheets.emplace_back();
+	mSheets.back().mImage = theImage;
+	mSheets.back().mNumSprites = 0;
+	BuildSheet(mSheets.back());
+
+	mSheetMap[theImage] = aSheetNum;
+	return aSheetNum;
+}
+
+int SpriteAnimator::GetSheetCel(const Sheet &theSheet, int theTime) const
+{
+	AnimInfo *anAnimInfo = theSheet.mAnimInfo;
+	if (anAnimInfo == nullptr || anAnimInfo->mTotalAnimTime <= 0)
+		return 0;
+
+	int aTime = theTime / 10;
+
+	int aTableSize = (int)theSheet.mCelAtTime.size();
+	if (aTableSize == 0)
+		return std::min(anAnimInfo->GetCel(aTime), (int)theSheet.mCelRects.size() - 1);
+
+	if (anAnimInfo->mAnimType == AnimType_Once && aTime >= aTableSize)
+		return theSheet.mCelAtTime[aTableSize - 1];
+
+	return theSheet.mCelAtTime[aTime % aTableSize];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+int SpriteAnimator::AddSprite(Image *theImage, float theX, float theY, int theTime)
+{
+	int aSheetNum = GetSheet(theImage);
+	theTime = std::max(theTime, 0);
+
+	int anId;
+	if (!mFreeIds.empty())
+	{
+		anId = mFreeIds.back();
+		mFreeIds.pop_back();
+	}
+	else
+	{
+		anId = (int)mSlots.size();
+		mSlots.push_back(-1);
+	}
+
+	mSlots[anId] = (int)mSheet.size();
+	mSheets[aSheetNum].mNumSprites++;
+
+	mSheet.push_back(aSheetNum);
+	mTime.push_back(theTime);
+	mCel.push_back(GetSheetCel(mSheets[aSheetNum], theTime));
+	mX.push_back(theX);
+	mY.push_back(theY);
+	mColor.push_back(0);
+	mVisible.push_back(1);
+	mSpriteIds.push_back(anId);
+
+	return anId;
+}
+
+void SpriteAnimator::RemoveSprite(int theId)
+{
+	if (theId < 0 || theId >= (int)mSlots.size() || mSlots[theId] < 0)
+		return;
+
+	// the last sprite takes the removed one's place
+	int aSlot = mSlots[theId];
+	int aLast = (int)mSheet.size() - 1;
+	mSheets[mSheet[aSlot]].mNumSprites--;
+
+	mSheet[aSlot] = mSheet[aLast];
+	mTime[aSlot] = mTime[aLast];
+	mCel[aSlot] = mCel[aLast];
+	mX[aSlot] = mX[aLast];
+	mY[aSlot] = mY[aLast];
+	mColor[aSlot] = mColor[aLast];
+	mVisible[aSlot] = mVisible[aLast];
+	mSpriteIds[aSlot] = mSpriteIds[aLast];
+	mSlots[mSpriteIds[aSlot]] = aSlot;
+
+	mSheet.pop_back();
+	mTime.pop_back();
+	mCel.pop_back();
+	mX.pop_back();
+	mY.pop_back();
+	mColor.pop_back();
+	mVisible.pop_back();
+	mSpriteIds.pop_back();
+
+	mSlots[theId] = -1;
+	mFreeIds.push_back(theId);
+}
+
+void SpriteAnimator::Clear()
+{
+	mSheet.clear();
+	mTime.clear();
+	mCel.clear();
+	mX.clear();
+	mY.clear();
+	mColor.clear();
+	mVisible.clear();
+	mSpriteIds.clear();
+	mSlots.clear();
+	mFreeIds.clear();
+	mSheets.clear();
+	mSheetMap.clear();
+}
+
+int SpriteAnimator::GetNumSprites() const
+{
+	return (int)mSheet.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void SpriteAnimator::SetPosition(int theId, float theX, float theY)
+{
+	int aSlot = mSlots[theId];
+	mX[aSlot] = theX;
+	mY[aSlot] = theY;
+}
+
+void SpriteAnimator::SetColor(int theId, const Color &theColor)
+{
+	mColor[mSlots[theId]] = (uint32_t)theColor.ToInt();
+}
+
+void SpriteAnimator::SetVisible(int theId, bool visible)
+{
+	mVisible[mSlots[theId]] = visible ? 1 : 0;
+}
+
+void SpriteAnimator::SetTime(int theId, int theTime)
+{
+	int aSlot = mSlots[theId];
+	mTime[aSlot] = std::max(theTime, 0);
+	mCel[aSlot] = GetSheetCel(mSheets[mSheet[aSlot]], mTime[aSlot]);
+}
+
+int SpriteAnimator::GetCel(int theId) const
+{
+	return mCel[mSlots[theId]];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void SpriteAnimator::Update(int theElapsed)
+{
+	// images can be reloaded with another size or animation
+	for (Sheet &aSheet : mSheets)
+	{
+		Image *anImage = aSheet.mImage;
+		if (aSheet.mNumSprites > 0 && (anImage->mWidth != aSheet.mWidth || anImage->mHeight != aSheet.mHeight ||
+									   anImage->mAnimInfo != aSheet.mAnimInfo))
+			BuildSheet(aSheet);
+	}
+
+	int aNumSprites = (int)mSheet.size();
+
+	int *aTime = mTime.data();
+	for (int i = 0; i < aNumSprites; i++)
+		aTime[i] += theElapsed;
+
+	const int *aSheetNum = mSheet.data();
+	int *aCel = mCel.data();
+	for (int i = 0; i < aNumSprites; i++)
+		aCel[i] = GetSheetCel(mSheets[aSheetNum[i]], aTime[i]);
+}
+
+void SpriteAnimator::Draw(Graphics *g)
+{
+	for (Sheet &aSheet : mSheets)
+		aSheet.mBatch.Clear();
+
+	int aNumSprites = (int)mSheet.size();
+	for (int i = 0; i < aNumSprites; i++)
+	{
+		if (!mVisible[i])
+			continue;
+
+		Sheet &aSheet = mSheets[mSheet[i]];
+		const Rect &aSrcRect = aSheet.mCelRects[mCel[i]];
+		aSheet.mBatch.AddQuad(FRect(mX[i], mY[i], aSrcRect.mWidth, aSrcRect.mHeight), aSrcRect, aSheet.mWidth,
+							  aSheet.mHeight, mColor[i]);
+	}
+
+	for (Sheet &aSheet : mSheets)
+		g->DrawMesh(aSheet.mImage, aSheet.mBatch);
+}
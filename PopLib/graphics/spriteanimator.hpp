@@ -0,0 +1,123 @@
+#ifndef __SPRITEANIMATOR_HPP__
+#define __SPRITEANIMATOR_HPP__
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "common.hpp"
+#include "color.hpp"
+#include "vertexbatch.hpp"
+
+namespace PopLib
+{
+
+class Image;
+class Graphics;
+struct AnimInfo;
+
+/**
+ * @brief lots of animated sprites, stepped and drawn together
+ *
+ * sprites are kept as parallel arrays, so Update is a couple of tight loops
+ * over all of them instead of a GetAnimCel call per object. the cel of every
+ * moment of an image's AnimInfo and the rect of every cel are worked out
+ * once per image. Draw builds one VertexBatch per image and submits each
+ * with a single Graphics::DrawMesh, so sprites of the same sheet keep their
+ * order but sheets are drawn in the order they were first used.
+ *
+ * animators made with autoUpdate are stepped by AppBase::UpdateFrames.
+ * an image must outlive the sprites that use it.
+ */
+class SpriteAnimator
+{
+  public:
+	SpriteAnimator(bool autoUpdate = true);
+	virtual ~SpriteAnimator();
+
+	/// @brief adds a sprite, static images stay on their first cel
+	/// @param theImage
+	/// @param theX
+	/// @param theY
+	/// @param theTime how far into the animation it starts, in ms
+	/// @return the sprite's id
+	int AddSprite(Image *theImage, float theX, float theY, int theTime = 0);
+	/// @brief removes a sprite, its id may be given out again
+	/// @param theId
+	void RemoveSprite(int theId);
+	/// @brief removes every sprite and forgets the images they used
+	void Clear();
+	/// @brief number of sprites
+	/// @return the count
+	int GetNumSprites() const;
+
+	/// @brief moves a sprite
+	/// @param theId
+	/// @param theX
+	/// @param theY
+	void SetPosition(int theId, float theX, float theY);
+	/// @brief tints a sprite
+	/// @param theId
+	/// @param theColor multiplied with the Graphics color
+	void SetColor(int theId, const Color &theColor);
+	/// @brief hides or shows a sprite, hidden sprites keep animating
+	/// @param theId
+	/// @param visible
+	void SetVisible(int theId, bool visible);
+	/// @brief restarts a sprite's animation at another point
+	/// @param theId
+	/// @param theTime in ms
+	void SetTime(int theId, int theTime);
+	/// @brief cel shown since the last Update
+	/// @param theId
+	/// @return the cel
+	int GetCel(int theId) const;
+
+	/// @brief advances every sprite's animation
+	/// @param theElapsed in ms
+	void Update(int theElapsed);
+	/// @brief draws the visible sprites, one batch per image
+	/// @param g
+	void Draw(Graphics *g);
+
+	/// @brief advances every animator made with autoUpdate, called by AppBase::UpdateFrames
+	/// @param theElapsed in ms
+	static void UpdateAll(int theElapsed);
+
+  protected:
+	struct Sheet
+	{
+		Image *mImage;
+		AnimInfo *mAnimInfo; ///< the one the tables were built from
+		int mWidth;
+		int mHeight;
+		std::vector<Rect> mCelRects;
+		std::vector<int> mCelAtTime; ///< by 1/100s into the animation, empty if it's static or too long
+		int mNumSprites;			 ///< sheets without sprites don't touch their image, it may be gone
+		VertexBatch mBatch;
+	};
+
+	bool mAutoUpdate;
+	std::vector<Sheet> mSheets;
+	std::unordered_map<Image *, int> mSheetMap;
+
+	// one entry per sprite, in the same order in every array
+	std::vector<int> mSheet;
+	std::vector<int> mTime;
+	std::vector<int> mCel;
+	std::vector<float> mX;
+	std::vector<float> mY;
+	std::vector<uint32_t> mColor;
+	std::vector<uint8_t> mVisible;
+	std::vector<int> mSpriteIds;
+
+	std::vector<int> mSlots; ///< sprite index by id, -1 if free
+	std::vector<int> mFreeIds;
+
+	int GetSheet(Image *theImage);
+	void BuildSheet(Sheet &theSheet);
+	int GetSheetCel(const Sheet &theSheet, int theTime) const;
+};
+
+} // namespace PopLib
+
+#endif
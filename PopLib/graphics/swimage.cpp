@@ -0,0 +1,156 @@
+#include "swimage.hpp"
+#include "swinterface.hpp"
+
+using namespace PopLib;
+
+// while the interface rasterizes, MemoryImage's own functions draw into the bits, including the ones they call
+// through the vtable (BltF calls BltRotated, FillScanLines calls FillRect)
+
+SWImage::SWImage(SWInterface *theInterface) : MemoryImage(theInterface->mApp)
+{
+	mInterface = theInterface;
+}
+
+SWImage::~SWImage()
+{
+}
+
+ulong *SWImage::GetBits()
+{
+	if (!mInterface->mRasterizing)
+		mInterface->Flush();
+
+	return MemoryImage::GetBits();
+}
+
+void SWImage::BitsChanged()
+{
+	// every tile would bump the count, the interface does it once per flush instead
+	if (!mInterface->mRasterizing)
+		MemoryImage::BitsChanged();
+}
+
+void SWImage::FillRect(const Rect &theRect, const Color &theColor, int theDrawMode)
+{
+	if (mInterface->mRasterizing)
+		MemoryImage::FillRect(theRect, theColor, theDrawMode);
+	else
+		mInterface->FillRect(theRect, theColor, theDrawMode);
+}
+
+void SWImage::ClearRect(const Rect &theRect)
+{
+	if (mInterface->mRasterizing)
+		MemoryImage::ClearRect(theRect);
+	else
+		mInterface->ClearRect(theRect);
+}
+
+void SWImage::DrawLine(double theStartX, double theStartY, double theEndX, double theEndY, const Color &theColor,
+					   int theDrawMode)
+{
+	if (mInterface->mRasterizing)
+		MemoryImage::DrawLine(theStartX, theStartY, theEndX, theEndY, theColor, theDrawMode);
+	else
+		mInterface->DrawLine(theStartX, theStartY, theEndX, theEndY, theColor, theDrawMode);
+}
+
+void SWImage::DrawLineAA(double theStartX, double theStartY, double theEndX, double theEndY, const Color &theColor,
+						 int theDrawMode)
+{
+	if (mInterface->mRasterizing)
+		MemoryImage::DrawLineAA(theStartX, theStartY, theEndX, theEndY, theColor, theDrawMode);
+	else
+		mInterface->DrawLineAA(theStartX, theStartY, theEndX, theEndY, theColor, theDrawMode);
+}
+
+void SWImage::FillScanLines(Span *theSpans, int theSpanCount, const Color &theColor, int theDrawMode)
+{
+	if (mInterface->mRasterizing)
+		MemoryImage::FillScanLines(theSpans, theSpanCount, theColor, theDrawMode);
+	else
+		mInterface->FillScanLines(theSpans, theSpanCount, theColor, theDrawMode);
+}
+
+void SWImage::FillScanLinesWithCoverage(Span *theSpans, int theSpanCount, const Color &theColor, int theDrawMode,
+										const BYTE *theCoverage, int theCoverX, int theCoverY, int theCoverWidth,
+										int theCoverHeight)
+{
+	if (mInterface->mRasterizing)
+		MemoryImage::FillScanLinesWithCoverage(theSpans, theSpanCount, theColor, theDrawMode, theCoverage, theCoverX,
+											   theCoverY, theCoverWidth, theCoverHeight);
+	else
+		mInterface->FillScanLinesWithCoverage(theSpans, theSpanCount, theColor, theDrawMode, theCoverage, theCoverX,
+											  theCoverY, theCoverWidth, theCoverHeight);
+}
+
+void SWImage::Blt(Image *theImage, int theX, int theY, const Rect &theSrcRect, const Color &theColor, int theDrawMode)
+{
+	if (mInterface->mRasterizing)
+		MemoryImage::Blt(theImage, theX, theY, theSrcRect, theColor, theDrawMode);
+	else
+		mInterface->Blt(theImage, theX, theY, theSrcRect, theColor, theDrawMode);
+}
+
+void SWImage::BltF(Image *theImage, float theX, float theY, const Rect &theSrcRect, const Rect &theClipRect,
+				   const Color &theColor, int theDrawMode)
+{
+	if (mInterface->mRasterizing)
+		MemoryImage::BltF(theImage, theX, theY, theSrcRect, theClipRect, theColor, theDrawMode);
+	else
+		mInterface->BltRotated(theImage, theX, theY, theSrcRect, theClipRect, theColor, theDrawMode, 0, 0, 0);
+}
+
+void SWImage::BltRotated(Image *theImage, float theX, float theY, const Rect &theSrcRect, const Rect &theClipRect,
+						 const Color &theColor, int theDrawMode, double theRot, float theRotCenterX,
+						 float theRotCenterY)
+{
+	if (mInterface->mRasterizing)
+		MemoryImage::BltRotated(theImage, theX, theY, theSrcRect, theClipRect, theColor, theDrawMode, theRot,
+								theRotCenterX, theRotCenterY);
+	else
+		mInterface->BltRotated(theImage, theX, theY, theSrcRect, theClipRect, theColor, theDrawMode, theRot,
+							   theRotCenterX, theRotCenterY);
+}
+
+void SWImage::StretchBlt(Image *theImage, const Rect &theDestRect, const Rect &theSrcRect, const Rect &theClipRect,
+						 const Color &theColor, int theDrawMode, bool fastStretch)
+{
+	if (mInterface->mRasterizing)
+		MemoryImage::StretchBlt(theImage, theDestRect, theSrcRect, theClipRect, theColor, theDrawMode, fastStretch);
+	else
+		mInterface->StretchBlt(theImage, theDestRect, theSrcRect, theClipRect, theColor, theDrawMode, fastStretch);
+}
+
+void SWImage::BltMatrix(Image *theImage, float x, float y, const Matrix3 &theMatrix, const Rect &theClipRect,
+						const Color &theColor, int theDrawMode, const Rect &theSrcRect, bool blend)
+{
+	if (mInterface->mRasterizing)
+		MemoryImage::BltMatrix(theImage, x, y, theMatrix, theClipRect, theColor, theDrawMode, theSrcRect, blend);
+	else
+		mInterface->BltMatrix(theImage, x, y, theMatrix, theClipRect, theColor, theDrawMode, theSrcRect, blend);
+}
+
+void SWImage::BltTrianglesTex(Image *theTexture, const TriVertex theVertices[][3], int theNumTriangles,
+							  const Rect &theClipRect, const Color &theColor, int theDrawMode, float tx, float ty,
+							  bool blend)
+{
+	if (mInterface->mRasterizing)
+		MemoryImage::BltTrianglesTex(theTexture, theVertices, theNumTriangles, theClipRect, theColor, theDrawMode, tx,
+									 ty, blend);
+	else
+		mInterface->BltTrianglesTex(theTexture, theVertices, theNumTriangles, theClipRect, theColor, theDrawMode, tx,
+									ty, blend);
+}
+
+void SWImage::BltMesh(Image *theTexture, const TriVertex theVertices[], int theNumVertices, const int theIndices[],
+					  int theNumIndices, const Rect &theClipRect, const Color &theColor, int theDrawMode, float tx,
+					  float ty, bool blend)
+{
+	if (mInterface->mRasterizing)
+		MemoryImage::BltMesh(theTexture, theVertices, theNumVertices, theIndices, theNumIndices, theClipRect, theColor,
+							 theDrawMode, tx, ty, blend);
+	else
+		mInterface->BltMesh(theTexture, theVertices, theNumVertices, theIndices, theNumIndices, theClipRect, theColor,
+							theDrawMode, tx, ty, blend);
+}
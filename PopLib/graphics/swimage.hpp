@@ -0,0 +1,57 @@
+#ifndef __SWIMAGE_HPP__
+#define __SWIMAGE_HPP__
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "memoryimage.hpp"
+
+namespace PopLib
+{
+class SWInterface;
+
+/// @brief the screen image of a SWInterface, draws on it are recorded until the interface flushes
+class SWImage : public MemoryImage
+{
+  public:
+	SWInterface *mInterface;
+
+  public:
+	SWImage(SWInterface *theInterface);
+	virtual ~SWImage();
+
+	/// @brief flushes first, so the bits have everything drawn so far
+	virtual ulong *GetBits();
+	virtual void BitsChanged();
+
+	virtual void FillRect(const Rect &theRect, const Color &theColor, int theDrawMode);
+	virtual void ClearRect(const Rect &theRect);
+	virtual void DrawLine(double theStartX, double theStartY, double theEndX, double theEndY, const Color &theColor,
+						  int theDrawMode);
+	virtual void DrawLineAA(double theStartX, double theStartY, double theEndX, double theEndY, const Color &theColor,
+							int theDrawMode);
+	virtual void FillScanLines(Span *theSpans, int theSpanCount, const Color &theColor, int theDrawMode);
+	virtual void FillScanLinesWithCoverage(Span *theSpans, int theSpanCount, const Color &theColor, int theDrawMode,
+										   const BYTE *theCoverage, int theCoverX, int theCoverY, int theCoverWidth,
+										   int theCoverHeight);
+	virtual void Blt(Image *theImage, int theX, int theY, const Rect &theSrcRect, const Color &theColor,
+					 int theDrawMode);
+	virtual void BltF(Image *theImage, float theX, float theY, const Rect &theSrcRect, const Rect &theClipRect,
+					  const Color &theColor, int theDrawMode);
+	virtual void BltRotated(Image *theImage, float theX, float theY, const Rect &theSrcRect, const Rect &theClipRect,
+							const Color &theColor, int theDrawMode, double theRot, float theRotCenterX,
+							float theRotCenterY);
+	virtual void StretchBlt(Image *theImage, const Rect &theDestRect, const Rect &theSrcRect, const Rect &theClipRect,
+							const Color &theColor, int theDrawMode, bool fastStretch);
+	virtual void BltMatrix(Image *theImage, float x, float y, const Matrix3 &theMatrix, const Rect &theClipRect,
+						   const Color &theColor, int theDrawMode, const Rect &theSrcRect, bool blend);
+	virtual void BltTrianglesTex(Image *theTexture, const TriVertex theVertices[][3], int theNumTriangles,
+								 const Rect &theClipRect, const Color &theColor, int theDrawMode, float tx, float ty,
+								 bool blend);
+	virtual void BltMesh(Image *theTexture, const TriVertex theVertices[], int theNumVertices, const int theIndices[],
+						 int theNumIndices, const Rect &theClipRect, const Color &theColor, int theDrawMode, float tx,
+						 float ty, bool blend);
+};
+} // namespace PopLib
+
+#endif
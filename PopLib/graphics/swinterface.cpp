@@ -0,0 +1,675 @@
+#include "swinterface.hpp"
+#include "swimage.hpp"
+#include "graphics.hpp"
+#include "misc/workerthread.hpp"
+#include "SWTri/SWTri.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace PopLib;
+
+SWInterface::SWInterface(AppBase *theApp, int theWidth, int theHeight, int theNumThreads)
+{
+	mApp = theApp;
+	mWidth = theWidth;
+	mHeight = theHeight;
+	mTileSize = 64;
+	mRasterizing = false;
+	mTexture = nullptr;
+	mTextureRenderer = nullptr;
+	mNextTile = 0;
+	mRecordThread = SDL_GetCurrentThreadID();
+
+	// the layout of MemoryImage's bits
+	mRGBBits = 32;
+	mRedBits = 8;
+	mGreenBits = 8;
+	mBlueBits = 8;
+	mRedShift = 16;
+	mGreenShift = 8;
+	mBlueShift = 0;
+	mRedMask = (0xFFU << mRedShift);
+	mGreenMask = (0xFFU << mGreenShift);
+	mBlueMask = (0xFFU << mBlueShift);
+
+	SWTri_AddAllDrawTriFuncs();
+
+	mScreenImage = new SWImage(this);
+	mScreenImage->Create(mWidth, mHeight);
+	mScreenImage->SetImageMode(false, false);
+
+	mNumTilesX = (mWidth + mTileSize - 1) / mTileSize;
+	mNumTilesY = (mHeight + mTileSize - 1) / mTileSize;
+	mTileCommands.resize(mNumTilesX * mNumTilesY);
+
+	if (theNumThreads <= 0)
+		theNumThreads = SDL_GetNumLogicalCPUCores();
+
+	// the thread calling Flush rasterizes too
+	for (int i = 1; i < theNumThreads; i++)
+		mWorkers.push_back(new WorkerThread(StrFormat("SWRaster%d", i)));
+}
+
+SWInterface::~SWInterface()
+{
+	for (WorkerThread *aWorker : mWorkers)
+		delete aWorker;
+	mWorkers.clear();
+
+	if (mTexture != nullptr)
+		SDL_DestroyTexture(mTexture);
+
+	delete mScreenImage;
+}
+
+MemoryImage *SWInterface::GetScreenImage()
+{
+	return mScreenImage;
+}
+
+int SWInterface::GetNumThreads()
+{
+	return (int)mWorkers.size() + 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+SWInterface::DrawCommand *SWInterface::AddCommand(int theType, Image *theImage, const Rect &theBounds, bool serial)
+{
+	Rect aBounds = theBounds.Intersection(Rect(0, 0, mWidth, mHeight));
+	if (aBounds.mWidth <= 0 || aBounds.mHeight <= 0)
+		return nullptr;
+
+	if (theImage != nullptr)
+	{
+		PrepareImage(theImage, theType == COMMAND_BLT);
+		mCommandImages.insert(theImage);
+	}
+
+	mCommands.emplace_back();
+	DrawCommand *aCommand = &mCommands.back();
+	aCommand->mType = theType;
+	aCommand->mSerial = serial;
+	aCommand->mBounds = aBounds;
+	aCommand->mImage = theImage;
+	aCommand->mDrawMode = Graphics::DRAWMODE_NORMAL;
+	aCommand->mX = 0;
+	aCommand->mY = 0;
+	aCommand->mRot = 0;
+	aCommand->mRotCenterX = 0;
+	aCommand->mRotCenterY = 0;
+	aCommand->mFlag = false;
+	aCommand->mFirst = 0;
+	aCommand->mCount = 0;
+	aCommand->mFirstCoverage = 0;
+	return aCommand;
+}
+
+void SWInterface::CommandAdded(Image *theImage)
+{
+	// its pixels are about to change, the commands using them can't wait for the end of the frame
+	MemoryImage *anImage = dynamic_cast<MemoryImage *>(theImage);
+	if (anImage != nullptr && anImage->mIsVolatile)
+		Flush();
+}
+
+void SWInterface::PrepareImage(Image *theImage, bool wantRLAlpha)
+{
+	theImage->mDrawn = true;
+
+	MemoryImage *anImage = dynamic_cast<MemoryImage *>(theImage);
+	if (anImage == nullptr || anImage == mScreenImage)
+		return;
+
+	// work out everything the blitters would otherwise make on first use, so the threads only read the image
+	anImage->CommitBits();
+	if (anImage->mBits == nullptr)
+		anImage->GetBits();
+	if (wantRLAlpha)
+		anImage->GetRLAlphaData();
+}
+
+Rect SWInterface::GetTriangleBounds(const TriVertex *theVertices, int theNumVertices, float tx, float ty,
+									const Rect &theClipRect)
+{
+	if (theNumVertices <= 0)
+		return Rect();
+
+	float aMinX = theVertices[0].x;
+	float aMaxX = theVertices[0].x;
+	float aMinY = theVertices[0].y;
+	float aMaxY = theVertices[0].y;
+	for (int i = 1; i < theNumVertices; i++)
+	{
+		aMinX = std::min(aMinX, theVertices[i].x);
+		aMaxX = std::max(aMaxX, theVertices[i].x);
+		aMinY = std::min(aMinY, theVertices[i].y);
+		aMaxY = std::max(aMaxY, theVertices[i].y);
+	}
+
+	int aLeft = (int)floorf(aMinX + tx);
+	int aTop = (int)floorf(aMinY + ty);
+	Rect aRect(aLeft, aTop, (int)ceilf(aMaxX + tx) - aLeft + 1, (int)ceilf(aMaxY + ty) - aTop + 1);
+	return aRect.Intersection(theClipRect);
+}
+
+Rect SWInterface::GetSpanBounds(const Span *theSpans, int theSpanCount)
+{
+	if (theSpanCount <= 0)
+		return Rect();
+
+	int aLeft = theSpans[0].mX;
+	int aRight = theSpans[0].mX + theSpans[0].mWidth;
+	int aTop = theSpans[0].mY;
+	int aBottom = theSpans[0].mY + 1;
+	for (int i = 1; i < theSpanCount; i++)
+	{
+		aLeft = std::min(aLeft, theSpans[i].mX);
+		aRight = std::max(aRight, theSpans[i].mX + theSpans[i].mWidth);
+		aTop = std::min(aTop, theSpans[i].mY);
+		aBottom = std::max(aBottom, theSpans[i].mY + 1);
+	}
+
+	return Rect(aLeft, aTop, aRight - aLeft, aBottom - aTop);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void SWInterface::FillRect(const Rect &theRect, const Color &theColor, int theDrawMode)
+{
+	DrawCommand *aCommand = AddCommand(COMMAND_FILLRECT, nullptr, theRect, false);
+	if (aCommand == nullptr)
+		return;
+
+	aCommand->mRect = theRect;
+	aCommand->mColor = theColor;
+	aCommand->mDrawMode = theDrawMode;
+}
+
+void SWInterface::ClearRect(const Rect &theRect)
+{
+	DrawCommand *aCommand = AddCommand(COMMAND_CLEARRECT, nullptr, theRect, false);
+	if (aCommand == nullptr)
+		return;
+
+	aCommand->mRect = theRect;
+}
+
+void SWInterface::DrawLine(double theStartX, double theStartY, double theEndX, double theEndY, const Color &theColor,
+						   int theDrawMode)
+{
+	DrawCommand *aCommand = AddCommand(COMMAND_LINE, nullptr, Rect(0, 0, mWidth, mHeight), true);
+	if (aCommand == nullptr)
+		return;
+
+	aCommand->mColor = theColor;
+	aCommand->mDrawMode = theDrawMode;
+	aCommand->mLine[0] = theStartX;
+	aCommand->mLine[1] = theStartY;
+	aCommand->mLine[2] = theEndX;
+	aCommand->mLine[3] = theEndY;
+}
+
+void SWInterface::DrawLineAA(double theStartX, double theStartY, double theEndX, double theEndY,
+							 const Color &theColor, int theDrawMode)
+{
+	DrawCommand *aCommand = AddCommand(COMMAND_LINEAA, nullptr, Rect(0, 0, mWidth, mHeight), true);
+	if (aCommand == nullptr)
+		return;
+
+	aCommand->mColor = theColor;
+	aCommand->mDrawMode = theDrawMode;
+	aCommand->mLine[0] = theStartX;
+	aCommand->mLine[1] = theStartY;
+	aCommand->mLine[2] = theEndX;
+	aCommand->mLine[3] = theEndY;
+}
+
+void SWInterface::FillScanLines(Span *theSpans, int theSpanCount, const Color &theColor, int theDrawMode)
+{
+	DrawCommand *aCommand = AddCommand(COMMAND_SCANLINES, nullptr, GetSpanBounds(theSpans, theSpanCount), false);
+	if (aCommand == nullptr)
+		return;
+
+	aCommand->mColor = theColor;
+	aCommand->mDrawMode = theDrawMode;
+	aCommand->mFirst = (int)mSpans.size();
+	aCommand->mCount = theSpanCount;
+	mSpans.insert(mSpans.end(), theSpans, theSpans + theSpanCount);
+}
+
+void SWInterface::FillScanLinesWithCoverage(Span *theSpans, int theSpanCount, const Color &theColor, int theDrawMode,
+											const BYTE *theCoverage, int theCoverX, int theCoverY, int theCoverWidth,
+											int theCoverHeight)
+{
+	DrawCommand *aCommand =
+		AddCommand(COMMAND_SCANLINES_COVERAGE, nullptr, GetSpanBounds(theSpans, theSpanCount), false);
+	if (aCommand == nullptr)
+		return;
+
+	aCommand->mColor = theColor;
+	aCommand->mDrawMode = theDrawMode;
+	aCommand->mFirst = (int)mSpans.size();
+	aCommand->mCount = theSpanCount;
+	mSpans.insert(mSpans.end(), theSpans, theSpans + theSpanCount);
+
+	// Graphics frees it once this returns
+	aCommand->mFirstCoverage = (int)mCoverage.size();
+	aCommand->mCoverX = theCoverX;
+	aCommand->mCoverY = theCoverY;
+	aCommand->mCoverWidth = theCoverWidth;
+	aCommand->mCoverHeight = theCoverHeight;
+	mCoverage.insert(mCoverage.end(), theCoverage, theCoverage + theCoverWidth * theCoverHeight);
+}
+
+void SWInterface::Blt(Image *theImage, int theX, int theY, const Rect &theSrcRect, const Color &theColor,
+					  int theDrawMode)
+{
+	DrawCommand *aCommand =
+		AddCommand(COMMAND_BLT, theImage, Rect(theX, theY, theSrcRect.mWidth, theSrcRect.mHeight), false);
+	if (aCommand == nullptr)
+		return;
+
+	aCommand->mX = (float)theX;
+	aCommand->mY = (float)theY;
+	aCommand->mSrcRect = theSrcRect;
+	aCommand->mColor = theColor;
+	aCommand->mDrawMode = theDrawMode;
+	CommandAdded(theImage);
+}
+
+void SWInterface::BltRotated(Image *theImage, float theX, float theY, const Rect &theSrcRect, const Rect &theClipRect,
+							 const Color &theColor, int theDrawMode, double theRot, float theRotCenterX,
+							 float theRotCenterY)
+{
+	// BltRotatedClipHelper truncates the clipped rect, so only unrotated blits on whole pixels split evenly
+	bool serial = theRot != 0 || theX != floorf(theX) || theY != floorf(theY);
+
+	Rect aBounds = theClipRect;
+	if (!serial)
+		aBounds = Rect((int)theX, (int)theY, theSrcRect.mWidth, theSrcRect.mHeight).Intersection(theClipRect);
+
+	DrawCommand *aCommand = AddCommand(COMMAND_BLTROTATED, theImage, aBounds, serial);
+	if (aCommand == nullptr)
+		return;
+
+	aCommand->mX = theX;
+	aCommand->mY = theY;
+	aCommand->mSrcRect = theSrcRect;
+	aCommand->mClipRect = theClipRect;
+	aCommand->mColor = theColor;
+	aCommand->mDrawMode = theDrawMode;
+	aCommand->mRot = theRot;
+	aCommand->mRotCenterX = theRotCenterX;
+	aCommand->mRotCenterY = theRotCenterY;
+	CommandAdded(theImage);
+}
+
+void SWInterface::StretchBlt(Image *theImage, const Rect &theDestRect, const Rect &theSrcRect,
+							 const Rect &theClipRect, const Color &theColor, int theDrawMode, bool fastStretch)
+{
+	DrawCommand *aCommand =
+		AddCommand(COMMAND_STRETCHBLT, theImage, theDestRect.Intersection(theClipRect), false);
+	if (aCommand == nullptr)
+		return;
+
+	aCommand->mRect = theDestRect;
+	aCommand->mSrcRect = theSrcRect;
+	aCommand->mClipRect = theClipRect;
+	aCommand->mColor = theColor;
+	aCommand->mDrawMode = theDrawMode;
+	aCommand->mFlag = fastStretch;
+	CommandAdded(theImage);
+}
+
+void SWInterface::BltMatrix(Image *theImage, float x, float y, const Matrix3 &theMatrix, const Rect &theClipRect,
+							const Color &theColor, int theDrawMode, const Rect &theSrcRect, bool blend)
+{
+	// the same corners BltMatrixHelper draws
+	float w2 = theSrcRect.mWidth / 2.0f;
+	float h2 = theSrcRect.mHeight / 2.0f;
+	TriVertex aCorners[4] = {TriVertex(-w2, -h2), TriVertex(w2, -h2), TriVertex(-w2, h2), TriVertex(w2, h2)};
+	for (int i = 0; i < 4; i++)
+	{
+		Vector3 v = theMatrix * Vector3(aCorners[i].x, aCorners[i].y, 1);
+		aCorners[i].x = v.x;
+		aCorners[i].y = v.y;
+	}
+
+	DrawCommand *aCommand = AddCommand(COMMAND_BLTMATRIX, theImage,
+									   GetTriangleBounds(aCorners, 4, x - 0.5f, y - 0.5f, theClipRect), false);
+	if (aCommand == nullptr)
+		return;
+
+	aCommand->mX = x;
+	aCommand->mY = y;
+	aCommand->mMatrix = theMatrix;
+	aCommand->mClipRect = theClipRect;
+	aCommand->mColor = theColor;
+	aCommand->mDrawMode = theDrawMode;
+	aCommand->mSrcRect = theSrcRect;
+	aCommand->mFlag = blend;
+	CommandAdded(theImage);
+}
+
+void SWInterface::BltTrianglesTex(Image *theTexture, const TriVertex theVertices[][3], int theNumTriangles,
+								  const Rect &theClipRect, const Color &theColor, int theDrawMode, float tx, float ty,
+								  bool blend)
+{
+	if (theNumTriangles <= 0)
+		return;
+
+	const TriVertex *aVertices = &theVertices[0][0];
+	DrawCommand *aCommand = AddCommand(COMMAND_TRIANGLES, theTexture,
+									   GetTriangleBounds(aVertices, theNumTriangles * 3, tx, ty, theClipRect), false);
+	if (aCommand == nullptr)
+		return;
+
+	aCommand->mX = tx;
+	aCommand->mY = ty;
+	aCommand->mClipRect = theClipRect;
+	aCommand->mColor = theColor;
+	aCommand->mDrawMode = theDrawMode;
+	aCommand->mFlag = blend;
+	aCommand->mFirst = (int)mVertices.size();
+	aCommand->mCount = theNumTriangles;
+	mVertices.insert(mVertices.end(), aVertices, aVertices + theNumTriangles * 3);
+	CommandAdded(theTexture);
+}
+
+void SWInterface::BltMesh(Image *theTexture, const TriVertex theVertices[], int theNumVertices, const int theIndices[],
+						  int theNumIndices, const Rect &theClipRect, const Color &theColor, int theDrawMode, float tx,
+						  float ty, bool blend)
+{
+	if (theIndices == nullptr)
+	{
+		BltTrianglesTex(theTexture, (const TriVertex(*)[3])theVertices, theNumVertices / 3, theClipRect, theColor,
+						theDrawMode, tx, ty, blend);
+		return;
+	}
+
+	// SWTri only takes triangle lists, expand the indices straight into the vertex store,
+	// skipping triangles that point past the vertices
+	int aFirst = (int)mVertices.size();
+	for (int i = 0; i + 2 < theNumIndices; i += 3)
+	{
+		const int *aTri = theIndices + i;
+		if ((unsigned)aTri[0] >= (unsigned)theNumVertices || (unsigned)aTri[1] >= (unsigned)theNumVertices ||
+			(unsigned)aTri[2] >= (unsigned)theNumVertices)
+			continue;
+
+		mVertices.push_back(theVertices[aTri[0]]);
+		mVertices.push_back(theVertices[aTri[1]]);
+		mVertices.push_back(theVertices[aTri[2]]);
+	}
+
+	int aNumTriangles = ((int)mVertices.size() - aFirst) / 3;
+	if (aNumTriangles <= 0)
+		return;
+
+	DrawCommand *aCommand =
+		AddCommand(COMMAND_TRIANGLES, theTexture,
+				   GetTriangleBounds(&mVertices[aFirst], aNumTriangles * 3, tx, ty, theClipRect), false);
+	if (aCommand == nullptr)
+	{
+		mVertices.resize(aFirst);
+		return;
+	}
+
+	aCommand->mX = tx;
+	aCommand->mY = ty;
+	aCommand->mClipRect = theClipRect;
+	aCommand->mColor = theColor;
+	aCommand->mDrawMode = theDrawMode;
+	aCommand->mFlag = blend;
+	aCommand->mFirst = aFirst;
+	aCommand->mCount = aNumTriangles;
+	CommandAdded(theTexture);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void SWInterface::Flush()
+{
+	if (mRasterizing || mCommands.empty())
+		return;
+
+	mRasterizing = true;
+
+	// made before any thread looks at it
+	mScreenImage->GetBits();
+
+	// runs of commands that can be split into tiles, separated by ones that have to be drawn whole
+	int aNumCommands = (int)mCommands.size();
+	int aPassStart = 0;
+	for (int i = 0; i <= aNumCommands; i++)
+	{
+		if (i < aNumCommands && !mCommands[i].mSerial)
+			continue;
+
+		RasterizePass(aPassStart, i);
+		if (i < aNumCommands)
+			ExecuteCommand(mCommands[i], Rect(0, 0, mWidth, mHeight));
+
+		aPassStart = i + 1;
+	}
+
+	mCommands.clear();
+	mVertices.clear();
+	mSpans.clear();
+	mCoverage.clear();
+	mCommandImages.clear();
+
+	mRasterizing = false;
+	mScreenImage->BitsChanged();
+}
+
+void SWInterface::ImageChanged(Image *theImage)
+{
+	if (mRasterizing || SDL_GetCurrentThreadID() != mRecordThread)
+		return;
+
+	if (mCommandImages.find(theImage) != mCommandImages.end())
+		Flush();
+}
+
+void SWInterface::RasterizePass(int theFirst, int theLast)
+{
+	if (theFirst >= theLast)
+		return;
+
+	for (int aTile : mActiveTiles)
+		mTileCommands[aTile].clear();
+	mActiveTiles.clear();
+
+	for (int i = theFirst; i < theLast; i++)
+	{
+		const Rect &aBounds = mCommands[i].mBounds;
+		int aTileLeft = aBounds.mX / mTileSize;
+		int aTileRight = (aBounds.mX + aBounds.mWidth - 1) / mTileSize;
+		int aTileTop = aBounds.mY / mTileSize;
+		int aTileBottom = (aBounds.mY + aBounds.mHeight - 1) / mTileSize;
+
+		for (int aTileY = aTileTop; aTileY <= aTileBottom; aTileY++)
+		{
+			for (int aTileX = aTileLeft; aTileX <= aTileRight; aTileX++)
+			{
+				int aTile = aTileY * mNumTilesX + aTileX;
+				if (mTileCommands[aTile].empty())
+					mActiveTiles.push_back(aTile);
+				mTileCommands[aTile].push_back(i);
+			}
+		}
+	}
+
+	mNextTile = 0;
+
+	int aNumWorkers = std::min((int)mWorkers.size(), (int)mActiveTiles.size() - 1);
+	for (int i = 0; i < aNumWorkers; i++)
+		mWorkers[i]->DoTask(RasterizeTilesProc, this);
+
+	RasterizeTiles();
+
+	for (int i = 0; i < aNumWorkers; i++)
+		mWorkers[i]->WaitForTask();
+}
+
+void SWInterface::RasterizeTilesProc(void *theInterface)
+{
+	((SWInterface *)theInterface)->RasterizeTiles();
+}
+
+void SWInterface::RasterizeTiles()
+{
+	for (;;)
+	{
+		int anIndex = mNextTile++;
+		if (anIndex >= (int)mActiveTiles.size())
+			break;
+
+		int aTile = mActiveTiles[anIndex];
+		int aTileX = (aTile % mNumTilesX) * mTileSize;
+		int aTileY = (aTile / mNumTilesX) * mTileSize;
+		Rect aTileRect(aTileX, aTileY, std::min(mTileSize, mWidth - aTileX), std::min(mTileSize, mHeight - aTileY));
+
+		for (int aCommand : mTileCommands[aTile])
+			ExecuteCommand(mCommands[aCommand], aTileRect);
+	}
+}
+
+void SWInterface::ExecuteCommand(const DrawCommand &theCommand, const Rect &theTileRect)
+{
+	// SWTri leaves out the last column and row of its clip rect, so tiles hand it one more to meet the next tile
+	// exactly. where the command's own clip is the tighter one it stays as it would be without tiles
+	Rect aTriangleClipRect =
+		Rect(theTileRect.mX, theTileRect.mY, theTileRect.mWidth + 1, theTileRect.mHeight + 1)
+			.Intersection(theCommand.mClipRect);
+	Rect aClipRect = theTileRect.Intersection(theCommand.mClipRect);
+
+	switch (theCommand.mType)
+	{
+	case COMMAND_FILLRECT: {
+		Rect aRect = theCommand.mRect.Intersection(theTileRect);
+		if (aRect.mWidth > 0 && aRect.mHeight > 0)
+			mScreenImage->MemoryImage::FillRect(aRect, theCommand.mColor, theCommand.mDrawMode);
+		break;
+	}
+	case COMMAND_CLEARRECT: {
+		Rect aRect = theCommand.mRect.Intersection(theTileRect);
+		if (aRect.mWidth > 0 && aRect.mHeight > 0)
+			mScreenImage->MemoryImage::ClearRect(aRect);
+		break;
+	}
+	case COMMAND_BLT: {
+		int aX = (int)theCommand.mX;
+		int aY = (int)theCommand.mY;
+		const Rect &aSrcRect = theCommand.mSrcRect;
+
+		Rect aDestRect = Rect(aX, aY, aSrcRect.mWidth, aSrcRect.mHeight).Intersection(theTileRect);
+		if (aDestRect.mWidth <= 0 || aDestRect.mHeight <= 0)
+			break;
+
+		Rect aTileSrcRect(aSrcRect.mX + aDestRect.mX - aX, aSrcRect.mY + aDestRect.mY - aY, aDestRect.mWidth,
+						  aDestRect.mHeight);
+		mScreenImage->MemoryImage::Blt(theCommand.mImage, aDestRect.mX, aDestRect.mY, aTileSrcRect,
+									   theCommand.mColor, theCommand.mDrawMode);
+		break;
+	}
+	case COMMAND_BLTROTATED:
+		if (aClipRect.mWidth > 0 && aClipRect.mHeight > 0)
+			mScreenImage->MemoryImage::BltRotated(theCommand.mImage, theCommand.mX, theCommand.mY,
+												  theCommand.mSrcRect, aClipRect, theCommand.mColor,
+												  theCommand.mDrawMode, theCommand.mRot, theCommand.mRotCenterX,
+												  theCommand.mRotCenterY);
+		break;
+	case COMMAND_STRETCHBLT:
+		if (aClipRect.mWidth > 0 && aClipRect.mHeight > 0)
+			mScreenImage->MemoryImage::StretchBlt(theCommand.mImage, theCommand.mRect, theCommand.mSrcRect,
+												  aClipRect, theCommand.mColor, theCommand.mDrawMode,
+												  theCommand.mFlag);
+		break;
+	case COMMAND_BLTMATRIX:
+		if (aTriangleClipRect.mWidth > 0 && aTriangleClipRect.mHeight > 0)
+			mScreenImage->MemoryImage::BltMatrix(theCommand.mImage, theCommand.mX, theCommand.mY, theCommand.mMatrix,
+												 aTriangleClipRect, theCommand.mColor, theCommand.mDrawMode,
+												 theCommand.mSrcRect, theCommand.mFlag);
+		break;
+	case COMMAND_TRIANGLES:
+		// mImage is nullptr for untextured meshes, they're filled with the vertex or draw color
+		if (aTriangleClipRect.mWidth > 0 && aTriangleClipRect.mHeight > 0)
+			mScreenImage->MemoryImage::BltTrianglesTex(
+				theCommand.mImage, (const TriVertex(*)[3]) & mVertices[theCommand.mFirst], theCommand.mCount,
+				aTriangleClipRect, theCommand.mColor, theCommand.mDrawMode, theCommand.mX, theCommand.mY,
+				theCommand.mFlag);
+		break;
+	case COMMAND_SCANLINES:
+	case COMMAND_SCANLINES_COVERAGE: {
+		// only the parts of the spans inside the tile
+		static thread_local std::vector<Span> aTileSpans;
+		aTileSpans.clear();
+
+		int aTileRight = theTileRect.mX + theTileRect.mWidth;
+		int aTileBottom = theTileRect.mY + theTileRect.mHeight;
+		for (int i = 0; i < theCommand.mCount; i++)
+		{
+			const Span &aSpan = mSpans[theCommand.mFirst + i];
+			if (aSpan.mY < theTileRect.mY || aSpan.mY >= aTileBottom)
+				continue;
+
+			int aLeft = std::max(aSpan.mX, theTileRect.mX);
+			int aRight = std::min(aSpan.mX + aSpan.mWidth, aTileRight);
+			if (aLeft < aRight)
+				aTileSpans.push_back(Span{aSpan.mY, aLeft, aRight - aLeft});
+		}
+
+		if (aTileSpans.empty())
+			break;
+
+		if (theCommand.mType == COMMAND_SCANLINES)
+			mScreenImage->MemoryImage::FillScanLines(aTileSpans.data(), (int)aTileSpans.size(), theCommand.mColor,
+													 theCommand.mDrawMode);
+		else
+			mScreenImage->MemoryImage::FillScanLinesWithCoverage(
+				aTileSpans.data(), (int)aTileSpans.size(), theCommand.mColor, theCommand.mDrawMode,
+				&mCoverage[theCommand.mFirstCoverage], theCommand.mCoverX, theCommand.mCoverY,
+				theCommand.mCoverWidth, theCommand.mCoverHeight);
+		break;
+	}
+	case COMMAND_LINE:
+		mScreenImage->MemoryImage::DrawLine(theCommand.mLine[0], theCommand.mLine[1], theCommand.mLine[2],
+											theCommand.mLine[3], theCommand.mColor, theCommand.mDrawMode);
+		break;
+	case COMMAND_LINEAA:
+		mScreenImage->MemoryImage::DrawLineAA(theCommand.mLine[0], theCommand.mLine[1], theCommand.mLine[2],
+											  theCommand.mLine[3], theCommand.mColor, theCommand.mDrawMode);
+		break;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool SWInterface::Present(SDL_Renderer *theRenderer)
+{
+	Flush();
+
+	if (mTexture == nullptr || mTextureRenderer != theRenderer)
+	{
+		if (mTexture != nullptr)
+			SDL_DestroyTexture(mTexture);
+
+		mTexture = SDL_CreateTexture(theRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, mWidth,
+									 mHeight);
+		mTextureRenderer = theRenderer;
+		if (mTexture == nullptr)
+			return false;
+
+		// the screen's alpha is whatever the blends left behind
+		SDL_SetTextureBlendMode(mTexture, SDL_BLENDMODE_NONE);
+	}
+
+	if (!SDL_UpdateTexture(mTexture, nullptr, mScreenImage->GetBits(), mWidth * sizeof(ulong)))
+		return false;
+
+	return SDL_RenderTexture(theRenderer, mTexture, nullptr, nullptr);
+}
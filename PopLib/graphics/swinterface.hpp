@@ -0,0 +1,189 @@
+#ifndef __SWINTERFACE_HPP__
+#define __SWINTERFACE_HPP__
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "common.hpp"
+#include "color.hpp"
+#include "image.hpp"
+#include "nativedisplay.hpp"
+#include "math/rect.hpp"
+#include "math/matrix.hpp"
+#include "math/trivertex.hpp"
+
+#include <SDL3/SDL.h>
+#include <atomic>
+#include <unordered_set>
+
+namespace PopLib
+{
+
+class AppBase;
+class MemoryImage;
+class SWImage;
+class WorkerThread;
+
+/**
+ * @brief draws the screen on the CPU, into a MemoryImage
+ *
+ * draws made on the screen image are recorded instead of done right away.
+ * Flush sorts them into squares of mTileSize pixels and rasterizes the
+ * squares on a pool of threads with the MemoryImage and SWTri code, each one
+ * running its commands in order, clipped to itself. lines and rotated or
+ * subpixel blits can't be split up without seams, those are drawn alone
+ * between the parallel passes. Present uploads the frame into a single
+ * streaming texture.
+ *
+ * images are read when the frame is flushed, not when they're drawn. ones
+ * that change in the middle of a frame have to be marked with SetVolatile,
+ * drawing them flushes everything recorded so far. MemoryImage also calls
+ * ImageChanged from BitsChanged and its destructor, so recorded commands never
+ * read a deleted image or alpha data that was thrown away. pixels written
+ * through GetBits before BitsChanged still show up in the earlier draws.
+ */
+class SWInterface : public NativeDisplay
+{
+  public:
+	AppBase *mApp;
+	int mWidth;
+	int mHeight;
+	int mTileSize;
+	SWImage *mScreenImage;
+	/// @brief set while Flush runs, draws on the screen image go straight to its bits then
+	bool mRasterizing;
+
+	SDL_Texture *mTexture;
+	SDL_Renderer *mTextureRenderer;
+
+  protected:
+	enum
+	{
+		COMMAND_FILLRECT,
+		COMMAND_CLEARRECT,
+		COMMAND_BLT,
+		COMMAND_BLTROTATED,
+		COMMAND_STRETCHBLT,
+		COMMAND_BLTMATRIX,
+		COMMAND_TRIANGLES,
+		COMMAND_SCANLINES,
+		COMMAND_SCANLINES_COVERAGE,
+		COMMAND_LINE,
+		COMMAND_LINEAA
+	};
+
+	struct DrawCommand
+	{
+		int mType;
+		bool mSerial;  ///< drawn alone on the whole screen instead of tile by tile
+		Rect mBounds;  ///< pixels it can touch
+		Image *mImage;
+		Rect mRect;	   ///< filled or stretched to
+		Rect mSrcRect;
+		Rect mClipRect;
+		Color mColor;
+		int mDrawMode;
+		float mX;
+		float mY;
+		double mRot;
+		float mRotCenterX;
+		float mRotCenterY;
+		Matrix3 mMatrix;
+		bool mFlag;	   ///< fastStretch or blend
+		int mFirst;	   ///< into mVertices or mSpans
+		int mCount;	   ///< triangles or spans
+		int mFirstCoverage;
+		int mCoverX;
+		int mCoverY;
+		int mCoverWidth;
+		int mCoverHeight;
+		double mLine[4];
+	};
+
+	std::vector<DrawCommand> mCommands;
+	std::vector<TriVertex> mVertices;
+	std::vector<Span> mSpans;
+	std::vector<BYTE> mCoverage;
+	std::unordered_set<Image *> mCommandImages; ///< images the recorded commands read
+	SDL_ThreadID mRecordThread;					///< the thread drawing into the screen image
+
+	int mNumTilesX;
+	int mNumTilesY;
+	std::vector<std::vector<int>> mTileCommands; ///< commands of the current pass, by tile
+	std::vector<int> mActiveTiles;				 ///< tiles with commands in the current pass
+	std::atomic<int> mNextTile;
+	std::vector<WorkerThread *> mWorkers;
+
+  public:
+	/// @brief creates the screen image and the threads
+	/// @param theApp
+	/// @param theWidth
+	/// @param theHeight
+	/// @param theNumThreads threads to rasterize with, counting the caller, 0 for one per core
+	SWInterface(AppBase *theApp, int theWidth, int theHeight, int theNumThreads = 0);
+	virtual ~SWInterface();
+
+	/// @brief the image to draw the frame on
+	/// @return the screen image, its bits are the frame once flushed
+	MemoryImage *GetScreenImage();
+	/// @brief threads the tiles are rasterized on
+	/// @return the count, counting the one calling Flush
+	int GetNumThreads();
+
+	/// @brief rasterizes everything drawn since the last flush
+	void Flush();
+	/// @brief flushes if recorded commands still read an image that is about to change or go away
+	///
+	/// only flushes on the thread drawing the frame, images shouldn't change under it from others.
+	/// @param theImage
+	void ImageChanged(Image *theImage);
+	/// @brief flushes and draws the frame over the whole render target
+	///
+	/// the texture is kept for the next frame, so theRenderer has to outlive
+	/// this interface or be the same one every time.
+	/// @param theRenderer
+	/// @return true if success
+	bool Present(SDL_Renderer *theRenderer);
+
+	// recorded for the screen image, see the Image functions of the same name
+	void FillRect(const Rect &theRect, const Color &theColor, int theDrawMode);
+	void ClearRect(const Rect &theRect);
+	void DrawLine(double theStartX, double theStartY, double theEndX, double theEndY, const Color &theColor,
+				  int theDrawMode);
+	void DrawLineAA(double theStartX, double theStartY, double theEndX, double theEndY, const Color &theColor,
+					int theDrawMode);
+	void FillScanLines(Span *theSpans, int theSpanCount, const Color &theColor, int theDrawMode);
+	void FillScanLinesWithCoverage(Span *theSpans, int theSpanCount, const Color &theColor, int theDrawMode,
+								   const BYTE *theCoverage, int theCoverX, int theCoverY, int theCoverWidth,
+								   int theCoverHeight);
+	void Blt(Image *theImage, int theX, int theY, const Rect &theSrcRect, const Color &theColor, int theDrawMode);
+	void BltRotated(Image *theImage, float theX, float theY, const Rect &theSrcRect, const Rect &theClipRect,
+					const Color &theColor, int theDrawMode, double theRot, float theRotCenterX, float theRotCenterY);
+	void StretchBlt(Image *theImage, const Rect &theDestRect, const Rect &theSrcRect, const Rect &theClipRect,
+					const Color &theColor, int theDrawMode, bool fastStretch);
+	void BltMatrix(Image *theImage, float x, float y, const Matrix3 &theMatrix, const Rect &theClipRect,
+				   const Color &theColor, int theDrawMode, const Rect &theSrcRect, bool blend);
+	void BltTrianglesTex(Image *theTexture, const TriVertex theVertices[][3], int theNumTriangles,
+						 const Rect &theClipRect, const Color &theColor, int theDrawMode, float tx, float ty,
+						 bool blend);
+	void BltMesh(Image *theTexture, const TriVertex theVertices[], int theNumVertices, const int theIndices[],
+				 int theNumIndices, const Rect &theClipRect, const Color &theColor, int theDrawMode, float tx,
+				 float ty, bool blend);
+
+  protected:
+	DrawCommand *AddCommand(int theType, Image *theImage, const Rect &theBounds, bool serial);
+	void CommandAdded(Image *theImage);
+	void PrepareImage(Image *theImage, bool wantRLAlpha);
+	Rect GetTriangleBounds(const TriVertex *theVertices, int theNumVertices, float tx, float ty,
+						   const Rect &theClipRect);
+	Rect GetSpanBounds(const Span *theSpans, int theSpanCount);
+
+	void RasterizePass(int theFirst, int theLast);
+	void RasterizeTiles();
+	void ExecuteCommand(const DrawCommand &theCommand, const Rect &theTileRect);
+	static void RasterizeTilesProc(void *theInterface);
+};
+
+} // namespace PopLib
+
+#endif // __SWINTERFACE_HPP__
@@ -11,6 +11,8 @@
 
 using namespace PopLib;
 
+static const int gMaxStringImages = 64; // the strings on screen at once, more and they're all rendered again
+
 SysFont::SysFont(const std::string &theFace, int thePointSize, bool bold, bool italics, bool underline)
 {
 	Init(gAppBase, theFace, thePointSize, 0, bold, italics, underline, false);
@@ -84,9 +86,54 @@ SysFont::SysFont(const SysFont &theSysFont)
 
 SysFont::~SysFont()
 {
+	ClearStringImages();
 	TTF_CloseFont(mTTFFont);
 }
 
+MemoryImage *SysFont::GetStringImage(const PopString &theString)
+{
+	StringImageMap::iterator anItr = mStringImages.find(theString);
+	if (anItr != mStringImages.end())
+		return anItr->second;
+
+	// white, so the image can be colorized to any color
+	SDL_Color aWhite = {255, 255, 255, 255};
+	SDL_Surface *aTextSurface = TTF_RenderText_Blended(mTTFFont, theString.c_str(), 0, aWhite);
+	if (!aTextSurface)
+		return nullptr;
+
+	SDL_Surface *anARGBSurface = SDL_ConvertSurface(aTextSurface, SDL_PIXELFORMAT_ARGB8888);
+	SDL_DestroySurface(aTextSurface);
+	if (!anARGBSurface)
+		return nullptr;
+
+	MemoryImage *anImage = new MemoryImage(mApp);
+	anImage->Create(anARGBSurface->w, anARGBSurface->h);
+
+	ulong *aBits = anImage->GetBits();
+	for (int y = 0; y < anARGBSurface->h; y++)
+		memcpy(aBits + y * anARGBSurface->w, (uchar *)anARGBSurface->pixels + y * anARGBSurface->pitch,
+			   anARGBSurface->w * sizeof(ulong));
+	SDL_DestroySurface(anARGBSurface);
+
+	anImage->mHasAlpha = true;
+	anImage->mHasTrans = true;
+	anImage->BitsChanged();
+
+	if ((int)mStringImages.size() >= gMaxStringImages)
+		ClearStringImages();
+
+	mStringImages[theString] = anImage;
+	return anImage;
+}
+
+void SysFont::ClearStringImages()
+{
+	for (StringImageMap::iterator anItr = mStringImages.begin(); anItr != mStringImages.end(); ++anItr)
+		delete anItr->second;
+	mStringImages.clear();
+}
+
 ImageFont *SysFont::CreateImageFont()
 {
 	/*
@@ -192,6 +239,31 @@ int SysFont::StringWidth(const PopString &theString)
 void SysFont::DrawString(Graphics *g, int theX, int theY, const PopString &theString, const Color &theColor,
 						 const Rect &theClipRect)
 {
+	if (dynamic_cast<SDLImage *>(g->mDestImage) == nullptr)
+	{
+		// the software screen or a MemoryImage, the renderer would draw past their command list
+		MemoryImage *anImage = GetStringImage(theString);
+		if (anImage == nullptr)
+			return;
+
+		Color anOldColor = g->GetColor();
+		bool wasColorized = g->GetColorizeImages();
+		g->SetColorizeImages(true);
+
+		if (mDrawShadow)
+		{
+			g->SetColor(Color(0, 0, 0, theColor.mAlpha));
+			g->DrawImage(anImage, theX + 1, theY - mAscent + 1);
+		}
+
+		g->SetColor(theColor);
+		g->DrawImage(anImage, theX, theY - mAscent);
+
+		g->SetColor(anOldColor);
+		g->SetColorizeImages(wasColorized);
+		return;
+	}
+
 	SDL_Renderer *renderer = mApp->mSDLInterface->mRenderer;
 	SDL_Color aColor = {(Uint8)theColor.mRed, (Uint8)theColor.mGreen, (Uint8)theColor.mBlue, (Uint8)theColor.mAlpha};
 	SDL_Surface *textSurface =
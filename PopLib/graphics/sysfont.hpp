@@ -14,6 +14,7 @@ namespace PopLib
 
 class ImageFont;
 class AppBase;
+class MemoryImage;
 
 class SysFont : public Font
 {
@@ -23,6 +24,17 @@ class SysFont : public Font
 	bool mDrawShadow;
 	bool mSimulateBold;
 
+  protected:
+	typedef std::map<PopString, MemoryImage *> StringImageMap;
+
+	/// @brief strings rendered for destinations that aren't drawn straight to the renderer
+	StringImageMap mStringImages;
+
+	MemoryImage *GetStringImage(const PopString &theString);
+	void ClearStringImages();
+
+  public:
+
 	void Init(AppBase *theApp, const std::string &theFace, int thePointSize, int theScript, bool bold, bool italics,
 			  bool underline, bool useDevCaps);
 
@@ -0,0 +1,344 @@
+#include "textlayout.hpp"
+#include "font.hpp"
+#include "graphics.hpp"
+#include "misc/autocrit.hpp"
+#include "misc/critsect.hpp"
+
+#include <list>
+#include <unordered_map>
+
+using namespace PopLib;
+
+TextLayout::TextLayout()
+{
+	mHeight = 0;
+	mMaxWidth = 0;
+	mLineSpacing = 0;
+}
+
+void TextLayout::Clear()
+{
+	mLines.clear();
+	mRuns.clear();
+	mHeight = 0;
+	mMaxWidth = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+int TextLayout::AddLine(Font *theFont, const PopString &theText, int theOffset, int theLength, int theY, int theWidth,
+						int theJustification, bool colored)
+{
+	// same parsing as Graphics::WriteString, positions are taken instead of drawing
+	Line aLine;
+	aLine.mY = theY;
+	aLine.mFirstRun = (int)mRuns.size();
+
+	int anEnd = (theLength < 0 || theOffset + theLength > (int)theText.length()) ? (int)theText.length()
+																				  : theOffset + theLength;
+
+	Run aRun;
+	aRun.mX = 0;
+	aRun.mColor = RUN_COLOR_NONE;
+
+	for (int i = theOffset; i < anEnd; i++)
+	{
+		if ((theText[i] == '^') && colored)
+		{
+			if (i + 1 < anEnd && theText[i + 1] == '^') // literal '^'
+			{
+				aRun.mText += '^';
+				i++;
+			}
+			else if (i > anEnd - 8) // badly formatted color specification
+				break;
+			else // change color instruction
+			{
+				int aColor = 0;
+				if (theText[i + 1] == 'o')
+				{
+					if (strncmp(theText.c_str() + i + 1, "oldclr", 6) == 0)
+						aColor = RUN_COLOR_OLD;
+				}
+				else
+				{
+					for (int aDigitNum = 0; aDigitNum < 6; aDigitNum++)
+					{
+						PopChar aChar = theText[i + aDigitNum + 1];
+						int aVal = 0;
+
+						if ((aChar >= '0') && (aChar <= '9'))
+							aVal = aChar - '0';
+						else if ((aChar >= 'A') && (aChar <= 'F'))
+							aVal = (aChar - 'A') + 10;
+						else if ((aChar >= 'a') && (aChar <= 'f'))
+							aVal = (aChar - 'a') + 10;
+
+						aColor += (aVal << ((5 - aDigitNum) * 4));
+					}
+				}
+
+				i += 7;
+
+				int aRunWidth = theFont->StringWidth(aRun.mText);
+				mRuns.push_back(aRun);
+
+				aRun.mText.clear();
+				aRun.mX += aRunWidth;
+				aRun.mColor = aColor;
+			}
+		}
+		else
+			aRun.mText += theText[i];
+	}
+
+	int aLineWidth = aRun.mX + theFont->StringWidth(aRun.mText);
+	mRuns.push_back(aRun);
+
+	int anOffsetX = 0;
+	if (theJustification == 0)
+		anOffsetX = (theWidth - aLineWidth) / 2;
+	else if (theJustification == 1)
+		anOffsetX = theWidth - aLineWidth;
+
+	for (int i = aLine.mFirstRun; i < (int)mRuns.size(); i++)
+		mRuns[i].mX += anOffsetX;
+
+	aLine.mNumRuns = (int)mRuns.size() - aLine.mFirstRun;
+	mLines.push_back(aLine);
+
+	return aLineWidth;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void TextLayout::WordWrap(Font *theFont, const PopString &theText, int theWidth, int theLineSpacing,
+						  int theJustification, bool colored)
+{
+	// mirrors Graphics::WriteWordWrapped so cached and uncached text break in the same places
+	Clear();
+
+	int aYOffset = theFont->GetAscent() - theFont->GetAscentPadding();
+
+	if (theLineSpacing == -1)
+		theLineSpacing = theFont->GetLineSpacing();
+	mLineSpacing = theLineSpacing;
+
+	ulong aCurPos = 0;
+	int aLineStartPos = 0;
+	int aCurWidth = 0;
+	PopChar aCurChar = 0;
+	PopChar aPrevChar = 0;
+	int aSpacePos = -1;
+	int aMaxWidth = 0;
+
+	while (aCurPos < theText.length())
+	{
+		aCurChar = theText[aCurPos];
+		if (aCurChar == '^' && colored)
+		{
+			if (aCurPos + 1 < theText.length())
+			{
+				if (theText[aCurPos + 1] == '^')
+					aCurPos++;
+				else
+				{
+					aCurPos += 8;
+					continue;
+				}
+			}
+		}
+		else if (aCurChar == ' ')
+			aSpacePos = aCurPos;
+		else if (aCurChar == '\n')
+		{
+			aCurWidth = theWidth + 1; // force word wrap
+			aSpacePos = aCurPos;
+			aCurPos++;
+		}
+
+		aCurWidth += theFont->CharWidthKern(aCurChar, aPrevChar);
+		aPrevChar = aCurChar;
+
+		if (aCurWidth > theWidth)
+		{
+			int aWrittenWidth;
+			if (aSpacePos != -1)
+			{
+				AddLine(theFont, theText, aLineStartPos, aSpacePos - aLineStartPos, aYOffset, theWidth,
+						theJustification, colored);
+				aWrittenWidth = aCurWidth;
+
+				aCurPos = aSpacePos + 1;
+				if (aCurChar != '\n')
+				{
+					while (aCurPos < theText.length() && theText[aCurPos] == ' ')
+						aCurPos++;
+				}
+			}
+			else
+			{
+				if ((int)aCurPos < aLineStartPos + 1)
+					aCurPos++; // ensure at least one character gets written
+
+				aWrittenWidth = AddLine(theFont, theText, aLineStartPos, aCurPos - aLineStartPos, aYOffset, theWidth,
+										theJustification, colored);
+			}
+
+			if (aWrittenWidth > aMaxWidth)
+				aMaxWidth = aWrittenWidth;
+
+			aLineStartPos = aCurPos;
+			aSpacePos = -1;
+			aCurWidth = 0;
+			aPrevChar = 0;
+			aYOffset += theLineSpacing;
+		}
+		else
+			aCurPos++;
+	}
+
+	if (aLineStartPos < (int)theText.length())
+	{
+		int aWrittenWidth = AddLine(theFont, theText, aLineStartPos, theText.length() - aLineStartPos, aYOffset,
+									theWidth, theJustification, colored);
+		if (aWrittenWidth > aMaxWidth)
+			aMaxWidth = aWrittenWidth;
+
+		aYOffset += theLineSpacing;
+	}
+	else if (aCurChar == '\n')
+		aYOffset += theLineSpacing;
+
+	mMaxWidth = aMaxWidth;
+	mHeight = aYOffset + theFont->GetDescent() - theLineSpacing;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void TextLayout::Draw(Graphics *g, int theX, int theY, int theOldColor) const
+{
+	for (const Line &aLine : mLines)
+	{
+		int aY = theY + aLine.mY;
+		float aPhysPos = aY + g->mTransY;
+		bool visible =
+			(aPhysPos >= g->mClipRect.mY) && (aPhysPos < g->mClipRect.mY + g->mClipRect.mHeight + mLineSpacing);
+
+		for (int i = aLine.mFirstRun; i < aLine.mFirstRun + aLine.mNumRuns; i++)
+		{
+			const Run &aRun = mRuns[i];
+
+			// colors still apply on hidden lines, they carry over to the next ones
+			if (aRun.mColor != RUN_COLOR_NONE)
+			{
+				int aColor = aRun.mColor == RUN_COLOR_OLD ? theOldColor : aRun.mColor;
+				g->SetColor(
+					Color((aColor >> 16) & 0xFF, (aColor >> 8) & 0xFF, aColor & 0xFF, g->GetColor().mAlpha));
+			}
+
+			if (visible && !aRun.mText.empty())
+				g->DrawString(aRun.mText, theX + aRun.mX, aY);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+namespace
+{
+
+struct LayoutKey
+{
+	PopString mText;
+	int mFontId;
+	int mWidth;
+	int mLineSpacing;
+	int mJustification;
+	bool mColored;
+
+	bool operator==(const LayoutKey &theKey) const
+	{
+		return mFontId == theKey.mFontId && mWidth == theKey.mWidth && mLineSpacing == theKey.mLineSpacing &&
+			   mJustification == theKey.mJustification && mColored == theKey.mColored && mText == theKey.mText;
+	}
+};
+
+struct LayoutKeyHash
+{
+	size_t operator()(const LayoutKey &theKey) const
+	{
+		size_t aHash = std::hash<PopString>()(theKey.mText);
+		for (int aVal :
+			 {theKey.mFontId, theKey.mWidth, theKey.mLineSpacing, theKey.mJustification, (int)theKey.mColored})
+			aHash = (aHash ^ (size_t)aVal) * 0x100000001B3ULL;
+		return aHash;
+	}
+};
+
+typedef std::list<std::pair<LayoutKey, std::shared_ptr<const TextLayout>>> LayoutList;
+typedef std::unordered_map<LayoutKey, LayoutList::iterator, LayoutKeyHash> LayoutMap;
+
+} // namespace
+
+static CritSect gLayoutCritSect;
+static LayoutList gLayouts; // most recently used first
+static LayoutMap gLayoutMap;
+static int gLayoutCapacity = 256;
+
+std::shared_ptr<const TextLayout> TextLayoutCache::Get(Font *theFont, const PopString &theText, int theWidth,
+													   int theLineSpacing, int theJustification, bool colored)
+{
+	LayoutKey aKey = {theText, theFont->mLayoutId, theWidth, theLineSpacing, theJustification, colored};
+
+	{
+		AutoCrit anAutoCrit(gLayoutCritSect);
+
+		auto anItr = gLayoutMap.find(aKey);
+		if (anItr != gLayoutMap.end())
+		{
+			gLayouts.splice(gLayouts.begin(), gLayouts, anItr->second);
+			return anItr->second->second;
+		}
+	}
+
+	// lay it out without holding the lock, fonts can be slow to measure
+	std::shared_ptr<TextLayout> aLayout = std::make_shared<TextLayout>();
+	aLayout->WordWrap(theFont, theText, theWidth, theLineSpacing, theJustification, colored);
+
+	AutoCrit anAutoCrit(gLayoutCritSect);
+
+	if (gLayoutMap.find(aKey) == gLayoutMap.end())
+	{
+		gLayouts.emplace_front(aKey, aLayout);
+		gLayoutMap.emplace(std::move(aKey), gLayouts.begin());
+
+		while ((int)gLayouts.size() > gLayoutCapacity)
+		{
+			gLayoutMap.erase(gLayouts.back().first);
+			gLayouts.pop_back();
+		}
+	}
+
+	return aLayout;
+}
+
+void TextLayoutCache::SetCapacity(int theMaxLayouts)
+{
+	AutoCrit anAutoCrit(gLayoutCritSect);
+
+	gLayoutCapacity = std::max(theMaxLayouts, 0);
+	while ((int)gLayouts.size() > gLayoutCapacity)
+	{
+		gLayoutMap.erase(gLayouts.back().first);
+		gLayouts.pop_back();
+	}
+}
+
+void TextLayoutCache::Clear()
+{
+	AutoCrit anAutoCrit(gLayoutCritSect);
+
+	gLayoutMap.clear();
+	gLayouts.clear();
+}
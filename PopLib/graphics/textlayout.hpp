@@ -0,0 +1,104 @@
+#ifndef __TEXTLAYOUT_HPP__
+#define __TEXTLAYOUT_HPP__
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "common.hpp"
+
+#include <memory>
+
+namespace PopLib
+{
+
+class Font;
+class Graphics;
+
+/**
+ * @brief word wrapped text broken into lines and colored runs
+ *
+ * WordWrap measures the text once with the same rules as
+ * Graphics::WriteWordWrapped: breaks at spaces and newlines, ^RRGGBB color
+ * codes, ^oldclr and ^^. Draw then only sets colors and draws the runs at
+ * their stored positions, so text that doesn't change can be drawn every
+ * frame without being parsed and measured again.
+ */
+class TextLayout
+{
+  public:
+	enum
+	{
+		RUN_COLOR_NONE = -1, ///< keep the current color
+		RUN_COLOR_OLD = -2	 ///< go back to the color the text started with
+	};
+
+	struct Run
+	{
+		PopString mText;
+		int mX;
+		int mColor; ///< RGB set before drawing the run, or one of the RUN_COLOR values
+	};
+
+	struct Line
+	{
+		int mY; ///< baseline, relative to the top of the text
+		int mFirstRun;
+		int mNumRuns;
+	};
+
+	std::vector<Line> mLines;
+	std::vector<Run> mRuns;
+	int mHeight;	  ///< what WriteWordWrapped returns for this text
+	int mMaxWidth;	  ///< what WriteWordWrapped stores in theMaxWidth
+	int mLineSpacing; ///< the spacing the lines were placed with
+
+  public:
+	TextLayout();
+
+	void Clear();
+	/// @brief breaks theText into lines
+	/// @param theFont
+	/// @param theText
+	/// @param theWidth wrap width
+	/// @param theLineSpacing -1 for the font's line spacing
+	/// @param theJustification -1 left, 0 centered, 1 right
+	/// @param colored false to draw color codes as text, like Graphics::mWriteColoredString
+	void WordWrap(Font *theFont, const PopString &theText, int theWidth, int theLineSpacing, int theJustification,
+				  bool colored);
+	/// @brief draws the text with g's font, lines outside g's clip rect only change the color
+	/// @param g
+	/// @param theX left of the wrap rect
+	/// @param theY top of the wrap rect
+	/// @param theOldColor RGB used by ^oldclr
+	void Draw(Graphics *g, int theX, int theY, int theOldColor) const;
+
+  protected:
+	int AddLine(Font *theFont, const PopString &theText, int theOffset, int theLength, int theY, int theWidth,
+				int theJustification, bool colored);
+};
+
+/**
+ * @brief the most recently used word wrapped layouts
+ *
+ * layouts are keyed on the text, the font and the wrap settings, so the
+ * same string drawn every frame is only laid out once. fonts get a new
+ * Font::mLayoutId whenever their metrics change, which makes old entries
+ * unreachable; they drop out as new layouts push them to the back.
+ */
+class TextLayoutCache
+{
+  public:
+	/// @brief finds or makes the layout of a text
+	/// @return a shared layout that stays valid even if it's evicted meanwhile
+	static std::shared_ptr<const TextLayout> Get(Font *theFont, const PopString &theText, int theWidth,
+												 int theLineSpacing, int theJustification, bool colored);
+	/// @brief sets how many layouts are kept
+	/// @param theMaxLayouts
+	static void SetCapacity(int theMaxLayouts);
+	/// @brief drops every layout
+	static void Clear();
+};
+
+} // namespace PopLib
+
+#endif
@@ -0,0 +1,82 @@
+#include "vertexbatch.hpp"
+
+using namespace PopLib;
+
+VertexBatch::VertexBatch()
+{
+}
+
+VertexBatch::~VertexBatch()
+{
+}
+
+void VertexBatch::Clear()
+{
+	mVertices.clear();
+	mIndices.clear();
+}
+
+void VertexBatch::Reserve(int theNumVertices, int theNumIndices)
+{
+	mVertices.reserve(mVertices.size() + theNumVertices);
+	mIndices.reserve(mIndices.size() + theNumIndices);
+}
+
+bool VertexBatch::IsEmpty() const
+{
+	return mIndices.size() < 3;
+}
+
+int VertexBatch::AddVertex(const TriVertex &theVertex)
+{
+	mVertices.push_back(theVertex);
+	return (int)mVertices.size() - 1;
+}
+
+void VertexBatch::AddIndex(int theIndex)
+{
+	mIndices.push_back(theIndex);
+}
+
+void VertexBatch::AddTriangle(const TriVertex &theV0, const TriVertex &theV1, const TriVertex &theV2)
+{
+	int aBase = (int)mVertices.size();
+	mVertices.push_back(theV0);
+	mVertices.push_back(theV1);
+	mVertices.push_back(theV2);
+
+	mIndices.push_back(aBase);
+	mIndices.push_back(aBase + 1);
+	mIndices.push_back(aBase + 2);
+}
+
+void VertexBatch::AddQuad(const TriVertex &theTopLeft, const TriVertex &theTopRight, const TriVertex &theBottomLeft,
+						  const TriVertex &theBottomRight)
+{
+	int aBase = (int)mVertices.size();
+	mVertices.push_back(theTopLeft);
+	mVertices.push_back(theTopRight);
+	mVertices.push_back(theBottomLeft);
+	mVertices.push_back(theBottomRight);
+
+	static const int aQuadIndices[6] = {0, 1, 2, 2, 1, 3};
+	for (int anIndex : aQuadIndices)
+		mIndices.push_back(aBase + anIndex);
+}
+
+void VertexBatch::AddQuad(const FRect &theDestRect, const Rect &theSrcRect, int theTextureWidth, int theTextureHeight,
+						  uint32_t theColor)
+{
+	float aLeft = (float)theDestRect.mX;
+	float aTop = (float)theDestRect.mY;
+	float aRight = (float)(theDestRect.mX + theDestRect.mWidth);
+	float aBottom = (float)(theDestRect.mY + theDestRect.mHeight);
+
+	float u0 = (float)theSrcRect.mX / theTextureWidth;
+	float v0 = (float)theSrcRect.mY / theTextureHeight;
+	float u1 = (float)(theSrcRect.mX + theSrcRect.mWidth) / theTextureWidth;
+	float v1 = (float)(theSrcRect.mY + theSrcRect.mHeight) / theTextureHeight;
+
+	AddQuad(TriVertex(aLeft, aTop, u0, v0, theColor), TriVertex(aRight, aTop, u1, v0, theColor),
+			TriVertex(aLeft, aBottom, u0, v1, theColor), TriVertex(aRight, aBottom, u1, v1, theColor));
+}
@@ -0,0 +1,67 @@
+#ifndef __VERTEXBATCH_HPP__
+#define __VERTEXBATCH_HPP__
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "common.hpp"
+#include "math/trivertex.hpp"
+#include "math/rect.hpp"
+
+namespace PopLib
+{
+
+/**
+ * @brief indexed vertices collected for a single Graphics::DrawMesh call
+ *
+ * fill one batch per texture (particles, tiles, glyphs...) and draw it once
+ * instead of calling DrawTrianglesTex for every quad. Clear keeps the
+ * allocations, so a batch kept around between frames stops allocating.
+ * texture coordinates are 0..1, colors are ARGB with 0 meaning the color of
+ * the Graphics.
+ */
+class VertexBatch
+{
+  public:
+	std::vector<TriVertex> mVertices;
+	std::vector<int> mIndices;
+
+  public:
+	VertexBatch();
+	virtual ~VertexBatch();
+
+	/// @brief removes everything but keeps the memory
+	void Clear();
+	/// @brief makes room for more quads
+	/// @param theNumVertices
+	/// @param theNumIndices
+	void Reserve(int theNumVertices, int theNumIndices);
+	/// @brief is there anything to draw?
+	/// @return true if not
+	bool IsEmpty() const;
+
+	/// @brief adds a vertex without referencing it
+	/// @param theVertex
+	/// @return the index to use with AddIndex
+	int AddVertex(const TriVertex &theVertex);
+	/// @brief references a vertex added before
+	/// @param theIndex
+	void AddIndex(int theIndex);
+	/// @brief adds a triangle
+	void AddTriangle(const TriVertex &theV0, const TriVertex &theV1, const TriVertex &theV2);
+	/// @brief adds a quad as two triangles sharing four vertices
+	void AddQuad(const TriVertex &theTopLeft, const TriVertex &theTopRight, const TriVertex &theBottomLeft,
+				 const TriVertex &theBottomRight);
+	/// @brief adds an axis aligned quad
+	/// @param theDestRect where to draw
+	/// @param theSrcRect part of the texture, in pixels
+	/// @param theTextureWidth
+	/// @param theTextureHeight
+	/// @param theColor ARGB, 0 for the color of the Graphics
+	void AddQuad(const FRect &theDestRect, const Rect &theSrcRect, int theTextureWidth, int theTextureHeight,
+				 uint32_t theColor = 0);
+};
+
+} // namespace PopLib
+
+#endif
@@ -1,5 +1,6 @@
 #include "imagelib.hpp"
 #include "paklib/pakinterface.hpp"
+#include "misc/mappedfile.hpp"
 
 #include <stb_image.h>
 #include <stb_image_write.h>
@@ -42,20 +43,15 @@ ulong *Image::GetBits()
 
 Image *GetImageSTB(const std::string &theFileName)
 {
-	PFILE *fp;
-
-	if ((fp = p_fopen(theFileName.c_str(), "rb")) == nullptr)
+	PopLib::MappedFile aFile;
+	if (!aFile.Open(theFileName))
 		return nullptr;
 
-	p_fseek(fp, 0, SEEK_END);
-	size_t fileSize = p_ftell(fp);
-	p_fseek(fp, 0, SEEK_SET);
-	std::vector<uint8_t> data(fileSize);
-	p_fread(data.data(), 1, fileSize, fp);
-	p_fclose(fp);
-
 	int width, height, num_channels;
-	unsigned char *stb_image = stbi_load_from_memory(data.data(), fileSize, &width, &height, &num_channels, NULL);
+	unsigned char *stb_image =
+		stbi_load_from_memory(aFile.GetData(), (int)aFile.GetSize(), &width, &height, &num_channels, NULL);
+	if (stb_image == nullptr)
+		return nullptr;
 
 	ulong *aBits = new ulong[width * height];
 	for (int i = 0; i < width * height; ++i)
@@ -665,6 +661,11 @@ int ImageLib::gAlphaComposeColor = 0xFFFFFF;
 bool ImageLib::gAutoLoadAlpha = true;
 
 Image *ImageLib::GetImage(const std::string &theFilename, bool lookForAlphaImage)
+{
+	return GetImage(theFilename, lookForAlphaImage, gAlphaComposeColor);
+}
+
+Image *ImageLib::GetImage(const std::string &theFilename, bool lookForAlphaImage, int theAlphaComposeColor)
 {
 	if (!gAutoLoadAlpha)
 		lookForAlphaImage = false;
@@ -732,7 +733,7 @@ Image *ImageLib::GetImage(const std::string &theFilename, bool lookForAlphaImage
 
 			delete anAlphaImage;
 		}
-		else if (gAlphaComposeColor == 0xFFFFFF)
+		else if (theAlphaComposeColor == 0xFFFFFF)
 		{
 			anImage = anAlphaImage;
 
@@ -747,7 +748,7 @@ Image *ImageLib::GetImage(const std::string &theFilename, bool lookForAlphaImage
 		}
 		else
 		{
-			const int aColor = gAlphaComposeColor;
+			const int aColor = theAlphaComposeColor;
 			anImage = anAlphaImage;
 
 			ulong *aBits1 = anImage->mBits;
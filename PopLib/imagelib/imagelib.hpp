@@ -34,6 +34,8 @@ extern int gAlphaComposeColor;
 extern bool gAutoLoadAlpha;
 
 Image *GetImage(const std::string &theFileName, bool lookForAlphaImage = true);
+// theAlphaComposeColor instead of gAlphaComposeColor, for loading on other threads
+Image *GetImage(const std::string &theFileName, bool lookForAlphaImage, int theAlphaComposeColor);
 
 } // namespace ImageLib
 
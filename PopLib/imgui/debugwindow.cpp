@@ -1,5 +1,7 @@
 #include "imguimanager.hpp"
 #include "appbase.hpp"
+#include "debug/framestats.hpp"
+#include "resources/resourcemanager.hpp"
 
 using namespace PopLib;
 
@@ -14,6 +16,101 @@ static Uint64 lastTime = SDL_GetPerformanceCounter();
 static int frameCount = 0;
 static float fps = 0.0f;
 
+static void DrawFrameStats()
+{
+	ImGui::Text("Screen: %s", FrameStats::GetScreenName().c_str());
+
+	if (ImGui::BeginTable("FrameStats", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("Stat");
+		ImGui::TableSetupColumn("Last");
+		ImGui::TableSetupColumn("p50");
+		ImGui::TableSetupColumn("p95");
+		ImGui::TableSetupColumn("p99");
+		ImGui::TableHeadersRow();
+
+		for (int i = 0; i < NUM_FRAMESTATS; i++)
+		{
+			FrameStat aStat = (FrameStat)i;
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(FrameStats::GetStatName(aStat));
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", FrameStats::GetLast(aStat));
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", FrameStats::GetPercentile(aStat, 50));
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", FrameStats::GetPercentile(aStat, 95));
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", FrameStats::GetPercentile(aStat, 99));
+		}
+
+		ImGui::EndTable();
+	}
+
+	for (int i = 0; i < NUM_FRAMESTATS; i++)
+	{
+		FrameStat aStat = (FrameStat)i;
+		int aCount, anOffset;
+		const float *aValues = FrameStats::GetHistory(aStat, &aCount, &anOffset);
+		ImGui::PlotLines(FrameStats::GetStatName(aStat), aValues, aCount, anOffset, nullptr, 0.0f, FLT_MAX,
+						 ImVec2(0, 40));
+	}
+
+	if (ImGui::Button("Dump CSV"))
+		FrameStats::WriteCSV(GetAppDataFolder() + "framestats.csv");
+	ImGui::SameLine();
+	if (ImGui::Button("Dump JSON"))
+		FrameStats::WriteJSON(GetAppDataFolder() + "framestats.json");
+}
+
+static void DrawResourceMemory()
+{
+	ResourceManager *aManager = gAppBase->mResourceManager;
+	const float aMB = 1024.0f * 1024.0f;
+
+	ResourceManager::MemoryUsage aTotal = aManager->GetTotalMemoryUsage();
+	ImGui::Text("Total: %.1f MB, cap %.1f MB", aTotal.GetTotal() / aMB, aManager->GetMemoryCap() / aMB);
+
+	if (ImGui::BeginTable("ResourceMemory", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("Group");
+		ImGui::TableSetupColumn("Policy");
+		ImGui::TableSetupColumn("Loaded");
+		ImGui::TableSetupColumn("Bits MB");
+		ImGui::TableSetupColumn("Texture MB");
+		ImGui::TableSetupColumn("Sound MB");
+		ImGui::TableHeadersRow();
+
+		std::vector<std::string> aGroups;
+		aManager->GetGroupNames(aGroups);
+		for (const std::string &aGroup : aGroups)
+		{
+			ResourceManager::MemoryUsage aUsage = aManager->GetGroupMemoryUsage(aGroup);
+			int aPolicy = aManager->GetGroupPolicy(aGroup);
+
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(aGroup.c_str());
+			ImGui::TableNextColumn();
+			ImGui::Text("%s%s", (aPolicy & ResourceManager::GROUPPOLICY_PIN) ? "pin"
+								 : (aPolicy & ResourceManager::GROUPPOLICY_EVICT) ? "evict"
+																				   : "-",
+						(aPolicy & ResourceManager::GROUPPOLICY_PURGEBITS) ? ", purge" : "");
+			ImGui::TableNextColumn();
+			ImGui::Text("%d/%d", aUsage.mNumLoaded, aManager->GetNumResources(aGroup));
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", aUsage.mBitsBytes / aMB);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", aUsage.mTextureBytes / aMB);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", aUsage.mSoundBytes / aMB);
+		}
+
+		ImGui::EndTable();
+	}
+}
+
 static struct RegisterDebugWindow
 {
 	RegisterDebugWindow()
@@ -50,6 +147,12 @@ static struct RegisterDebugWindow
 
 			ImGui::Text("FPS: %.2f", fps);
 
+			if (ImGui::CollapsingHeader("Frame Stats"))
+				DrawFrameStats();
+
+			if (ImGui::CollapsingHeader("Resource Memory"))
+				DrawResourceMemory();
+
 			// quit button
 			const float padding = 10.0f;
 			ImVec2 windowSize = ImGui::GetWindowSize();
@@ -0,0 +1,139 @@
+#include "imguimanager.hpp"
+#include "appbase.hpp"
+#include "debug/perftimer.hpp"
+
+using namespace PopLib;
+
+bool profilerWind = false;
+
+static bool gProfilerFrozen = false;
+static int gProfilerThread = 0;
+static uint64_t gProfilerFrameStart = 0;
+static uint64_t gProfilerFrameEnd = 0;
+static PerfZoneVector gProfilerZones;
+
+static ImU32 GetZoneColor(const char *theName)
+{
+	// FNV-1a so the same zone keeps the same colour between frames
+	uint32_t aHash = 2166136261u;
+	for (const char *p = theName; *p != 0; p++)
+		aHash = (aHash ^ (uint8_t)*p) * 16777619u;
+
+	return IM_COL32(96 + (aHash & 0x7F), 96 + ((aHash >> 8) & 0x7F), 96 + ((aHash >> 16) & 0x7F), 255);
+}
+
+static void DrawFlameGraph()
+{
+	const float aRowHeight = ImGui::GetTextLineHeight() + 4.0f;
+
+	int aMaxDepth = 0;
+	for (const PerfZone &aZone : gProfilerZones)
+		aMaxDepth = std::max(aMaxDepth, aZone.mDepth);
+
+	ImVec2 anOrigin = ImGui::GetCursorScreenPos();
+	float aWidth = std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+	float aHeight = (aMaxDepth + 1) * aRowHeight;
+	double aFrameNS = (double)std::max<uint64_t>(gProfilerFrameEnd - gProfilerFrameStart, 1);
+
+	ImDrawList *aDrawList = ImGui::GetWindowDrawList();
+	aDrawList->AddRectFilled(anOrigin, ImVec2(anOrigin.x + aWidth, anOrigin.y + aHeight), IM_COL32(30, 30, 30, 255));
+
+	ImVec2 aMouse = ImGui::GetIO().MousePos;
+	const PerfZone *aHovered = nullptr;
+
+	for (const PerfZone &aZone : gProfilerZones)
+	{
+		uint64_t aStart = std::max(aZone.mStartNS, gProfilerFrameStart);
+		uint64_t anEnd = std::min(aZone.mEndNS, gProfilerFrameEnd);
+
+		float x0 = anOrigin.x + (float)((aStart - gProfilerFrameStart) / aFrameNS) * aWidth;
+		float x1 = anOrigin.x + (float)((anEnd - gProfilerFrameStart) / aFrameNS) * aWidth;
+		float y0 = anOrigin.y + aZone.mDepth * aRowHeight;
+		float y1 = y0 + aRowHeight - 1.0f;
+		if (x1 - x0 < 1.0f)
+			x1 = x0 + 1.0f;
+
+		aDrawList->AddRectFilled(ImVec2(x0, y0), ImVec2(x1, y1), GetZoneColor(aZone.mName));
+
+		if (x1 - x0 > 24.0f)
+		{
+			aDrawList->PushClipRect(ImVec2(x0, y0), ImVec2(x1, y1), true);
+			aDrawList->AddText(ImVec2(x0 + 2.0f, y0 + 2.0f), IM_COL32(0, 0, 0, 255), aZone.mName);
+			aDrawList->PopClipRect();
+		}
+
+		if (aMouse.x >= x0 && aMouse.x < x1 && aMouse.y >= y0 && aMouse.y < y1)
+			aHovered = &aZone;
+	}
+
+	ImGui::Dummy(ImVec2(aWidth, aHeight));
+
+	if (aHovered != nullptr && ImGui::IsItemHovered())
+	{
+		ImGui::BeginTooltip();
+		ImGui::Text("%s", aHovered->mName);
+		ImGui::Text("%.3f ms", (double)(aHovered->mEndNS - aHovered->mStartNS) / 1000000.0);
+		ImGui::EndTooltip();
+	}
+}
+
+static struct RegisterProfilerWindow
+{
+	RegisterProfilerWindow()
+	{
+		RegisterImGuiWindow("Profiler", &profilerWind, [] {
+			ImGui::Begin("Profiler", &profilerWind);
+
+			bool isRecording = Perf::IsPerfOn();
+			if (ImGui::Checkbox("Record", &isRecording))
+			{
+				if (isRecording)
+					Perf::BeginPerf();
+				else
+					Perf::EndPerf();
+			}
+
+			ImGui::SameLine();
+			ImGui::Checkbox("Freeze", &gProfilerFrozen);
+
+			ImGui::SameLine();
+			if (ImGui::Button("Export Chrome Trace"))
+				Perf::WriteChromeTrace(GetAppDataFolder() + "trace.json");
+
+			int aThreadCount = Perf::GetThreadCount();
+			if (gProfilerThread >= aThreadCount)
+				gProfilerThread = 0;
+
+			std::string aThreadName = aThreadCount > 0 ? Perf::GetThreadName(gProfilerThread) : "";
+			if (ImGui::BeginCombo("Thread", aThreadName.c_str()))
+			{
+				for (int i = 0; i < aThreadCount; i++)
+				{
+					std::string aName = Perf::GetThreadName(i);
+					if (ImGui::Selectable(aName.c_str(), i == gProfilerThread))
+						gProfilerThread = i;
+				}
+				ImGui::EndCombo();
+			}
+
+			if (!gProfilerFrozen && Perf::GetLastFrame(&gProfilerFrameStart, &gProfilerFrameEnd))
+			{
+				gProfilerZones.clear();
+				Perf::GetZones(gProfilerThread, gProfilerFrameStart, gProfilerFrameEnd, gProfilerZones);
+			}
+
+			ImGui::Text("Frame: %.3f ms, %d zones", (double)(gProfilerFrameEnd - gProfilerFrameStart) / 1000000.0,
+						(int)gProfilerZones.size());
+
+			if (!Perf::IsPerfOn() && !gProfilerFrozen)
+				ImGui::TextDisabled("Not recording");
+			else
+				DrawFlameGraph();
+
+			if (!Perf::IsPerfOn() && ImGui::CollapsingHeader("Last Session"))
+				ImGui::TextUnformatted(Perf::GetResults().c_str());
+
+			ImGui::End();
+		});
+	}
+} registerProfilerWindow;
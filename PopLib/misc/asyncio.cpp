@@ -0,0 +1,256 @@
+#include "asyncio.hpp"
+#include "mappedfile.hpp"
+
+using namespace PopLib;
+
+AsyncIO::AsyncIO(int theNumThreads)
+{
+	mStop = false;
+	mNextId = 1;
+
+	for (int i = 0; i < std::max(theNumThreads, 1); i++)
+		mThreads.push_back(std::thread(&AsyncIO::ThreadProc, this));
+}
+
+AsyncIO::~AsyncIO()
+{
+	{
+		std::lock_guard<std::mutex> aLock(mMutex);
+		mStop = true;
+
+		for (int aPriority = 0; aPriority < NUM_PRIORITIES; aPriority++)
+		{
+			for (IORequest *aRequest : mQueues[aPriority])
+			{
+				mRequests.erase(aRequest->mId);
+				delete aRequest;
+			}
+			mQueues[aPriority].clear();
+		}
+	}
+
+	mQueueCond.notify_all();
+	for (std::thread &aThread : mThreads)
+		aThread.join();
+
+	// whatever is left finished loading but never got its callback
+	for (IORequest *aRequest : mDone)
+	{
+		delete aRequest->mFile;
+		delete aRequest;
+	}
+	mDone.clear();
+	mRequests.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+int AsyncIO::Request(const std::string &theFileName, int thePriority, const Callback &theCallback, size_t theOffset,
+					 size_t theSize)
+{
+	IORequest *aRequest = new IORequest();
+	aRequest->mFileName = theFileName;
+	aRequest->mPriority = std::min(std::max(thePriority, 0), NUM_PRIORITIES - 1);
+	aRequest->mOffset = theOffset;
+	aRequest->mSize = theSize;
+	aRequest->mCallback = theCallback;
+	aRequest->mFile = nullptr;
+	aRequest->mStarted = false;
+	aRequest->mDone = false;
+	aRequest->mCancelled = false;
+
+	{
+		std::lock_guard<std::mutex> aLock(mMutex);
+		aRequest->mId = mNextId++;
+		mRequests[aRequest->mId] = aRequest;
+		mQueues[aRequest->mPriority].push_back(aRequest);
+	}
+
+	mQueueCond.notify_one();
+	return aRequest->mId;
+}
+
+bool AsyncIO::Cancel(int theId)
+{
+	std::lock_guard<std::mutex> aLock(mMutex);
+
+	IORequestMap::iterator anItr = mRequests.find(theId);
+	if (anItr == mRequests.end())
+		return false;
+
+	IORequest *aRequest = anItr->second;
+	mRequests.erase(anItr);
+
+	if (!aRequest->mStarted)
+	{
+		RemoveFromQueue(aRequest);
+		delete aRequest;
+	}
+	else
+	{
+		// the thread loading it or Update deletes it
+		aRequest->mCancelled = true;
+	}
+
+	mDoneCond.notify_all();
+	return true;
+}
+
+bool AsyncIO::SetPriority(int theId, int thePriority)
+{
+	std::lock_guard<std::mutex> aLock(mMutex);
+
+	IORequestMap::iterator anItr = mRequests.find(theId);
+	if (anItr == mRequests.end() || anItr->second->mStarted)
+		return false;
+
+	IORequest *aRequest = anItr->second;
+	RemoveFromQueue(aRequest);
+	aRequest->mPriority = std::min(std::max(thePriority, 0), NUM_PRIORITIES - 1);
+	mQueues[aRequest->mPriority].push_back(aRequest);
+	return true;
+}
+
+bool AsyncIO::Wait(int theId)
+{
+	std::unique_lock<std::mutex> aLock(mMutex);
+
+	IORequestMap::iterator anItr = mRequests.find(theId);
+	if (anItr == mRequests.end())
+		return false;
+
+	IORequest *aRequest = anItr->second;
+	if (!aRequest->mStarted)
+	{
+		// quicker than waiting for everything queued ahead of it
+		RemoveFromQueue(aRequest);
+		aRequest->mStarted = true;
+
+		aLock.unlock();
+		Load(aRequest);
+		aLock.lock();
+
+		Finish(aRequest);
+		return true;
+	}
+
+	mDoneCond.wait(aLock, [this, theId]() {
+		IORequestMap::iterator aWaitItr = mRequests.find(theId);
+		return aWaitItr == mRequests.end() || aWaitItr->second->mDone;
+	});
+	return true;
+}
+
+int AsyncIO::GetNumPending()
+{
+	std::lock_guard<std::mutex> aLock(mMutex);
+
+	return (int)mRequests.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void AsyncIO::Update()
+{
+	std::vector<IORequest *> aDone;
+	{
+		std::lock_guard<std::mutex> aLock(mMutex);
+		if (mDone.empty())
+			return;
+
+		aDone.swap(mDone);
+		for (IORequest *aRequest : aDone)
+		{
+			if (!aRequest->mCancelled)
+				mRequests.erase(aRequest->mId);
+		}
+	}
+
+	// unlocked, callbacks often queue the next request
+	for (IORequest *aRequest : aDone)
+	{
+		if (aRequest->mCancelled)
+			delete aRequest->mFile;
+		else if (aRequest->mCallback)
+			aRequest->mCallback(aRequest->mId, aRequest->mFile);
+		else
+			delete aRequest->mFile;
+
+		delete aRequest;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void AsyncIO::RemoveFromQueue(IORequest *theRequest)
+{
+	std::deque<IORequest *> &aQueue = mQueues[theRequest->mPriority];
+	std::deque<IORequest *>::iterator anItr = std::find(aQueue.begin(), aQueue.end(), theRequest);
+	if (anItr != aQueue.end())
+		aQueue.erase(anItr);
+}
+
+void AsyncIO::Load(IORequest *theRequest)
+{
+	MappedFile *aFile = new MappedFile();
+	if (aFile->Open(theRequest->mFileName))
+		aFile->Preload(theRequest->mOffset, theRequest->mSize);
+	else
+	{
+		delete aFile;
+		aFile = nullptr;
+	}
+
+	theRequest->mFile = aFile;
+}
+
+void AsyncIO::Finish(IORequest *theRequest)
+{
+	// called with mMutex held
+	theRequest->mDone = true;
+
+	if (theRequest->mCancelled)
+	{
+		delete theRequest->mFile;
+		delete theRequest;
+	}
+	else
+		mDone.push_back(theRequest);
+
+	mDoneCond.notify_all();
+}
+
+void AsyncIO::ThreadProc()
+{
+	std::unique_lock<std::mutex> aLock(mMutex);
+
+	for (;;)
+	{
+		IORequest *aRequest = nullptr;
+		for (int aPriority = 0; aPriority < NUM_PRIORITIES && aRequest == nullptr; aPriority++)
+		{
+			if (!mQueues[aPriority].empty())
+			{
+				aRequest = mQueues[aPriority].front();
+				mQueues[aPriority].pop_front();
+			}
+		}
+
+		if (aRequest == nullptr)
+		{
+			if (mStop)
+				break;
+
+			mQueueCond.wait(aLock);
+			continue;
+		}
+
+		aRequest->mStarted = true;
+
+		aLock.unlock();
+		Load(aRequest);
+		aLock.lock();
+
+		Finish(aRequest);
+	}
+}
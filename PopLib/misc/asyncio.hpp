@@ -0,0 +1,115 @@
+#ifndef __ASYNCIO_HPP__
+#define __ASYNCIO_HPP__
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "common.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace PopLib
+{
+
+class MappedFile;
+
+/**
+ * @brief loads files on background threads, the most urgent first
+ *
+ * a request opens a file with MappedFile, out of a pak or from disk, and
+ * reads the wanted bytes in on one of the I/O threads, so whoever uses them
+ * afterwards doesn't wait on the disk. requests are served by priority, then
+ * in the order they were made. callbacks run on the main thread, from Update,
+ * and not at all for cancelled requests.
+ */
+class AsyncIO
+{
+  public:
+	enum
+	{
+		PRIORITY_AUDIO,	   ///< streamed sound, late means a gap you can hear
+		PRIORITY_VISIBLE,  ///< something on screen is waiting for it
+		PRIORITY_PREFETCH, ///< might be needed soon
+		NUM_PRIORITIES
+	};
+
+	/// @brief called with the loaded file, which is the callback's to delete, or nullptr if it couldn't be read
+	typedef std::function<void(int theId, MappedFile *theFile)> Callback;
+
+  public:
+	/// @brief starts the I/O threads
+	/// @param theNumThreads disks don't get faster with more, a couple keep one busy while another is handed out
+	AsyncIO(int theNumThreads = 2);
+	virtual ~AsyncIO();
+
+	/// @brief queues a file to load
+	/// @param theFileName
+	/// @param thePriority one of the PRIORITY_ values
+	/// @param theCallback
+	/// @param theOffset where the part that is read in starts
+	/// @param theSize how much is read in, 0 for the rest of the file
+	/// @return the id of the request
+	int Request(const std::string &theFileName, int thePriority, const Callback &theCallback, size_t theOffset = 0,
+				size_t theSize = 0);
+	/// @brief drops a request
+	/// @param theId
+	/// @return true if its callback won't be called
+	bool Cancel(int theId);
+	/// @brief moves a request that hasn't started yet to another priority, at the end of its queue
+	/// @param theId
+	/// @param thePriority
+	/// @return false if it already started
+	bool SetPriority(int theId, int thePriority);
+	/// @brief blocks until a request is loaded, loading it on this thread if no I/O thread took it yet
+	///
+	/// the callback still runs from the next Update.
+	/// @param theId
+	/// @return false if there is no such request
+	bool Wait(int theId);
+	/// @brief number of requests whose callback hasn't run yet
+	/// @return the count
+	int GetNumPending();
+
+	/// @brief runs the callbacks of loaded requests, call from the main thread
+	void Update();
+
+  protected:
+	struct IORequest
+	{
+		int mId;
+		std::string mFileName;
+		int mPriority;
+		size_t mOffset;
+		size_t mSize;
+		Callback mCallback;
+		MappedFile *mFile;
+		bool mStarted;
+		bool mDone;
+		bool mCancelled;
+	};
+
+	typedef std::map<int, IORequest *> IORequestMap;
+
+	std::mutex mMutex;
+	std::condition_variable mQueueCond; ///< something was queued, or the threads should stop
+	std::condition_variable mDoneCond;	///< a request finished loading
+	std::deque<IORequest *> mQueues[NUM_PRIORITIES];
+	IORequestMap mRequests; ///< every request whose callback hasn't run, by id
+	std::vector<IORequest *> mDone;
+	std::vector<std::thread> mThreads;
+	bool mStop;
+	int mNextId;
+
+	void RemoveFromQueue(IORequest *theRequest);
+	void Load(IORequest *theRequest);
+	void Finish(IORequest *theRequest);
+	void ThreadProc();
+};
+
+} // namespace PopLib
+
+#endif
@@ -156,6 +156,46 @@ static int GetUTF8Char(const char **theBuffer, int theLen, wchar_t *theChar)
 	return aConsumedCount;
 }
 
+//----------------------------------------------------------------------------
+// Fixed width and variable length encodings shared by Buffer and SpanBuffer
+//----------------------------------------------------------------------------
+static inline void EncodeLE(uchar *theDest, uint64_t theValue, int theBytes)
+{
+	for (int i = 0; i < theBytes; i++)
+		theDest[i] = (uchar)(theValue >> (i * 8));
+}
+
+static inline uint64_t DecodeLE(const uchar *theSrc, int theBytes)
+{
+	uint64_t aValue = 0;
+	for (int i = 0; i < theBytes; i++)
+		aValue |= (uint64_t)theSrc[i] << (i * 8);
+	return aValue;
+}
+
+// at most 10 bytes for 64 bits
+static inline int EncodeVarInt(uchar *theDest, uint64_t theValue)
+{
+	int aLen = 0;
+	while (theValue >= 0x80)
+	{
+		theDest[aLen++] = (uchar)(theValue | 0x80);
+		theValue >>= 7;
+	}
+	theDest[aLen++] = (uchar)theValue;
+	return aLen;
+}
+
+static inline uint64_t ZigZagEncode(int64_t theValue)
+{
+	return ((uint64_t)theValue << 1) ^ (uint64_t)(theValue >> 63);
+}
+
+static inline int64_t ZigZagDecode(uint64_t theValue)
+{
+	return (int64_t)(theValue >> 1) ^ -(int64_t)(theValue & 1);
+}
+
 Buffer::Buffer()
 {
 	mDataBitSize = 0;
@@ -268,6 +308,11 @@ void Buffer::Clear()
 	mData.clear();
 }
 
+void Buffer::Reserve(int theByteCount)
+{
+	mData.reserve(mData.size() + theByteCount);
+}
+
 void Buffer::WriteByte(uchar theByte)
 {
 	if (mWriteBitPos % 8 == 0)
@@ -286,15 +331,26 @@ void Buffer::WriteByte(uchar theByte)
 
 void Buffer::WriteNumBits(int theNum, int theBits)
 {
-	for (int aBitNum = 0; aBitNum < theBits; aBitNum++)
-	{
-		if (mWriteBitPos % 8 == 0)
-			mData.push_back(0);
-		if ((theNum & (1 << aBitNum)) != 0)
-			mData[mWriteBitPos / 8] |= 1 << (mWriteBitPos % 8);
-		mWriteBitPos++;
-	}
+	if (theBits <= 0)
+		return;
 
+	if (theBits > 32)
+		theBits = 32;
+
+	// shifted into place as a whole, then ORed into the at most five bytes it touches
+	int anOfs = mWriteBitPos % 8;
+	uint64_t aValue = (uint64_t)((uint32_t)theNum & (0xFFFFFFFFu >> (32 - theBits))) << anOfs;
+
+	int aFirstByte = mWriteBitPos / 8;
+	int aNumBytes = (anOfs + theBits + 7) / 8;
+	if ((int)mData.size() < aFirstByte + aNumBytes)
+		mData.resize(aFirstByte + aNumBytes, 0);
+
+	uchar *aDest = &mData[aFirstByte];
+	for (int i = 0; i < aNumBytes; i++)
+		aDest[i] |= (uchar)(aValue >> (i * 8));
+
+	mWriteBitPos += theBits;
 	if (mWriteBitPos > mDataBitSize)
 		mDataBitSize = mWriteBitPos;
 }
@@ -321,23 +377,61 @@ void Buffer::WriteBoolean(bool theBool)
 
 void Buffer::WriteShort(short theShort)
 {
-	WriteByte((uchar)theShort);
-	WriteByte((uchar)(theShort >> 8));
+	uchar aBytes[2];
+	EncodeLE(aBytes, (uint16_t)theShort, 2);
+	WriteBytes(aBytes, 2);
 }
 
 void Buffer::WriteLong(long theLong)
 {
-	WriteByte((uchar)theLong);
-	WriteByte((uchar)(theLong >> 8));
-	WriteByte((uchar)(theLong >> 16));
-	WriteByte((uchar)(theLong >> 24));
+	uchar aBytes[4];
+	EncodeLE(aBytes, (uint32_t)theLong, 4);
+	WriteBytes(aBytes, 4);
+}
+
+void Buffer::WriteInt32(int32_t theValue)
+{
+	uchar aBytes[4];
+	EncodeLE(aBytes, (uint32_t)theValue, 4);
+	WriteBytes(aBytes, 4);
+}
+
+void Buffer::WriteInt64(int64_t theValue)
+{
+	uchar aBytes[8];
+	EncodeLE(aBytes, (uint64_t)theValue, 8);
+	WriteBytes(aBytes, 8);
+}
+
+void Buffer::WriteFloat(float theValue)
+{
+	uint32_t aBits;
+	memcpy(&aBits, &theValue, sizeof(aBits));
+	WriteInt32((int32_t)aBits);
+}
+
+void Buffer::WriteDouble(double theValue)
+{
+	uint64_t aBits;
+	memcpy(&aBits, &theValue, sizeof(aBits));
+	WriteInt64((int64_t)aBits);
+}
+
+void Buffer::WriteVarInt(uint64_t theValue)
+{
+	uchar aBytes[10];
+	WriteBytes(aBytes, EncodeVarInt(aBytes, theValue));
+}
+
+void Buffer::WriteSignedVarInt(int64_t theValue)
+{
+	WriteVarInt(ZigZagEncode(theValue));
 }
 
 void Buffer::WriteString(const std::string &theString)
 {
 	WriteShort((short)theString.length());
-	for (int i = 0; i < (int)theString.length(); i++)
-		WriteByte(theString[i]);
+	WriteBytes((const uchar *)theString.data(), (int)theString.length());
 }
 
 void Buffer::WriteUTF8String(const std::wstring &theString)
@@ -346,33 +440,40 @@ void Buffer::WriteUTF8String(const std::wstring &theString)
 		mWriteBitPos = (mWriteBitPos + 8) & ~7;
 
 	WriteShort((short)theString.length());
+
+	// encoded up front so it goes in with a single copy
+	ByteVector anEncoded;
+	anEncoded.reserve(theString.length() * 3);
 	for (int i = 0; i < (int)theString.length(); ++i)
 	{
 		const unsigned int c =
 			(unsigned int)theString[i]; // just in case wchar_t is only 16 bits, and it generally is in visual studio
 		if (c < 0x80)
 		{
-			WriteByte((uchar)c);
+			anEncoded.push_back((uchar)c);
 		}
 		else if (c < 0x800)
 		{
-			WriteByte((uchar)(0xC0 | (c >> 6)));
-			WriteByte((uchar)(0x80 | (c & 0x3F)));
+			anEncoded.push_back((uchar)(0xC0 | (c >> 6)));
+			anEncoded.push_back((uchar)(0x80 | (c & 0x3F)));
 		}
 		else if (c < 0x10000)
 		{
-			WriteByte((uchar)(0xE0 | c >> 12));
-			WriteByte((uchar)(0x80 | ((c >> 6) & 0x3F)));
-			WriteByte((uchar)(0x80 | (c & 0x3F)));
+			anEncoded.push_back((uchar)(0xE0 | c >> 12));
+			anEncoded.push_back((uchar)(0x80 | ((c >> 6) & 0x3F)));
+			anEncoded.push_back((uchar)(0x80 | (c & 0x3F)));
 		}
 		else if (c < 0x110000)
 		{
-			WriteByte((uchar)(0xF0 | (c >> 18)));
-			WriteByte((uchar)(0x80 | ((c >> 12) & 0x3F)));
-			WriteByte((uchar)(0x80 | ((c >> 6) & 0x3F)));
-			WriteByte((uchar)(0x80 | (c & 0x3F)));
+			anEncoded.push_back((uchar)(0xF0 | (c >> 18)));
+			anEncoded.push_back((uchar)(0x80 | ((c >> 12) & 0x3F)));
+			anEncoded.push_back((uchar)(0x80 | ((c >> 6) & 0x3F)));
+			anEncoded.push_back((uchar)(0x80 | (c & 0x3F)));
 		} // are the remaining ranges really necessary? add if so!
 	}
+
+	if (!anEncoded.empty())
+		WriteBytes(&anEncoded[0], (int)anEncoded.size());
 }
 
 void Buffer::WriteLine(const std::string &theString)
@@ -382,15 +483,36 @@ void Buffer::WriteLine(const std::string &theString)
 
 void Buffer::WriteBuffer(const ByteVector &theBuffer)
 {
-	WriteLong((short)theBuffer.size());
-	for (int i = 0; i < (int)theBuffer.size(); i++)
-		WriteByte(theBuffer[i]);
+	WriteLong((long)theBuffer.size());
+	if (!theBuffer.empty())
+		WriteBytes(&theBuffer[0], (int)theBuffer.size());
 }
 
 void Buffer::WriteBytes(const uchar *theByte, int theCount)
 {
-	for (int i = 0; i < theCount; i++)
-		WriteByte(theByte[i]);
+	if (theCount <= 0)
+		return;
+
+	size_t anOldSize = mData.size();
+	mData.resize(anOldSize + theCount);
+
+	if (mWriteBitPos % 8 == 0)
+		memcpy(&mData[anOldSize], theByte, theCount);
+	else
+	{
+		// each byte straddles two, the low bits finish the partial byte at the write position
+		int anOfs = mWriteBitPos % 8;
+		uchar *aDest = &mData[mWriteBitPos / 8];
+		for (int i = 0; i < theCount; i++)
+		{
+			aDest[i] |= theByte[i] << anOfs;
+			aDest[i + 1] = theByte[i] >> (8 - anOfs);
+		}
+	}
+
+	mWriteBitPos += theCount * 8;
+	if (mWriteBitPos > mDataBitSize)
+		mDataBitSize = mWriteBitPos;
 }
 
 void Buffer::SetData(const ByteVector &theBuffer)
@@ -436,26 +558,27 @@ uchar Buffer::ReadByte() const
 
 int Buffer::ReadNumBits(int theBits, bool isSigned) const
 {
-	int aByteLength = (int)mData.size();
+	if (theBits > 32)
+		theBits = 32;
 
-	int theNum = 0;
-	bool bset = false;
-	for (int aBitNum = 0; aBitNum < theBits; aBitNum++)
-	{
-		int aBytePos = mReadBitPos / 8;
+	// the bits past the end read as zeros without moving the read position
+	int aNumBits = std::min(theBits, (int)mData.size() * 8 - mReadBitPos);
+	if (aNumBits <= 0)
+		return 0;
 
-		if (aBytePos >= aByteLength)
-			break;
+	int anOfs = mReadBitPos % 8;
+	int aFirstByte = mReadBitPos / 8;
+	int aNumBytes = (anOfs + aNumBits + 7) / 8;
 
-		if (bset = (mData[aBytePos] & (1 << (mReadBitPos % 8))) != 0)
-			theNum |= 1 << aBitNum;
+	uint64_t aValue = DecodeLE(&mData[aFirstByte], aNumBytes) >> anOfs;
+	aValue &= 0xFFFFFFFFu >> (32 - aNumBits);
+	mReadBitPos += aNumBits;
 
-		mReadBitPos++;
-	}
+	int theNum = (int)(uint32_t)aValue;
+	bool bset = ((aValue >> (aNumBits - 1)) & 1) != 0;
 
-	if ((isSigned) && (bset)) // sign extend
-		for (int aBitNum = theBits; aBitNum < 32; aBitNum++)
-			theNum |= 1 << aBitNum;
+	if ((isSigned) && (bset) && (theBits < 32)) // sign extend
+		theNum |= (int)(0xFFFFFFFFu << theBits);
 
 	return theNum;
 }
@@ -467,28 +590,83 @@ bool Buffer::ReadBoolean() const
 
 short Buffer::ReadShort() const
 {
-	short aShort = ReadByte();
-	aShort |= ((short)ReadByte() << 8);
-	return aShort;
+	uchar aBytes[2];
+	ReadBytes(aBytes, 2);
+	return (short)DecodeLE(aBytes, 2);
 }
 
 long Buffer::ReadLong() const
 {
-	long aLong = ReadByte();
-	aLong |= ((long)ReadByte()) << 8;
-	aLong |= ((long)ReadByte()) << 16;
-	aLong |= ((long)ReadByte()) << 24;
+	uchar aBytes[4];
+	ReadBytes(aBytes, 4);
+
+	// not sign extended where long is 64 bits, as always
+	long aLong = aBytes[0];
+	aLong |= ((long)aBytes[1]) << 8;
+	aLong |= ((long)aBytes[2]) << 16;
+	aLong |= ((long)aBytes[3]) << 24;
 
 	return aLong;
 }
 
+int32_t Buffer::ReadInt32() const
+{
+	uchar aBytes[4];
+	ReadBytes(aBytes, 4);
+	return (int32_t)(uint32_t)DecodeLE(aBytes, 4);
+}
+
+int64_t Buffer::ReadInt64() const
+{
+	uchar aBytes[8];
+	ReadBytes(aBytes, 8);
+	return (int64_t)DecodeLE(aBytes, 8);
+}
+
+float Buffer::ReadFloat() const
+{
+	uint32_t aBits = (uint32_t)ReadInt32();
+	float aValue;
+	memcpy(&aValue, &aBits, sizeof(aValue));
+	return aValue;
+}
+
+double Buffer::ReadDouble() const
+{
+	uint64_t aBits = (uint64_t)ReadInt64();
+	double aValue;
+	memcpy(&aValue, &aBits, sizeof(aValue));
+	return aValue;
+}
+
+uint64_t Buffer::ReadVarInt() const
+{
+	uint64_t aValue = 0;
+	for (int aShift = 0; aShift < 64; aShift += 7)
+	{
+		uchar aByte = ReadByte();
+		aValue |= (uint64_t)(aByte & 0x7F) << aShift;
+		if ((aByte & 0x80) == 0)
+			break;
+	}
+
+	return aValue;
+}
+
+int64_t Buffer::ReadSignedVarInt() const
+{
+	return ZigZagDecode(ReadVarInt());
+}
+
 std::string Buffer::ReadString() const
 {
 	std::string aString;
 	int aLen = ReadShort();
+	if (aLen <= 0)
+		return aString;
 
-	for (int i = 0; i < aLen; i++)
-		aString += (char)ReadByte();
+	aString.resize(aLen);
+	ReadBytes((uchar *)&aString[0], aLen);
 
 	return aString;
 }
@@ -539,8 +717,32 @@ std::string Buffer::ReadLine() const
 
 void Buffer::ReadBytes(uchar *theData, int theLen) const
 {
-	for (int i = 0; i < theLen; i++)
-		theData[i] = ReadByte();
+	if (theLen <= 0)
+		return;
+
+	// same as ReadByte: a misaligned byte needs the one after it too
+	int anOfs = mReadBitPos % 8;
+	int aFirstByte = mReadBitPos / 8;
+	int anAvail = (int)mData.size() - aFirstByte - (anOfs != 0 ? 1 : 0);
+	int aCount = std::max(0, std::min(theLen, anAvail));
+
+	if (aCount > 0)
+	{
+		const uchar *aSrc = &mData[aFirstByte];
+		if (anOfs == 0)
+			memcpy(theData, aSrc, aCount);
+		else
+		{
+			for (int i = 0; i < aCount; i++)
+				theData[i] = (uchar)((aSrc[i] >> anOfs) | (aSrc[i + 1] << (8 - anOfs)));
+		}
+
+		mReadBitPos += aCount * 8;
+	}
+
+	// underflow
+	if (aCount < theLen)
+		memset(theData + aCount, 0, theLen - aCount);
 }
 
 void Buffer::ReadBuffer(ByteVector *theByteVector) const
@@ -549,7 +751,8 @@ void Buffer::ReadBuffer(ByteVector *theByteVector) const
 
 	ulong aLength = ReadLong();
 	theByteVector->resize(aLength);
-	ReadBytes(&(*theByteVector)[0], aLength);
+	if (aLength > 0)
+		ReadBytes(&(*theByteVector)[0], aLength);
 }
 
 const uchar *Buffer::GetDataPtr() const
@@ -576,6 +779,11 @@ ulong Buffer::GetCRC32(ulong theSeed) const
 	return aCRC;
 }
 
+ulong Buffer::GetCRC32(const uchar *theData, int theLen, ulong theSeed)
+{
+	return UpdateCRC(theSeed, (const char *)theData, theLen);
+}
+
 bool Buffer::AtEnd() const
 {
 	// return mReadBitPos >= (int)mData.size()*8;
@@ -586,3 +794,110 @@ bool Buffer::PastEnd() const
 {
 	return mReadBitPos > mDataBitSize;
 }
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+SpanBuffer::SpanBuffer(uchar *theData, int theCapacity)
+{
+	mData = theData;
+	mCapacity = theCapacity;
+	mPos = 0;
+	mOverflowed = false;
+}
+
+void SpanBuffer::Clear()
+{
+	mPos = 0;
+	mOverflowed = false;
+}
+
+void SpanBuffer::WriteBytes(const uchar *theByte, int theCount)
+{
+	if (theCount <= 0)
+		return;
+
+	if (theCount > mCapacity - mPos)
+	{
+		mOverflowed = true;
+		return;
+	}
+
+	memcpy(mData + mPos, theByte, theCount);
+	mPos += theCount;
+}
+
+void SpanBuffer::WriteByte(uchar theByte)
+{
+	WriteBytes(&theByte, 1);
+}
+
+void SpanBuffer::WriteBoolean(bool theBool)
+{
+	WriteByte(theBool ? 1 : 0);
+}
+
+void SpanBuffer::WriteShort(short theShort)
+{
+	uchar aBytes[2];
+	EncodeLE(aBytes, (uint16_t)theShort, 2);
+	WriteBytes(aBytes, 2);
+}
+
+void SpanBuffer::WriteLong(long theLong)
+{
+	uchar aBytes[4];
+	EncodeLE(aBytes, (uint32_t)theLong, 4);
+	WriteBytes(aBytes, 4);
+}
+
+void SpanBuffer::WriteInt32(int32_t theValue)
+{
+	uchar aBytes[4];
+	EncodeLE(aBytes, (uint32_t)theValue, 4);
+	WriteBytes(aBytes, 4);
+}
+
+void SpanBuffer::WriteInt64(int64_t theValue)
+{
+	uchar aBytes[8];
+	EncodeLE(aBytes, (uint64_t)theValue, 8);
+	WriteBytes(aBytes, 8);
+}
+
+void SpanBuffer::WriteFloat(float theValue)
+{
+	uint32_t aBits;
+	memcpy(&aBits, &theValue, sizeof(aBits));
+	WriteInt32((int32_t)aBits);
+}
+
+void SpanBuffer::WriteDouble(double theValue)
+{
+	uint64_t aBits;
+	memcpy(&aBits, &theValue, sizeof(aBits));
+	WriteInt64((int64_t)aBits);
+}
+
+void SpanBuffer::WriteVarInt(uint64_t theValue)
+{
+	uchar aBytes[10];
+	WriteBytes(aBytes, EncodeVarInt(aBytes, theValue));
+}
+
+void SpanBuffer::WriteSignedVarInt(int64_t theValue)
+{
+	WriteVarInt(ZigZagEncode(theValue));
+}
+
+void SpanBuffer::WriteString(const std::string &theString)
+{
+	// all or nothing, half a string would read back as garbage
+	if (2 + (int)theString.length() > mCapacity - mPos)
+	{
+		mOverflowed = true;
+		return;
+	}
+
+	WriteShort((short)theString.length());
+	WriteBytes((const uchar *)theString.data(), (int)theString.length());
+}
@@ -12,6 +12,15 @@ namespace PopLib
 
 typedef std::vector<uchar> ByteVector;
 
+/**
+ * @brief a growable stream of bits
+ *
+ * values are written least significant bit first and can start anywhere,
+ * WriteNumBits packs them tightly. byte aligned writes and reads of several
+ * bytes are copied in one go, misaligned ones are shifted a byte at a time.
+ * multi-byte values are little endian. reading past the end gives zeros and
+ * doesn't move the read position.
+ */
 class Buffer
 {
   public:
@@ -26,6 +35,9 @@ class Buffer
 
 	void SeekFront() const;
 	void Clear();
+	/// @brief makes room for this many more bytes, so writing them won't reallocate
+	/// @param theByteCount
+	void Reserve(int theByteCount);
 
 	void FromWebString(const std::string &theString);
 	void WriteByte(uchar theByte);
@@ -39,6 +51,16 @@ class Buffer
 	void WriteLine(const std::string &theString);
 	void WriteBuffer(const ByteVector &theBuffer);
 	void WriteBytes(const uchar *theByte, int theCount);
+	void WriteInt32(int32_t theValue);
+	void WriteInt64(int64_t theValue);
+	void WriteFloat(float theValue);
+	void WriteDouble(double theValue);
+	/// @brief writes 7 bits a byte, as few bytes as the value needs
+	/// @param theValue
+	void WriteVarInt(uint64_t theValue);
+	/// @brief zigzag encodes theValue first, so small negative numbers stay short
+	/// @param theValue
+	void WriteSignedVarInt(int64_t theValue);
 	void SetData(const ByteVector &theBuffer);
 	void SetData(uchar *thePtr, int theCount);
 
@@ -54,16 +76,71 @@ class Buffer
 	std::string ReadLine() const;
 	void ReadBytes(uchar *theData, int theLen) const;
 	void ReadBuffer(ByteVector *theByteVector) const;
+	int32_t ReadInt32() const;
+	int64_t ReadInt64() const;
+	float ReadFloat() const;
+	double ReadDouble() const;
+	uint64_t ReadVarInt() const;
+	int64_t ReadSignedVarInt() const;
 
 	const uchar *GetDataPtr() const;
 	int GetDataLen() const;
 	int GetDataLenBits() const;
 	ulong GetCRC32(ulong theSeed = 0) const;
+	static ulong GetCRC32(const uchar *theData, int theLen, ulong theSeed = 0);
 
 	bool AtEnd() const;
 	bool PastEnd() const;
 };
 
+/**
+ * @brief writes the byte aligned encoding of Buffer into memory the caller owns
+ *
+ * for packets and other fixed size destinations, where building a Buffer and
+ * copying it out would be wasted work. what doesn't fit is dropped and sets
+ * the overflow flag, the caller checks it once at the end.
+ */
+class SpanBuffer
+{
+  public:
+	uchar *mData;
+	int mCapacity;
+	int mPos;
+	bool mOverflowed;
+
+  public:
+	SpanBuffer(uchar *theData, int theCapacity);
+
+	/// @brief starts over at the front of the span
+	void Clear();
+
+	void WriteByte(uchar theByte);
+	void WriteBoolean(bool theBool);
+	void WriteShort(short theShort);
+	void WriteLong(long theLong);
+	void WriteInt32(int32_t theValue);
+	void WriteInt64(int64_t theValue);
+	void WriteFloat(float theValue);
+	void WriteDouble(double theValue);
+	void WriteVarInt(uint64_t theValue);
+	void WriteSignedVarInt(int64_t theValue);
+	void WriteString(const std::string &theString);
+	void WriteBytes(const uchar *theByte, int theCount);
+
+	/// @brief bytes written so far
+	/// @return the count
+	int GetDataLen() const
+	{
+		return mPos;
+	}
+	/// @brief did a write not fit?
+	/// @return true if something was dropped
+	bool HasOverflowed() const
+	{
+		return mOverflowed;
+	}
+};
+
 } // namespace PopLib
 
 #endif
\ No newline at end of file
@@ -0,0 +1,200 @@
+#include "demobuffer.hpp"
+
+using namespace PopLib;
+
+static const ulong DEMO_MAGIC = 0x4F4D4450; // "PDMO"
+static const int DEMO_VERSION = 1;
+
+DemoBuffer::DemoBuffer()
+{
+	mRandSeed = 0;
+	mNextUpdateCount = -1;
+}
+
+DemoBuffer::~DemoBuffer()
+{
+}
+
+void DemoBuffer::WriteFloat(float theFloat)
+{
+	uint32_t aBits;
+	memcpy(&aBits, &theFloat, sizeof(aBits));
+	mBuffer.WriteLong((long)aBits);
+}
+
+float DemoBuffer::ReadFloat() const
+{
+	uint32_t aBits = (uint32_t)mBuffer.ReadLong();
+	float aFloat;
+	memcpy(&aFloat, &aBits, sizeof(aFloat));
+	return aFloat;
+}
+
+void DemoBuffer::StartRecording(ulong theRandSeed)
+{
+	mBuffer.Clear();
+	mRandSeed = theRandSeed;
+	mNextUpdateCount = -1;
+
+	mBuffer.WriteLong(DEMO_MAGIC);
+	mBuffer.WriteLong(DEMO_VERSION);
+	mBuffer.WriteLong((long)theRandSeed);
+}
+
+bool DemoBuffer::IsInputEvent(const SDL_Event &theEvent)
+{
+	switch (theEvent.type)
+	{
+	case SDL_EVENT_MOUSE_MOTION:
+	case SDL_EVENT_MOUSE_BUTTON_DOWN:
+	case SDL_EVENT_MOUSE_BUTTON_UP:
+	case SDL_EVENT_MOUSE_WHEEL:
+	case SDL_EVENT_KEY_DOWN:
+	case SDL_EVENT_KEY_UP:
+	case SDL_EVENT_TEXT_INPUT:
+	case SDL_EVENT_WINDOW_FOCUS_GAINED:
+	case SDL_EVENT_WINDOW_FOCUS_LOST:
+		return true;
+	}
+
+	return false;
+}
+
+void DemoBuffer::WriteEvent(int theUpdateCount, const SDL_Event &theEvent)
+{
+	if (!IsInputEvent(theEvent))
+		return;
+
+	mBuffer.WriteLong(theUpdateCount);
+	mBuffer.WriteByte(DEMO_EVENT);
+	mBuffer.WriteLong((long)theEvent.type);
+
+	switch (theEvent.type)
+	{
+	case SDL_EVENT_MOUSE_MOTION:
+		WriteFloat(theEvent.motion.x);
+		WriteFloat(theEvent.motion.y);
+		break;
+	case SDL_EVENT_MOUSE_BUTTON_DOWN:
+	case SDL_EVENT_MOUSE_BUTTON_UP:
+		mBuffer.WriteByte(theEvent.button.button);
+		WriteFloat(theEvent.button.x);
+		WriteFloat(theEvent.button.y);
+		break;
+	case SDL_EVENT_MOUSE_WHEEL:
+		WriteFloat(theEvent.wheel.y);
+		break;
+	case SDL_EVENT_KEY_DOWN:
+	case SDL_EVENT_KEY_UP:
+		mBuffer.WriteLong((long)theEvent.key.key);
+		break;
+	case SDL_EVENT_TEXT_INPUT:
+		mBuffer.WriteString(theEvent.text.text != nullptr ? theEvent.text.text : "");
+		break;
+	}
+}
+
+void DemoBuffer::WriteMarker(int theUpdateCount, DemoRecordType theType)
+{
+	mBuffer.WriteLong(theUpdateCount);
+	mBuffer.WriteByte((uchar)theType);
+}
+
+bool DemoBuffer::Save(const std::string &theFileName, int theUpdateCount)
+{
+	WriteMarker(theUpdateCount, DEMO_END);
+
+	FILE *aFile = fopen(theFileName.c_str(), "wb");
+	if (aFile == nullptr)
+		return false;
+
+	bool success = (int)fwrite(mBuffer.GetDataPtr(), 1, mBuffer.GetDataLen(), aFile) == mBuffer.GetDataLen();
+	fclose(aFile);
+	return success;
+}
+
+bool DemoBuffer::Load(const std::string &theFileName)
+{
+	mBuffer.Clear();
+	mNextUpdateCount = -1;
+
+	FILE *aFile = fopen(theFileName.c_str(), "rb");
+	if (aFile == nullptr)
+		return false;
+
+	fseek(aFile, 0, SEEK_END);
+	int aFileSize = ftell(aFile);
+	fseek(aFile, 0, SEEK_SET);
+
+	ByteVector aData(aFileSize);
+	bool success = aFileSize > 0 && (int)fread(&aData[0], 1, aFileSize, aFile) == aFileSize;
+	fclose(aFile);
+
+	if (!success)
+		return false;
+
+	mBuffer.SetData(aData);
+	mBuffer.SeekFront();
+
+	if ((ulong)mBuffer.ReadLong() != DEMO_MAGIC || mBuffer.ReadLong() != DEMO_VERSION)
+		return false;
+
+	mRandSeed = (ulong)mBuffer.ReadLong();
+	ReadNextUpdateCount();
+	return true;
+}
+
+void DemoBuffer::ReadNextUpdateCount()
+{
+	if (mBuffer.AtEnd())
+		mNextUpdateCount = -1;
+	else
+		mNextUpdateCount = (int)mBuffer.ReadLong();
+}
+
+DemoRecordType DemoBuffer::ReadRecord(SDL_Event *theEvent)
+{
+	if (mNextUpdateCount < 0)
+		return DEMO_NONE;
+
+	DemoRecordType aType = (DemoRecordType)mBuffer.ReadByte();
+	if (aType == DEMO_EVENT)
+	{
+		SDL_zerop(theEvent);
+		theEvent->type = (Uint32)mBuffer.ReadLong();
+
+		switch (theEvent->type)
+		{
+		case SDL_EVENT_MOUSE_MOTION:
+			theEvent->motion.x = ReadFloat();
+			theEvent->motion.y = ReadFloat();
+			break;
+		case SDL_EVENT_MOUSE_BUTTON_DOWN:
+		case SDL_EVENT_MOUSE_BUTTON_UP:
+			theEvent->button.button = mBuffer.ReadByte();
+			theEvent->button.down = theEvent->type == SDL_EVENT_MOUSE_BUTTON_DOWN;
+			theEvent->button.x = ReadFloat();
+			theEvent->button.y = ReadFloat();
+			break;
+		case SDL_EVENT_MOUSE_WHEEL:
+			theEvent->wheel.y = ReadFloat();
+			break;
+		case SDL_EVENT_KEY_DOWN:
+		case SDL_EVENT_KEY_UP:
+			theEvent->key.key = (SDL_Keycode)mBuffer.ReadLong();
+			theEvent->key.down = theEvent->type == SDL_EVENT_KEY_DOWN;
+			break;
+		case SDL_EVENT_TEXT_INPUT:
+			mTextInput = mBuffer.ReadString();
+			theEvent->text.text = mTextInput.c_str();
+			break;
+		}
+	}
+
+	if (aType == DEMO_END || mBuffer.PastEnd())
+		mNextUpdateCount = -1;
+	else
+		ReadNextUpdateCount();
+
+	return aType;
+}
@@ -0,0 +1,95 @@
+#ifndef __DEMOBUFFER_HPP__
+#define __DEMOBUFFER_HPP__
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "common.hpp"
+#include "buffer.hpp"
+
+#include <SDL3/SDL.h>
+
+namespace PopLib
+{
+
+/**
+ * @brief record types stored in a demo
+ */
+enum DemoRecordType
+{
+	DEMO_EVENT,	 ///< an input event
+	DEMO_LOADED, ///< the loading thread completed on this update
+	DEMO_END,	 ///< the recording stopped on this update
+	DEMO_NONE
+};
+
+/**
+ * @brief records and replays input for deterministic playback
+ *
+ * every record is stamped with the AppBase update count it was handled on,
+ * so playback feeds it back on exactly the same update. the MTRand seed is
+ * stored in the header.
+ */
+class DemoBuffer
+{
+  public:
+	/// @brief the recorded data
+	Buffer mBuffer;
+	/// @brief the MTRand seed of the recording
+	ulong mRandSeed;
+	/// @brief the update count of the next record to replay, -1 if none
+	int mNextUpdateCount;
+	/// @brief backing store for replayed text input events
+	std::string mTextInput;
+
+  public:
+	DemoBuffer();
+	virtual ~DemoBuffer();
+
+	/// @brief clears the buffer and writes the header
+	/// @param theRandSeed
+	void StartRecording(ulong theRandSeed);
+	/// @brief records an input event, ignores events that aren't replayed
+	/// @param theUpdateCount
+	/// @param theEvent
+	void WriteEvent(int theUpdateCount, const SDL_Event &theEvent);
+	/// @brief records a marker
+	/// @param theUpdateCount
+	/// @param theType DEMO_LOADED or DEMO_END
+	void WriteMarker(int theUpdateCount, DemoRecordType theType);
+	/// @brief writes a DEMO_END marker and saves the demo
+	/// @param theFileName
+	/// @param theUpdateCount
+	/// @return true if success
+	bool Save(const std::string &theFileName, int theUpdateCount);
+
+	/// @brief loads a demo for playback
+	/// @param theFileName
+	/// @return true if success
+	bool Load(const std::string &theFileName);
+	/// @brief is a record due on this update?
+	/// @param theUpdateCount
+	/// @return true if yes
+	bool HasRecord(int theUpdateCount) const
+	{
+		return mNextUpdateCount >= 0 && mNextUpdateCount <= theUpdateCount;
+	}
+	/// @brief reads the next record
+	/// @param theEvent filled in for DEMO_EVENT, text points into mTextInput
+	/// @return the record type
+	DemoRecordType ReadRecord(SDL_Event *theEvent);
+
+	/// @brief is this an event that gets recorded and replayed?
+	/// @param theEvent
+	/// @return true if yes
+	static bool IsInputEvent(const SDL_Event &theEvent);
+
+  protected:
+	void WriteFloat(float theFloat);
+	float ReadFloat() const;
+	void ReadNextUpdateCount();
+};
+
+} // namespace PopLib
+
+#endif
@@ -0,0 +1,385 @@
+#include "filewatcher.hpp"
+#include "autocrit.hpp"
+
+#include <SDL3/SDL.h>
+#include <chrono>
+#include <filesystem>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace PopLib;
+
+FileWatcher::FileWatcher() : mStop(false)
+{
+	mPollIntervalMS = 500;
+	mSettleMS = 100;
+	mNotifyFd = -1;
+
+#ifdef __linux__
+	mNotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+	Stop();
+
+#ifdef __linux__
+	if (mNotifyFd >= 0)
+		close(mNotifyFd);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool FileWatcher::Start(const Callback &theCallback)
+{
+	if (mThread.joinable())
+		return false;
+
+	mCallback = theCallback;
+	mStop = false;
+	mThread = std::thread(&FileWatcher::ThreadProc, this);
+	return true;
+}
+
+void FileWatcher::Stop()
+{
+	if (!mThread.joinable())
+		return;
+
+	mStop = true;
+	mThread.join();
+
+	AutoCrit anAutoCrit(mCritSect);
+	mPending.clear();
+}
+
+bool FileWatcher::IsRunning()
+{
+	return mThread.joinable();
+}
+
+bool FileWatcher::IsUsingNotify()
+{
+	return mNotifyFd >= 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+std::string FileWatcher::GetFullPath(const std::string &theFileName)
+{
+	std::error_code anError;
+	std::filesystem::path aPath = std::filesystem::absolute(theFileName, anError);
+	if (anError)
+		return theFileName;
+
+	return aPath.lexically_normal().generic_string();
+}
+
+void FileWatcher::GetFileStamp(const std::string &thePath, int64_t *theTime, uintmax_t *theSize)
+{
+	std::error_code anError;
+	auto aTime = std::filesystem::last_write_time(thePath, anError);
+	*theTime = anError ? 0 : (int64_t)aTime.time_since_epoch().count();
+
+	uintmax_t aSize = std::filesystem::file_size(thePath, anError);
+	*theSize = anError ? 0 : aSize;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool FileWatcher::WatchDir(const std::string &theDir)
+{
+#ifdef __linux__
+	if (mNotifyFd < 0)
+		return false;
+
+	for (auto &aWatch : mWatchDirs)
+	{
+		if (aWatch.second == theDir)
+			return true;
+	}
+
+	// IN_MOVED_TO catches editors that save to a temporary file and rename it over the old one
+	int aWatchFd = inotify_add_watch(mNotifyFd, theDir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_ATTRIB);
+	if (aWatchFd < 0)
+		return false;
+
+	mWatchDirs[aWatchFd] = theDir;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void FileWatcher::UnwatchDir(const std::string &theDir)
+{
+#ifdef __linux__
+	for (auto aWatchItr = mWatchDirs.begin(); aWatchItr != mWatchDirs.end(); ++aWatchItr)
+	{
+		if (aWatchItr->second == theDir)
+		{
+			inotify_rm_watch(mNotifyFd, aWatchItr->first);
+			mWatchDirs.erase(aWatchItr);
+			break;
+		}
+	}
+#endif
+}
+
+void FileWatcher::AddFile(const std::string &theFileName)
+{
+	AutoCrit anAutoCrit(mCritSect);
+
+	if (mNames.insert(theFileName).second)
+		mFileOps.push_back({theFileName, true});
+}
+
+void FileWatcher::RemoveFile(const std::string &theFileName)
+{
+	AutoCrit anAutoCrit(mCritSect);
+
+	if (mNames.erase(theFileName) == 0)
+		return;
+
+	mFileOps.push_back({theFileName, false});
+	mPending.erase(theFileName);
+}
+
+void FileWatcher::SetFiles(const std::set<std::string> &theFileNames)
+{
+	AutoCrit anAutoCrit(mCritSect);
+
+	// both are sorted, one pass finds what was added and removed
+	std::set<std::string>::const_iterator aNewItr = theFileNames.begin();
+	std::set<std::string>::iterator anOldItr = mNames.begin();
+	while (aNewItr != theFileNames.end() || anOldItr != mNames.end())
+	{
+		if (anOldItr == mNames.end() || (aNewItr != theFileNames.end() && *aNewItr < *anOldItr))
+		{
+			mFileOps.push_back({*aNewItr, true});
+			mNames.insert(anOldItr, *aNewItr);
+			++aNewItr;
+		}
+		else if (aNewItr == theFileNames.end() || *anOldItr < *aNewItr)
+		{
+			mFileOps.push_back({*anOldItr, false});
+			mPending.erase(*anOldItr);
+			anOldItr = mNames.erase(anOldItr);
+		}
+		else
+		{
+			++aNewItr;
+			++anOldItr;
+		}
+	}
+}
+
+// resolves the names added and removed since the last call, watcher thread only
+void FileWatcher::ApplyFileOps()
+{
+	std::vector<FileOp> anOps;
+	{
+		AutoCrit anAutoCrit(mCritSect);
+		anOps.swap(mFileOps);
+	}
+
+	if (anOps.empty())
+		return;
+
+	// the paths are worked out without the lock, there may be many files
+	std::vector<std::string> aPaths(anOps.size());
+	for (size_t i = 0; i < anOps.size(); i++)
+	{
+		if (anOps[i].mAdd)
+			aPaths[i] = GetFullPath(anOps[i].mName);
+	}
+
+	AutoCrit anAutoCrit(mCritSect);
+
+	for (size_t i = 0; i < anOps.size(); i++)
+	{
+		const std::string &aName = anOps[i].mName;
+
+		if (anOps[i].mAdd)
+		{
+			const std::string &aPath = aPaths[i];
+			mPaths[aName] = aPath;
+
+			// another name for the same file already watches it
+			if (mFiles.find(aPath) != mFiles.end())
+				continue;
+
+			std::string aDir = std::filesystem::path(aPath).parent_path().generic_string();
+			WatchedFile &aFile = mFiles[aPath];
+			aFile.mName = aName;
+			aFile.mTime = 0;
+			aFile.mSize = 0;
+			aFile.mStamped = false;
+			aFile.mPolled = !WatchDir(aDir);
+			mDirFiles[aDir]++;
+		}
+		else
+		{
+			auto aPathItr = mPaths.find(aName);
+			if (aPathItr == mPaths.end())
+				continue;
+
+			WatchedFileMap::iterator anItr = mFiles.find(aPathItr->second);
+			if (anItr != mFiles.end() && anItr->second.mName == aName)
+			{
+				std::string aDir = std::filesystem::path(anItr->first).parent_path().generic_string();
+				mFiles.erase(anItr);
+
+				// drop the folder's watch once nothing in it is watched anymore
+				auto aDirItr = mDirFiles.find(aDir);
+				if (aDirItr != mDirFiles.end() && --aDirItr->second <= 0)
+				{
+					mDirFiles.erase(aDirItr);
+					UnwatchDir(aDir);
+				}
+			}
+
+			mPaths.erase(aPathItr);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void FileWatcher::ReadNotifyEvents()
+{
+#ifdef __linux__
+	alignas(inotify_event) char aBuffer[4096];
+
+	while (true)
+	{
+		ssize_t aLength = read(mNotifyFd, aBuffer, sizeof(aBuffer));
+		if (aLength <= 0)
+			break;
+
+		uint64_t aNow = SDL_GetTicksNS();
+		AutoCrit anAutoCrit(mCritSect);
+
+		for (char *aPtr = aBuffer; aPtr < aBuffer + aLength;)
+		{
+			inotify_event *anEvent = (inotify_event *)aPtr;
+			aPtr += sizeof(inotify_event) + anEvent->len;
+
+			if (anEvent->len == 0)
+				continue;
+
+			auto aWatchItr = mWatchDirs.find(anEvent->wd);
+			if (aWatchItr == mWatchDirs.end())
+				continue;
+
+			WatchedFileMap::iterator anItr = mFiles.find(aWatchItr->second + "/" + anEvent->name);
+			if (anItr != mFiles.end())
+				mPending[anItr->second.mName] = aNow;
+		}
+	}
+#endif
+}
+
+void FileWatcher::PollFiles()
+{
+	std::vector<std::string> aPaths;
+	{
+		AutoCrit anAutoCrit(mCritSect);
+		for (auto &aFile : mFiles)
+		{
+			if (aFile.second.mPolled)
+				aPaths.push_back(aFile.first);
+		}
+	}
+
+	if (aPaths.empty())
+		return;
+
+	// stat without the lock, there may be many files
+	std::vector<std::pair<int64_t, uintmax_t>> aStamps(aPaths.size());
+	for (size_t i = 0; i < aPaths.size(); i++)
+		GetFileStamp(aPaths[i], &aStamps[i].first, &aStamps[i].second);
+
+	uint64_t aNow = SDL_GetTicksNS();
+	AutoCrit anAutoCrit(mCritSect);
+
+	for (size_t i = 0; i < aPaths.size(); i++)
+	{
+		WatchedFileMap::iterator anItr = mFiles.find(aPaths[i]);
+		if (anItr == mFiles.end())
+			continue;
+
+		WatchedFile &aFile = anItr->second;
+		if (aFile.mTime != aStamps[i].first || aFile.mSize != aStamps[i].second)
+		{
+			aFile.mTime = aStamps[i].first;
+			aFile.mSize = aStamps[i].second;
+			if (aFile.mStamped)
+				mPending[aFile.mName] = aNow;
+		}
+
+		aFile.mStamped = true;
+	}
+}
+
+void FileWatcher::ReportSettledFiles()
+{
+	uint64_t aNow = SDL_GetTicksNS();
+	uint64_t aSettleNS = (uint64_t)mSettleMS * 1000000ULL;
+
+	std::vector<std::string> aSettled;
+	{
+		AutoCrit anAutoCrit(mCritSect);
+		for (auto anItr = mPending.begin(); anItr != mPending.end();)
+		{
+			if (aNow - anItr->second >= aSettleNS)
+			{
+				aSettled.push_back(anItr->first);
+				anItr = mPending.erase(anItr);
+			}
+			else
+				++anItr;
+		}
+	}
+
+	for (const std::string &aFileName : aSettled)
+		mCallback(aFileName);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void FileWatcher::ThreadProc()
+{
+	uint64_t aNextPollNS = 0;
+
+	while (!mStop)
+	{
+		ApplyFileOps();
+
+#ifdef __linux__
+		if (mNotifyFd >= 0)
+		{
+			pollfd aPollFd = {mNotifyFd, POLLIN, 0};
+			if (poll(&aPollFd, 1, 50) > 0 && (aPollFd.revents & POLLIN))
+				ReadNotifyEvents();
+		}
+		else
+#endif
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+		uint64_t aNow = SDL_GetTicksNS();
+		if (aNow >= aNextPollNS)
+		{
+			PollFiles();
+			aNextPollNS = aNow + (uint64_t)mPollIntervalMS * 1000000ULL;
+		}
+
+		ReportSettledFiles();
+	}
+}
@@ -0,0 +1,110 @@
+#ifndef __FILEWATCHER_HPP__
+#define __FILEWATCHER_HPP__
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "common.hpp"
+#include "critsect.hpp"
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+namespace PopLib
+{
+
+/**
+ * @brief reports files that changed on disk
+ *
+ * on Linux the folders of the watched files are watched with inotify, files
+ * whose folder can't be watched and every file on other platforms are
+ * polled for a new modification time or size every mPollIntervalMS.
+ * editors often write a file in several steps, so a change is only reported
+ * once the file stayed untouched for mSettleMS. a watched file that doesn't
+ * exist yet is reported once it's created. the callback runs on the
+ * watcher's own thread, which is also where added files are resolved and
+ * their folders watched, so AddFile and SetFiles never touch the disk.
+ */
+class FileWatcher
+{
+  public:
+	typedef std::function<void(const std::string &theFileName)> Callback;
+
+	/// @brief how often polled files are checked
+	int mPollIntervalMS;
+	/// @brief how long a file has to stay untouched before its change is reported
+	int mSettleMS;
+
+  public:
+	FileWatcher();
+	virtual ~FileWatcher();
+
+	/// @brief starts the watcher thread
+	/// @param theCallback called with the name a file was added with, on the watcher thread
+	/// @return false if it was already running
+	bool Start(const Callback &theCallback);
+	/// @brief stops the watcher thread, pending changes are dropped
+	void Stop();
+	/// @brief is the watcher thread running?
+	/// @return true if yes
+	bool IsRunning();
+	/// @brief are changes noticed through the OS rather than by polling?
+	/// @return true if yes
+	bool IsUsingNotify();
+
+	/// @brief starts watching a file, it doesn't need to exist yet
+	/// @param theFileName
+	void AddFile(const std::string &theFileName);
+	/// @brief stops watching a file
+	/// @param theFileName
+	void RemoveFile(const std::string &theFileName);
+	/// @brief watches exactly these files, adding and removing only what differs from the current set
+	/// @param theFileNames
+	void SetFiles(const std::set<std::string> &theFileNames);
+
+  protected:
+	struct WatchedFile
+	{
+		std::string mName; ///< as passed to AddFile
+		int64_t mTime;
+		uintmax_t mSize;
+		bool mPolled;
+		bool mStamped; ///< mTime and mSize were read, done by the first poll so AddFile doesn't touch the disk
+	};
+
+	struct FileOp
+	{
+		std::string mName;
+		bool mAdd;
+	};
+
+	typedef std::map<std::string, WatchedFile> WatchedFileMap;
+
+	CritSect mCritSect;
+	std::set<std::string> mNames;			  ///< everything added and not removed, as passed to AddFile
+	std::vector<FileOp> mFileOps;			  ///< adds and removes the watcher thread hasn't applied yet
+	std::map<std::string, std::string> mPaths; ///< absolute path of each applied name
+	std::map<std::string, int> mDirFiles;	  ///< number of watched files in each folder
+	WatchedFileMap mFiles;					  ///< by absolute path
+	std::map<std::string, uint64_t> mPending; ///< time of the last change, by name
+	std::map<int, std::string> mWatchDirs;	  ///< inotify watched folders, by descriptor
+	int mNotifyFd;
+	std::thread mThread;
+	std::atomic<bool> mStop;
+	Callback mCallback;
+
+	static std::string GetFullPath(const std::string &theFileName);
+	static void GetFileStamp(const std::string &thePath, int64_t *theTime, uintmax_t *theSize);
+	bool WatchDir(const std::string &theDir);
+	void UnwatchDir(const std::string &theDir);
+	void ApplyFileOps();
+	void ReadNotifyEvents();
+	void PollFiles();
+	void ReportSettledFiles();
+	void ThreadProc();
+};
+
+} // namespace PopLib
+
+#endif
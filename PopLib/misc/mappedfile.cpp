@@ -0,0 +1,196 @@
+#include "mappedfile.hpp"
+#include "paklib/pakinterface.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace PopLib;
+
+// what an empty file points at, so an open file never has a null mData
+static const uint8_t gEmptyData[1] = {0};
+
+MappedFile::MappedFile()
+{
+	mData = nullptr;
+	mSize = 0;
+	mMapping = nullptr;
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool MappedFile::Open(const std::string &theFileName)
+{
+	Close();
+
+	// paks come first, like with p_fopen
+	const uint8_t *aData;
+	size_t aDataSize;
+	if (p_map(theFileName.c_str(), &aData, &aDataSize))
+	{
+		mData = aData;
+		mSize = aDataSize;
+		return true;
+	}
+
+	if (MapFromDisk(theFileName))
+		return true;
+
+	// the pak interface might still know how to read it
+	PFILE *aFile = p_fopen(theFileName.c_str(), "rb");
+	if (aFile == nullptr)
+		return false;
+
+	p_fseek(aFile, 0, SEEK_END);
+	long aSize = p_ftell(aFile);
+	p_fseek(aFile, 0, SEEK_SET);
+
+	if (aSize == 0)
+		mData = gEmptyData;
+	else if (aSize > 0)
+	{
+		mBuffer.resize(aSize);
+		if (p_fread(mBuffer.data(), 1, aSize, aFile) == (size_t)aSize)
+		{
+			mData = mBuffer.data();
+			mSize = aSize;
+		}
+	}
+	p_fclose(aFile);
+
+	if (mData == nullptr)
+		mBuffer.clear();
+
+	return mData != nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void MappedFile::Close()
+{
+	if (mMapping != nullptr)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(mData);
+		CloseHandle((HANDLE)mMapping);
+#else
+		munmap((void *)mData, mSize);
+#endif
+		mMapping = nullptr;
+	}
+
+	mBuffer.clear();
+	mBuffer.shrink_to_fit();
+	mData = nullptr;
+	mSize = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void MappedFile::Preload(size_t theOffset, size_t theSize)
+{
+	// pak data and read in files are in memory already
+	if (mMapping == nullptr || theOffset >= mSize)
+		return;
+
+	size_t anEnd = (theSize == 0 || theSize > mSize - theOffset) ? mSize : theOffset + theSize;
+
+#ifndef _WIN32
+	// lets the kernel read the whole range ahead instead of a fault at a time
+	size_t aPageSize = (size_t)sysconf(_SC_PAGESIZE);
+	size_t aStart = theOffset - theOffset % aPageSize;
+	madvise((void *)(mData + aStart), anEnd - aStart, MADV_WILLNEED);
+#endif
+
+	// touching a byte of every page waits for it to be read
+	uint8_t aSum = mData[anEnd - 1];
+	for (size_t aPos = theOffset; aPos < anEnd; aPos += 4096)
+		aSum += mData[aPos];
+
+	volatile uint8_t aSink = aSum;
+	(void)aSink;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool MappedFile::MapFromDisk(const std::string &theFileName)
+{
+#ifdef _WIN32
+	HANDLE aFile = CreateFileA(theFileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+							   FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (aFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER aSize;
+	if (!GetFileSizeEx(aFile, &aSize))
+	{
+		CloseHandle(aFile);
+		return false;
+	}
+
+	// empty files can't be mapped, but they opened fine
+	if (aSize.QuadPart == 0)
+	{
+		CloseHandle(aFile);
+		mData = gEmptyData;
+		return true;
+	}
+
+	HANDLE aMapping = CreateFileMappingA(aFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(aFile);
+	if (aMapping == nullptr)
+		return false;
+
+	void *aData = MapViewOfFile(aMapping, FILE_MAP_READ, 0, 0, 0);
+	if (aData == nullptr)
+	{
+		CloseHandle(aMapping);
+		return false;
+	}
+
+	mMapping = aMapping;
+	mData = (const uint8_t *)aData;
+	mSize = (size_t)aSize.QuadPart;
+#else
+	int aFile = open(theFileName.c_str(), O_RDONLY);
+	if (aFile < 0)
+		return false;
+
+	struct stat aStat;
+	if (fstat(aFile, &aStat) != 0)
+	{
+		close(aFile);
+		return false;
+	}
+
+	// empty files can't be mapped, but they opened fine
+	if (aStat.st_size == 0)
+	{
+		close(aFile);
+		mData = gEmptyData;
+		return true;
+	}
+
+	void *aData = mmap(nullptr, aStat.st_size, PROT_READ, MAP_PRIVATE, aFile, 0);
+	close(aFile);
+	if (aData == MAP_FAILED)
+		return false;
+
+	// there is no handle to keep around, anything non null marks the mapping
+	mMapping = aData;
+	mData = (const uint8_t *)aData;
+	mSize = (size_t)aStat.st_size;
+#endif
+
+	return true;
+}
@@ -0,0 +1,67 @@
+#ifndef __MAPPEDFILE_HPP__
+#define __MAPPEDFILE_HPP__
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "common.hpp"
+
+namespace PopLib
+{
+
+/**
+ * @brief read only view of a whole file
+ *
+ * files in a pak point straight at the pak's data, see p_map. files on disk
+ * are memory mapped, so nothing is copied until a page is touched. files
+ * that can only be read through a custom pak interface are read into memory
+ * instead, callers don't need to care which one happened.
+ */
+class MappedFile
+{
+  public:
+	MappedFile();
+	virtual ~MappedFile();
+
+	/// @brief maps a file, closing the previous one
+	/// @param theFileName
+	/// @return false if the file can't be opened, an empty file opens with a size of 0
+	bool Open(const std::string &theFileName);
+	/// @brief unmaps the file
+	void Close();
+	/// @brief reads part of a mapped file in now, so touching it later doesn't wait on the disk
+	/// @param theOffset
+	/// @param theSize bytes from theOffset, 0 for the rest of the file
+	void Preload(size_t theOffset = 0, size_t theSize = 0);
+
+	/// @brief is a file open?
+	/// @return true if yes
+	bool IsOpen() const
+	{
+		return mData != nullptr;
+	}
+	/// @brief gets the contents
+	/// @return the first byte of the file, or nullptr if none is open
+	const uint8_t *GetData() const
+	{
+		return mData;
+	}
+	/// @brief gets the file size
+	/// @return size in bytes
+	size_t GetSize() const
+	{
+		return mSize;
+	}
+
+  protected:
+	const uint8_t *mData;
+	size_t mSize;
+	void *mMapping;
+	std::vector<uint8_t> mBuffer;
+
+	bool MapFromDisk(const std::string &theFileName);
+};
+
+} // namespace PopLib
+
+#endif
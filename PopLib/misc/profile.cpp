@@ -22,10 +22,48 @@
 #include "profile.hpp"
 #include "readwrite/xmlwriter.hpp" // Write
 #include "readwrite/xmlparser.hpp" // Read
+#include "misc/buffer.hpp"			// Binary Write
+#include "misc/mappedfile.hpp"		// Binary Read
 #include "appbase.hpp"
 
+#include <filesystem>
+
 using namespace PopLib;
 
+// Binary profile layout, all little endian:
+//	"PPRF", int32 version
+//	records: varint payload length, int32 CRC of the payload, payload
+//	payload: byte type, varint name length, name, value
+// A later record for the same type and name replaces the earlier one.
+static const uchar gProfileMagic[4] = {'P', 'P', 'R', 'F'};
+static const int gProfileVersion = 1;
+static const int gProfileHeaderSize = 8;
+static const int64_t gMinJournalBytes = 4096; // don't compact tiny profiles on every save
+
+static bool DecodeVarInt(const uchar *&thePtr, const uchar *theEnd, uint64_t &theValue)
+{
+	theValue = 0;
+	for (int aShift = 0; aShift < 64 && thePtr < theEnd; aShift += 7)
+	{
+		uchar aByte = *thePtr++;
+		theValue |= (uint64_t)(aByte & 0x7F) << aShift;
+		if ((aByte & 0x80) == 0)
+			return true;
+	}
+	return false;
+}
+
+static uint32_t DecodeLE32(const uchar *thePtr)
+{
+	return (uint32_t)thePtr[0] | ((uint32_t)thePtr[1] << 8) | ((uint32_t)thePtr[2] << 16) |
+		   ((uint32_t)thePtr[3] << 24);
+}
+
+static uint64_t DecodeLE64(const uchar *thePtr)
+{
+	return (uint64_t)DecodeLE32(thePtr) | ((uint64_t)DecodeLE32(thePtr + 4) << 32);
+}
+
 //************************************
 // Method:      Profile
 // FullName:    PopLib::Profile::Profile
@@ -33,6 +71,9 @@ using namespace PopLib;
 //************************************
 Profile::Profile()
 {
+	mTableBytes = 0;
+	mJournalBytes = 0;
+	mNeedsCompact = true;
 }
 
 //************************************
@@ -91,6 +132,24 @@ std::string PopLib::Profile::GetUserFileName(PopString theUserName /*= ""*/)
 	return StrFormat("%susers/%s.xml", GetAppDataFolder().c_str(), aUserName.c_str());
 }
 
+//************************************
+// Method:    GetUserBinaryFileName
+// FullName:  PopLib::Profile::GetUserBinaryFileName
+// Access:    virtual public
+// Returns:   std::string
+// Description: Same as GetUserFileName(), for the binary profile that LoadUser()
+//				and SaveUser() use.  The XML one is only read when there is no
+//				binary one yet, so old profiles carry over.
+// Parameter: PopString theUserName
+//************************************
+std::string PopLib::Profile::GetUserBinaryFileName(PopString theUserName /*= ""*/)
+{
+	std::string aUserName =
+		(theUserName == "") ? mUserName : theUserName;
+
+	return StrFormat("%susers/%s.prof", GetAppDataFolder().c_str(), aUserName.c_str());
+}
+
 //************************************
 // Method:    SetIntegerValue
 // FullName:  PopLib::Profile::SetIntegerValue
@@ -104,10 +163,18 @@ std::string PopLib::Profile::GetUserFileName(PopString theUserName /*= ""*/)
 //************************************
 void PopLib::Profile::SetIntegerValue(PopString theValueName, int theValue)
 {
-	if (mIntegerMap.find(theValueName) != mIntegerMap.end())
-		mIntegerMap[theValueName] = theValue;
+	std::map<PopString, int>::iterator anItr = mIntegerMap.find(theValueName);
+	if (anItr != mIntegerMap.end())
+	{
+		if (anItr->second == theValue)
+			return;
+
+		anItr->second = theValue;
+	}
 	else
 		mIntegerMap.insert(std::pair<PopString, int>(theValueName, theValue));
+
+	MarkDirty(VALUE_INTEGER, theValueName);
 }
 
 //************************************
@@ -213,6 +280,7 @@ bool Profile::Load(PopString theFileName)
 	mBoolMap.clear();
 	mFloatMap.clear();
 	mStringMap.clear();
+	mDirtyValues.clear();
 
 	XMLParser aParser;
 
@@ -221,6 +289,7 @@ bool Profile::Load(PopString theFileName)
 		XMLElement aNode;
 
 		ParseXML(&aParser);
+		mNeedsCompact = true; // the binary profile is rewritten from what we imported
 		return true; // SUCCESS
 	}
 
@@ -228,6 +297,310 @@ bool Profile::Load(PopString theFileName)
 	return false;
 }
 
+//************************************
+// Method:      SaveBinary
+// FullName:    PopLib::Profile::SaveBinary
+// Access:      virtual public
+// Returns:     bool
+// Parameter:   PopString theFileName
+// Description: Appends the values changed since the last save to the binary
+//				profile.  Saving with nothing changed doesn't touch the disk at
+//				all, so this is cheap enough to autosave from the game loop.
+//				The file is rewritten instead when it isn't the one we loaded,
+//				is damaged, or the journal got bigger than the table.
+//************************************
+bool Profile::SaveBinary(PopString theFileName)
+{
+	// saved every so often, most of the time nothing changed and the disk isn't touched
+	if (!mNeedsCompact && theFileName == mJournalFileName && mDirtyValues.empty())
+		return true;
+
+	if (mNeedsCompact || theFileName != mJournalFileName || !FileExists(theFileName) ||
+		mJournalBytes > std::max(mTableBytes, gMinJournalBytes))
+		return CompactBinary(theFileName);
+
+	Buffer aBuffer;
+	for (const ValueKey &aKey : mDirtyValues)
+		WriteValue(&aBuffer, aKey.first, aKey.second);
+
+	FILE *aFP = fopen(theFileName.c_str(), "ab");
+	if (aFP == nullptr)
+		return false;
+
+	bool aSuccess = fwrite(aBuffer.GetDataPtr(), 1, aBuffer.GetDataLen(), aFP) == (size_t)aBuffer.GetDataLen();
+	aSuccess = (fclose(aFP) == 0) && aSuccess;
+
+	if (!aSuccess)
+	{
+		// a torn record fails its CRC and is dropped on load, the rewrite puts it back
+		mNeedsCompact = true;
+		return false;
+	}
+
+	mJournalBytes += aBuffer.GetDataLen();
+	mDirtyValues.clear();
+	return true;
+}
+
+//************************************
+// Method:      CompactBinary
+// FullName:    PopLib::Profile::CompactBinary
+// Access:      virtual protected
+// Returns:     bool
+// Parameter:   const std::string &theFileName
+// Description: Writes every value once into a new binary profile, then swaps
+//				it in for the old one, so a crash halfway leaves the old file.
+//************************************
+bool Profile::CompactBinary(const std::string &theFileName)
+{
+	Buffer aBuffer;
+	aBuffer.WriteBytes(gProfileMagic, 4);
+	aBuffer.WriteInt32(gProfileVersion);
+
+	for (std::map<PopString, int>::iterator anItr = mIntegerMap.begin(); anItr != mIntegerMap.end(); ++anItr)
+		WriteValue(&aBuffer, VALUE_INTEGER, anItr->first);
+	for (std::map<PopString, bool>::iterator anItr = mBoolMap.begin(); anItr != mBoolMap.end(); ++anItr)
+		WriteValue(&aBuffer, VALUE_BOOL, anItr->first);
+	for (std::map<PopString, double>::iterator anItr = mFloatMap.begin(); anItr != mFloatMap.end(); ++anItr)
+		WriteValue(&aBuffer, VALUE_FLOAT, anItr->first);
+	for (std::map<PopString, PopString>::iterator anItr = mStringMap.begin(); anItr != mStringMap.end(); ++anItr)
+		WriteValue(&aBuffer, VALUE_STRING, anItr->first);
+
+	MkDir(GetFileDir(theFileName));
+
+	std::string aTempName = theFileName + ".tmp";
+	FILE *aFP = fopen(aTempName.c_str(), "wb");
+	if (aFP == nullptr)
+		return false;
+
+	bool aSuccess = fwrite(aBuffer.GetDataPtr(), 1, aBuffer.GetDataLen(), aFP) == (size_t)aBuffer.GetDataLen();
+	aSuccess = (fclose(aFP) == 0) && aSuccess;
+
+	std::error_code anError;
+	if (aSuccess)
+		std::filesystem::rename(aTempName, theFileName, anError);
+
+	if (!aSuccess || anError)
+	{
+		remove(aTempName.c_str());
+		return false;
+	}
+
+	mJournalFileName = theFileName;
+	mTableBytes = aBuffer.GetDataLen();
+	mJournalBytes = 0;
+	mNeedsCompact = false;
+	mDirtyValues.clear();
+	return true;
+}
+
+//************************************
+// Method:      LoadBinary
+// FullName:    PopLib::Profile::LoadBinary
+// Access:      virtual public
+// Returns:     bool
+// Parameter:   PopString theFileName
+// Description: Loads a binary profile written by SaveBinary().  The file is
+//				mapped and the values read straight out of it.  Reading stops
+//				at the first damaged record, which is where a crash in the
+//				middle of a save leaves off, and the next save rewrites it.
+//************************************
+bool Profile::LoadBinary(PopString theFileName)
+{
+	mIntegerMap.clear();
+	mBoolMap.clear();
+	mFloatMap.clear();
+	mStringMap.clear();
+	mDirtyValues.clear();
+
+	MappedFile aFile;
+	if (!aFile.Open(theFileName) || aFile.GetSize() < (size_t)gProfileHeaderSize ||
+		memcmp(aFile.GetData(), gProfileMagic, 4) != 0 || (int)DecodeLE32(aFile.GetData() + 4) != gProfileVersion)
+		return false; // FAILURE
+
+	const uchar *aStart = aFile.GetData();
+	const uchar *anEnd = aStart + aFile.GetSize();
+	const uchar *aPtr = aStart + gProfileHeaderSize;
+	int aNumRecords = 0;
+
+	while (aPtr < anEnd)
+	{
+		const uchar *aRecord = aPtr;
+		uint64_t aLen;
+		if (!DecodeVarInt(aPtr, anEnd, aLen) || anEnd - aPtr < 4 || (uint64_t)(anEnd - aPtr - 4) < aLen)
+		{
+			aPtr = aRecord;
+			break;
+		}
+
+		uint32_t aCRC = DecodeLE32(aPtr);
+		aPtr += 4;
+
+		if ((uint32_t)Buffer::GetCRC32(aPtr, (int)aLen) != aCRC || !ReadValue(aPtr, (int)aLen))
+		{
+			aPtr = aRecord;
+			break;
+		}
+
+		aPtr += aLen;
+		aNumRecords++;
+	}
+
+	int aNumValues = (int)(mIntegerMap.size() + mBoolMap.size() + mFloatMap.size() + mStringMap.size());
+
+	mJournalFileName = theFileName;
+	mTableBytes = aPtr - aStart;
+	mJournalBytes = 0;
+	// rewrite a damaged file, or one that is mostly values that were changed again later
+	mNeedsCompact = aPtr != anEnd || aNumRecords > aNumValues * 2 + 32;
+
+	return true; // SUCCESS
+}
+
+//************************************
+// Method:      WriteValue
+// FullName:    PopLib::Profile::WriteValue
+// Access:      virtual protected
+// Returns:     void
+// Parameter:   Buffer *theBuffer
+// Parameter:   int theType
+// Parameter:   const PopString &theValueName
+// Description: Adds a binary profile record holding the current value.
+//************************************
+void Profile::WriteValue(Buffer *theBuffer, int theType, const PopString &theValueName)
+{
+	Buffer aRecord;
+	aRecord.WriteByte((uchar)theType);
+	aRecord.WriteVarInt(theValueName.length());
+	aRecord.WriteBytes((const uchar *)theValueName.data(), (int)theValueName.length());
+
+	switch (theType)
+	{
+	case VALUE_INTEGER:
+	{
+		std::map<PopString, int>::iterator anItr = mIntegerMap.find(theValueName);
+		if (anItr == mIntegerMap.end())
+			return;
+		aRecord.WriteSignedVarInt(anItr->second);
+		break;
+	}
+	case VALUE_BOOL:
+	{
+		std::map<PopString, bool>::iterator anItr = mBoolMap.find(theValueName);
+		if (anItr == mBoolMap.end())
+			return;
+		aRecord.WriteByte(anItr->second ? 1 : 0);
+		break;
+	}
+	case VALUE_FLOAT:
+	{
+		std::map<PopString, double>::iterator anItr = mFloatMap.find(theValueName);
+		if (anItr == mFloatMap.end())
+			return;
+		aRecord.WriteDouble(anItr->second);
+		break;
+	}
+	case VALUE_STRING:
+	{
+		std::map<PopString, PopString>::iterator anItr = mStringMap.find(theValueName);
+		if (anItr == mStringMap.end())
+			return;
+		aRecord.WriteVarInt(anItr->second.length());
+		aRecord.WriteBytes((const uchar *)anItr->second.data(), (int)anItr->second.length());
+		break;
+	}
+	default:
+		return;
+	}
+
+	theBuffer->WriteVarInt(aRecord.GetDataLen());
+	theBuffer->WriteInt32((int32_t)(uint32_t)aRecord.GetCRC32());
+	theBuffer->WriteBytes(aRecord.GetDataPtr(), aRecord.GetDataLen());
+}
+
+//************************************
+// Method:      ReadValue
+// FullName:    PopLib::Profile::ReadValue
+// Access:      virtual protected
+// Returns:     bool
+// Parameter:   const uchar *theData
+// Parameter:   int theLen
+// Description: Stores the value in a binary profile record's payload.
+//				Returns 'false' if the payload doesn't make sense.
+//************************************
+bool Profile::ReadValue(const uchar *theData, int theLen)
+{
+	const uchar *aPtr = theData;
+	const uchar *anEnd = theData + theLen;
+
+	uint64_t aNameLen;
+	if (aPtr >= anEnd)
+		return false;
+	int aType = *aPtr++;
+	if (!DecodeVarInt(aPtr, anEnd, aNameLen) || (uint64_t)(anEnd - aPtr) < aNameLen)
+		return false;
+
+	PopString aName((const char *)aPtr, (size_t)aNameLen);
+	aPtr += aNameLen;
+
+	switch (aType)
+	{
+	case VALUE_INTEGER:
+	{
+		uint64_t aValue;
+		if (!DecodeVarInt(aPtr, anEnd, aValue))
+			return false;
+		mIntegerMap[aName] = (int)(int64_t)((aValue >> 1) ^ (~(aValue & 1) + 1)); // zigzag
+		break;
+	}
+	case VALUE_BOOL:
+	{
+		if (aPtr >= anEnd)
+			return false;
+		mBoolMap[aName] = *aPtr++ != 0;
+		break;
+	}
+	case VALUE_FLOAT:
+	{
+		if (anEnd - aPtr < 8)
+			return false;
+		uint64_t aBits = DecodeLE64(aPtr);
+		double aValue;
+		memcpy(&aValue, &aBits, sizeof(aValue));
+		mFloatMap[aName] = aValue;
+		aPtr += 8;
+		break;
+	}
+	case VALUE_STRING:
+	{
+		uint64_t aLen;
+		if (!DecodeVarInt(aPtr, anEnd, aLen) || (uint64_t)(anEnd - aPtr) < aLen)
+			return false;
+		mStringMap[aName] = PopString((const char *)aPtr, (size_t)aLen);
+		aPtr += aLen;
+		break;
+	}
+	default:
+		return false;
+	}
+
+	return aPtr == anEnd;
+}
+
+//************************************
+// Method:      MarkDirty
+// FullName:    PopLib::Profile::MarkDirty
+// Access:      virtual protected
+// Returns:     void
+// Parameter:   int theType
+// Parameter:   const PopString &theValueName
+// Description: Remembers a changed value, for the next SaveUser() to append.
+//************************************
+void Profile::MarkDirty(int theType, const PopString &theValueName)
+{
+	mDirtyValues.insert(ValueKey(theType, theValueName));
+}
+
 // This can be done inline with the code, but makes it messy
 bool Profile::HasAttribute(PopLib::XMLElement *theNode, PopString theAttrib)
 {
@@ -318,6 +691,14 @@ bool Profile::LoadUser(PopString theUserName)
 	SetUserName(theUserName);
 	if (mUserName != "")
 	{
+		std::string aBinaryFileName = GetUserBinaryFileName(mUserName);
+
+		if (PopLib::FileExists(aBinaryFileName) && LoadBinary(aBinaryFileName))
+		{
+			return true;
+		}
+
+		// no binary profile yet, import the XML one
 		std::string aFileName = GetUserFileName(mUserName);
 
 		if (PopLib::FileExists(aFileName))
@@ -337,15 +718,17 @@ bool Profile::LoadUser(PopString theUserName)
 // Returns:   bool
 // Description: Saves the currently loaded user's profile
 //				This is one of the main methods you will be using.
+//				Only the values changed since the last save are written,
+//				use Save() to export the whole profile as XML.
 //************************************
 bool Profile::SaveUser()
 {
 	if (mUserName != "")
 	{
-		std::string aFileName = GetUserFileName(mUserName);
+		std::string aFileName = GetUserBinaryFileName(mUserName);
 		MkDir(GetFileDir(aFileName));
 
-		return Save(aFileName);
+		return SaveBinary(aFileName);
 	}
 	return false;
 }
@@ -390,6 +773,13 @@ bool Profile::RenameUser(PopString theNewUserName)
 
 			rename(OldFileName.c_str(), NewFileName.c_str());
 
+			std::string OldBinaryFileName = GetUserBinaryFileName(OldUserName);
+			std::string NewBinaryFileName = GetUserBinaryFileName(mUserName);
+
+			rename(OldBinaryFileName.c_str(), NewBinaryFileName.c_str());
+			if (mJournalFileName == OldBinaryFileName)
+				mJournalFileName = NewBinaryFileName;
+
 			return true;
 		}
 		else
@@ -418,6 +808,10 @@ bool Profile::DeleteUser(PopString theUserName)
 
 		remove(aFileName.c_str());
 
+		std::string aBinaryFileName = GetUserBinaryFileName(theUserName);
+
+		remove(aBinaryFileName.c_str());
+
 		return true;
 	}
 	return false;
@@ -465,6 +859,9 @@ void Profile::ResetProfile()
 	mIntegerMap.clear();
 	mStringMap.clear();
 	mBoolMap.clear();
+
+	mDirtyValues.clear();
+	mNeedsCompact = true;
 }
 
 //************************************
@@ -478,10 +875,18 @@ void Profile::ResetProfile()
 //************************************
 void PopLib::Profile::SetBoolValue(PopString theValueName, bool theValue)
 {
-	if (mBoolMap.find(theValueName) != mBoolMap.end())
-		mBoolMap[theValueName] = theValue;
+	std::map<PopString, bool>::iterator anItr = mBoolMap.find(theValueName);
+	if (anItr != mBoolMap.end())
+	{
+		if (anItr->second == theValue)
+			return;
+
+		anItr->second = theValue;
+	}
 	else
 		mBoolMap.insert(std::pair<PopString, bool>(theValueName, theValue));
+
+	MarkDirty(VALUE_BOOL, theValueName);
 }
 
 //************************************
@@ -514,10 +919,18 @@ bool PopLib::Profile::GetBoolValue(PopString theValueName, bool theDefault)
 //************************************
 void PopLib::Profile::SetFloatValue(PopString theValueName, double theValue)
 {
-	if (mFloatMap.find(theValueName) != mFloatMap.end())
-		mFloatMap[theValueName] = theValue;
+	std::map<PopString, double>::iterator anItr = mFloatMap.find(theValueName);
+	if (anItr != mFloatMap.end())
+	{
+		if (anItr->second == theValue)
+			return;
+
+		anItr->second = theValue;
+	}
 	else
 		mFloatMap.insert(std::pair<PopString, double>(theValueName, theValue));
+
+	MarkDirty(VALUE_FLOAT, theValueName);
 }
 
 //************************************
@@ -550,10 +963,18 @@ double PopLib::Profile::GetFloatValue(PopString theValueName, double theDefault)
 //************************************
 void PopLib::Profile::SetStringValue(PopString theValueName, PopString theValue)
 {
-	if (mStringMap.find(theValueName) != mStringMap.end())
-		mStringMap[theValueName] = theValue;
+	std::map<PopString, PopString>::iterator anItr = mStringMap.find(theValueName);
+	if (anItr != mStringMap.end())
+	{
+		if (anItr->second == theValue)
+			return;
+
+		anItr->second = theValue;
+	}
 	else
 		mStringMap.insert(std::pair<PopString, PopString>(theValueName, theValue));
+
+	MarkDirty(VALUE_STRING, theValueName);
 }
 
 //************************************
@@ -6,11 +6,13 @@
 
 #include "common.hpp"
 #include <map>
+#include <set>
 
 namespace PopLib
 {
 class XMLParser; // Forward Class declaration to avoid Include files
 class XMLElement;
+class Buffer;
 
 class Profile
 {
@@ -25,8 +27,31 @@ class Profile
 	std::map<PopString, PopString> mStringMap;
 	std::map<PopString, double> mFloatMap;
 
+	// The binary profile is a table of typed values followed by a journal of the
+	// ones changed since.  SaveUser only appends what changed, and rewrites the
+	// whole file once the journal outgrows the table.
+	enum
+	{
+		VALUE_INTEGER,
+		VALUE_BOOL,
+		VALUE_FLOAT,
+		VALUE_STRING
+	};
+
+	typedef std::pair<int, PopString> ValueKey; // type and name
+	std::set<ValueKey> mDirtyValues;			// changed since the last save
+	std::string mJournalFileName;				// the binary file the journal belongs to
+	int64_t mTableBytes;						// size of the file when it was last compacted
+	int64_t mJournalBytes;						// appended since
+	bool mNeedsCompact;
+
 	Profile();
 
+	virtual void MarkDirty(int theType, const PopString &theValueName);
+	virtual void WriteValue(Buffer *theBuffer, int theType, const PopString &theValueName);
+	virtual bool ReadValue(const uchar *theData, int theLen);
+	virtual bool CompactBinary(const std::string &theFileName);
+
   public:
 	static Profile *GetProfile();
 	virtual ~Profile();
@@ -38,6 +63,9 @@ class Profile
 	virtual void ParseXML(PopLib::XMLParser *theParser);
 	virtual bool HasAttribute(PopLib::XMLElement *theNode, PopString theAttrib);
 
+	virtual bool SaveBinary(PopString theFileName); // Returns 'true' if success
+	virtual bool LoadBinary(PopString theFileName); // Returns 'true' if success
+
 	// Even More Abstract Serialization functions
   public:
 	virtual bool LoadUser(PopString theUserName);	   // Load the User from the users dir
@@ -60,6 +88,7 @@ class Profile
 	virtual std::string GetStateFileName(PopString theStateName, PopString theUserName = "");
 	virtual void EraseStateSaves(PopString theUserName = "");
 	virtual std::string GetUserFileName(PopString theUserName = "");
+	virtual std::string GetUserBinaryFileName(PopString theUserName = "");
 
 	// Another Cool Feature!  Read and Write integers with String Values!
 	virtual void SetIntegerValue(PopString theValueName, int theValue);
@@ -0,0 +1,286 @@
+#include "registrystore.hpp"
+#include "autocrit.hpp"
+
+#include <SDL3/SDL.h>
+#include <filesystem>
+#include <fstream>
+
+using namespace PopLib;
+
+RegistryStore::RegistryStore() : mFlushFailed(false)
+{
+	mFlushDelayNS = 1000000000ULL;
+	mFormat = FORMAT_JSON;
+	mRoot = nlohmann::json::object();
+	mLoaded = false;
+	mDirty = false;
+	mLastWriteNS = 0;
+}
+
+RegistryStore::~RegistryStore()
+{
+	Flush(true);
+	WaitForFlush();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void RegistryStore::SetDir(const std::string &theDir)
+{
+	AutoCrit anAutoCrit(mCritSect);
+
+	if (theDir == mDir)
+		return;
+
+	if (mLoaded)
+		Flush(true);
+
+	mDir = theDir;
+	mRoot = nlohmann::json::object();
+	mLoaded = false;
+	mDirty = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void RegistryStore::SetFormat(Format theFormat)
+{
+	AutoCrit anAutoCrit(mCritSect);
+
+	if (theFormat == mFormat)
+		return;
+
+	mFormat = theFormat;
+
+	// rewrite the file in the new format on the next flush
+	if (mLoaded)
+	{
+		mDirty = true;
+		mLastWriteNS = SDL_GetTicksNS();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+std::string RegistryStore::GetFileName(Format theFormat) const
+{
+	return mDir + (theFormat == FORMAT_BINARY ? "registry.bin" : "registry.json");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void RegistryStore::Load()
+{
+	if (mLoaded)
+		return;
+
+	mLoaded = true;
+	mRoot = nlohmann::json::object();
+
+	Format aFormats[2] = {mFormat, mFormat == FORMAT_BINARY ? FORMAT_JSON : FORMAT_BINARY};
+	for (Format aFormat : aFormats)
+	{
+		std::ifstream aStream(GetFileName(aFormat), std::ios::binary);
+		if (!aStream)
+			continue;
+
+		std::vector<uint8_t> aData((std::istreambuf_iterator<char>(aStream)), std::istreambuf_iterator<char>());
+
+		nlohmann::json aRoot = aFormat == FORMAT_BINARY ? nlohmann::json::from_cbor(aData, true, false)
+														: nlohmann::json::parse(aData, nullptr, false);
+		if (aRoot.is_discarded() || !aRoot.is_object())
+			continue;
+
+		mRoot = std::move(aRoot);
+
+		// migrate to the preferred format
+		if (aFormat != mFormat)
+		{
+			mDirty = true;
+			mLastWriteNS = SDL_GetTicksNS();
+		}
+		break;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool RegistryStore::Read(const std::string &theValueName, nlohmann::json *theValue)
+{
+	AutoCrit anAutoCrit(mCritSect);
+	Load();
+
+	auto anItr = mRoot.find(theValueName);
+	if (anItr == mRoot.end())
+		return false;
+
+	*theValue = *anItr;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void RegistryStore::Write(const std::string &theValueName, const nlohmann::json &theValue)
+{
+	AutoCrit anAutoCrit(mCritSect);
+	Load();
+
+	nlohmann::json &aValue = mRoot[theValueName];
+	if (aValue == theValue)
+		return;
+
+	aValue = theValue;
+	mDirty = true;
+	mLastWriteNS = SDL_GetTicksNS();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool RegistryStore::Erase(const std::string &theValueName)
+{
+	AutoCrit anAutoCrit(mCritSect);
+	Load();
+
+	if (mRoot.erase(theValueName) == 0)
+		return false;
+
+	mDirty = true;
+	mLastWriteNS = SDL_GetTicksNS();
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool RegistryStore::Clear()
+{
+	AutoCrit anAutoCrit(mCritSect);
+	WaitForFlush();
+
+	mRoot = nlohmann::json::object();
+	mLoaded = true;
+	mDirty = false;
+
+	std::error_code anError;
+	bool success = true;
+	for (Format aFormat : {FORMAT_JSON, FORMAT_BINARY})
+	{
+		std::filesystem::remove(GetFileName(aFormat), anError);
+		success = success && !anError;
+	}
+
+	return success;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool RegistryStore::IsDirty()
+{
+	AutoCrit anAutoCrit(mCritSect);
+	return mDirty;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void RegistryStore::Update()
+{
+	AutoCrit anAutoCrit(mCritSect);
+
+	if (mFlushFailed.exchange(false))
+	{
+		// try again after another delay
+		mDirty = true;
+		mLastWriteNS = SDL_GetTicksNS();
+	}
+
+	if (mDirty && SDL_GetTicksNS() - mLastWriteNS >= mFlushDelayNS)
+		Flush(false);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool RegistryStore::Flush(bool waitForIt)
+{
+	AutoCrit anAutoCrit(mCritSect);
+
+	if (!mDirty || mDir.empty())
+		return true;
+
+	std::vector<uint8_t> aData;
+	if (mFormat == FORMAT_BINARY)
+		aData = nlohmann::json::to_cbor(mRoot);
+	else
+	{
+		std::string aString = mRoot.dump(4);
+		aData.assign(aString.begin(), aString.end());
+	}
+
+	std::string aFileName = GetFileName(mFormat);
+	std::string anOldFileName = GetFileName(mFormat == FORMAT_BINARY ? FORMAT_JSON : FORMAT_BINARY);
+	mDirty = false;
+
+	// keep writes in order
+	WaitForFlush();
+
+	auto aWriteProc = [this, aFileName, anOldFileName, aData = std::move(aData)] {
+		if (!WriteFileAtomic(aFileName, aData))
+		{
+			mFlushFailed = true;
+			return false;
+		}
+
+		std::error_code anError;
+		std::filesystem::remove(anOldFileName, anError);
+		return true;
+	};
+
+	if (waitForIt)
+	{
+		bool success = aWriteProc();
+		mFlushFailed = false;
+		mDirty = !success;
+		return success;
+	}
+
+	mFlushThread = std::thread(std::move(aWriteProc));
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void RegistryStore::WaitForFlush()
+{
+	if (mFlushThread.joinable())
+		mFlushThread.join();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool RegistryStore::WriteFileAtomic(const std::string &theFileName, const std::vector<uint8_t> &theData)
+{
+	std::filesystem::path aPath(theFileName);
+	std::filesystem::path aTempPath(theFileName + ".tmp");
+
+	std::error_code anError;
+	if (aPath.has_parent_path())
+		std::filesystem::create_directories(aPath.parent_path(), anError);
+
+	{
+		std::ofstream aStream(aTempPath, std::ios::binary | std::ios::trunc);
+		if (!aStream)
+			return false;
+
+		aStream.write((const char *)theData.data(), theData.size());
+		aStream.flush();
+		if (!aStream)
+			return false;
+	}
+
+	std::filesystem::rename(aTempPath, aPath, anError);
+	if (anError)
+	{
+		std::filesystem::remove(aTempPath, anError);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,97 @@
+#ifndef __REGISTRYSTORE_HPP__
+#define __REGISTRYSTORE_HPP__
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "common.hpp"
+#include "critsect.hpp"
+
+#include <atomic>
+#include <thread>
+#include <json.hpp>
+
+namespace PopLib
+{
+
+/**
+ * @brief in-memory copy of the registry file
+ *
+ * the file is parsed once on first access. writes only touch memory and
+ * mark the store dirty; Update flushes it on a background thread once no
+ * write happened for mFlushDelayNS, and the destructor flushes whatever is
+ * left. files are written to a temporary file first and renamed over the
+ * old one, so a crash never leaves a half written registry behind.
+ */
+class RegistryStore
+{
+  public:
+	enum Format
+	{
+		FORMAT_JSON,  ///< registry.json, human readable
+		FORMAT_BINARY ///< registry.bin, CBOR
+	};
+
+	/// @brief how long the store has to stay untouched before Update flushes it
+	uint64_t mFlushDelayNS;
+
+  public:
+	RegistryStore();
+	virtual ~RegistryStore();
+
+	/// @brief sets the folder the registry lives in, flushing the old one if it changed
+	/// @param theDir
+	void SetDir(const std::string &theDir);
+	/// @brief sets the file format used for saving
+	///
+	/// loading falls back to the other format, so switching migrates the old file.
+	/// @param theFormat
+	void SetFormat(Format theFormat);
+
+	/// @brief gets a value
+	/// @param theValueName
+	/// @param theValue receives a copy of the value
+	/// @return false if there's no such value
+	bool Read(const std::string &theValueName, nlohmann::json *theValue);
+	/// @brief sets a value and marks the store dirty
+	/// @param theValueName
+	/// @param theValue
+	void Write(const std::string &theValueName, const nlohmann::json &theValue);
+	/// @brief removes a value
+	/// @param theValueName
+	/// @return true if it existed
+	bool Erase(const std::string &theValueName);
+	/// @brief removes every value and deletes the files
+	/// @return true if success
+	bool Clear();
+
+	/// @brief flushes in the background once the flush delay passed, call once per update
+	void Update();
+	/// @brief writes the store if dirty
+	/// @param waitForIt if false the file is written on a background thread
+	/// @return false if a synchronous write failed
+	bool Flush(bool waitForIt = true);
+	/// @brief are there writes that haven't been flushed yet?
+	/// @return true if yes
+	bool IsDirty();
+
+  protected:
+	CritSect mCritSect;
+	std::string mDir;
+	Format mFormat;
+	nlohmann::json mRoot;
+	bool mLoaded;
+	bool mDirty;
+	uint64_t mLastWriteNS;
+	std::thread mFlushThread;
+	std::atomic<bool> mFlushFailed;
+
+	void Load();
+	std::string GetFileName(Format theFormat) const;
+	void WaitForFlush();
+	static bool WriteFileAtomic(const std::string &theFileName, const std::vector<uint8_t> &theData);
+};
+
+} // namespace PopLib
+
+#endif
@@ -15,7 +15,7 @@ WorkerThread::~WorkerThread()
 {
 	SDL_LockMutex(mMutex);
 	mStopped = true;
-	SDL_SignalCondition(mCond);
+	SDL_BroadcastCondition(mCond);
 	SDL_UnlockMutex(mMutex);
 
 	SDL_WaitThread(mThread, nullptr);
@@ -29,7 +29,7 @@ void WorkerThread::DoTask(void (*task)(void *), void *arg)
 	mTask = task;
 	mTaskArg = arg;
 	mTaskPending = true;
-	SDL_SignalCondition(mCond);
+	SDL_BroadcastCondition(mCond);
 	SDL_UnlockMutex(mMutex);
 }
 
@@ -76,7 +76,6 @@ void WorkerThread::ThreadProc()
 
 		void (*task)(void *) = mTask;
 		void *arg = mTaskArg;
-		mTaskPending = false;
 		SDL_UnlockMutex(mMutex);
 
 		if (task)
@@ -84,8 +83,10 @@ void WorkerThread::ThreadProc()
 			task(arg);
 		}
 
+		// the task stays pending until it has run, so WaitForTask doesn't return while it's still going
 		SDL_LockMutex(mMutex);
-		SDL_SignalCondition(mCond);
+		mTaskPending = false;
+		SDL_BroadcastCondition(mCond);
 		SDL_UnlockMutex(mMutex);
 	}
 }
\ No newline at end of file
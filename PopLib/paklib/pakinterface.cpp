@@ -260,6 +260,19 @@ int PakInterface::FEof(PFILE *pf)
 	return pf->mRecord ? pf->mPos >= pf->mRecord->mSize : feof(pf->mFP);
 }
 
+bool PakInterface::Map(const char *fn, const uint8_t **data, size_t *size)
+{
+	auto it = mPakRecordMap.find(toupper(string(fn)));
+	if (it == mPakRecordMap.end())
+		return false;
+
+	// collections are never unloaded, so the record's bytes can be handed out as they are
+	PakRecord &r = it->second;
+	*data = r.mCollection->data() + r.mStartPos;
+	*size = r.mSize;
+	return true;
+}
+
 #ifdef _WIN32
 #undef FindFirstFile
 #undef FindNextFile
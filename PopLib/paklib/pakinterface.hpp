@@ -139,6 +139,10 @@ class PakInterfaceBase
 	{
 		return false;
 	}
+	virtual bool Map(const char *fn, const uint8_t **data, std::size_t *size)
+	{
+		return false;
+	}
 
 	virtual PFindData FindFirstFile(const std::string &pattern)
 	{
@@ -174,6 +178,7 @@ class PakInterface : public PakInterfaceBase
 	int UnGetC(int c, PFILE *pf) override;
 	char *FGetS(char *str, int size, PFILE *pf) override;
 	int FEof(PFILE *pf) override;
+	bool Map(const char *fn, const uint8_t **data, std::size_t *size) override;
 
 	PFindData FindFirstFile(const std::string &pattern) override;
 	bool FindNextFile(PFindData &fd, std::string &outName) override;
@@ -270,6 +275,21 @@ inline bool p_feof(PFILE *pf)
 	return feof(pf->mFP) != 0;
 }
 
+/// @brief finds a file inside a pak without copying it
+///
+/// the data is the pak's own, it stays valid as long as gPakInterface does.
+/// loose files aren't looked at, MappedFile maps those.
+/// @param theFileName
+/// @param theData set to the first byte of the file
+/// @param theSize set to its size in bytes
+/// @return false if no pak has the file
+inline bool p_map(const char *theFileName, const uint8_t **theData, std::size_t *theSize)
+{
+	if (!gPakInterface)
+		return false;
+	return gPakInterface->Map(theFileName, theData, theSize);
+}
+
 inline PFindData p_FindFirstFile(const std::string &pattern)
 {
 	std::filesystem::path p(pattern);
@@ -1,5 +1,6 @@
 #include "descparser.hpp"
 #include "paklib/pakinterface.hpp"
+#include "misc/mappedfile.hpp"
 
 using namespace PopLib;
 
@@ -427,13 +428,18 @@ bool DescParser::LoadDescriptor(const std::string &theFileName)
 
 	mError.clear();
 
-	PFILE *aStream = p_fopen(theFileName.c_str(), "r");
-	if (!aStream)
+	// read straight out of the pak or the mapped file instead of a character at a time through the pak interface
+	MappedFile aFile;
+	if (!aFile.Open(theFileName))
 		return false;
 
+	const char *aData = (const char *)aFile.GetData();
+	size_t aSize = aFile.GetSize();
+	size_t aPos = 0;
+
 	char aBuffChar = 0;
 
-	while (!p_feof(aStream))
+	while (aPos < aSize || aBuffChar != 0)
 	{
 		int aChar;
 
@@ -453,9 +459,9 @@ bool DescParser::LoadDescriptor(const std::string &theFileName)
 			}
 			else
 			{
-				aChar = p_fgetc(aStream);
-				if (aChar == EOF)
+				if (aPos >= aSize)
 					break;
+				aChar = (uchar)aData[aPos++];
 			}
 
 			if (aChar != '\r')
@@ -540,6 +546,5 @@ bool DescParser::LoadDescriptor(const std::string &theFileName)
 	mCurrentLine.clear();
 	mCurrentLineNum = 0;
 
-	p_fclose(aStream);
 	return !hasErrors;
 }
@@ -1,5 +1,6 @@
 #include "jsonparser.hpp"
 #include "paklib/pakinterface.hpp"
+#include "misc/mappedfile.hpp"
 
 using namespace PopLib;
 
@@ -21,38 +22,23 @@ bool JsonParser::OpenFile(const std::string &theFilename)
 	mHasFailed = false;
 	mErrorText.clear();
 
-	PFILE *pf = p_fopen(theFilename.c_str(), "rb");
-	if (!pf)
+	// parsed straight out of the pak or the mapped file
+	MappedFile aFile;
+	if (!aFile.Open(theFilename))
 	{
 		Fail("Failed to open file: " + theFilename);
 		return false;
 	}
 
-	// determine file size
-	p_fseek(pf, 0, SEEK_END);
-	long size = p_ftell(pf);
-	p_fseek(pf, 0, SEEK_SET);
-
-	if (size <= 0)
+	if (aFile.GetSize() == 0)
 	{
-		p_fclose(pf);
 		Fail("Empty or unreadable file: " + theFilename);
 		return false;
 	}
 
-	std::string jsonText(size, '\0');
-	std::size_t readCount = p_fread(&jsonText[0], 1, size, pf);
-	p_fclose(pf);
-
-	if (readCount != static_cast<std::size_t>(size))
-	{
-		Fail("Failed to read complete file: " + theFilename);
-		return false;
-	}
-
 	try
 	{
-		mJson = nlohmann::json::parse(jsonText);
+		mJson = nlohmann::json::parse(aFile.GetData(), aFile.GetData() + aFile.GetSize());
 	}
 	catch (const nlohmann::json::parse_error &e)
 	{
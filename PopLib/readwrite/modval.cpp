@@ -1,6 +1,15 @@
 #include "modval.hpp"
 #include "common.hpp"
+#include "misc/autocrit.hpp"
+#include "misc/workerthread.hpp"
+
+#include <atomic>
+#include <charconv>
 #include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+using namespace PopLib;
 
 struct ModStorage
 {
@@ -12,36 +21,91 @@ struct ModStorage
 
 struct ModPointer
 {
-	const char *mStrPtr;
+	ModStorage *mStorage;
 	int mLineNum;
 
-	ModPointer() : mStrPtr(NULL), mLineNum(0)
-	{
-	}
-	ModPointer(const char *theStrPtr, int theLineNum) : mStrPtr(theStrPtr), mLineNum(theLineNum)
+	ModPointer() : mStorage(NULL), mLineNum(0)
 	{
 	}
 };
 
 typedef std::map<int, ModPointer> ModStorageMap; // stores counters
 
+// where an M( is in the source
+struct ModIndexEntry
+{
+	int mLineNum;
+	int mColumn;
+	uint32_t mOffset; // of the value, just past the '('
+};
+
+typedef std::vector<ModIndexEntry> ModIndex;
+
 struct FileMod
 {
 	bool mHasMods;
 	ModStorageMap mMap;
+	time_t mFileTime;	// of the file mIndex was built from, 0 for not built yet
+	ModIndex mIndex;
+	bool mNewCounters; // M()s seen since mIndex was built, their values weren't read yet
 
 	FileMod(bool hasMods = false)
 	{
 		mHasMods = hasMods;
+		mFileTime = 0;
+		mNewCounters = false;
 	}
 };
 
+struct ModValue
+{
+	int mCounter;
+	int mInt;
+	double mDouble;
+	std::string mString;
+};
+
+// one file being reread on a worker thread, it only touches its own members
+struct ModReparseJob
+{
+	std::string mFileName;
+	time_t mFileTime;
+	bool mRebuildIndex;
+	ModIndex mIndex;							 // the index to use, or the rebuilt one
+	std::vector<std::pair<int, int>> mCounters; // counter and line number, by counter
+	std::vector<ModValue> mValues;
+	std::string mError;
+};
+
 typedef std::map<std::string, int> StringToIntMap;
 typedef std::map<std::string, FileMod> FileModMap;
+typedef std::unordered_map<const char *, ModStorage *> ModStringMap;
+
+struct ModReparse
+{
+	std::vector<WorkerThread *> mWorkers;
+	int mNumBusy; // workers given the current reparse
+	std::vector<ModReparseJob> mJobs;
+	std::atomic<int> mNextJob;
+	StringToIntMap mEnums; // copied for the workers
+	bool mRunning;
+	bool mReparseAgain; // asked for while running
+
+	ModReparse() : mNumBusy(0), mNextJob(0), mRunning(false), mReparseAgain(false)
+	{
+	}
+
+	~ModReparse()
+	{
+		for (WorkerThread *aWorker : mWorkers)
+			delete aWorker;
+	}
+};
+
+static const char gModValPrefix[] = "POPLIB_POPLIBMODVAL";
+static const int gMaxReparseThreads = 4;
 
 static StringToIntMap gStringToIntMap;
-time_t gLastFileTime = 0;
-const char *gSampleString = NULL; // for finding the others
 
 static FileModMap &GetFileModMap()
 {
@@ -49,24 +113,24 @@ static FileModMap &GetFileModMap()
 	return aMap;
 }
 
-static const char *FindFileInStringTable(const std::string &theSearch, const char *theMem, uint32_t theLength,
-										 const char *theStartPos)
+// the storage of every M() string seen, so each one is parsed once
+static ModStringMap &GetModStringMap()
 {
-	const char *aFind = NULL;
-	try
-	{
-		aFind = std::search(theStartPos, theMem + theLength, theSearch.c_str(), theSearch.c_str() + theSearch.length());
-		if (aFind >= theMem + theLength)
-			return NULL;
-		else
-			return aFind;
-	}
-	catch (...)
-	{
-		return NULL;
-	}
+	static ModStringMap aMap;
+	return aMap;
+}
 
-	return NULL;
+// guards the maps above, M() can be used off the main thread
+static CritSect &GetModCritSect()
+{
+	static CritSect aCritSect;
+	return aCritSect;
+}
+
+static ModReparse &GetModReparse()
+{
+	static ModReparse aReparse;
+	return aReparse;
 }
 
 static bool ParseModValString(std::string &theStr, int *theCounter = NULL, int *theLineNum = NULL)
@@ -102,119 +166,52 @@ static bool ParseModValString(std::string &theStr, int *theCounter = NULL, int *
 	return true;
 }
 
-static bool FindModValsInMemoryHelper(const char *theMem, uint32_t theLength)
+static ModStorage *CreateFileMods(const char *theFileName)
 {
-	std::string aSearchStr = "POPLIBMODVAL";
+	ModStorage *&aModStorage = GetModStringMap()[theFileName];
 
-	FileModMap &aMap = GetFileModMap();
-
-	bool foundOne = false;
-	const char *aPtr = theMem;
-	while (true)
+	std::string aFileName = theFileName + sizeof(gModValPrefix) - 1; // skip POPLIB_POPLIBMODVAL
+	int aCounter, aLineNum;
+	if (!ParseModValString(aFileName, &aCounter, &aLineNum))
 	{
-		aPtr = FindFileInStringTable(aSearchStr, theMem, theLength, aPtr);
-		if (!aPtr)
-			break;
-
-		int aCounter, aLineNum;
-		std::string aFileName = aPtr + 10; // skip POPLIBMODVAL
-		if (ParseModValString(aFileName, &aCounter, &aLineNum))
-		{
-
-			FileMod &aFileMod = aMap[aFileName];
-			aFileMod.mMap[aCounter] = ModPointer(aPtr - 5, aLineNum);
-			foundOne = true;
-		}
-		aPtr++;
+		aModStorage = new ModStorage;
+		aModStorage->mChanged = false;
+		return aModStorage;
 	}
 
-	return foundOne;
-}
-
-static void FindModValsInMemory()
-{
-	/*
-	MEMORY_BASIC_INFORMATION mbi;
-	PVOID      pvAddress = 0;
-
-	const char *aMem = NULL;
-	DWORD aMemLength = 0;
-
-	int aFound = 0;
-	int aTotal = 0;
-	memset(&mbi, 0, sizeof(MEMORY_BASIC_INFORMATION));
-	for (; VirtualQuery(pvAddress, &mbi, sizeof(MEMORY_BASIC_INFORMATION)) == sizeof(MEMORY_BASIC_INFORMATION);
-	pvAddress = ((BYTE*)mbi.BaseAddress) + mbi.RegionSize)
-	{
-		const char *anAddress = (const char*)mbi.BaseAddress;
-		if (mbi.State==MEM_COMMIT && mbi.Type==MEM_IMAGE)
-		{
-			aTotal++;
-			if (aMem!=NULL && aMem+aMemLength==anAddress) // compact these two
-			{
-				aMemLength += mbi.RegionSize;
-				continue;
-			}
-
-			if (aMem!=NULL) // do find in old section
-			{
-				if (FindModValsInMemoryHelper(aMem,aMemLength))
-				{
-					aFound++;
-					return;
-				}
+	FileMod &aFileMod = GetFileModMap()[aFileName];
+	aFileMod.mHasMods = true;
 
-				aMem = NULL;
-			}
-
-			aMem = anAddress;
-			aMemLength = mbi.RegionSize;
-		}
-	}
-
-	if (aMem!=NULL)
+	// another copy of the same string shares the storage
+	ModPointer &aModPointer = aFileMod.mMap[aCounter];
+	if (aModPointer.mStorage == NULL)
 	{
-		if (FindModValsInMemoryHelper(aMem,aMemLength))
-			aFound++;
+		aModPointer.mStorage = new ModStorage;
+		aModPointer.mStorage->mChanged = false;
+		aModPointer.mLineNum = aLineNum;
+		if (aFileMod.mFileTime != 0)
+			aFileMod.mNewCounters = true;
 	}
-	*/
-}
 
-static ModStorage *CreateFileModsHelper(const char *theFileName)
-{
-	ModStorage *aModStorage = new ModStorage;
-	aModStorage->mChanged = false;
-	/*
-	// Change this thinggie
-	DWORD anOldProtect;
-	VirtualProtect((LPVOID) theFileName, 5, PAGE_READWRITE, &anOldProtect);
-	*((char*) theFileName) = 0;
-	*((ModStorage**) (theFileName+1)) = aModStorage;
-	VirtualProtect((LPVOID) theFileName, 5, anOldProtect, &anOldProtect);
-	*/
+	aModStorage = aModPointer.mStorage;
 	return aModStorage;
 }
 
-static ModStorage *CreateFileMods(const char *theFileName)
+static ModStorage *GetFileMods(const char *theFileName)
 {
-	if (!gSampleString)
-		gSampleString = theFileName;
+	ModStringMap &aMap = GetModStringMap();
+	ModStringMap::iterator anItr = aMap.find(theFileName);
+	if (anItr != aMap.end())
+		return anItr->second;
 
-	std::string aFileName = theFileName + 15; // skip POPLIB_POPLIBMODVAL
-	ParseModValString(aFileName);
-
-	FileModMap &aMap = GetFileModMap();
-	aMap[aFileName].mHasMods = true;
-
-	return CreateFileModsHelper(theFileName);
+	return CreateFileMods(theFileName);
 }
 
 int PopLib::ModVal(int theAreaNum, const char *theFileName, int theInt)
 {
-	if (*theFileName != 0)
-		CreateFileMods(theFileName);
+	AutoCrit anAutoCrit(GetModCritSect());
 
-	ModStorage *aModStorage = *(ModStorage **)(theFileName + 1);
+	ModStorage *aModStorage = GetFileMods(theFileName);
 	if (aModStorage->mChanged)
 		return aModStorage->mInt;
 	else
@@ -223,10 +220,9 @@ int PopLib::ModVal(int theAreaNum, const char *theFileName, int theInt)
 
 double PopLib::ModVal(int theAreaNum, const char *theFileName, double theDouble)
 {
-	if (*theFileName != 0)
-		CreateFileMods(theFileName);
+	AutoCrit anAutoCrit(GetModCritSect());
 
-	ModStorage *aModStorage = *(ModStorage **)(theFileName + 1);
+	ModStorage *aModStorage = GetFileMods(theFileName);
 	if (aModStorage->mChanged)
 		return aModStorage->mDouble;
 	else
@@ -240,155 +236,104 @@ float PopLib::ModVal(int theAreaNum, const char *theFileName, float theFloat)
 
 const char *PopLib::ModVal(int theAreaNum, const char *theFileName, const char *theStr)
 {
-	if (*theFileName != 0)
-		CreateFileMods(theFileName);
+	AutoCrit anAutoCrit(GetModCritSect());
 
-	ModStorage *aModStorage = *(ModStorage **)(theFileName + 1);
+	ModStorage *aModStorage = GetFileMods(theFileName);
 	if (aModStorage->mChanged)
 		return aModStorage->mString.c_str();
 	else
 		return theStr;
 }
 
+void PopLib::GetModValFileNames(std::vector<std::string> *theFileNames)
+{
+	AutoCrit anAutoCrit(GetModCritSect());
+
+	FileModMap &aMap = GetFileModMap();
+	for (FileModMap::iterator anItr = aMap.begin(); anItr != aMap.end(); ++anItr)
+	{
+		if (anItr->second.mHasMods)
+			theFileNames->push_back(anItr->first);
+	}
+}
+
 void PopLib::AddModValEnum(const std::string &theEnumName, int theVal)
 {
 	gStringToIntMap[theEnumName] = theVal;
 }
 
-static bool ModStringToInteger(const char *theString, int *theIntVal)
+static bool ModStringAtEnd(const char *theString, const char *theEnd)
 {
-	*theIntVal = 0;
+	while (theString < theEnd && (*theString == ' ' || *theString == '\t'))
+		theString++;
 
-	int theRadix = 10;
-	bool isNeg = false;
+	return theString < theEnd && *theString == ')';
+}
 
-	unsigned i = 0;
+static bool ModStringToInteger(const char *theString, const char *theEnd, const StringToIntMap &theEnums,
+							   int *theIntVal)
+{
+	*theIntVal = 0;
 
-	if (isalpha((unsigned char)theString[i]) || theString[i] == '_') // enum
+	const char *aPtr = theString;
+	if (isalpha((unsigned char)*aPtr) || *aPtr == '_') // enum
 	{
+		const char *anEnumEnd = aPtr;
+		while (anEnumEnd < theEnd && (isalnum((unsigned char)*anEnumEnd) || *anEnumEnd == '_'))
+			anEnumEnd++;
 
-		std::string aStr;
-		while (isalnum((unsigned char)theString[i]) || theString[i] == '_')
-		{
-			aStr += theString[i];
-			i++;
-		}
-
-		StringToIntMap::iterator anItr = gStringToIntMap.find(aStr);
-		if (anItr != gStringToIntMap.end())
+		StringToIntMap::const_iterator anItr = theEnums.find(std::string(aPtr, anEnumEnd));
+		if (anItr != theEnums.end())
 		{
 			*theIntVal = anItr->second;
 			return true;
 		}
 
-		i = 0;
+		return false;
 	}
 
-	if (theString[i] == '-')
+	bool isNeg = false;
+	if (*aPtr == '-')
 	{
 		isNeg = true;
-		i++;
+		aPtr++;
 	}
 
-	for (;;)
+	int aRadix = 10;
+	if (theEnd - aPtr >= 2 && aPtr[0] == '0' && (aPtr[1] == 'x' || aPtr[1] == 'X'))
 	{
-		char aChar = theString[i];
+		aRadix = 0x10;
+		aPtr += 2;
+	}
 
-		if ((theRadix == 10) && (aChar >= '0') && (aChar <= '9'))
-			*theIntVal = (*theIntVal * 10) + (aChar - '0');
-		else if ((theRadix == 0x10) && (((aChar >= '0') && (aChar <= '9')) || ((aChar >= 'A') && (aChar <= 'F')) ||
-										((aChar >= 'a') && (aChar <= 'f'))))
-		{
-			if (aChar <= '9')
-				*theIntVal = (*theIntVal * 0x10) + (aChar - '0');
-			else if (aChar <= 'F')
-				*theIntVal = (*theIntVal * 0x10) + (aChar - 'A') + 0x0A;
-			else
-				*theIntVal = (*theIntVal * 0x10) + (aChar - 'a') + 0x0A;
-		}
-		else if (((aChar == 'x') || (aChar == 'X')) && (i == 1) && (*theIntVal == 0))
-		{
-			theRadix = 0x10;
-		}
-		else if (aChar == ')')
-		{
-			if (isNeg)
-				*theIntVal = -*theIntVal;
-			return true;
-		}
-		else
-		{
-			*theIntVal = 0;
-			return false;
-		}
+	// unsigned, so 0xFFFFFFFF wraps around like it does in the source
+	unsigned int aValue = 0;
+	std::from_chars_result aResult = std::from_chars(aPtr, theEnd, aValue, aRadix);
+	if (aResult.ec != std::errc() || !ModStringAtEnd(aResult.ptr, theEnd))
+		return false;
 
-		i++;
-	}
+	*theIntVal = isNeg ? -(int)aValue : (int)aValue;
+	return true;
 }
 
-static bool ModStringToDouble(const char *theString, double *theDoubleVal)
+static bool ModStringToDouble(const char *theString, const char *theEnd, double *theDoubleVal)
 {
 	*theDoubleVal = 0.0;
 
-	bool isNeg = false;
-
-	unsigned i = 0;
-	if (theString[i] == '-')
-	{
-		isNeg = true;
-		i++;
-	}
-
-	for (;;)
-	{
-		char aChar = theString[i];
-
-		if ((aChar >= '0') && (aChar <= '9'))
-			*theDoubleVal = (*theDoubleVal * 10) + (aChar - '0');
-		else if (aChar == '.')
-		{
-			i++;
-			break;
-		}
-		else if ((aChar == ')') || ((aChar == 'f') && (theString[i + 1] == ')'))) // At end
-		{
-			if (isNeg)
-				*theDoubleVal = -*theDoubleVal;
-			return true;
-		}
-		else
-		{
-			*theDoubleVal = 0.0;
-			return false;
-		}
-
-		i++;
-	}
+	double aValue = 0.0;
+	std::from_chars_result aResult = std::from_chars(theString, theEnd, aValue);
+	if (aResult.ec != std::errc())
+		return false;
 
-	double aMult = 0.1;
-	for (;;)
-	{
-		char aChar = theString[i];
+	const char *aPtr = aResult.ptr;
+	if (aPtr < theEnd && (*aPtr == 'f' || *aPtr == 'F'))
+		aPtr++;
 
-		if ((aChar >= '0') && (aChar <= '9'))
-		{
-			*theDoubleVal += (aChar - '0') * aMult;
-			aMult /= 10.0;
-		}
-		else if ((aChar == ')') || ((aChar == 'f') && (theString[i + 1] == ')'))) // At end
-		{
-			if (isNeg)
-				*theDoubleVal = -*theDoubleVal;
-			return true;
-		}
-		else
-		{
-			*theDoubleVal = 0.0;
-			return false;
-		}
+	if (!ModStringAtEnd(aPtr, theEnd))
+		return false;
 
-		i++;
-	}
+	*theDoubleVal = aValue;
+	return true;
 }
 
 static bool ModStringToString(const char *theString, std::string &theStrVal)
@@ -443,243 +388,314 @@ static bool ModStringToString(const char *theString, std::string &theStrVal)
 	return true;
 }
 
-bool PopLib::ReparseModValues()
+// Finds every M( and M1( through M9( outside of strings and comments
+static bool BuildModIndex(const std::string &theSource, ModIndex &theIndex, std::string &theError)
 {
-	/*
-	if (gLastFileTime == 0)
-	{
-		char anEXEName[256];
-		GetModuleFileNameA(NULL, anEXEName, 256);
-		gLastFileTime = GetFileDate(anEXEName);
-
-		FindModValsInMemory();
-	}
+	theIndex.clear();
 
-	bool hasNewFiles = false;
-	std::string aFileList;
+	const char *aSource = theSource.c_str();
+	int aLength = (int)theSource.length();
+	int aLineNum = 1;
+	int aLineStart = 0;
 
-	// Process each file one at a time
-	FileModMap &aMap = GetFileModMap();
-	FileModMap::iterator aFileModItr;
-	for (aFileModItr = aMap.begin(); aFileModItr != aMap.end(); ++aFileModItr)
+	for (int i = 0; i < aLength; i++)
 	{
-		FileMod &aFileMod = aFileModItr->second;
-		if (!aFileMod.mHasMods)
-			continue;
+		char aChar = aSource[i];
 
-		ModStorageMap &aModMap = aFileMod.mMap;
-		std::string aFileName = aFileModItr->first;
-
-		time_t aThisTime = GetFileDate(aFileName);
-		if (aThisTime > gLastFileTime)
+		if (aChar == '\n')
 		{
-			gLastFileTime = aThisTime;
-			hasNewFiles = true;
+			aLineNum++;
+			aLineStart = i + 1;
 		}
-
-		if (aFileList.length() > 0)
-			aFileList += "\n  ";
-		aFileList += aFileName;
-
-		int aLineNum = 1;
-		int aModNum = 0;
-		ModStorageMap::iterator aModMapItr = aModMap.begin();
-
-		std::fstream aStream(aFileName.c_str(), std::ios::in);
-
-		if (aStream.is_open())
+		else if (aChar == '"' || (aChar == '\'' && (i == 0 || !isalnum((unsigned char)aSource[i - 1])))) // Skip strings
 		{
-			while (!aStream.eof())
+			int aStartLine = aLineNum;
+			for (i++; i < aLength && aSource[i] != aChar; i++)
 			{
-				char aString[8192];
-				aStream.getline(aString, 8192);
-
-				int aCharIdx = 0;
-				int aChar = 0;
-				int aLastChar = 0;
-				while (aString[aCharIdx] != 0)
+				if (aSource[i] == '\\' && i + 1 < aLength)
 				{
-					aLastChar = aChar;
-					aChar = aString[aCharIdx];
+					i++; // so we don't interpret \\" as an escaped quote
+					if (aSource[i] == '\r' && i + 1 < aLength && aSource[i + 1] == '\n')
+						i++;
 
-					if (aChar == '"')  // Skip strings
+					if (aSource[i] == '\n') // continuation
 					{
-						while (true)
-						{
-							aLastChar = aChar;
-							aChar = aString[++aCharIdx];
-
-							if (aChar=='\\' && aLastChar=='\\') // so we don't interpret \\" as an escaped quote
-								aChar = 0;
-							else if (aChar=='"' && aLastChar!='\\')
-								break;
-							else if (aChar==0)
-							{
-								if (aLastChar=='\\') // continuation
-								{
-									aCharIdx = -1;
-									aChar = 0;
-									aLastChar = 0;
-									aLineNum++;
-
-									aStream.getline(aString, 8192);
-									if (aString[0]!=0 || !aStream.eof()) // got valid new line
-										continue;
-								}
-
-								char aStr[512];
-								sprintf(aStr, "ERROR in %s on line %d: Error parsing quotes", aFileName.c_str(),
-	aLineNum); MessageBoxA(NULL, aStr, "MODVAL ERROR", MB_OK | MB_ICONERROR); return false;
-							}
-						}
+						aLineNum++;
+						aLineStart = i + 1;
 					}
-					else if (aChar=='/') // Skip C++ comments
-					{
-						if (aLastChar=='/')
-						{
-
-							while (true)
-							{
-								aLastChar = aChar;
-								aChar = aString[++aCharIdx];
-								if (aChar==0) // line continuation
-								{
-									if (aLastChar=='\\') // continuation
-									{
-										aCharIdx = -1;
-										aChar = 0;
-										aLastChar = 0;
-										aLineNum++;
-
-										aStream.getline(aString, 8192);
-										if (aString[0]!=0 || !aStream.eof()) // got valid new line
-											continue;
-									}
-									else
-									{
-										aCharIdx--;
-										break;
-									}
-
-									char aStr[512];
-									sprintf(aStr, "ERROR in %s on line %d: Error parsing c++ comment",
-	aFileName.c_str(), aLineNum); MessageBoxA(NULL, aStr, "MODVAL ERROR", MB_OK | MB_ICONERROR); return false;
-								}
-							}
-						}
-					}
-					else if (aChar=='*') // skip C comments
-					{
-						if (aLastChar=='/')
-						{
-							while (true)
-							{
-								aLastChar = aChar;
-								aChar = aString[++aCharIdx];
-								if (aChar=='/' && aLastChar=='*')
-									break;
-								else if (aChar==0) // line continuation
-								{
-									aCharIdx = -1;
-									aChar = 0;
-									aLastChar = 0;
-									aLineNum++;
-
-									aStream.getline(aString, 8192);
-									if (aString[0]!=0 || !aStream.eof()) // got valid new line
-										continue;
-
-									char aStr[512];
-									sprintf(aStr, "ERROR in %s on line %d: Error parsing c comment", aFileName.c_str(),
-	aLineNum); MessageBoxA(NULL, aStr, "MODVAL ERROR", MB_OK | MB_ICONERROR); return false;
-								}
-							}
-						}
-					}
-					else if (aChar == '(')
+				}
+				else if (aSource[i] == '\n')
+				{
+					theError = StrFormat("line %d: Error parsing quotes", aStartLine);
+					return false;
+				}
+			}
+
+			if (i >= aLength)
+			{
+				theError = StrFormat("line %d: Error parsing quotes", aStartLine);
+				return false;
+			}
+		}
+		else if (aChar == '/' && i + 1 < aLength && aSource[i + 1] == '/') // Skip C++ comments
+		{
+			for (i += 2; i < aLength; i++)
+			{
+				if (aSource[i] == '\n')
+				{
+					bool isContinued = aSource[i - 1] == '\\' || (aSource[i - 1] == '\r' && aSource[i - 2] == '\\');
+					if (!isContinued)
 					{
-						int theAreaNum = -1;
-						if ((aCharIdx >= 2) && (aString[aCharIdx-1] == 'M') &&
-							(!isalpha((unsigned char) aString[aCharIdx-2])))
-						{
-							theAreaNum = 0;
-						}
-						else if ((aCharIdx >= 3) &&
-							(aString[aCharIdx-1] >= '1') && (aString[aCharIdx-1] <= '9') &&
-							(aString[aCharIdx-2] == 'M') &&
-							(!isalpha((unsigned char) aString[aCharIdx-3])))
-						{
-							theAreaNum = aString[aCharIdx-1] - '0';
-						}
-
-						if (theAreaNum != -1)
-						{
-							while (aModMapItr!=aModMap.end() && aModMapItr->second.mLineNum<aLineNum)
-								++aModMapItr;
-
-							if (aModMapItr!=aModMap.end() && aModMapItr->second.mLineNum==aLineNum)
-							{
-								const char *aPtr = aModMapItr->second.mStrPtr;
-								aModMapItr++;
-
-								int anIntVal = 0;
-								double aDoubleVal = 0.0;
-								std::string aStrVal;
-
-								// Try to parse out a number
-								if ((ModStringToString(aString + aCharIdx + 1, aStrVal)) ||
-									(ModStringToInteger(aString + aCharIdx + 1, &anIntVal)) ||
-									(ModStringToDouble(aString + aCharIdx + 1, &aDoubleVal)))
-								{
-									// We found a mod value!
-
-									if (*aPtr!=0) // have stored something here
-										CreateFileMods(aPtr);
-
-									ModStorage* aModStorage = *(ModStorage**)(aPtr+1);
-									aModStorage->mInt = anIntVal;
-									aModStorage->mDouble = aDoubleVal;
-									aModStorage->mString = aStrVal;
-									aModStorage->mChanged = true;
-								}
-								else
-								{
-									char aStr[512];
-									sprintf(aStr, "ERROR in %s on line %d.  Parsing Error.", aFileName.c_str(),
-	aLineNum); MessageBoxA(NULL, aStr, "MODVAL ERROR", MB_OK | MB_ICONERROR);
-
-									return false;
-								}
-							}
-							else
-							{
-								// Functions can be optimized out
-							}
-						}
+						i--; // the newline is counted above
+						break;
 					}
 
-					aCharIdx++;
+					aLineNum++;
+					aLineStart = i + 1;
+				}
+			}
+		}
+		else if (aChar == '/' && i + 1 < aLength && aSource[i + 1] == '*') // skip C comments
+		{
+			int aStartLine = aLineNum;
+			for (i += 2; i < aLength && !(aSource[i] == '*' && i + 1 < aLength && aSource[i + 1] == '/'); i++)
+			{
+				if (aSource[i] == '\n')
+				{
+					aLineNum++;
+					aLineStart = i + 1;
 				}
+			}
+
+			if (i >= aLength)
+			{
+				theError = StrFormat("line %d: Error parsing c comment", aStartLine);
+				return false;
+			}
+
+			i++; // the '/'
+		}
+		else if (aChar == '(')
+		{
+			int aNamePos = i - 1;
+			if (aNamePos >= 0 && aSource[aNamePos] >= '1' && aSource[aNamePos] <= '9')
+				aNamePos--;
 
-				aLineNum++;
+			if (aNamePos >= 0 && aSource[aNamePos] == 'M' &&
+				(aNamePos == 0 || !(isalnum((unsigned char)aSource[aNamePos - 1]) || aSource[aNamePos - 1] == '_')))
+			{
+				ModIndexEntry anEntry;
+				anEntry.mLineNum = aLineNum;
+				anEntry.mColumn = aNamePos - aLineStart + 1;
+				anEntry.mOffset = i + 1;
+				theIndex.push_back(anEntry);
 			}
 		}
+	}
+
+	return true;
+}
+
+static void RunReparseJob(ModReparseJob &theJob, const StringToIntMap &theEnums)
+{
+	std::ifstream aStream(theJob.mFileName.c_str(), std::ios::in | std::ios::binary);
+	if (!aStream.is_open())
+	{
+		theJob.mError = "Unable to open the file for reparsing";
+		return;
+	}
+
+	std::stringstream aContents;
+	aContents << aStream.rdbuf();
+	std::string aSource = aContents.str();
+
+	if (theJob.mRebuildIndex && !BuildModIndex(aSource, theJob.mIndex, theJob.mError))
+		return;
+
+	// the string of each M() only has its line, so the ones on a line go to the M(s there in order
+	const ModIndex &anIndex = theJob.mIndex;
+	const char *aSourceEnd = aSource.c_str() + aSource.length();
+	size_t aCounterIdx = 0;
+	for (const ModIndexEntry &anEntry : anIndex)
+	{
+		while (aCounterIdx < theJob.mCounters.size() && theJob.mCounters[aCounterIdx].second < anEntry.mLineNum)
+			aCounterIdx++;
+
+		if (aCounterIdx == theJob.mCounters.size())
+			break;
+		if (theJob.mCounters[aCounterIdx].second != anEntry.mLineNum)
+			continue; // Functions can be optimized out
+
+		if (anEntry.mOffset > aSource.length())
+		{
+			theJob.mError = StrFormat("line %d: The index is out of date", anEntry.mLineNum);
+			return;
+		}
+
+		const char *aValueStr = aSource.c_str() + anEntry.mOffset;
+		while (*aValueStr == ' ' || *aValueStr == '\t')
+			aValueStr++;
+
+		ModValue aValue;
+		aValue.mCounter = theJob.mCounters[aCounterIdx].first;
+		aValue.mInt = 0;
+		aValue.mDouble = 0.0;
+		aCounterIdx++;
+
+		// Try to parse out a number
+		if (ModStringToString(aValueStr, aValue.mString))
+		{
+		}
+		else if (ModStringToInteger(aValueStr, aSourceEnd, theEnums, &aValue.mInt))
+			aValue.mDouble = aValue.mInt; // in case the M() used to hold a double
+		else if (ModStringToDouble(aValueStr, aSourceEnd, &aValue.mDouble))
+		{
+		}
 		else
 		{
-			MessageBoxA(NULL, (std::string("ERROR: Unable to open ") + aFileName + " for reparsing.").c_str(), "MODVAL
-	ERROR!", MB_OK | MB_ICONERROR); return false;
+			theJob.mError = StrFormat("line %d, column %d: Parsing Error", anEntry.mLineNum, anEntry.mColumn);
+			return;
 		}
+
+		theJob.mValues.push_back(aValue);
+	}
+}
+
+static void ReparseProc(void *theReparse)
+{
+	ModReparse *aReparse = (ModReparse *)theReparse;
+
+	for (;;)
+	{
+		int anIndex = aReparse->mNextJob++;
+		if (anIndex >= (int)aReparse->mJobs.size())
+			break;
+
+		RunReparseJob(aReparse->mJobs[anIndex], aReparse->mEnums);
 	}
+}
 
-	if (!hasNewFiles)
+bool PopLib::ReparseModValues()
+{
+	ModReparse &aReparse = GetModReparse();
+	if (aReparse.mRunning)
+	{
+		aReparse.mReparseAgain = true;
+		return true;
+	}
+
+	std::string aFileList;
+	{
+		AutoCrit anAutoCrit(GetModCritSect());
+
+		// Only files that changed since they were indexed, or have M()s that weren't read yet
+		FileModMap &aMap = GetFileModMap();
+		for (FileModMap::iterator aFileModItr = aMap.begin(); aFileModItr != aMap.end(); ++aFileModItr)
+		{
+			FileMod &aFileMod = aFileModItr->second;
+			if (!aFileMod.mHasMods)
+				continue;
+
+			if (aFileList.length() > 0)
+				aFileList += "\n  ";
+			aFileList += aFileModItr->first;
+
+			time_t aThisTime = GetFileDate(aFileModItr->first);
+			bool isChanged = aFileMod.mFileTime == 0 || aThisTime != aFileMod.mFileTime;
+			if (!isChanged && !aFileMod.mNewCounters)
+				continue;
+
+			aReparse.mJobs.push_back(ModReparseJob());
+			ModReparseJob &aJob = aReparse.mJobs.back();
+			aJob.mFileName = aFileModItr->first;
+			aJob.mFileTime = aThisTime;
+			aJob.mRebuildIndex = isChanged;
+			if (!isChanged)
+				aJob.mIndex = aFileMod.mIndex;
+
+			for (ModStorageMap::iterator anItr = aFileMod.mMap.begin(); anItr != aFileMod.mMap.end(); ++anItr)
+				aJob.mCounters.push_back(std::pair<int, int>(anItr->first, anItr->second.mLineNum));
+		}
+	}
+
+	if (aReparse.mJobs.empty())
 	{
 		if (aFileList.length() == 0)
 			aFileList = "none";
-		MessageBoxA(NULL, (std::string("WARNING: No file changes detected.  Files parsed: \n  ") + aFileList).c_str(),
-	"MODVAL WARNING!", MB_OK | MB_ICONWARNING); return false;
+		SDL_Log("MODVAL WARNING: No file changes detected.  Files parsed: \n  %s\r\n", aFileList.c_str());
+		return false;
 	}
 
+	if (aReparse.mWorkers.empty())
+	{
+		int aNumThreads = std::min(std::max(SDL_GetNumLogicalCPUCores() - 1, 1), gMaxReparseThreads);
+		for (int i = 0; i < aNumThreads; i++)
+			aReparse.mWorkers.push_back(new WorkerThread(StrFormat("ModVal%d", i)));
+	}
+
+	aReparse.mEnums = gStringToIntMap;
+	aReparse.mNextJob = 0;
+	aReparse.mNumBusy = std::min((int)aReparse.mWorkers.size(), (int)aReparse.mJobs.size());
+	aReparse.mRunning = true;
+
+	for (int i = 0; i < aReparse.mNumBusy; i++)
+		aReparse.mWorkers[i]->DoTask(ReparseProc, &aReparse);
+
 	return true;
-	*/
-	return false;
+}
+
+void PopLib::UpdateModValues()
+{
+	ModReparse &aReparse = GetModReparse();
+	if (!aReparse.mRunning)
+		return;
+
+	for (int i = 0; i < aReparse.mNumBusy; i++)
+	{
+		if (aReparse.mWorkers[i]->IsProcessingTask())
+			return;
+	}
+
+	bool hasErrors = false;
+	for (const ModReparseJob &aJob : aReparse.mJobs)
+	{
+		if (!aJob.mError.empty())
+		{
+			SDL_Log("MODVAL ERROR in %s on %s\r\n", aJob.mFileName.c_str(), aJob.mError.c_str());
+			hasErrors = true;
+		}
+	}
+
+	// all or nothing, so the game never runs with half of a change
+	if (!hasErrors)
+	{
+		AutoCrit anAutoCrit(GetModCritSect());
+
+		FileModMap &aMap = GetFileModMap();
+		for (ModReparseJob &aJob : aReparse.mJobs)
+		{
+			FileMod &aFileMod = aMap[aJob.mFileName];
+			aFileMod.mFileTime = aJob.mFileTime;
+			aFileMod.mIndex.swap(aJob.mIndex);
+			aFileMod.mNewCounters = false;
+
+			for (const ModValue &aValue : aJob.mValues)
+			{
+				ModStorage *aModStorage = aFileMod.mMap[aValue.mCounter].mStorage;
+				aModStorage->mInt = aValue.mInt;
+				aModStorage->mDouble = aValue.mDouble;
+				aModStorage->mString = aValue.mString;
+				aModStorage->mChanged = true;
+			}
+		}
+	}
+
+	aReparse.mJobs.clear();
+	aReparse.mRunning = false;
+
+	if (aReparse.mReparseAgain)
+	{
+		aReparse.mReparseAgain = false;
+		ReparseModValues();
+	}
 }
@@ -5,6 +5,7 @@
 #endif
 
 #include <string>
+#include <vector>
 
 /*
  This module allows for dynamic modification of integer and floating-point
@@ -17,6 +18,11 @@
  to contain some trigger such as a key combination to trigger the
  ReparseModValues() call.
 
+ The files are reread on worker threads, and the new values show up all at
+ once from the next UpdateModValues(), which AppBase calls every frame.
+ Only files whose modification time changed are read again, the others
+ keep an index of where each M() is.
+
  Example:
 	x = x + M(2.1);
 
@@ -28,8 +34,8 @@
 
  Performance:
 	There a small setup cost the first time each M() value is accessed
-	after program startup and reparsing, but after that there is just the
-	tiny overhead of a function call and a few vector dereferences.
+	after program startup, but after that there is just the tiny overhead
+	of a function call, a lock and a hash lookup.
 
  */
 
@@ -51,7 +57,7 @@ namespace PopLib
 #define MODVAL_STR_COUNTER2(x, y, z) x #y "," #z
 #define MODVAL_STR_COUNTER1(x, y, z) MODVAL_STR_COUNTER2(x, y, z)
 #define MODVAL_STR_COUNTER(x) MODVAL_STR_COUNTER1(x, __COUNTER__, __LINE__)
-#define M(val) ModVal(0, MODVAL_STR_COUNTER("POPLIB_POPLIBMODVAL"__FILE__), (val))
+#define M(val) ModVal(0, MODVAL_STR_COUNTER("POPLIB_POPLIBMODVAL" __FILE__), (val))
 #define M1(val) M(val)
 #define M2(val) M(val)
 #define M3(val) M(val)
@@ -67,7 +73,9 @@ int ModVal(int theAreaNum, const char *theFileName, int theInt);
 double ModVal(int theAreaNum, const char *theFileName, double theDouble);
 float ModVal(int theAreaNum, const char *theFileName, float theFloat);
 const char *ModVal(int theAreaNum, const char *theFileName, const char *theStr);
-bool ReparseModValues();
+bool ReparseModValues(); // false if no file changed
+void UpdateModValues();	 // applies a finished reparse, main thread only
+void GetModValFileNames(std::vector<std::string> *theFileNames);
 void AddModValEnum(const std::string &theEnumName, int theVal);
 
 } // namespace PopLib
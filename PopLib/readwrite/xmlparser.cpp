@@ -1,6 +1,7 @@
 #include "xmlparser.hpp"
 #include "debug/debug.hpp"
 #include "paklib/pakinterface.hpp"
+#include "misc/mappedfile.hpp"
 
 using namespace PopLib;
 
@@ -50,6 +51,11 @@ bool XMLParser::AddAttribute(XMLElement *theElement, const PopString &theAttribu
 }
 
 bool XMLParser::OpenBuffer(const std::string &theBuffer, const std::string &custom_root)
+{
+	return OpenData(theBuffer.data(), theBuffer.size(), custom_root);
+}
+
+bool XMLParser::OpenData(const char *theData, size_t theSize, const std::string &custom_root)
 {
 	mCurrentNode = nullptr;
 	mSectionStack.clear();
@@ -58,21 +64,23 @@ bool XMLParser::OpenBuffer(const std::string &theBuffer, const std::string &cust
 
 
     // UTF-8 stuff
-    std::string input = theBuffer;
-    if (input.size() >= 3 &&
-        (unsigned char)input[0] == 0xEF &&
-        (unsigned char)input[1] == 0xBB &&
-        (unsigned char)input[2] == 0xBF)
+    if (theSize >= 3 &&
+        (unsigned char)theData[0] == 0xEF &&
+        (unsigned char)theData[1] == 0xBB &&
+        (unsigned char)theData[2] == 0xBF)
     {
-        input = input.substr(3);
+        theData += 3;
+        theSize -= 3;
     }
 
     std::string aNewWrappedBuffer;
 
     if (custom_root != "")
     {
+        std::string_view input(theData, theSize);
+
         // get the declaration so we dont add the custom root before it
-        std::string xmlDecl;
+        std::string_view xmlDecl;
         if (input.find("<?xml") == 0)
         {
             size_t declEnd = input.find("?>");
@@ -85,16 +93,19 @@ bool XMLParser::OpenBuffer(const std::string &theBuffer, const std::string &cust
         }
 
         // Wrap with custom root
-        aNewWrappedBuffer = xmlDecl + "<" + custom_root + ">" + input + "</" + custom_root + ">";
+        aNewWrappedBuffer.reserve(xmlDecl.size() + input.size() + custom_root.size() * 2 + 5);
+        aNewWrappedBuffer.append(xmlDecl);
+        aNewWrappedBuffer += "<" + custom_root + ">";
+        aNewWrappedBuffer.append(input);
+        aNewWrappedBuffer += "</" + custom_root + ">";
+
+        theData = aNewWrappedBuffer.c_str();
+        theSize = aNewWrappedBuffer.size();
     }
-    else
-        aNewWrappedBuffer = input;
-
-    const char* data = aNewWrappedBuffer.c_str();
-    size_t size = aNewWrappedBuffer.size();
 
+    // tinyxml makes its own copy, the data can be the file's
     mDocument = new XMLDocument();
-	XMLError err = mDocument->Parse(data, size);
+	XMLError err = mDocument->Parse(theData, theSize);
 	if (err != XML_SUCCESS) { 
 		std::string anError = mDocument->ErrorStr();
 		Fail("Parse error: " + anError); 
@@ -105,31 +116,15 @@ bool XMLParser::OpenBuffer(const std::string &theBuffer, const std::string &cust
 
 bool XMLParser::OpenFile(const std::string &theFileName, const std::string &custom_root)
 {
-	mFile = p_fopen(theFileName.c_str(), "r");
-
-	if (mFile == NULL)
+	MappedFile aFile;
+	if (!aFile.Open(theFileName))
 	{
 		mLineNum = 0;
 		Fail("Unable to open file " + theFileName);
 		return false;
 	}
 
-	p_fseek(mFile, 0, SEEK_END);
-	long size = p_ftell(mFile);
-	p_fseek(mFile, 0, SEEK_SET);
-
-	if (size <= 0)
-	{
-		p_fclose(mFile);
-		Fail("Empty or unreadable file: " + theFileName);
-		return false;
-	}
-
-	std::string content(size, '\0');
-	p_fread(content.data(), size, 1, mFile);
-
-    OpenBuffer(content, custom_root);
-	return true;
+	return OpenData((const char *)aFile.GetData(), aFile.GetSize(), custom_root);
 }
 
 bool XMLParser::NextElement(XMLElement *theElement)
@@ -76,6 +76,7 @@ class XMLParser
 	void Init();
 
 	bool AddAttribute(XMLElement *theElement, const PopString &aAttributeKey, const PopString &aAttributeValue);
+	bool OpenData(const char *theData, size_t theSize, const std::string &custom_root);
 
   public:
 	XMLParser();
@@ -0,0 +1,433 @@
+#include "hotreloader.hpp"
+#include "resourcemanager.hpp"
+#include "appbase.hpp"
+#include "audio/soundmanager.hpp"
+#include "graphics/imagefont.hpp"
+#include "graphics/sdlimage.hpp"
+#include "graphics/sdlinterface.hpp"
+#include "imagelib/imagelib.hpp"
+#include "misc/autocrit.hpp"
+#include "readwrite/modval.hpp"
+
+#include <SDL3/SDL.h>
+#include <algorithm>
+
+using namespace PopLib;
+
+HotReloader::HotReloader(AppBase *theApp)
+{
+	mApp = theApp;
+	mRefreshIntervalMS = 2000;
+	mNextRefreshNS = 0;
+	mSharedImageGeneration = 0;
+	mResourceGeneration = 0;
+	mNumPropertiesFiles = 0;
+}
+
+HotReloader::~HotReloader()
+{
+	Stop();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void HotReloader::Start()
+{
+	RefreshFiles();
+	mWatcher.Start([this](const std::string &theFileName) { FileChanged(theFileName); });
+}
+
+void HotReloader::Stop()
+{
+	mWatcher.Stop();
+
+	AutoCrit anAutoCrit(mCritSect);
+	for (Reload &aReload : mReloads)
+		FreeReload(aReload);
+	mReloads.clear();
+}
+
+void HotReloader::FreeReload(Reload &theReload)
+{
+	delete theReload.mImage;
+	theReload.mImage = nullptr;
+
+	if (theReload.mFontData != nullptr)
+		theReload.mFontData->DeRef();
+	theReload.mFontData = nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+const std::vector<std::string> &HotReloader::GetImageFiles(const std::string &theFileName)
+{
+	auto anItr = mImageFiles.find(theFileName);
+	if (anItr != mImageFiles.end())
+		return anItr->second;
+
+	// the same names ImageLib::GetImage tries, alpha images included. all of them are watched whether
+	// they exist or not, so a variant saved later (foo.jpg replaced by foo.png) is picked up too and
+	// the main thread never has to ask the disk
+	std::vector<std::string> &aFiles = mImageFiles[theFileName];
+
+	int aLastDotPos = theFileName.rfind('.');
+	int aLastSlashPos = std::max((int)theFileName.rfind('\\'), (int)theFileName.rfind('/'));
+
+	std::vector<std::string> aNames;
+	aNames.push_back(theFileName);
+	aNames.push_back(theFileName.substr(0, aLastSlashPos + 1) + "_" + theFileName.substr(aLastSlashPos + 1));
+	aNames.push_back(theFileName + "_");
+
+	for (const std::string &aName : aNames)
+	{
+		if (aLastDotPos > aLastSlashPos)
+			aFiles.push_back(aName);
+		else
+		{
+			for (const char *anExt : {".tga", ".jpg", ".png", ".gif"})
+				aFiles.push_back(aName + anExt);
+		}
+	}
+
+	return aFiles;
+}
+
+void HotReloader::AddTarget(TargetMap &theTargets, const std::string &theFileName, ReloadType theType,
+							const std::string &theName, const std::string &thePath,
+							const ResourceManager::ImageComposition &theComposition)
+{
+	auto aRange = theTargets.equal_range(theFileName);
+	for (auto anItr = aRange.first; anItr != aRange.second; ++anItr)
+	{
+		if (anItr->second.mType == theType && anItr->second.mName == theName)
+			return;
+	}
+
+	theTargets.emplace(theFileName, Target{theType, theName, thePath, theComposition});
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// cheap enough to ask every interval, unlike walking every image and resource
+bool HotReloader::FilesChanged()
+{
+	if (mApp->mSharedImageGeneration != mSharedImageGeneration || mApp->mPropertiesFiles.size() != mNumPropertiesFiles)
+		return true;
+
+	if (mApp->mResourceManager != nullptr && mApp->mResourceManager->mResourceGeneration != mResourceGeneration)
+		return true;
+
+	std::vector<std::string> aModValFiles;
+	GetModValFileNames(&aModValFiles);
+	return aModValFiles != mModValFiles;
+}
+
+void HotReloader::RefreshFiles()
+{
+	mNextRefreshNS = SDL_GetTicksNS() + (uint64_t)mRefreshIntervalMS * 1000000ULL;
+
+	// taken first, whatever is loaded during the walk makes the next check rebuild again
+	mSharedImageGeneration = mApp->mSharedImageGeneration;
+	if (mApp->mResourceManager != nullptr)
+		mResourceGeneration = mApp->mResourceManager->mResourceGeneration;
+	mNumPropertiesFiles = mApp->mPropertiesFiles.size();
+
+	TargetMap aTargets;
+	ResourceManager *aResourceManager = mApp->mResourceManager;
+
+	// images are reloaded the way the resource that loaded them composed them, on the watcher thread
+	std::map<SDLImage *, ResourceManager::ImageComposition> aCompositions;
+	if (aResourceManager != nullptr)
+	{
+		for (auto &anEntry : aResourceManager->mImageMap)
+		{
+			ResourceManager::ImageRes *aRes = (ResourceManager::ImageRes *)anEntry.second;
+			SDLImage *anImage = (SDLImage *)aRes->mImage;
+			if (anImage != nullptr)
+				aCompositions.emplace(anImage, ResourceManager::GetImageComposition(aRes));
+		}
+	}
+
+	// shared images, which includes the ones resources and fonts use
+	if (mApp->mSDLInterface != nullptr)
+	{
+		AutoCrit anAutoCrit(mApp->mSDLInterface->mCritSect);
+
+		for (auto &anEntry : mApp->mSharedImageMap)
+		{
+			SDLImage *anImage = anEntry.second.mImage;
+			if (anImage == nullptr || anEntry.second.mRefCount < 0 || anImage->mFilePath.empty())
+				continue;
+
+			auto aCompositionItr = aCompositions.find(anImage);
+			ResourceManager::ImageComposition aComposition =
+				aCompositionItr != aCompositions.end() ? aCompositionItr->second : ResourceManager::ImageComposition();
+
+			for (const std::string &aFile : GetImageFiles(anImage->mFilePath))
+				AddTarget(aTargets, aFile, RELOAD_IMAGE, anImage->mFilePath, anImage->mFilePath, aComposition);
+		}
+	}
+
+	if (aResourceManager != nullptr)
+	{
+		// an alpha image changing means the image has to be composed again
+		for (auto &anEntry : aResourceManager->mImageMap)
+		{
+			ResourceManager::ImageRes *aRes = (ResourceManager::ImageRes *)anEntry.second;
+			SDLImage *anImage = (SDLImage *)aRes->mImage;
+			if (anImage == nullptr || anImage->mFilePath.empty())
+				continue;
+
+			for (const std::string *anAlphaName : {&aRes->mAlphaImage, &aRes->mAlphaGridImage})
+			{
+				if (anAlphaName->empty())
+					continue;
+
+				for (const std::string &aFile : GetImageFiles(*anAlphaName))
+					AddTarget(aTargets, aFile, RELOAD_IMAGE, anImage->mFilePath, anImage->mFilePath,
+							  aCompositions[anImage]);
+			}
+		}
+
+		for (auto &anEntry : aResourceManager->mSoundMap)
+		{
+			ResourceManager::SoundRes *aRes = (ResourceManager::SoundRes *)anEntry.second;
+			if (aRes->mSoundId < 0)
+				continue;
+
+			// the extensions the sound manager tries, existing or not
+			for (const char *anExt : {".ogg", ".mp3", ".flac", ".wav"})
+				AddTarget(aTargets, aRes->mPath + anExt, RELOAD_SOUND, aRes->mId, aRes->mPath);
+		}
+
+		for (auto &anEntry : aResourceManager->mFontMap)
+		{
+			ResourceManager::FontRes *aRes = (ResourceManager::FontRes *)anEntry.second;
+			if (aRes->mSysFont || !aRes->mImagePath.empty() || aRes->mPath.empty() || aRes->mPath[0] == '!')
+				continue;
+
+			if (dynamic_cast<ImageFont *>(aRes->mFont) != nullptr)
+				AddTarget(aTargets, aRes->mPath, RELOAD_FONT, aRes->mId, aRes->mPath);
+		}
+	}
+
+	for (const std::string &aFile : mApp->mPropertiesFiles)
+		AddTarget(aTargets, aFile, RELOAD_PROPERTIES, aFile, aFile);
+
+	mModValFiles.clear();
+	GetModValFileNames(&mModValFiles);
+	for (const std::string &aFile : mModValFiles)
+		AddTarget(aTargets, aFile, RELOAD_MODVAL, aFile, aFile);
+
+	std::set<std::string> aFiles;
+	for (auto &anEntry : aTargets)
+		aFiles.insert(anEntry.first);
+
+	{
+		AutoCrit anAutoCrit(mCritSect);
+		mTargets.swap(aTargets);
+	}
+
+	mWatcher.SetFiles(aFiles);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void HotReloader::FileChanged(const std::string &theFileName)
+{
+	std::vector<Target> aTargets;
+	{
+		AutoCrit anAutoCrit(mCritSect);
+
+		auto aRange = mTargets.equal_range(theFileName);
+		for (auto anItr = aRange.first; anItr != aRange.second; ++anItr)
+			aTargets.push_back(anItr->second);
+	}
+
+	for (const Target &aTarget : aTargets)
+	{
+		Reload aReload = {aTarget.mType, aTarget.mName, nullptr, nullptr};
+
+		// the slow part happens here, on the watcher thread
+		if (aTarget.mType == RELOAD_IMAGE)
+		{
+			aReload.mImage = ResourceManager::LoadComposedImage(aTarget.mPath, aTarget.mComposition);
+			if (aReload.mImage == nullptr)
+				continue; // removed, not written completely or the sizes don't match, keep what we have
+		}
+		else if (aTarget.mType == RELOAD_FONT)
+		{
+			aReload.mFontData = new FontData();
+			aReload.mFontData->Ref();
+			if (!aReload.mFontData->Load(mApp, aTarget.mPath) || !aReload.mFontData->mInitialized)
+			{
+				FreeReload(aReload);
+				continue;
+			}
+		}
+
+		AutoCrit anAutoCrit(mCritSect);
+
+		// a newer version of the same thing replaces one that wasn't applied yet
+		for (auto anItr = mReloads.begin(); anItr != mReloads.end(); ++anItr)
+		{
+			if (anItr->mType == aReload.mType && anItr->mName == aReload.mName)
+			{
+				FreeReload(*anItr);
+				mReloads.erase(anItr);
+				break;
+			}
+		}
+
+		mReloads.push_back(aReload);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void HotReloader::ApplyImage(Reload &theReload)
+{
+	if (mApp->mSDLInterface == nullptr)
+		return;
+
+	std::vector<SDLImage *> anImages;
+	{
+		AutoCrit anAutoCrit(mApp->mSDLInterface->mCritSect);
+
+		for (auto &anEntry : mApp->mSharedImageMap)
+		{
+			SDLImage *anImage = anEntry.second.mImage;
+			if (anImage != nullptr && anEntry.second.mRefCount >= 0 &&
+				stricmp(anImage->mFilePath.c_str(), theReload.mName.c_str()) == 0)
+				anImages.push_back(anImage);
+		}
+	}
+
+	// already composed with its alpha image and alpha grid on the watcher thread
+	ImageLib::Image *aLoadedImage = theReload.mImage;
+	for (SDLImage *anImage : anImages)
+	{
+		anImage->SetBits((ulong *)aLoadedImage->GetBits(), aLoadedImage->GetWidth(), aLoadedImage->GetHeight(), false);
+		anImage->mFileBitsChangedCount = anImage->mBitsChangedCount;
+	}
+
+	ResourceManager *aResourceManager = mApp->mResourceManager;
+	if (aResourceManager != nullptr)
+	{
+		// scaled font layers are copies of the image
+		for (auto &anEntry : aResourceManager->mFontMap)
+		{
+			ImageFont *aFont = dynamic_cast<ImageFont *>(((ResourceManager::FontRes *)anEntry.second)->mFont);
+			if (aFont == nullptr)
+				continue;
+
+			for (FontLayer &aLayer : aFont->mFontData->mFontLayerList)
+			{
+				if (std::find(anImages.begin(), anImages.end(), (SDLImage *)aLayer.mImage) != anImages.end())
+				{
+					aFont->mActiveListValid = false;
+					aFont->Prepare();
+					break;
+				}
+			}
+		}
+	}
+
+	for (SDLImage *anImage : anImages)
+	{
+		anImage->CommitBits();
+		if (anImage->mPurgeBits)
+			anImage->PurgeBits();
+	}
+}
+
+void HotReloader::ApplySound(Reload &theReload)
+{
+	ResourceManager *aResourceManager = mApp->mResourceManager;
+	if (aResourceManager == nullptr || mApp->mSoundManager == nullptr)
+		return;
+
+	auto anItr = aResourceManager->mSoundMap.find(theReload.mName);
+	if (anItr == aResourceManager->mSoundMap.end())
+		return;
+
+	ResourceManager::SoundRes *aRes = (ResourceManager::SoundRes *)anItr->second;
+	if (aRes->mSoundId < 0)
+		return;
+
+	// the sound manager decodes while loading, so this can't be moved to the watcher thread
+	if (!mApp->mSoundManager->LoadSound(aRes->mSoundId, aRes->mPath))
+	{
+		SDL_Log("Hot reload of %s failed\r\n", aRes->mId.c_str());
+		return;
+	}
+
+	if (aRes->mVolume >= 0)
+		mApp->mSoundManager->SetBaseVolume(aRes->mSoundId, aRes->mVolume);
+
+	if (aRes->mPanning != 0)
+		mApp->mSoundManager->SetBasePan(aRes->mSoundId, aRes->mPanning);
+}
+
+void HotReloader::ApplyFont(Reload &theReload)
+{
+	ResourceManager *aResourceManager = mApp->mResourceManager;
+	if (aResourceManager == nullptr)
+		return;
+
+	auto anItr = aResourceManager->mFontMap.find(theReload.mName);
+	if (anItr == aResourceManager->mFontMap.end())
+		return;
+
+	ImageFont *aFont = dynamic_cast<ImageFont *>(((ResourceManager::FontRes *)anItr->second)->mFont);
+	if (aFont != nullptr)
+		aFont->SetFontData(theReload.mFontData);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void HotReloader::Update()
+{
+	if (SDL_GetTicksNS() >= mNextRefreshNS)
+	{
+		if (FilesChanged())
+			RefreshFiles();
+		else
+			mNextRefreshNS = SDL_GetTicksNS() + (uint64_t)mRefreshIntervalMS * 1000000ULL;
+	}
+
+	std::vector<Reload> aReloads;
+	{
+		AutoCrit anAutoCrit(mCritSect);
+		aReloads.swap(mReloads);
+	}
+
+	bool reparseModValues = false;
+	for (Reload &aReload : aReloads)
+	{
+		switch (aReload.mType)
+		{
+		case RELOAD_IMAGE:
+			ApplyImage(aReload);
+			break;
+		case RELOAD_SOUND:
+			ApplySound(aReload);
+			break;
+		case RELOAD_FONT:
+			ApplyFont(aReload);
+			break;
+		case RELOAD_PROPERTIES:
+			mApp->LoadProperties(aReload.mName, false, false);
+			break;
+		case RELOAD_MODVAL:
+			reparseModValues = true;
+			break;
+		}
+
+		FreeReload(aReload);
+	}
+
+	// ReparseModValues checks the times of every file anyway
+	if (reparseModValues)
+		ReparseModValues();
+}
@@ -0,0 +1,108 @@
+#ifndef __HOTRELOADER_HPP__
+#define __HOTRELOADER_HPP__
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "common.hpp"
+#include "misc/critsect.hpp"
+#include "misc/filewatcher.hpp"
+#include "resources/resourcemanager.hpp"
+
+namespace ImageLib
+{
+class Image;
+};
+
+namespace PopLib
+{
+
+class AppBase;
+class FontData;
+
+/**
+ * @brief reloads images, sounds, fonts, properties and M() values when their files change
+ *
+ * the files behind everything that is loaded are handed to a FileWatcher.
+ * when one of them changes, only the things made from it are reloaded:
+ * images and font descriptors are decoded on the watcher thread, then
+ * Update swaps them into the objects that already exist, so pointers held
+ * by the game stay valid and textures are uploaded again on their next
+ * draw. call Update once per frame on the main thread.
+ */
+class HotReloader
+{
+  public:
+	/// @brief how often to check for loaded or freed resources, the list of watched files is only
+	/// rebuilt when there are some
+	int mRefreshIntervalMS;
+
+  public:
+	HotReloader(AppBase *theApp);
+	virtual ~HotReloader();
+
+	/// @brief starts watching
+	void Start();
+	/// @brief stops watching, changes that weren't applied yet are dropped
+	void Stop();
+	/// @brief applies the reloads that are done, main thread only
+	void Update();
+	/// @brief rebuilds the list of watched files now
+	void RefreshFiles();
+
+  protected:
+	enum ReloadType
+	{
+		RELOAD_IMAGE,	   ///< named by the file name the shared image was loaded with
+		RELOAD_SOUND,	   ///< named by the resource id
+		RELOAD_FONT,	   ///< named by the resource id
+		RELOAD_PROPERTIES, ///< named by the properties file
+		RELOAD_MODVAL	   ///< named by the source file
+	};
+
+	struct Target
+	{
+		ReloadType mType;
+		std::string mName;
+		std::string mPath; ///< what to load, for fonts the descriptor
+		ResourceManager::ImageComposition mComposition; ///< for images, as the resource loading it composes it
+	};
+
+	struct Reload
+	{
+		ReloadType mType;
+		std::string mName;
+		ImageLib::Image *mImage;
+		FontData *mFontData;
+	};
+
+	typedef std::multimap<std::string, Target> TargetMap;
+
+	AppBase *mApp;
+	FileWatcher mWatcher;
+	CritSect mCritSect;
+	TargetMap mTargets;			  ///< by watched file
+	std::vector<Reload> mReloads; ///< done on the watcher thread, waiting for Update
+	/// @brief the files ImageLib would try for an image, by the name it's loaded with
+	std::map<std::string, std::vector<std::string>> mImageFiles;
+	uint64_t mNextRefreshNS;
+	uint32_t mSharedImageGeneration; ///< AppBase::mSharedImageGeneration the list was built at
+	uint32_t mResourceGeneration;	 ///< ResourceManager::mResourceGeneration the list was built at
+	size_t mNumPropertiesFiles;
+	std::vector<std::string> mModValFiles;
+
+	bool FilesChanged();
+	const std::vector<std::string> &GetImageFiles(const std::string &theFileName);
+	void AddTarget(TargetMap &theTargets, const std::string &theFileName, ReloadType theType,
+				   const std::string &theName, const std::string &thePath,
+				   const ResourceManager::ImageComposition &theComposition = ResourceManager::ImageComposition());
+	void FileChanged(const std::string &theFileName);
+	void ApplyImage(Reload &theReload);
+	void ApplySound(Reload &theReload);
+	void ApplyFont(Reload &theReload);
+	static void FreeReload(Reload &theReload);
+};
+
+} // namespace PopLib
+
+#endif
@@ -1,5 +1,6 @@
 #include <memory>
 #include "resourcemanager.hpp"
+#include "resourcemanifest.hpp"
 #include "readwrite/xmlparser.hpp"
 #include "audio/soundmanager.hpp"
 #include "graphics/sdlimage.hpp"
@@ -7,11 +8,19 @@
 #include "graphics/imagefont.hpp"
 #include "graphics/sysfont.hpp"
 #include "imagelib/imagelib.hpp"
+#include "misc/asyncio.hpp"
+#include "misc/autocrit.hpp"
+#include "misc/mappedfile.hpp"
 
 #include "debug/perftimer.hpp"
 
 using namespace PopLib;
 
+// registry value the group trace is kept in
+static const char *gGroupTraceKey = "ResourceGroupTrace";
+// enough to keep the I/O threads busy, few enough that a real load doesn't queue behind them
+static const int gMaxPrefetchRequests = 8;
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 void ResourceManager::ImageRes::DeleteResource()
@@ -51,15 +60,34 @@ ResourceManager::ResourceManager(AppBase *theApp)
 	mAllowMissingProgramResources = false;
 	mAllowAlreadyDefinedResources = false;
 	mCurResGroupList = NULL;
+
+	mGroupTraceLoaded = false;
+	mGroupTraceChanged = false;
+	mPrefetchQueuePos = 0;
+	mPrefetchDirty = true;
+	mPrefetchRound = 0;
+	mPrefetchBytes = 0;
+	mPrefetchBudget = 32 * 1024 * 1024;
+	mPrefetchGroups = 2;
+
+	mMemoryCap = 0;
+	mMemoryUsed = 0;
+	mMemoryUsageChanged = true;
+	mResourceGeneration = 0;
+	mUseCount = 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 ResourceManager::~ResourceManager()
 {
+	CancelPrefetch();
+	ReleasePrefetched("");
+
 	DeleteMap(mImageMap);
 	DeleteMap(mSoundMap);
 	DeleteMap(mFontMap);
+	mResources.clear();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -91,6 +119,9 @@ void ResourceManager::DeleteResources(ResMap &theMap, const std::string &theGrou
 		if (theGroup.empty() || anItr->second->mResGroup == theGroup)
 			anItr->second->DeleteResource();
 	}
+
+	mMemoryUsageChanged = true;
+	mResourceGeneration++;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -201,6 +232,9 @@ bool ResourceManager::ParseCommonResource(XMLElement &theElement, BaseRes *theRe
 		return Fail("Resource already defined.");
 	}
 
+	theRes->mIndex = (int)mResources.size();
+	mResources.push_back(theRes);
+
 	mCurResGroupList->push_back(theRes);
 	return true;
 }
@@ -475,6 +509,26 @@ bool ResourceManager::ParseSetDefaults(XMLElement &theElement)
 	return true;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool ResourceManager::ParseResourceElement(XMLElement &theElement)
+{
+	if (theElement.mValue == "Image")
+		return ParseImageResource(theElement);
+	else if (theElement.mValue == "Sound")
+		return ParseSoundResource(theElement);
+	else if (theElement.mValue == "Font")
+		return ParseFontResource(theElement);
+	else if (theElement.mValue == "PopAnim")
+		return ParsePopAnimResource(theElement);
+	else if (theElement.mValue == "PIEffect")
+		return ParsePIEffectResource(theElement);
+	else if (theElement.mValue == "SetDefaults")
+		return ParseSetDefaults(theElement);
+
+	return Fail("Invalid Section '" + theElement.mValue + "'");
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 bool ResourceManager::ParseResources()
@@ -487,77 +541,14 @@ bool ResourceManager::ParseResources()
 
 		if (aXMLElement.mType == XMLElement::TYPE_START)
 		{
-			if (aXMLElement.mValue == "Image")
-			{
-				if (!ParseImageResource(aXMLElement))
-					return false;
-
-				if (!mXMLParser->NextElement(&aXMLElement))
-					return false;
-
-				if (aXMLElement.mType != XMLElement::TYPE_END)
-					return Fail("Unexpected element found.");
-			}
-			else if (aXMLElement.mValue == "Sound")
-			{
-				if (!ParseSoundResource(aXMLElement))
-					return false;
-
-				if (!mXMLParser->NextElement(&aXMLElement))
-					return false;
-
-				if (aXMLElement.mType != XMLElement::TYPE_END)
-					return Fail("Unexpected element found.");
-			}
-			else if (aXMLElement.mValue == "Font")
-			{
-				if (!ParseFontResource(aXMLElement))
-					return false;
-
-				if (!mXMLParser->NextElement(&aXMLElement))
-					return false;
-
-				if (aXMLElement.mType != XMLElement::TYPE_END)
-					return Fail("Unexpected element found.");
-			}
-			else if (aXMLElement.mValue == "PopAnim")
-			{
-				if (!ParsePopAnimResource(aXMLElement))
-					return false;
-
-				if (!mXMLParser->NextElement(&aXMLElement))
-					return false;
-
-				if (aXMLElement.mType != XMLElement::TYPE_END)
-					return Fail("Unexpected element found.");
-			}
-			else if (aXMLElement.mValue == "PIEffect")
-			{
-				if (!ParsePIEffectResource(aXMLElement))
-					return false;
-
-				if (!mXMLParser->NextElement(&aXMLElement))
-					return false;
-
-				if (aXMLElement.mType != XMLElement::TYPE_END)
-					return Fail("Unexpected element found.");
-			}
-			else if (aXMLElement.mValue == "SetDefaults")
-			{
-				if (!ParseSetDefaults(aXMLElement))
-					return false;
-
-				if (!mXMLParser->NextElement(&aXMLElement))
-					return false;
+			if (!ParseResourceElement(aXMLElement))
+				return false;
 
-				if (aXMLElement.mType != XMLElement::TYPE_END)
-					return Fail("Unexpected element found.");
-			}
-			else
-			{
-				Fail("Invalid Section '" + aXMLElement.mValue + "'");
+			if (!mXMLParser->NextElement(&aXMLElement))
 				return false;
-			}
+
+			if (aXMLElement.mType != XMLElement::TYPE_END)
+				return Fail("Unexpected element found.");
 		}
 		else if (aXMLElement.mType == XMLElement::TYPE_ELEMENT)
 		{
@@ -622,10 +613,48 @@ bool ResourceManager::DoParseResources()
 	return !mHasFailed;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool ResourceManager::ParseCompiledManifest(const ResourceManifest &theManifest)
+{
+	for (int aGroupNum = 0; aGroupNum < theManifest.GetNumGroups() && !mHasFailed; aGroupNum++)
+	{
+		const ResourceManifest::Group &aGroup = theManifest.GetGroup(aGroupNum);
+		mCurResGroup = theManifest.GetString(aGroup.mId);
+		mCurResGroupList = &mResGroupMap[mCurResGroup];
+
+		for (uint32_t i = 0; i < aGroup.mNumRecords; i++)
+		{
+			const ResourceManifest::Record &aRecord = theManifest.GetRecord(aGroup.mFirstRecord + i);
+
+			XMLElement anElement;
+			anElement.mType = XMLElement::TYPE_START;
+			anElement.mValue = theManifest.GetString(aRecord.mName);
+			for (uint32_t j = 0; j < aRecord.mNumAttributes; j++)
+			{
+				const ResourceManifest::Attribute &anAttribute = theManifest.GetAttribute(aRecord.mFirstAttribute + j);
+				anElement.mAttributes.emplace(theManifest.GetString(anAttribute.mKey),
+											  theManifest.GetString(anAttribute.mValue));
+			}
+
+			if (!ParseResourceElement(anElement))
+				break;
+		}
+	}
+
+	return !mHasFailed;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 bool ResourceManager::ParseResourcesFile(const std::string &theFilename)
 {
+	// use the manifest compiled by rescompiler when it's there and up to date
+	ResourceManifest aManifest;
+	if (aManifest.Open(ResourceManifest::GetCompiledFileName(theFilename)) && !aManifest.IsStale(theFilename))
+		return ParseCompiledManifest(aManifest);
+	aManifest.Close();
+
 	mXMLParser = new XMLParser();
 	if (!mXMLParser->OpenFile(theFilename))
 		Fail("Resource file not found: " + theFilename);
@@ -666,32 +695,24 @@ bool ResourceManager::ReparseResourcesFile(const std::string &theFilename)
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
-bool ResourceManager::LoadAlphaGridImage(ImageRes *theRes, SDLImage *theImage)
+// puts one alpha cel over every cel of theBits, false if its size doesn't match a cel
+static bool ComposeAlphaGrid(ImageLib::Image *theAlphaImage, ulong *theBits, int theWidth, int theHeight, int theNumRows,
+							 int theNumCols)
 {
-	ImageLib::Image *anAlphaImage = ImageLib::GetImage(theRes->mAlphaGridImage, true);
-	if (!anAlphaImage)
-		return Fail(StrFormat("Failed to load image: %s", theRes->mAlphaGridImage.c_str()));
-
-	std::unique_ptr<ImageLib::Image> aDelAlphaImage(anAlphaImage);
-
-	int aNumRows = theRes->mRows;
-	int aNumCols = theRes->mCols;
+	int aCelWidth = theWidth / theNumCols;
+	int aCelHeight = theHeight / theNumRows;
 
-	int aCelWidth = theImage->mWidth / aNumCols;
-	int aCelHeight = theImage->mHeight / aNumRows;
-
-	if (anAlphaImage->mWidth != aCelWidth || anAlphaImage->mHeight != aCelHeight)
-		return Fail(StrFormat("GridAlphaImage size mismatch between %s and %s", theRes->mPath.c_str(),
-							  theRes->mAlphaGridImage.c_str()));
+	if (theAlphaImage->mWidth != aCelWidth || theAlphaImage->mHeight != aCelHeight)
+		return false;
 
-	ulong *aMasterRowPtr = theImage->mBits;
-	for (int i = 0; i < aNumRows; i++)
+	ulong *aMasterRowPtr = theBits;
+	for (int i = 0; i < theNumRows; i++)
 	{
 		ulong *aMasterColPtr = aMasterRowPtr;
-		for (int j = 0; j < aNumCols; j++)
+		for (int j = 0; j < theNumCols; j++)
 		{
 			ulong *aRowPtr = aMasterColPtr;
-			ulong *anAlphaBits = anAlphaImage->mBits;
+			ulong *anAlphaBits = theAlphaImage->mBits;
 			for (int y = 0; y < aCelHeight; y++)
 			{
 				ulong *aDestPtr = aRowPtr;
@@ -701,14 +722,51 @@ bool ResourceManager::LoadAlphaGridImage(ImageRes *theRes, SDLImage *theImage)
 					++anAlphaBits;
 					++aDestPtr;
 				}
-				aRowPtr += theImage->mWidth;
+				aRowPtr += theWidth;
 			}
 
 			aMasterColPtr += aCelWidth;
 		}
-		aMasterRowPtr += aCelHeight * theImage->mWidth;
+		aMasterRowPtr += aCelHeight * theWidth;
+	}
+
+	return true;
+}
+
+// takes the alpha of theBits from the red channel of theAlphaImage, false if the sizes don't match
+static bool ComposeAlphaImage(ImageLib::Image *theAlphaImage, ulong *theBits, int theWidth, int theHeight)
+{
+	if (theAlphaImage->mWidth != theWidth || theAlphaImage->mHeight != theHeight)
+		return false;
+
+	ulong *aBits1 = theBits;
+
+	ulong *aBits2 = theAlphaImage->mBits;
+	int aSize = theWidth * theHeight;
+
+	for (int i = 0; i < aSize; i++)
+	{
+		*aBits1 = (*aBits1 & 0x00FFFFFF) | ((*aBits2 & 0xFF) << 24);
+		++aBits1;
+		++aBits2;
 	}
 
+	return true;
+}
+
+bool ResourceManager::LoadAlphaGridImage(ImageRes *theRes, SDLImage *theImage)
+{
+	ImageLib::Image *anAlphaImage = ImageLib::GetImage(theRes->mAlphaGridImage, true);
+	if (!anAlphaImage)
+		return Fail(StrFormat("Failed to load image: %s", theRes->mAlphaGridImage.c_str()));
+
+	std::unique_ptr<ImageLib::Image> aDelAlphaImage(anAlphaImage);
+
+	if (!ComposeAlphaGrid(anAlphaImage, theImage->mBits, theImage->mWidth, theImage->mHeight, theRes->mRows,
+						  theRes->mCols))
+		return Fail(StrFormat("GridAlphaImage size mismatch between %s and %s", theRes->mPath.c_str(),
+							  theRes->mAlphaGridImage.c_str()));
+
 	theImage->BitsChanged();
 	return true;
 }
@@ -726,22 +784,10 @@ bool ResourceManager::LoadAlphaImage(ImageRes *theRes, SDLImage *theImage)
 
 	std::unique_ptr<ImageLib::Image> aDelAlphaImage(anAlphaImage);
 
-	if (anAlphaImage->mWidth != theImage->mWidth || anAlphaImage->mHeight != theImage->mHeight)
+	if (!ComposeAlphaImage(anAlphaImage, theImage->mBits, theImage->mWidth, theImage->mHeight))
 		return Fail(StrFormat("AlphaImage size mismatch between %s and %s", theRes->mPath.c_str(),
 							  theRes->mAlphaImage.c_str()));
 
-	ulong *aBits1 = theImage->mBits;
-
-	ulong *aBits2 = anAlphaImage->mBits;
-	int aSize = theImage->mWidth * theImage->mHeight;
-
-	for (int i = 0; i < aSize; i++)
-	{
-		*aBits1 = (*aBits1 & 0x00FFFFFF) | ((*aBits2 & 0xFF) << 24);
-		++aBits1;
-		++aBits2;
-	}
-
 	theImage->BitsChanged();
 	return true;
 }
@@ -755,13 +801,14 @@ bool ResourceManager::DoLoadImage(ImageRes *theRes)
 	PERF_BEGIN("ResourceManager:GetImage");
 
 	// ImageLib::Image *anImage = ImageLib::GetImage(theRes->mPath, lookForAlpha);
-	// PERF_END("ResourceManager:GetImage");
 
 	bool isNew;
 	ImageLib::gAlphaComposeColor = theRes->mAlphaColor;
 	SharedImageRef aSharedImageRef = gAppBase->GetSharedImage(theRes->mPath, theRes->mVariant, &isNew);
 	ImageLib::gAlphaComposeColor = 0xFFFFFF;
 
+	PERF_END("ResourceManager:GetImage");
+
 	SDLImage *aSDLImage = (SDLImage *)aSharedImageRef;
 	if (!aSDLImage)
 		return Fail(StrFormat("Failed to load image: %s", theRes->mPath.c_str()));
@@ -779,11 +826,15 @@ bool ResourceManager::DoLoadImage(ImageRes *theRes)
 			if (!LoadAlphaGridImage(theRes, aSharedImageRef))
 				return false;
 		}
+
+		// still what the files give, ReloadImageBits composes it the same way
+		if (aSDLImage->mFileBitsChangedCount >= 0)
+			aSDLImage->mFileBitsChangedCount = aSDLImage->mBitsChangedCount;
 	}
 
 	aSDLImage->CommitBits();
 	theRes->mImage = aSharedImageRef;
-	aSDLImage->mPurgeBits = theRes->mPurgeBits;
+	aSDLImage->mPurgeBits = theRes->mPurgeBits || (GetGroupPolicy(theRes->mResGroup) & GROUPPOLICY_PURGEBITS) != 0;
 
 	if (theRes->mDDSurface)
 	{
@@ -822,10 +873,82 @@ bool ResourceManager::DoLoadImage(ImageRes *theRes)
 	if (aSDLImage->mPurgeBits)
 		aSDLImage->PurgeBits();
 
+	mMemoryUsageChanged = true;
+	mResourceGeneration++;
 	ResourceLoadedHook(theRes);
 	return true;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+ResourceManager::ImageComposition ResourceManager::GetImageComposition(ImageRes *theRes)
+{
+	ImageComposition aComposition;
+	aComposition.mAlphaColor = theRes->mAlphaColor;
+	aComposition.mAlphaImage = theRes->mAlphaImage;
+	aComposition.mAlphaGridImage = theRes->mAlphaGridImage;
+	aComposition.mRows = theRes->mRows;
+	aComposition.mCols = theRes->mCols;
+	return aComposition;
+}
+
+// doesn't touch the ResourceManager or change ImageLib's globals, so it can run on any thread
+ImageLib::Image *ResourceManager::LoadComposedImage(const std::string &thePath, const ImageComposition &theComposition)
+{
+	std::unique_ptr<ImageLib::Image> aLoadedImage(ImageLib::GetImage(thePath, true, theComposition.mAlphaColor));
+	if (aLoadedImage == NULL)
+		return NULL;
+
+	if (!theComposition.mAlphaImage.empty())
+	{
+		std::unique_ptr<ImageLib::Image> anAlphaImage(ImageLib::GetImage(theComposition.mAlphaImage, true, 0xFFFFFF));
+		if (anAlphaImage == NULL || !ComposeAlphaImage(anAlphaImage.get(), aLoadedImage->mBits, aLoadedImage->mWidth,
+													   aLoadedImage->mHeight))
+			return NULL;
+	}
+
+	if (!theComposition.mAlphaGridImage.empty())
+	{
+		std::unique_ptr<ImageLib::Image> anAlphaImage(ImageLib::GetImage(theComposition.mAlphaGridImage, true, 0xFFFFFF));
+		if (anAlphaImage == NULL ||
+			!ComposeAlphaGrid(anAlphaImage.get(), aLoadedImage->mBits, aLoadedImage->mWidth, aLoadedImage->mHeight,
+							  theComposition.mRows, theComposition.mCols))
+			return NULL;
+	}
+
+	return aLoadedImage.release();
+}
+
+// resources sharing an image only compose it when they're the first to load it, the first one is taken
+ResourceManager::ImageRes *ResourceManager::FindImageRes(MemoryImage *theImage)
+{
+	for (ResMap::iterator anItr = mImageMap.begin(); anItr != mImageMap.end(); ++anItr)
+	{
+		ImageRes *anImageRes = (ImageRes *)anItr->second;
+		if ((MemoryImage *)anImageRes->mImage == theImage)
+			return anImageRes;
+	}
+
+	return NULL;
+}
+
+bool ResourceManager::ReloadImageBits(MemoryImage *theImage)
+{
+	if (theImage->mFilePath.empty() || theImage->mBits == NULL)
+		return false;
+
+	ImageRes *aRes = FindImageRes(theImage);
+	ImageComposition aComposition = aRes != NULL ? GetImageComposition(aRes) : ImageComposition();
+
+	std::unique_ptr<ImageLib::Image> aLoadedImage(LoadComposedImage(theImage->mFilePath, aComposition));
+	if (aLoadedImage == NULL || aLoadedImage->mWidth != theImage->mWidth || aLoadedImage->mHeight != theImage->mHeight)
+		return false;
+
+	// copy straight into mBits, going through SetBits would count as a change and upload it twice
+	memcpy(theImage->mBits, aLoadedImage->mBits, theImage->mWidth * theImage->mHeight * sizeof(ulong));
+	return true;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 void ResourceManager::DeleteImage(const std::string &theName)
@@ -842,6 +965,7 @@ SharedImageRef ResourceManager::LoadImage(const std::string &theName)
 		return NULL;
 
 	ImageRes *aRes = (ImageRes *)anItr->second;
+	aRes->mHandedOut = true;
 	if ((SDLImage *)aRes->mImage != NULL)
 		return aRes->mImage;
 
@@ -877,6 +1001,8 @@ bool ResourceManager::DoLoadSound(SoundRes *theRes)
 
 	aRes->mSoundId = aSoundId;
 
+	mMemoryUsageChanged = true;
+	mResourceGeneration++;
 	ResourceLoadedHook(theRes);
 	return true;
 }
@@ -953,6 +1079,8 @@ bool ResourceManager::DoLoadFont(FontRes *theRes)
 
 	PERF_END("ResourceManager:DoLoadFont");
 
+	mMemoryUsageChanged = true;
+	mResourceGeneration++;
 	ResourceLoadedHook(theRes);
 	return true;
 }
@@ -1035,6 +1163,8 @@ bool ResourceManager::LoadNextResource()
 		if (aRes->mFromProgram)
 			continue;
 
+		aRes->mLastUsed = ++mUseCount;
+
 		switch (aRes->mType)
 		{
 		case ResType_Image: {
@@ -1063,6 +1193,8 @@ bool ResourceManager::LoadNextResource()
 		}
 	}
 
+	// it's all decoded now, the prefetched files did their job
+	ReleasePrefetched(mCurResGroup);
 	return false;
 }
 
@@ -1079,6 +1211,8 @@ void ResourceManager::StartLoadResources(const std::string &theGroup)
 	mError = "";
 	mHasFailed = false;
 
+	RecordGroupRequest(theGroup);
+
 	mCurResGroup = theGroup;
 	mCurResGroupList = &mResGroupMap[theGroup];
 	mCurResGroupListItr = mCurResGroupList->begin();
@@ -1186,10 +1320,11 @@ int ResourceManager::GetNumResources(const std::string &theGroup)
 SharedImageRef ResourceManager::GetImage(const std::string &theId)
 {
 	ResMap::iterator anItr = mImageMap.find(theId);
-	if (anItr != mImageMap.end())
-		return ((ImageRes *)anItr->second)->mImage;
-	else
+	if (anItr == mImageMap.end())
 		return NULL;
+
+	UseRes(anItr->second);
+	return ((ImageRes *)anItr->second)->mImage;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -1197,21 +1332,109 @@ SharedImageRef ResourceManager::GetImage(const std::string &theId)
 int ResourceManager::GetSound(const std::string &theId)
 {
 	ResMap::iterator anItr = mSoundMap.find(theId);
-	if (anItr != mSoundMap.end())
-		return ((SoundRes *)anItr->second)->mSoundId;
-	else
+	if (anItr == mSoundMap.end())
 		return -1;
+
+	UseRes(anItr->second);
+	return ((SoundRes *)anItr->second)->mSoundId;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 Font *ResourceManager::GetFont(const std::string &theId)
 {
+	ResMap::iterator anItr = mFontMap.find(theId);
+	if (anItr == mFontMap.end())
+		return NULL;
+
+	UseRes(anItr->second);
+	return ((FontRes *)anItr->second)->mFont;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+ResourceManager::ResourceId ResourceManager::GetImageId(const std::string &theId)
+{
+	ResourceId anId;
+
+	ResMap::iterator anItr = mImageMap.find(theId);
+	if (anItr != mImageMap.end())
+		anId.mIndex = anItr->second->mIndex;
+
+	return anId;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+ResourceManager::ResourceId ResourceManager::GetSoundId(const std::string &theId)
+{
+	ResourceId anId;
+
+	ResMap::iterator anItr = mSoundMap.find(theId);
+	if (anItr != mSoundMap.end())
+		anId.mIndex = anItr->second->mIndex;
+
+	return anId;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+ResourceManager::ResourceId ResourceManager::GetFontId(const std::string &theId)
+{
+	ResourceId anId;
+
 	ResMap::iterator anItr = mFontMap.find(theId);
 	if (anItr != mFontMap.end())
-		return ((FontRes *)anItr->second)->mFont;
-	else
+		anId.mIndex = anItr->second->mIndex;
+
+	return anId;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+ResourceManager::BaseRes *ResourceManager::GetRes(ResType theType, ResourceId theId)
+{
+	if (theId.mIndex < 0 || theId.mIndex >= (int)mResources.size())
 		return NULL;
+
+	BaseRes *aRes = mResources[theId.mIndex];
+	return aRes->mType == theType ? aRes : NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+SharedImageRef ResourceManager::GetImage(ResourceId theId)
+{
+	ImageRes *aRes = (ImageRes *)GetRes(ResType_Image, theId);
+	if (aRes == NULL)
+		return NULL;
+
+	UseRes(aRes);
+	return aRes->mImage;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+int ResourceManager::GetSound(ResourceId theId)
+{
+	SoundRes *aRes = (SoundRes *)GetRes(ResType_Sound, theId);
+	if (aRes == NULL)
+		return -1;
+
+	UseRes(aRes);
+	return aRes->mSoundId;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+Font *ResourceManager::GetFont(ResourceId theId)
+{
+	FontRes *aRes = (FontRes *)GetRes(ResType_Font, theId);
+	if (aRes == NULL)
+		return NULL;
+
+	UseRes(aRes);
+	return aRes->mFont;
 }
 
 ResourceManager::BaseRes *ResourceManager::GetBaseRes(int type, const std::string &theId)
@@ -1263,7 +1486,8 @@ ResourceManager::ResourceRef *ResourceManager::GetResourceRef(BaseRes *base)
 	ResourceRef *ref = new ResourceRef();
 
 	bool fromProgram;
-	if (base->mRefCount == 0)
+	UseRes(base, true);
+	if (base->mRefCount == 0 && !IsResourceLoaded(base))
 		DoLoadResource(base, &fromProgram);
 
 	ref->mBaseResP = base;
@@ -1343,6 +1567,8 @@ bool ResourceManager::ReplaceImage(const std::string &theId, Image *theImage)
 	if (anItr != mImageMap.end())
 	{
 		anItr->second->DeleteResource();
+		mMemoryUsageChanged = true;
+		mResourceGeneration++;
 		((ImageRes *)anItr->second)->mImage = (MemoryImage *)theImage;
 		((ImageRes *)anItr->second)->mImage.mOwnsUnshared = true;
 		return true;
@@ -1359,6 +1585,8 @@ bool ResourceManager::ReplaceSound(const std::string &theId, int theSound)
 	if (anItr != mSoundMap.end())
 	{
 		anItr->second->DeleteResource();
+		mMemoryUsageChanged = true;
+		mResourceGeneration++;
 		((SoundRes *)anItr->second)->mSoundId = theSound;
 		return true;
 	}
@@ -1374,6 +1602,8 @@ bool ResourceManager::ReplaceFont(const std::string &theId, Font *theFont)
 	if (anItr != mFontMap.end())
 	{
 		anItr->second->DeleteResource();
+		mMemoryUsageChanged = true;
+		mResourceGeneration++;
 		((FontRes *)anItr->second)->mFont = theFont;
 		return true;
 	}
@@ -1393,3 +1623,570 @@ const XMLParamMap &ResourceManager::GetImageAttributes(const std::string &theId)
 	else
 		return aStrMap;
 }
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void ResourceManager::LoadGroupTrace()
+{
+	mGroupTraceLoaded = true;
+
+	std::string aTrace;
+	if (!mApp->RegistryReadString(gGroupTraceKey, &aTrace))
+		return;
+
+	// one "from\tto\tcount" per line
+	size_t aPos = 0;
+	while (aPos < aTrace.size())
+	{
+		size_t anEnd = aTrace.find('\n', aPos);
+		if (anEnd == std::string::npos)
+			anEnd = aTrace.size();
+
+		std::string aLine = aTrace.substr(aPos, anEnd - aPos);
+		aPos = anEnd + 1;
+
+		size_t aFirstTab = aLine.find('\t');
+		if (aFirstTab == std::string::npos)
+			continue;
+
+		size_t aSecondTab = aLine.find('\t', aFirstTab + 1);
+		if (aSecondTab == std::string::npos)
+			continue;
+
+		int aCount = atoi(aLine.c_str() + aSecondTab + 1);
+		if (aCount > 0)
+			mGroupTrace[aLine.substr(0, aFirstTab)][aLine.substr(aFirstTab + 1, aSecondTab - aFirstTab - 1)] += aCount;
+	}
+}
+
+void ResourceManager::SaveGroupTrace()
+{
+	std::string aTrace;
+	for (GroupTraceMap::iterator aTraceItr = mGroupTrace.begin(); aTraceItr != mGroupTrace.end(); ++aTraceItr)
+	{
+		for (GroupCountMap::iterator anItr = aTraceItr->second.begin(); anItr != aTraceItr->second.end(); ++anItr)
+			aTrace += StrFormat("%s\t%s\t%d\n", aTraceItr->first.c_str(), anItr->first.c_str(), anItr->second);
+	}
+
+	mApp->RegistryWriteString(gGroupTraceKey, aTrace);
+	mGroupTraceChanged = false;
+}
+
+void ResourceManager::RecordGroupRequest(const std::string &theGroup)
+{
+	AutoCrit anAutoCrit(mPrefetchCritSect);
+
+	if (!mGroupTraceLoaded)
+		LoadGroupTrace();
+
+	// the disk is needed for the real thing now. the queue is gone, so predict again even when
+	// the same group is asked for twice
+	CancelPrefetch();
+	mPrefetchDirty = true;
+
+	if (!mLastGroup.empty() && _stricmp(mLastGroup.c_str(), theGroup.c_str()) == 0)
+		return;
+
+	GroupCountMap &aCounts = mGroupTrace[mLastGroup];
+	if (++aCounts[theGroup] >= 1024)
+	{
+		// halved once they get large, so what's played lately outweighs old habits
+		GroupCountMap::iterator anItr = aCounts.begin();
+		while (anItr != aCounts.end())
+		{
+			anItr->second /= 2;
+			if (anItr->second == 0)
+				anItr = aCounts.erase(anItr);
+			else
+				++anItr;
+		}
+	}
+
+	mGroupTraceChanged = true;
+	mLastGroup = theGroup;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void ResourceManager::PredictGroups()
+{
+	mPrefetchDirty = false;
+	mPrefetchRound++;
+	mPrefetchQueue.clear();
+	mPrefetchQueuePos = 0;
+
+	GroupTraceMap::iterator aTraceItr = mGroupTrace.find(mLastGroup);
+	if (aTraceItr == mGroupTrace.end())
+		return;
+
+	std::vector<std::pair<int, std::string>> aCandidates;
+	for (GroupCountMap::iterator anItr = aTraceItr->second.begin(); anItr != aTraceItr->second.end(); ++anItr)
+	{
+		if (!IsGroupLoaded(anItr->first) && mResGroupMap.find(anItr->first) != mResGroupMap.end())
+			aCandidates.push_back(std::make_pair(anItr->second, anItr->first));
+	}
+
+	std::stable_sort(aCandidates.begin(), aCandidates.end(),
+					 [](const std::pair<int, std::string> &a, const std::pair<int, std::string> &b) {
+						 return a.first > b.first;
+					 });
+
+	for (int i = 0; i < (int)aCandidates.size() && i < mPrefetchGroups; i++)
+	{
+		ResList &aList = mResGroupMap[aCandidates[i].second];
+		for (ResList::iterator anItr = aList.begin(); anItr != aList.end(); ++anItr)
+		{
+			if (!(*anItr)->mFromProgram)
+				mPrefetchQueue.push_back(*anItr);
+		}
+	}
+}
+
+bool ResourceManager::IsResourceLoaded(BaseRes *theRes)
+{
+	switch (theRes->mType)
+	{
+	case ResType_Image:
+		return (SDLImage *)((ImageRes *)theRes)->mImage != NULL;
+	case ResType_Sound:
+		return ((SoundRes *)theRes)->mSoundId != -1;
+	case ResType_Font:
+		return ((FontRes *)theRes)->mFont != NULL;
+	}
+
+	return false;
+}
+
+void ResourceManager::GetImageFileNames(const std::string &thePath, std::vector<std::string> &theFileNames)
+{
+	int aLastDotPos = (int)thePath.rfind('.');
+	int aLastSlashPos = std::max((int)thePath.rfind('\\'), (int)thePath.rfind('/'));
+	if (aLastDotPos > aLastSlashPos)
+	{
+		theFileNames.push_back(thePath);
+		return;
+	}
+
+	// the ones ImageLib::GetImage tries, the missing ones fail on the I/O thread
+	static const char *anExtensions[] = {".tga", ".jpg", ".png", ".gif"};
+	for (const char *anExtension : anExtensions)
+		theFileNames.push_back(thePath + anExtension);
+}
+
+void ResourceManager::GetPrefetchFileNames(BaseRes *theRes, std::vector<std::string> &theFileNames)
+{
+	switch (theRes->mType)
+	{
+	case ResType_Image: {
+		ImageRes *anImageRes = (ImageRes *)theRes;
+		GetImageFileNames(anImageRes->mPath, theFileNames);
+		if (!anImageRes->mAlphaImage.empty())
+			GetImageFileNames(anImageRes->mAlphaImage, theFileNames);
+		if (!anImageRes->mAlphaGridImage.empty())
+			GetImageFileNames(anImageRes->mAlphaGridImage, theFileNames);
+		break;
+	}
+
+	case ResType_Sound: {
+		// the ones the sound manager tries
+		static const char *anExtensions[] = {".ogg", ".mp3", ".flac", ".wav"};
+		for (const char *anExtension : anExtensions)
+			theFileNames.push_back(theRes->mPath + anExtension);
+		break;
+	}
+
+	case ResType_Font: {
+		FontRes *aFontRes = (FontRes *)theRes;
+		if (aFontRes->mSysFont || strncmp(aFontRes->mPath.c_str(), "!ref:", 5) == 0)
+			break;
+
+		theFileNames.push_back(aFontRes->mPath);
+		if (!aFontRes->mImagePath.empty())
+			GetImageFileNames(aFontRes->mImagePath, theFileNames);
+		break;
+	}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void ResourceManager::PrefetchDone(int theId, MappedFile *theFile)
+{
+	AutoCrit anAutoCrit(mPrefetchCritSect);
+
+	std::map<int, BaseRes *>::iterator anItr = mPrefetchRequests.find(theId);
+	if (anItr == mPrefetchRequests.end())
+	{
+		delete theFile;
+		return;
+	}
+
+	BaseRes *aRes = anItr->second;
+	mPrefetchRequests.erase(anItr);
+
+	// mostly extensions the resource doesn't have
+	if (theFile == nullptr)
+		return;
+
+	if (IsResourceLoaded(aRes))
+	{
+		delete theFile;
+		return;
+	}
+
+	// older guesses make room first
+	while (mPrefetchBytes + theFile->GetSize() > mPrefetchBudget && !mPrefetchedFiles.empty() &&
+		   mPrefetchedFiles.front().mRound != mPrefetchRound)
+	{
+		mPrefetchBytes -= mPrefetchedFiles.front().mFile->GetSize();
+		delete mPrefetchedFiles.front().mFile;
+		mPrefetchedFiles.pop_front();
+	}
+
+	if (mPrefetchBytes + theFile->GetSize() > mPrefetchBudget)
+	{
+		// the rest of this guess won't fit either
+		mPrefetchQueuePos = mPrefetchQueue.size();
+		delete theFile;
+		return;
+	}
+
+	PrefetchedFile aPrefetchedFile;
+	aPrefetchedFile.mRes = aRes;
+	aPrefetchedFile.mFile = theFile;
+	aPrefetchedFile.mRound = mPrefetchRound;
+	mPrefetchedFiles.push_back(aPrefetchedFile);
+	mPrefetchBytes += theFile->GetSize();
+}
+
+void ResourceManager::ReleasePrefetched(const std::string &theGroup)
+{
+	AutoCrit anAutoCrit(mPrefetchCritSect);
+
+	std::list<PrefetchedFile>::iterator anItr = mPrefetchedFiles.begin();
+	while (anItr != mPrefetchedFiles.end())
+	{
+		if (theGroup.empty() || _stricmp(anItr->mRes->mResGroup.c_str(), theGroup.c_str()) == 0)
+		{
+			mPrefetchBytes -= anItr->mFile->GetSize();
+			delete anItr->mFile;
+			anItr = mPrefetchedFiles.erase(anItr);
+		}
+		else
+			++anItr;
+	}
+}
+
+void ResourceManager::CancelPrefetch()
+{
+	AutoCrit anAutoCrit(mPrefetchCritSect);
+
+	for (std::map<int, BaseRes *>::iterator anItr = mPrefetchRequests.begin(); anItr != mPrefetchRequests.end(); ++anItr)
+		mApp->mAsyncIO->Cancel(anItr->first);
+
+	mPrefetchRequests.clear();
+	mPrefetchQueuePos = mPrefetchQueue.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void ResourceManager::Update()
+{
+	AutoCrit anAutoCrit(mPrefetchCritSect);
+
+	if (!mGroupTraceLoaded)
+		LoadGroupTrace();
+
+	if (mGroupTraceChanged)
+		SaveGroupTrace();
+
+	if (mMemoryCap > 0)
+		EnforceMemoryCap();
+
+	if (mPrefetchBudget == 0 || mResGroupMap.empty())
+		return;
+
+	// a group loading a resource per frame has the disk to itself
+	if (mCurResGroupList != NULL && mCurResGroupListItr != mCurResGroupList->end())
+		return;
+
+	if (mPrefetchDirty)
+		PredictGroups();
+
+	while ((int)mPrefetchRequests.size() < gMaxPrefetchRequests && mPrefetchBytes < mPrefetchBudget &&
+		   mPrefetchQueuePos < mPrefetchQueue.size())
+	{
+		BaseRes *aRes = mPrefetchQueue[mPrefetchQueuePos++];
+		if (IsResourceLoaded(aRes))
+			continue;
+
+		std::vector<std::string> aFileNames;
+		GetPrefetchFileNames(aRes, aFileNames);
+
+		for (const std::string &aFileName : aFileNames)
+		{
+			int anId = mApp->mAsyncIO->Request(aFileName, AsyncIO::PRIORITY_PREFETCH,
+											   [this](int theId, MappedFile *theFile) { PrefetchDone(theId, theFile); });
+			mPrefetchRequests[anId] = aRes;
+		}
+	}
+}
+
+void ResourceManager::SetPrefetchBudget(size_t theBytes)
+{
+	AutoCrit anAutoCrit(mPrefetchCritSect);
+
+	mPrefetchBudget = theBytes;
+	if (mPrefetchBudget == 0)
+		CancelPrefetch();
+
+	while (mPrefetchBytes > mPrefetchBudget && !mPrefetchedFiles.empty())
+	{
+		mPrefetchBytes -= mPrefetchedFiles.front().mFile->GetSize();
+		delete mPrefetchedFiles.front().mFile;
+		mPrefetchedFiles.pop_front();
+	}
+
+	mPrefetchDirty = true;
+}
+
+void ResourceManager::SetPrefetchGroupCount(int theCount)
+{
+	AutoCrit anAutoCrit(mPrefetchCritSect);
+
+	mPrefetchGroups = theCount;
+	mPrefetchDirty = true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+static void AddImageMemoryUsage(MemoryImage *theImage, ResourceManager::MemoryUsage &theUsage)
+{
+	if (theImage == NULL)
+		return;
+
+	theUsage.mBitsBytes += theImage->GetMemSize();
+
+	SDLTextureData *aData = (SDLTextureData *)theImage->mD3DData;
+	if (aData != NULL && aData->mTexture != NULL)
+		theUsage.mTextureBytes += aData->GetMemSize();
+}
+
+ResourceManager::MemoryUsage ResourceManager::GetMemoryUsage(BaseRes *theRes)
+{
+	MemoryUsage aUsage;
+	if (!IsResourceLoaded(theRes))
+		return aUsage;
+
+	aUsage.mNumLoaded = 1;
+
+	switch (theRes->mType)
+	{
+	case ResType_Image:
+		AddImageMemoryUsage((MemoryImage *)((ImageRes *)theRes)->mImage, aUsage);
+		break;
+
+	case ResType_Sound:
+		aUsage.mSoundBytes = mApp->mSoundManager->GetSoundSize(((SoundRes *)theRes)->mSoundId);
+		break;
+
+	case ResType_Font: {
+		ImageFont *anImageFont = dynamic_cast<ImageFont *>(((FontRes *)theRes)->mFont);
+		if (anImageFont == NULL || anImageFont->mFontData == NULL)
+			break;
+
+		FontLayerList &aLayerList = anImageFont->mFontData->mFontLayerList;
+		for (FontLayerList::iterator anItr = aLayerList.begin(); anItr != aLayerList.end(); ++anItr)
+			AddImageMemoryUsage((MemoryImage *)anItr->mImage, aUsage);
+		break;
+	}
+	}
+
+	return aUsage;
+}
+
+ResourceManager::MemoryUsage ResourceManager::GetResourceMemoryUsage(int type, const std::string &theId)
+{
+	BaseRes *aRes = GetBaseRes(type, theId);
+	if (aRes == NULL)
+		return MemoryUsage();
+
+	return GetMemoryUsage(aRes);
+}
+
+ResourceManager::MemoryUsage ResourceManager::GetGroupMemoryUsage(const std::string &theGroup)
+{
+	MemoryUsage aUsage;
+
+	ResGroupMap::iterator aGroupItr = mResGroupMap.find(theGroup);
+	if (aGroupItr == mResGroupMap.end())
+		return aUsage;
+
+	for (ResList::iterator anItr = aGroupItr->second.begin(); anItr != aGroupItr->second.end(); ++anItr)
+		aUsage.Add(GetMemoryUsage(*anItr));
+
+	return aUsage;
+}
+
+ResourceManager::MemoryUsage ResourceManager::GetTotalMemoryUsage()
+{
+	MemoryUsage aUsage;
+	for (BaseRes *aRes : mResources)
+		aUsage.Add(GetMemoryUsage(aRes));
+
+	return aUsage;
+}
+
+void ResourceManager::GetGroupNames(std::vector<std::string> &theGroups)
+{
+	for (ResGroupMap::iterator anItr = mResGroupMap.begin(); anItr != mResGroupMap.end(); ++anItr)
+		theGroups.push_back(anItr->first);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void ResourceManager::SetGroupPolicy(const std::string &theGroup, int thePolicy)
+{
+	mGroupPolicies[theGroup] = thePolicy;
+
+	// resources that couldn't be evicted before may be now
+	mMemoryUsageChanged = true;
+
+	if ((thePolicy & GROUPPOLICY_PURGEBITS) == 0)
+		return;
+
+	// images loaded before the policy was set drop their pixels now, the rest when they load
+	ResGroupMap::iterator aGroupItr = mResGroupMap.find(theGroup);
+	if (aGroupItr == mResGroupMap.end())
+		return;
+
+	for (ResList::iterator anItr = aGroupItr->second.begin(); anItr != aGroupItr->second.end(); ++anItr)
+	{
+		if ((*anItr)->mType != ResType_Image)
+			continue;
+
+		MemoryImage *anImage = (MemoryImage *)((ImageRes *)*anItr)->mImage;
+		if (anImage != NULL && !anImage->mPurgeBits)
+			anImage->PurgeBits();
+	}
+}
+
+int ResourceManager::GetGroupPolicy(const std::string &theGroup)
+{
+	GroupPolicyMap::iterator anItr = mGroupPolicies.find(theGroup);
+	if (anItr == mGroupPolicies.end())
+		return GROUPPOLICY_PIN;
+
+	return anItr->second;
+}
+
+void ResourceManager::SetMemoryCap(int64_t theBytes)
+{
+	mMemoryCap = theBytes;
+	mMemoryUsageChanged = true;
+}
+
+void ResourceManager::ReleaseResourceRef(ResourceRef *theRef)
+{
+	BaseRes *aRes = (BaseRes *)theRef->mBaseResP;
+	if (aRes != NULL && aRes->mRefCount > 0)
+	{
+		aRes->mRefCount--;
+		mMemoryUsageChanged = true;
+	}
+
+	delete theRef;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void ResourceManager::UseRes(BaseRes *theRes, bool isRef)
+{
+	theRes->mLastUsed = ++mUseCount;
+	if (isRef)
+		theRes->mRefTaken = true;
+	else
+		theRes->mHandedOut = true;
+
+	if (theRes->mEvicted && !IsResourceLoaded(theRes))
+	{
+		bool fromProgram;
+		DoLoadResource(theRes, &fromProgram);
+	}
+
+	theRes->mEvicted = false;
+}
+
+bool ResourceManager::CanEvict(BaseRes *theRes)
+{
+	int aPolicy = GetGroupPolicy(theRes->mResGroup);
+	if ((aPolicy & GROUPPOLICY_PIN) != 0 || (aPolicy & GROUPPOLICY_EVICT) == 0)
+		return false;
+
+	if (theRes->mFromProgram || theRes->mRefCount > 0 || !IsResourceLoaded(theRes))
+		return false;
+
+	// a plain pointer or id handed out once may still be in use, there's no telling when it's let go
+	if (!theRes->mRefTaken || theRes->mHandedOut)
+		return false;
+
+	// the group being loaded a resource per frame needs all of it
+	if (mCurResGroupList != NULL && mCurResGroupListItr != mCurResGroupList->end() &&
+		_stricmp(theRes->mResGroup.c_str(), mCurResGroup.c_str()) == 0)
+		return false;
+
+	switch (theRes->mType)
+	{
+	case ResType_Image: {
+		// a SharedImageRef held anywhere else keeps it
+		SharedImage *aSharedImage = ((ImageRes *)theRes)->mImage.mSharedImage;
+		return aSharedImage != NULL && aSharedImage->mRefCount == 1;
+	}
+
+	case ResType_Sound:
+		return !mApp->mSoundManager->IsSoundInUse(((SoundRes *)theRes)->mSoundId);
+
+	case ResType_Font:
+		// other fonts and widgets keep pointers to it
+		return false;
+	}
+
+	return false;
+}
+
+void ResourceManager::EnforceMemoryCap()
+{
+	// the total is a walk over every resource, only redone when something was loaded or deleted.
+	// textures created or dropped in between are counted the next time
+	if (!mMemoryUsageChanged.exchange(false))
+		return;
+
+	mMemoryUsed = GetTotalMemoryUsage().GetTotal();
+	if (mMemoryUsed <= mMemoryCap)
+		return;
+
+	std::vector<BaseRes *> aCandidates;
+	for (BaseRes *aRes : mResources)
+	{
+		if (CanEvict(aRes))
+			aCandidates.push_back(aRes);
+	}
+
+	std::sort(aCandidates.begin(), aCandidates.end(),
+			  [](BaseRes *a, BaseRes *b) { return a->mLastUsed < b->mLastUsed; });
+
+	// what can't be evicted now waits for the next load, delete or released reference
+	for (BaseRes *aRes : aCandidates)
+	{
+		if (mMemoryUsed <= mMemoryCap)
+			break;
+
+		mMemoryUsed -= GetMemoryUsage(aRes).GetTotal();
+		aRes->DeleteResource();
+		aRes->mEvicted = true;
+		mResourceGeneration++;
+
+		// LoadResources brings back what's missing
+		mLoadedGroups.erase(aRes->mResGroup);
+	}
+}
@@ -7,8 +7,10 @@
 #include "common.hpp"
 #include "graphics/image.hpp"
 #include "appbase.hpp"
+#include "misc/critsect.hpp"
 #include <string>
 #include <map>
+#include <atomic>
 
 namespace ImageLib
 {
@@ -20,10 +22,12 @@ namespace PopLib
 
 class XMLParser;
 class XMLElement;
+class ResourceManifest;
 class Image;
 class SoundInstance;
 class AppBase;
 class Font;
+class MappedFile;
 
 typedef std::map<std::string, std::string> StringToStringMap;
 typedef std::map<PopString, PopString> XMLParamMap;
@@ -32,6 +36,66 @@ typedef std::map<PopString, PopString> XMLParamMap;
 ///////////////////////////////////////////////////////////////////////////////
 class ResourceManager
 {
+	friend class HotReloader;
+
+  public:
+	/// @brief a resource id looked up once
+	///
+	/// resolve ids at load time with GetImageId and friends, then use the
+	/// overloads that take a ResourceId every frame: those are an array index
+	/// instead of a hashed string lookup. ids stay valid for the lifetime of
+	/// the ResourceManager, even across DeleteResources and reparsing.
+	struct ResourceId
+	{
+		int mIndex = -1;
+
+		bool IsValid() const
+		{
+			return mIndex >= 0;
+		}
+	};
+
+	/// @brief memory held by loaded resources
+	///
+	/// an image or font image shared by several resources is counted for each.
+	struct MemoryUsage
+	{
+		int64_t mBitsBytes = 0;	   ///< pixels and the buffers made from them, in system memory
+		int64_t mTextureBytes = 0; ///< SDL textures
+		int64_t mSoundBytes = 0;   ///< decoded sound
+		int mNumLoaded = 0;
+
+		int64_t GetTotal() const
+		{
+			return mBitsBytes + mTextureBytes + mSoundBytes;
+		}
+		void Add(const MemoryUsage &theUsage)
+		{
+			mBitsBytes += theUsage.mBitsBytes;
+			mTextureBytes += theUsage.mTextureBytes;
+			mSoundBytes += theUsage.mSoundBytes;
+			mNumLoaded += theUsage.mNumLoaded;
+		}
+	};
+
+	/// @brief what DoLoadImage does to an image resource's pixels after reading them
+	struct ImageComposition
+	{
+		uint32_t mAlphaColor = 0xFFFFFF; ///< color of an image that only has an alpha image
+		std::string mAlphaImage;
+		std::string mAlphaGridImage;
+		int mRows = 1;
+		int mCols = 1;
+	};
+
+	/// @brief what a group's resources may have done to them to stay under the memory cap, see SetGroupPolicy
+	enum
+	{
+		GROUPPOLICY_PIN = 0x01,		  ///< never unloaded by the cap, what groups get unless told otherwise
+		GROUPPOLICY_EVICT = 0x02,	  ///< unloaded when their ResourceRefs are released, least recently looked up first
+		GROUPPOLICY_PURGEBITS = 0x04, ///< images drop their pixels once they're in a texture
+	};
+
   protected:
 	enum ResType
 	{
@@ -43,12 +107,17 @@ class ResourceManager
 	struct BaseRes
 	{
 		int mRefCount = 0;
+		int mIndex = -1;
 		ResType mType;
 		std::string mId;
 		std::string mResGroup;
 		std::string mPath;
 		XMLParamMap mXMLAttributes;
 		bool mFromProgram;
+		bool mEvicted = false;	///< unloaded by the memory cap, looking it up loads it again
+		bool mRefTaken = false; ///< handed out through GetResourceRef
+		bool mHandedOut = false; ///< handed out by GetImage, GetSound or GetFont, which can't be taken back
+		uint64_t mLastUsed = 0; ///< ResourceManager::mUseCount when it was last looked up
 
 		virtual ~BaseRes()
 		{
@@ -123,7 +192,7 @@ class ResourceManager
 		virtual void DeleteResource();
 	};
 
-	typedef std::map<std::string, BaseRes *> ResMap;
+	typedef std::unordered_map<std::string, BaseRes *, StringHash, std::equal_to<>> ResMap;
 	typedef std::list<BaseRes *> ResList;
 	typedef std::map<std::string, ResList, StringLessNoCase> ResGroupMap;
 
@@ -132,6 +201,8 @@ class ResourceManager
 	ResMap mImageMap;
 	ResMap mSoundMap;
 	ResMap mFontMap;
+	/// @brief every resource ever parsed, indexed by ResourceId
+	std::vector<BaseRes *> mResources;
 
 	XMLParser *mXMLParser;
 	std::string mError;
@@ -148,6 +219,42 @@ class ResourceManager
 	ResList *mCurResGroupList;
 	ResList::iterator mCurResGroupListItr;
 
+	typedef std::map<std::string, int, StringLessNoCase> GroupCountMap;
+	typedef std::map<std::string, GroupCountMap, StringLessNoCase> GroupTraceMap;
+
+	struct PrefetchedFile
+	{
+		BaseRes *mRes;
+		MappedFile *mFile;
+		int mRound;
+	};
+
+	/// @brief how often each group was loaded right after another, "" being the start of a session
+	GroupTraceMap mGroupTrace;
+	bool mGroupTraceLoaded;
+	bool mGroupTraceChanged;
+	std::string mLastGroup;
+
+	std::vector<BaseRes *> mPrefetchQueue; ///< resources of the predicted groups, in load order
+	size_t mPrefetchQueuePos;
+	bool mPrefetchDirty;
+	int mPrefetchRound; ///< bumped every time the prediction changes
+	std::map<int, BaseRes *> mPrefetchRequests;
+	std::list<PrefetchedFile> mPrefetchedFiles; ///< oldest first
+	size_t mPrefetchBytes;
+	size_t mPrefetchBudget;
+	int mPrefetchGroups;
+	CritSect mPrefetchCritSect; ///< groups can be loaded on the loading thread while callbacks run on the main one
+
+	typedef std::map<std::string, int, StringLessNoCase> GroupPolicyMap;
+
+	GroupPolicyMap mGroupPolicies;
+	int64_t mMemoryCap;
+	int64_t mMemoryUsed; ///< GetTotalMemoryUsage as of the last load, delete or eviction
+	std::atomic<bool> mMemoryUsageChanged; ///< set when mMemoryUsed has to be walked again, groups load on other threads
+	std::atomic<uint32_t> mResourceGeneration; ///< bumped whenever a resource is loaded, deleted or replaced
+	uint64_t mUseCount;
+
 	bool Fail(const std::string &theErrorText);
 
 	virtual bool ParseCommonResource(XMLElement &theElement, BaseRes *theRes, ResMap &theMap);
@@ -157,12 +264,17 @@ class ResourceManager
 	virtual bool ParsePopAnimResource(XMLElement &theElement);
 	virtual bool ParsePIEffectResource(XMLElement &theElement);
 	virtual bool ParseSetDefaults(XMLElement &theElement);
+	virtual bool ParseResourceElement(XMLElement &theElement);
 	virtual bool ParseResources();
+	bool ParseCompiledManifest(const ResourceManifest &theManifest);
 
 	bool DoParseResources();
 	void DeleteMap(ResMap &theMap);
 	virtual void DeleteResources(ResMap &theMap, const std::string &theGroup);
 
+	static ImageComposition GetImageComposition(ImageRes *theRes);
+	static ImageLib::Image *LoadComposedImage(const std::string &thePath, const ImageComposition &theComposition);
+	ImageRes *FindImageRes(MemoryImage *theImage);
 	bool LoadAlphaGridImage(ImageRes *theRes, SDLImage *theImage);
 	bool LoadAlphaImage(ImageRes *theRes, SDLImage *theImage);
 	virtual bool DoLoadImage(ImageRes *theRes);
@@ -171,6 +283,23 @@ class ResourceManager
 	virtual bool DoLoadResource(BaseRes *theRes, bool *fromProgram);
 
 	int GetNumResources(const std::string &theGroup, ResMap &theMap);
+	BaseRes *GetRes(ResType theType, ResourceId theId);
+
+	void LoadGroupTrace();
+	void SaveGroupTrace();
+	void RecordGroupRequest(const std::string &theGroup);
+	void PredictGroups();
+	bool IsResourceLoaded(BaseRes *theRes);
+	void GetPrefetchFileNames(BaseRes *theRes, std::vector<std::string> &theFileNames);
+	void GetImageFileNames(const std::string &thePath, std::vector<std::string> &theFileNames);
+	void PrefetchDone(int theId, MappedFile *theFile);
+	void ReleasePrefetched(const std::string &theGroup);
+	void CancelPrefetch();
+
+	MemoryUsage GetMemoryUsage(BaseRes *theRes);
+	bool CanEvict(BaseRes *theRes);
+	void UseRes(BaseRes *theRes, bool isRef = false);
+	void EnforceMemoryCap();
 
   public:
 	ResourceManager(AppBase *theApp);
@@ -200,6 +329,14 @@ class ResourceManager
 
 	void DeleteImage(const std::string &theName);
 	SharedImageRef LoadImage(const std::string &theName);
+	/// @brief reads an image's pixels from its file again, the way DoLoadImage made them
+	///
+	/// the alpha color, alpha image and alpha grid of the image resource that
+	/// loaded it are applied again. used to bring back the bits of an image
+	/// whose bits were purged and whose texture was evicted.
+	/// @param theImage its mBits are overwritten without counting as a change
+	/// @return false if a file is missing or changed size
+	bool ReloadImageBits(MemoryImage *theImage);
 
 	void DeleteFont(const std::string &theName);
 	Font *LoadFont(const std::string &theName);
@@ -208,6 +345,23 @@ class ResourceManager
 	int GetSound(const std::string &theId);
 	Font *GetFont(const std::string &theId);
 
+	/// @brief interns an image id
+	/// @param theId
+	/// @return an invalid id if there's no such image
+	ResourceId GetImageId(const std::string &theId);
+	/// @brief interns a sound id
+	/// @param theId
+	/// @return an invalid id if there's no such sound
+	ResourceId GetSoundId(const std::string &theId);
+	/// @brief interns a font id
+	/// @param theId
+	/// @return an invalid id if there's no such font
+	ResourceId GetFontId(const std::string &theId);
+
+	SharedImageRef GetImage(ResourceId theId);
+	int GetSound(ResourceId theId);
+	Font *GetFont(ResourceId theId);
+
 	BaseRes *GetBaseRes(int type, const std::string &theId);
 	ResourceRef *GetFontRef(const std::string &theId);
 	ResourceRef *GetResourceRef(int type, const std::string &theId);
@@ -226,6 +380,76 @@ class ResourceManager
 	virtual void DeleteResources(const std::string &theGroup);
 	void DeleteExtraImageBuffers(const std::string &theGroup);
 
+	/// @brief reads ahead the groups that usually get loaded after the last one, call once per update
+	///
+	/// every StartLoadResources is remembered as coming after the group before
+	/// it, in the registry, so the guesses carry over between sessions. while
+	/// no group is loading, the files of the likeliest next groups are read in
+	/// by AsyncIO at prefetch priority and held until their group loads.
+	/// decoding still happens on load, what's saved is the wait on the disk.
+	/// also unloads evictable resources while over the memory cap, see SetMemoryCap.
+	void Update();
+	/// @brief caps the bytes held for groups that haven't been loaded yet
+	/// @param theBytes 0 turns prefetching off
+	void SetPrefetchBudget(size_t theBytes);
+	/// @brief sets how many of the likeliest next groups get read ahead
+	/// @param theCount
+	void SetPrefetchGroupCount(int theCount);
+	/// @brief bytes currently held for groups that haven't been loaded yet
+	/// @return the count
+	size_t GetPrefetchedBytes()
+	{
+		return mPrefetchBytes;
+	}
+
+	/// @brief memory held by one resource
+	/// @param type 0 for an image, 1 for a sound, 2 for a font
+	/// @param theId
+	/// @return all zero if it's not loaded or there's no such resource
+	MemoryUsage GetResourceMemoryUsage(int type, const std::string &theId);
+	/// @brief memory held by the loaded resources of a group
+	/// @param theGroup
+	/// @return the sum
+	MemoryUsage GetGroupMemoryUsage(const std::string &theGroup);
+	/// @brief memory held by every loaded resource
+	/// @return the sum
+	MemoryUsage GetTotalMemoryUsage();
+	/// @brief gets the names of all groups parsed so far
+	/// @param theGroups
+	void GetGroupNames(std::vector<std::string> &theGroups);
+
+	/// @brief sets what can be done to a group's resources to stay under the memory cap
+	///
+	/// GROUPPOLICY_EVICT only unloads resources that were taken with
+	/// GetResourceRef and whose references were all released. anything ever
+	/// handed out as a plain Image, Font or sound id by GetImage, GetSound or
+	/// GetFont stays, it may be kept around, and fonts always stay. evicted
+	/// resources load again when looked up.
+	/// @param theGroup
+	/// @param thePolicy GROUPPOLICY_ flags
+	void SetGroupPolicy(const std::string &theGroup, int thePolicy);
+	/// @brief gets a group's policy
+	/// @param theGroup
+	/// @return GROUPPOLICY_ flags
+	int GetGroupPolicy(const std::string &theGroup);
+	/// @brief unloads resources of evictable groups from Update while the total memory usage is above this
+	///
+	/// the total is only summed up again after a resource is loaded or deleted,
+	/// so textures created in between count from the next load on. textures
+	/// are also capped by SDLInterface::SetTextureBudget, which drops only the
+	/// texture and keeps the resource.
+	/// @param theBytes 0 for no cap
+	void SetMemoryCap(int64_t theBytes);
+	/// @brief gets the memory cap
+	/// @return bytes, 0 if there's none
+	int64_t GetMemoryCap()
+	{
+		return mMemoryCap;
+	}
+	/// @brief gives back a reference taken with GetResourceRef and deletes it
+	/// @param theRef
+	void ReleaseResourceRef(ResourceRef *theRef);
+
 	const ResList *GetCurResGroupList()
 	{
 		return mCurResGroupList;
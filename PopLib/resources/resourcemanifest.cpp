@@ -0,0 +1,303 @@
+#include "resourcemanifest.hpp"
+#include "readwrite/xmlparser.hpp"
+
+#include <filesystem>
+#include <unordered_map>
+
+using namespace PopLib;
+
+ResourceManifest::ResourceManifest()
+{
+	Close();
+}
+
+ResourceManifest::~ResourceManifest()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+std::string ResourceManifest::GetCompiledFileName(const std::string &theXMLFileName)
+{
+	return theXMLFileName + ".bin";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool ResourceManifest::GetSourceStamp(const std::string &theXMLFileName, uint64_t *theSize, int64_t *theTime)
+{
+	std::error_code anError;
+	std::filesystem::path aPath(theXMLFileName);
+
+	uint64_t aSize = std::filesystem::file_size(aPath, anError);
+	if (anError)
+		return false;
+
+	auto aTime = std::filesystem::last_write_time(aPath, anError);
+	if (anError)
+		return false;
+
+	*theSize = aSize;
+	*theTime = (int64_t)aTime.time_since_epoch().count();
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+uint64_t ResourceManifest::HashFile(const std::string &theFileName)
+{
+	// FNV-1a
+	uint64_t aHash = 14695981039346656037ULL;
+
+	FILE *aFile = fopen(theFileName.c_str(), "rb");
+	if (aFile == nullptr)
+		return aHash;
+
+	uint8_t aBuffer[16384];
+	size_t aRead;
+	while ((aRead = fread(aBuffer, 1, sizeof(aBuffer), aFile)) > 0)
+	{
+		for (size_t i = 0; i < aRead; i++)
+			aHash = (aHash ^ aBuffer[i]) * 1099511628211ULL;
+	}
+	fclose(aFile);
+
+	return aHash;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool ResourceManifest::Compile(const std::string &theXMLFileName, const std::string &theOutFileName,
+							   std::string *theError)
+{
+	std::string anError;
+	std::string &aError = theError != nullptr ? *theError : anError;
+
+	std::vector<StringEntry> aStrings;
+	std::string aStringData;
+	std::unordered_map<std::string, uint32_t> aStringMap;
+	std::vector<Group> aGroups;
+	std::vector<Record> aRecords;
+	std::vector<Attribute> anAttributes;
+
+	auto anAddString = [&](const std::string &theString) -> uint32_t {
+		auto anItr = aStringMap.find(theString);
+		if (anItr != aStringMap.end())
+			return anItr->second;
+
+		uint32_t anIndex = (uint32_t)aStrings.size();
+		aStrings.push_back({(uint32_t)aStringData.size(), (uint32_t)theString.size()});
+		aStringData += theString;
+		aStringData += '\0';
+		aStringMap[theString] = anIndex;
+		return anIndex;
+	};
+
+	XMLParser aParser;
+	if (!aParser.OpenFile(theXMLFileName))
+	{
+		aError = aParser.GetErrorText();
+		return false;
+	}
+
+	auto aFail = [&](const std::string &theText) {
+		aError = StrFormat("%s on line %d in %s", theText.c_str(), aParser.GetCurrentLineNum(),
+						   theXMLFileName.c_str());
+		return false;
+	};
+
+	XMLElement anElement;
+	for (;;)
+	{
+		if (!aParser.NextElement(&anElement))
+			return aFail("Expecting ResourceManifest tag");
+
+		if (anElement.mType == XMLElement::TYPE_START)
+		{
+			if (anElement.mValue != "ResourceManifest")
+				return aFail("Expecting ResourceManifest tag");
+			break;
+		}
+	}
+
+	Group *aGroup = nullptr;
+	bool inRecord = false;
+	while (aParser.NextElement(&anElement))
+	{
+		if (anElement.mType == XMLElement::TYPE_START)
+		{
+			if (aGroup == nullptr)
+			{
+				if (anElement.mValue != "Resources")
+					return aFail("Invalid Section '" + anElement.mValue + "'");
+
+				const PopString &anId = anElement.mAttributes["id"];
+				if (anId.empty())
+					return aFail("No id specified.");
+
+				aGroups.push_back({anAddString(anId), (uint32_t)aRecords.size(), 0});
+				aGroup = &aGroups.back();
+			}
+			else if (!inRecord)
+			{
+				Record aRecord = {anAddString(anElement.mValue), (uint32_t)anAttributes.size(), 0};
+				for (const auto &anAttribute : anElement.mAttributes)
+				{
+					anAttributes.push_back({anAddString(anAttribute.first), anAddString(anAttribute.second)});
+					aRecord.mNumAttributes++;
+				}
+
+				aRecords.push_back(aRecord);
+				aGroup->mNumRecords++;
+				inRecord = true;
+			}
+			else
+				return aFail("Unexpected element found.");
+		}
+		else if (anElement.mType == XMLElement::TYPE_ELEMENT)
+			return aFail("Element Not Expected '" + anElement.mValue + "'");
+		else if (anElement.mType == XMLElement::TYPE_END)
+		{
+			if (inRecord)
+				inRecord = false;
+			else if (aGroup != nullptr)
+				aGroup = nullptr;
+			else
+				break;
+		}
+	}
+
+	if (aParser.HasFailed())
+	{
+		aError = aParser.GetErrorText();
+		return false;
+	}
+
+	Header aHeader = {};
+	memcpy(aHeader.mMagic, "PRES", 4);
+	aHeader.mVersion = VERSION;
+	GetSourceStamp(theXMLFileName, &aHeader.mSourceSize, &aHeader.mSourceTime);
+	aHeader.mSourceHash = HashFile(theXMLFileName);
+	aHeader.mNumStrings = (uint32_t)aStrings.size();
+	aHeader.mNumGroups = (uint32_t)aGroups.size();
+	aHeader.mNumRecords = (uint32_t)aRecords.size();
+	aHeader.mNumAttributes = (uint32_t)anAttributes.size();
+	aHeader.mStringDataSize = (uint32_t)aStringData.size();
+
+	FILE *aFile = fopen(theOutFileName.c_str(), "wb");
+	if (aFile == nullptr)
+	{
+		aError = "Unable to write " + theOutFileName;
+		return false;
+	}
+
+	bool success = fwrite(&aHeader, sizeof(aHeader), 1, aFile) == 1;
+	success = success && fwrite(aStrings.data(), sizeof(StringEntry), aStrings.size(), aFile) == aStrings.size();
+	success = success && fwrite(aGroups.data(), sizeof(Group), aGroups.size(), aFile) == aGroups.size();
+	success = success && fwrite(aRecords.data(), sizeof(Record), aRecords.size(), aFile) == aRecords.size();
+	success = success &&
+			  fwrite(anAttributes.data(), sizeof(Attribute), anAttributes.size(), aFile) == anAttributes.size();
+	success = success && fwrite(aStringData.data(), 1, aStringData.size(), aFile) == aStringData.size();
+	fclose(aFile);
+
+	if (!success)
+		aError = "Unable to write " + theOutFileName;
+
+	return success;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool ResourceManifest::Open(const std::string &theFileName)
+{
+	Close();
+
+	if (!mFile.Open(theFileName) || mFile.GetSize() < sizeof(Header))
+	{
+		Close();
+		return false;
+	}
+
+	const uint8_t *aData = mFile.GetData();
+	const Header *aHeader = (const Header *)aData;
+	if (memcmp(aHeader->mMagic, "PRES", 4) != 0 || aHeader->mVersion != VERSION)
+	{
+		Close();
+		return false;
+	}
+
+	uint64_t aSize = sizeof(Header);
+	aSize += (uint64_t)aHeader->mNumStrings * sizeof(StringEntry);
+	aSize += (uint64_t)aHeader->mNumGroups * sizeof(Group);
+	aSize += (uint64_t)aHeader->mNumRecords * sizeof(Record);
+	aSize += (uint64_t)aHeader->mNumAttributes * sizeof(Attribute);
+	aSize += aHeader->mStringDataSize;
+	if (aSize != mFile.GetSize())
+	{
+		Close();
+		return false;
+	}
+
+	mHeader = aHeader;
+	mStrings = (const StringEntry *)(aData + sizeof(Header));
+	mGroups = (const Group *)(mStrings + aHeader->mNumStrings);
+	mRecords = (const Record *)(mGroups + aHeader->mNumGroups);
+	mAttributes = (const Attribute *)(mRecords + aHeader->mNumRecords);
+	mStringData = (const char *)(mAttributes + aHeader->mNumAttributes);
+
+	// the tables are trusted from here on, so check every index once
+	bool isValid = true;
+	for (uint32_t i = 0; i < aHeader->mNumStrings && isValid; i++)
+		isValid = (uint64_t)mStrings[i].mOffset + mStrings[i].mLength < aHeader->mStringDataSize;
+	for (uint32_t i = 0; i < aHeader->mNumGroups && isValid; i++)
+		isValid = mGroups[i].mId < aHeader->mNumStrings &&
+				  (uint64_t)mGroups[i].mFirstRecord + mGroups[i].mNumRecords <= aHeader->mNumRecords;
+	for (uint32_t i = 0; i < aHeader->mNumRecords && isValid; i++)
+		isValid = mRecords[i].mName < aHeader->mNumStrings &&
+				  (uint64_t)mRecords[i].mFirstAttribute + mRecords[i].mNumAttributes <= aHeader->mNumAttributes;
+	for (uint32_t i = 0; i < aHeader->mNumAttributes && isValid; i++)
+		isValid = mAttributes[i].mKey < aHeader->mNumStrings && mAttributes[i].mValue < aHeader->mNumStrings;
+
+	if (!isValid)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void ResourceManifest::Close()
+{
+	mFile.Close();
+	mHeader = nullptr;
+	mStrings = nullptr;
+	mGroups = nullptr;
+	mRecords = nullptr;
+	mAttributes = nullptr;
+	mStringData = nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool ResourceManifest::IsStale(const std::string &theXMLFileName) const
+{
+	if (mHeader == nullptr)
+		return true;
+
+	uint64_t aSize;
+	int64_t aTime;
+	if (!GetSourceStamp(theXMLFileName, &aSize, &aTime))
+		return false; // shipped without the XML
+
+	if (aSize != mHeader->mSourceSize)
+		return true;
+
+	if (aTime == mHeader->mSourceTime)
+		return false;
+
+	// copying files around changes the time, only the contents matter
+	return HashFile(theXMLFileName) != mHeader->mSourceHash;
+}
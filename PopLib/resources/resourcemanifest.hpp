@@ -0,0 +1,140 @@
+#ifndef __RESOURCEMANIFEST_HPP__
+#define __RESOURCEMANIFEST_HPP__
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "common.hpp"
+#include "misc/mappedfile.hpp"
+
+#include <string_view>
+
+namespace PopLib
+{
+
+/**
+ * @brief resources.xml compiled into flat tables
+ *
+ * the compiler keeps every element of the manifest in order, SetDefaults
+ * included, so ResourceManager can replay it through the same code that
+ * handles the XML. all strings are stored once in a string table. the file
+ * is memory mapped and read in place, there is no parsing step at all.
+ *
+ * the source file's size, modification time and hash are stored in the
+ * header. if the XML next to it changed, the compiled file is stale and the
+ * XML is used instead.
+ */
+class ResourceManifest
+{
+  public:
+	enum
+	{
+		VERSION = 1
+	};
+
+	struct Header
+	{
+		char mMagic[4]; ///< "PRES"
+		uint32_t mVersion;
+		uint64_t mSourceSize;
+		int64_t mSourceTime;
+		uint64_t mSourceHash;
+		uint32_t mNumStrings;
+		uint32_t mNumGroups;
+		uint32_t mNumRecords;
+		uint32_t mNumAttributes;
+		uint32_t mStringDataSize;
+		uint32_t mReserved;
+	};
+
+	struct StringEntry
+	{
+		uint32_t mOffset;
+		uint32_t mLength;
+	};
+
+	/// @brief a Resources element
+	struct Group
+	{
+		uint32_t mId;
+		uint32_t mFirstRecord;
+		uint32_t mNumRecords;
+	};
+
+	/// @brief an element inside a group, like Image or SetDefaults
+	struct Record
+	{
+		uint32_t mName;
+		uint32_t mFirstAttribute;
+		uint32_t mNumAttributes;
+	};
+
+	struct Attribute
+	{
+		uint32_t mKey;
+		uint32_t mValue;
+	};
+
+  public:
+	ResourceManifest();
+	virtual ~ResourceManifest();
+
+	/// @brief gets the name of the compiled file that belongs to a manifest
+	/// @param theXMLFileName e.g. properties/resources.xml
+	/// @return e.g. properties/resources.xml.bin
+	static std::string GetCompiledFileName(const std::string &theXMLFileName);
+	/// @brief compiles a manifest
+	/// @param theXMLFileName
+	/// @param theOutFileName
+	/// @param theError receives the reason on failure, can be null
+	/// @return true if success
+	static bool Compile(const std::string &theXMLFileName, const std::string &theOutFileName,
+						std::string *theError = nullptr);
+
+	/// @brief maps a compiled manifest and checks its tables
+	/// @param theFileName
+	/// @return false if it's missing, from another version or damaged
+	bool Open(const std::string &theFileName);
+	void Close();
+	/// @brief checks the stamp against the XML the file was compiled from
+	/// @param theXMLFileName
+	/// @return true if the XML exists on disk and changed since
+	bool IsStale(const std::string &theXMLFileName) const;
+
+	int GetNumGroups() const
+	{
+		return mHeader->mNumGroups;
+	}
+	const Group &GetGroup(int theIndex) const
+	{
+		return mGroups[theIndex];
+	}
+	const Record &GetRecord(int theIndex) const
+	{
+		return mRecords[theIndex];
+	}
+	const Attribute &GetAttribute(int theIndex) const
+	{
+		return mAttributes[theIndex];
+	}
+	std::string_view GetString(uint32_t theIndex) const
+	{
+		return std::string_view(mStringData + mStrings[theIndex].mOffset, mStrings[theIndex].mLength);
+	}
+
+  protected:
+	MappedFile mFile;
+	const Header *mHeader;
+	const StringEntry *mStrings;
+	const Group *mGroups;
+	const Record *mRecords;
+	const Attribute *mAttributes;
+	const char *mStringData;
+
+	static bool GetSourceStamp(const std::string &theXMLFileName, uint64_t *theSize, int64_t *theTime);
+	static uint64_t HashFile(const std::string &theFileName);
+};
+
+} // namespace PopLib
+
+#endif
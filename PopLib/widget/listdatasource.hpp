@@ -0,0 +1,54 @@
+#ifndef __LISTDATASOURCE_HPP__
+#define __LISTDATASOURCE_HPP__
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "common.hpp"
+#include "graphics/color.hpp"
+
+namespace PopLib
+{
+
+/**
+ * @brief supplies the rows of a virtual ListWidget
+ *
+ * the list only asks for the rows it is about to draw, so the source can
+ * hold any number of them in whatever form it likes. rows are numbered in
+ * the source's own order; sorting is done by the list.
+ */
+class ListDataSource
+{
+  public:
+	virtual ~ListDataSource()
+	{
+	}
+
+	/// @brief number of rows
+	/// @param theId id of the asking list
+	virtual int GetRowCount(int theId) = 0;
+	/// @brief text shown for a row
+	/// @param theId id of the asking list
+	/// @param theRow
+	virtual PopString GetRowText(int theId, int theRow) = 0;
+	/// @brief color of a row's text
+	/// @param theId id of the asking list
+	/// @param theRow
+	/// @param theColor receives the color
+	/// @return false to use the list's COLOR_TEXT
+	virtual bool GetRowColor(int theId, int theRow, Color *theColor)
+	{
+		return false;
+	}
+	/// @brief key the list sorts by, the row text by default
+	/// @param theId id of the asking list
+	/// @param theRow
+	virtual PopString GetRowSortKey(int theId, int theRow)
+	{
+		return GetRowText(theId, theRow);
+	}
+};
+
+} // namespace PopLib
+
+#endif
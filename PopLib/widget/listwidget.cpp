@@ -3,8 +3,12 @@
 #include "widgetmanager.hpp"
 #include "scrollbarwidget.hpp"
 #include "listlistener.hpp"
+#include "listdatasource.hpp"
 #include "appbase.hpp"
 
+#include <algorithm>
+#include <numeric>
+
 using namespace PopLib;
 
 static int gInitialListWidgetColors[][3] = {{255, 255, 255}, {255, 255, 255}, {0, 0, 0},
@@ -36,6 +40,10 @@ ListWidget::ListWidget(int theId, Font *theFont, ListListener *theListListener)
 	mMaxNumericPlaces = 0;
 	mDrawSelectWhenHilited = false;
 	mDoFingerWhenHilited = true;
+	mDataSource = NULL;
+	mRowCacheFirst = 0;
+	mSortList = NULL;
+	mSortAscending = true;
 }
 
 ListWidget::~ListWidget()
@@ -49,8 +57,152 @@ void ListWidget::RemovedFromManager(WidgetManager *theManager)
 		mListListener->ListClosed(mId);
 }
 
+ListWidget *ListWidget::GetListRoot()
+{
+	ListWidget *aListWidget = this;
+	while (aListWidget->mParent != NULL)
+		aListWidget = aListWidget->mParent;
+
+	return aListWidget;
+}
+
+int ListWidget::GetRow(int theIdx)
+{
+	ListWidget *aRoot = GetListRoot();
+	return aRoot->mRowOrder.empty() ? theIdx : aRoot->mRowOrder[theIdx];
+}
+
+PopString ListWidget::GetRowSortKey(int theRow)
+{
+	// columns can be fed differently, so a child without a source falls back to its own lines,
+	// and a row it doesn't have sorts as empty
+	PopString aString;
+	if (mDataSource != NULL)
+	{
+		if ((theRow >= 0) && (theRow < mDataSource->GetRowCount(mId)))
+			aString = mDataSource->GetRowSortKey(mId, theRow);
+	}
+	else if ((theRow >= 0) && (theRow < (int)mLines.size()))
+		aString = mLines[theRow];
+
+	while (aString.length() < (ulong)mMaxNumericPlaces)
+		aString = "0" + aString;
+
+	if (mChild == NULL)
+		return aString;
+	else if (mSortFromChild)
+		return mChild->GetRowSortKey(theRow) + aString;
+	else
+		return aString + mChild->GetRowSortKey(theRow);
+}
+
+void ListWidget::SetDataSource(ListDataSource *theDataSource)
+{
+	mDataSource = theDataSource;
+	mLines.clear();
+	mLineColors.clear();
+
+	ListWidget *aRoot = GetListRoot();
+	aRoot->mRowOrder.clear();
+	aRoot->mSortKeys.clear();
+	aRoot->mSortList = NULL;
+
+	InvalidateRows();
+}
+
+void ListWidget::DataChanged()
+{
+	ListWidget *aRoot = GetListRoot();
+	if (aRoot->mSortList != NULL)
+	{
+		// also invalidates the rows
+		aRoot->mSortList->Sort(aRoot->mSortAscending);
+		return;
+	}
+
+	aRoot->mRowOrder.clear();
+	InvalidateRows();
+}
+
+void ListWidget::RowsAdded(int theFirstRow, int theCount)
+{
+	ListWidget *aRoot = GetListRoot();
+	ListWidget *aSortList = aRoot->mSortList;
+
+	if (aSortList != NULL)
+	{
+		if (theFirstRow != (int)aRoot->mSortKeys.size())
+		{
+			// not appended after the rows we know about
+			DataChanged();
+			return;
+		}
+
+		std::vector<int> &anOrder = aRoot->mRowOrder;
+		PopStringVector &aKeys = aRoot->mSortKeys;
+		bool ascending = aRoot->mSortAscending;
+
+		for (int aRow = theFirstRow; aRow < theFirstRow + theCount; aRow++)
+		{
+			aKeys.push_back(aSortList->GetRowSortKey(aRow));
+
+			// after any equal keys, like a stable sort would put it
+			auto anItr = std::upper_bound(anOrder.begin(), anOrder.end(), aRow, [&aKeys, ascending](int a, int b) {
+				return ascending ? aKeys[a] < aKeys[b] : aKeys[b] < aKeys[a];
+			});
+			anOrder.insert(anItr, aRow);
+		}
+	}
+
+	InvalidateRows();
+}
+
+void ListWidget::CacheRows(int theFirstIdx, int theLastIdx)
+{
+	if (theFirstIdx >= mRowCacheFirst && theLastIdx < mRowCacheFirst + (int)mRowCache.size())
+		return;
+
+	mRowCacheFirst = theFirstIdx;
+	mRowCache.resize(std::max(0, theLastIdx - theFirstIdx + 1));
+
+	for (int i = 0; i < (int)mRowCache.size(); i++)
+	{
+		ListRow &aListRow = mRowCache[i];
+		int aRow = GetRow(theFirstIdx + i);
+
+		aListRow.mText = mDataSource->GetRowText(mId, aRow);
+		aListRow.mHasColor = mDataSource->GetRowColor(mId, aRow, &aListRow.mColor);
+		aListRow.mTextWidth = mFont->StringWidth(aListRow.mText);
+	}
+}
+
+void ListWidget::InvalidateRows()
+{
+	ListWidget *aListWidget = GetListRoot();
+
+	while (aListWidget != NULL)
+	{
+		aListWidget->mRowCache.clear();
+
+		int aCount = aListWidget->GetLineCount();
+		if (aListWidget->mSelectIdx >= aCount)
+			aListWidget->mSelectIdx = -1;
+		if (aListWidget->mHiliteIdx >= aCount)
+			aListWidget->mHiliteIdx = -1;
+
+		if (aListWidget->mScrollbar != NULL)
+			aListWidget->mScrollbar->SetMaxValue(aCount);
+
+		aListWidget->MarkDirty();
+		aListWidget = aListWidget->mChild;
+	}
+}
+
 PopString ListWidget::GetSortKey(int theIdx)
 {
+	if (mDataSource != NULL)
+		return GetRowSortKey(GetRow(theIdx));
+
 	PopString aString = mLines[theIdx];
 
 	while (aString.length() < (ulong)mMaxNumericPlaces)
@@ -71,36 +223,47 @@ PopString ListWidget::GetSortKey(int theIdx)
 
 void ListWidget::Sort(bool ascending)
 {
+	if (mDataSource != NULL)
+	{
+		// only the order is sorted, the source keeps its rows where they are
+		ListWidget *aRoot = GetListRoot();
+		int aCount = mDataSource->GetRowCount(mId);
+
+		PopStringVector &aKeys = aRoot->mSortKeys;
+		aKeys.resize(aCount);
+		for (int aRow = 0; aRow < aCount; aRow++)
+			aKeys[aRow] = GetRowSortKey(aRow);
+
+		std::vector<int> &anOrder = aRoot->mRowOrder;
+		anOrder.resize(aCount);
+		std::iota(anOrder.begin(), anOrder.end(), 0);
+		std::stable_sort(anOrder.begin(), anOrder.end(), [&aKeys, ascending](int a, int b) {
+			return ascending ? aKeys[a] < aKeys[b] : aKeys[b] < aKeys[a];
+		});
+
+		aRoot->mSortList = this;
+		aRoot->mSortAscending = ascending;
+
+		InvalidateRows();
+		return;
+	}
+
 	int aCount = mLines.size();
-	int *aMap = new int[aCount];
-	PopString *aKeys = new PopString[aCount];
+	std::vector<int> aMap(aCount);
+	PopStringVector aKeys(aCount);
 
-	int i;
-	for (i = 0; i < aCount; i++)
+	for (int i = 0; i < aCount; i++)
 	{
 		aMap[i] = i;
 		aKeys[i] = GetSortKey(i);
 	}
 
-	for (i = 1; i < aCount; i++)
-		for (int j = 0; j < aCount - i; j++)
-		{
-			int aComp = aKeys[j].compare(aKeys[j + 1]);
-			if ((ascending && (aComp > 0)) || (!ascending && (aComp < 0)))
-			{
-				int aSwapInt = aMap[j];
-				aMap[j] = aMap[j + 1];
-				aMap[j + 1] = aSwapInt;
-
-				PopString aSwapKey = aKeys[j];
-				aKeys[j] = aKeys[j + 1];
-				aKeys[j + 1] = aSwapKey;
-			}
-		}
+	// stable, equal lines keep their order like they did with the old bubble sort
+	std::stable_sort(aMap.begin(), aMap.end(), [&aKeys, ascending](int a, int b) {
+		return ascending ? aKeys[a] < aKeys[b] : aKeys[b] < aKeys[a];
+	});
 
-	ListWidget *aListWidget = this;
-	while (aListWidget->mParent != NULL)
-		aListWidget = aListWidget->mParent;
+	ListWidget *aListWidget = GetListRoot();
 
 	while (aListWidget != NULL)
 	{
@@ -120,13 +283,13 @@ void ListWidget::Sort(bool ascending)
 
 		aListWidget = aListWidget->mChild;
 	}
-
-	delete aMap;
-	delete aKeys;
 }
 
 PopString ListWidget::GetStringAt(int theIdx)
 {
+	if (mDataSource != NULL)
+		return mDataSource->GetRowText(mId, GetRow(theIdx));
+
 	return mLines[theIdx];
 }
 
@@ -151,6 +314,9 @@ int ListWidget::AddLine(const PopString &theLine, bool alphabetical)
 	int anIdx = -1;
 	bool inserted = false;
 
+	if (mDataSource != NULL)
+		return -1;
+
 	if (alphabetical)
 	{
 		for (int i = 0; i < (int)mLines.size(); i++)
@@ -212,17 +378,33 @@ int ListWidget::AddLine(const PopString &theLine, bool alphabetical)
 
 void ListWidget::SetLine(int theIdx, const PopString &theString)
 {
+	if (mDataSource != NULL)
+		return;
+
 	mLines[theIdx] = theString;
 	MarkDirty();
 }
 
 int ListWidget::GetLineCount()
 {
+	if (mDataSource != NULL)
+		return mDataSource->GetRowCount(mId);
+
 	return mLines.size();
 }
 
 int ListWidget::GetLineIdx(const PopString &theLine)
 {
+	if (mDataSource != NULL)
+	{
+		int aCount = GetLineCount();
+		for (int i = 0; i < aCount; i++)
+			if (GetStringAt(i) == theLine)
+				return i;
+
+		return -1;
+	}
+
 	for (ulong i = 0; i < mLines.size(); i++)
 		if (strcmp(mLines[i].c_str(), theLine.c_str()) == 0)
 			return i;
@@ -243,7 +425,7 @@ void ListWidget::SetColor(int theIdx, const Color &theColor)
 
 void ListWidget::SetLineColor(int theIdx, const Color &theColor)
 {
-	if ((theIdx >= 0) && (theIdx < (int)mLines.size()))
+	if ((mDataSource == NULL) && (theIdx >= 0) && (theIdx < (int)mLines.size()))
 	{
 		ListWidget *aListWidget = this;
 
@@ -262,6 +444,9 @@ void ListWidget::SetLineColor(int theIdx, const Color &theColor)
 
 void ListWidget::RemoveLine(int theIdx)
 {
+	if (mDataSource != NULL)
+		return;
+
 	if (theIdx != -1)
 	{
 		ListWidget *aListWidget = this;
@@ -285,6 +470,9 @@ void ListWidget::RemoveLine(int theIdx)
 
 void ListWidget::RemoveAll()
 {
+	if (mDataSource != NULL)
+		return;
+
 	ListWidget *aListWidget = this;
 
 	while (aListWidget->mParent != NULL)
@@ -309,8 +497,9 @@ int ListWidget::GetOptimalWidth()
 {
 	int aMaxWidth = 0;
 
-	for (ulong i = 0; i < mLines.size(); i++)
-		aMaxWidth = std::max(aMaxWidth, mFont->StringWidth(mLines[i]));
+	int aCount = GetLineCount();
+	for (int i = 0; i < aCount; i++)
+		aMaxWidth = std::max(aMaxWidth, mFont->StringWidth(GetStringAt(i)));
 
 	return aMaxWidth + 16;
 }
@@ -319,7 +508,7 @@ int ListWidget::GetOptimalHeight()
 {
 	int anItemHeight = (mItemHeight != -1) ? mItemHeight : mFont->GetHeight();
 
-	return anItemHeight * mLines.size() + 8;
+	return anItemHeight * GetLineCount() + 8;
 }
 
 void ListWidget::OrderInManagerChanged()
@@ -346,7 +535,10 @@ void ListWidget::Draw(Graphics *g)
 	aClipG.SetFont(mFont);
 
 	int aFirstLine = (int)mPosition;
-	int aLastLine = std::min((int)mLines.size() - 1, (int)mPosition + (int)mPageSize + 1);
+	int aLastLine = std::min(GetLineCount() - 1, (int)mPosition + (int)mPageSize + 1);
+
+	if (mDataSource != NULL)
+		CacheRows(aFirstLine, aLastLine);
 
 	int anItemHeight, anItemOffset;
 	if (mItemHeight != -1)
@@ -370,14 +562,18 @@ void ListWidget::Draw(Graphics *g)
 			aSelectClipG.FillRect(0, aDrawY, mWidth, anItemHeight);
 		}
 
+		const ListRow *aListRow = (mDataSource != NULL) ? &mRowCache[i - mRowCacheFirst] : NULL;
+
 		if (i == mHiliteIdx)
 			aClipG.SetColor(mColors[COLOR_HILITE]);
 		else if ((i == mSelectIdx) && (mColors.size() > COLOR_SELECT_TEXT))
 			aClipG.SetColor(mColors[COLOR_SELECT_TEXT]);
+		else if (aListRow != NULL)
+			aClipG.SetColor(aListRow->mHasColor ? aListRow->mColor : mColors[COLOR_TEXT]);
 		else
 			aClipG.SetColor(mLineColors[i]);
 
-		PopString aString = mLines[i];
+		const PopString &aString = aListRow != NULL ? aListRow->mText : mLines[i];
 		int aFontX;
 		switch (mJustify)
 		{
@@ -385,10 +581,10 @@ void ListWidget::Draw(Graphics *g)
 			aFontX = 4;
 			break;
 		case JUSTIFY_CENTER:
-			aFontX = (mWidth - mFont->StringWidth(aString)) / 2;
+			aFontX = (mWidth - (aListRow != NULL ? aListRow->mTextWidth : mFont->StringWidth(aString))) / 2;
 			break;
 		default:
-			aFontX = mWidth - mFont->StringWidth(aString) - 4;
+			aFontX = mWidth - (aListRow != NULL ? aListRow->mTextWidth : mFont->StringWidth(aString)) - 4;
 			break;
 		}
 
@@ -424,7 +620,7 @@ void ListWidget::MouseMove(int x, int y)
 	int anItemHeight = (mItemHeight != -1) ? mItemHeight : mFont->GetHeight();
 
 	int aNewHilite = (int)(((y - 4) / (double)anItemHeight) + mPosition);
-	if ((aNewHilite < 0) || (aNewHilite >= (int)mLines.size()))
+	if ((aNewHilite < 0) || (aNewHilite >= GetLineCount()))
 		aNewHilite = -1;
 
 	if (aNewHilite != mHiliteIdx)
@@ -15,6 +15,7 @@ typedef std::vector<Color> ColorVector;
 
 class ScrollbarWidget;
 class ListListener;
+class ListDataSource;
 class Font;
 
 class ListWidget : public Widget, public ScrollListener
@@ -60,14 +61,63 @@ class ListWidget : public Widget, public ScrollListener
 	bool mDrawSelectWhenHilited;
 	bool mDoFingerWhenHilited;
 
+	/// @brief where the rows come from in virtual mode, NULL if they're stored in mLines
+	ListDataSource *mDataSource;
+
 	void SetHilite(int theHiliteIdx, bool notifyListener = false);
 
+  protected:
+	struct ListRow
+	{
+		PopString mText;
+		Color mColor;
+		bool mHasColor; // false to draw in COLOR_TEXT
+		int mTextWidth;
+	};
+
+	// virtual mode: the visible rows, fetched from mDataSource once instead of every draw
+	std::vector<ListRow> mRowCache;
+	int mRowCacheFirst;
+
+	// virtual mode, only used on the first list of a chain: line index -> source row
+	// (empty while unsorted) and the sort keys by source row
+	std::vector<int> mRowOrder;
+	PopStringVector mSortKeys;
+	ListWidget *mSortList;
+	bool mSortAscending;
+
+	ListWidget *GetListRoot();
+	int GetRow(int theIdx);
+	PopString GetRowSortKey(int theRow);
+	void CacheRows(int theFirstIdx, int theLastIdx);
+	void InvalidateRows();
+
   public:
 	ListWidget(int theId, Font *theFont, ListListener *theListListener);
 	virtual ~ListWidget();
 
 	virtual void RemovedFromManager(WidgetManager *theManager);
 
+	/// @brief switches the list to virtual mode, or back to mLines if NULL
+	///
+	/// in virtual mode only the visible rows are asked for, so the list can
+	/// hold far more rows than mLines would. AddLine, SetLine, RemoveLine and
+	/// SetLineColor don't apply; change the source and call DataChanged or
+	/// RowsAdded instead. every list of a parent/child chain needs a source
+	/// with the same number of rows.
+	/// @param theDataSource
+	void SetDataSource(ListDataSource *theDataSource);
+	/// @brief rows of the data source changed, were removed or reordered
+	///
+	/// a sorted list is sorted again.
+	void DataChanged();
+	/// @brief rows were appended to the data source
+	///
+	/// a sorted list inserts them with a binary search instead of sorting again.
+	/// @param theFirstRow source index of the first new row
+	/// @param theCount
+	void RowsAdded(int theFirstRow, int theCount);
+
 	virtual PopString GetSortKey(int theIdx);
 	virtual void Sort(bool ascending);
 	virtual PopString GetStringAt(int theIdx);
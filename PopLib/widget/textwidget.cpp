@@ -14,6 +14,15 @@ TextWidget::TextWidget()
 	mStickToBottom = true;
 	mMaxLines = 2048;
 	mScrollbar = NULL;
+	mLayoutWidth = -1;
+	mLayoutFont = NULL;
+	mLayoutFontId = -1;
+}
+
+// color changes are stored as 0xFF followed by the red, green and blue bytes
+static bool IsColorMarker(PopChar theChar)
+{
+	return (uchar)theChar == 0xFF;
 }
 
 PopStringVector TextWidget::GetLines()
@@ -24,12 +33,15 @@ PopStringVector TextWidget::GetLines()
 void TextWidget::SetLines(PopStringVector theNewLines)
 {
 	mLogicalLines = theNewLines;
+	mLayoutWidth = -1;
 }
 
 void TextWidget::Clear()
 {
 	mLogicalLines.clear();
 	mPhysicalLines.clear();
+	mPhysicalRuns.clear();
+	mLineMap.clear();
 	mPosition = 0.0;
 	mScrollbar->SetMaxValue(0.0);
 	MarkDirty();
@@ -45,7 +57,7 @@ void TextWidget::DrawColorString(Graphics *g, const PopString &theString, int x,
 	PopString aCurString = "";
 	for (int i = 0; i < (int)theString.length(); i++)
 	{
-		if (theString[i] == 0x100)
+		if (IsColorMarker(theString[i]))
 		{
 			if (aCurString.length() > 0)
 				g->DrawString(aCurString, x + aWidth, y);
@@ -53,7 +65,7 @@ void TextWidget::DrawColorString(Graphics *g, const PopString &theString, int x,
 			aWidth += g->GetFont()->StringWidth(aCurString);
 			aCurString = "";
 			if (useColors)
-				g->SetColor(Color(theString[i + 1], theString[i + 2], theString[i + 3]));
+				g->SetColor(Color((uchar)theString[i + 1], (uchar)theString[i + 2], (uchar)theString[i + 3]));
 			i += 3;
 		}
 		else
@@ -111,7 +123,7 @@ int TextWidget::GetColorStringWidth(const PopString &theString)
 
 	for (int i = 0; i < (int)theString.length(); i++)
 	{
-		if (theString[i] == 0x100)
+		if (IsColorMarker(theString[i]))
 		{
 			aWidth += mFont->StringWidth(aTempString);
 			aTempString = "";
@@ -145,15 +157,25 @@ void TextWidget::Resize(int theX, int theY, int theWidth, int theHeight)
 
 	int aNewPhysValue = 0;
 
-	mLineMap.clear();
-	mPhysicalLines.clear();
-	for (int i = 0; i < (int)mLogicalLines.size(); i++)
+	if (mLayoutWidth != mWidth || mLayoutFont != mFont || mLayoutFontId != mFont->mLayoutId)
 	{
-		if (i == aLogValue)
-			aNewPhysValue = mPhysicalLines.size();
+		// only a new width or font, or new metrics of the same font, move the line breaks
+		mLayoutWidth = mWidth;
+		mLayoutFont = mFont;
+		mLayoutFontId = mFont->mLayoutId;
+		mLineMap.clear();
+		mPhysicalLines.clear();
+		mPhysicalRuns.clear();
+		for (int i = 0; i < (int)mLogicalLines.size(); i++)
+		{
+			if (i == aLogValue)
+				aNewPhysValue = mPhysicalLines.size();
 
-		AddToPhysicalLines(i, mLogicalLines[i]);
+			AddToPhysicalLines(i, mLogicalLines[i]);
+		}
 	}
+	else
+		aNewPhysValue = (int)mScrollbar->mValue;
 
 	bool atBottom = mScrollbar->AtBottom();
 
@@ -173,7 +195,7 @@ Color TextWidget::GetLastColor(const PopString &theString)
 	if (anIdx < 0)
 		return Color(0, 0, 0);
 
-	return Color(theString[anIdx + 1], theString[anIdx + 2], theString[anIdx + 3]);
+	return Color((uchar)theString[anIdx + 1], (uchar)theString[anIdx + 2], (uchar)theString[anIdx + 3]);
 }
 
 // UNICODE
@@ -187,6 +209,8 @@ void TextWidget::AddToPhysicalLines(int theIdx, const PopString &theLine)
 	}
 	else
 	{
+		// keep the width of aCurString so each word is only measured once
+		int aCurWidth = 0;
 		int aCurPos = 0;
 		while (aCurPos < (int)theLine.length())
 		{
@@ -198,17 +222,22 @@ void TextWidget::AddToPhysicalLines(int theIdx, const PopString &theLine)
 			if (aSpacePos == -1)
 				aSpacePos = theLine.length();
 
-			PopString aNewString = aCurString + theLine.substr(aCurPos, aSpacePos - aCurPos);
-			if (GetColorStringWidth(aNewString) > mWidth - 8)
+			PopString aWord = theLine.substr(aCurPos, aSpacePos - aCurPos);
+			int aNewWidth = aCurWidth + GetColorStringWidth(aWord);
+			if (aNewWidth > mWidth - 8)
 			{
 				mPhysicalLines.push_back(aCurString);
 				mLineMap.push_back(theIdx);
 				Color aColor = GetLastColor(aCurString);
 				aCurString = "  " + PopChar(0xFF) + (PopChar)aColor.mRed + (PopChar)aColor.mGreen +
 							 (PopChar)aColor.mBlue + theLine.substr(aNextCheckPos, aSpacePos - aNextCheckPos);
+				aCurWidth = GetColorStringWidth(aCurString);
 			}
 			else
-				aCurString = aNewString;
+			{
+				aCurString += aWord;
+				aCurWidth = aNewWidth;
+			}
 
 			aCurPos = aSpacePos;
 		}
@@ -250,6 +279,8 @@ void TextWidget::AddLine(const PopString &theLine)
 
 		mLineMap.erase(mLineMap.begin(), mLineMap.begin() + aPhysLineRemoveCount);
 		mPhysicalLines.erase(mPhysicalLines.begin(), mPhysicalLines.begin() + aPhysLineRemoveCount);
+		mPhysicalRuns.erase(mPhysicalRuns.begin(),
+							mPhysicalRuns.begin() + std::min(aPhysLineRemoveCount, (int)mPhysicalRuns.size()));
 
 		// Offset the line map numbers
 		int i;
@@ -324,14 +355,62 @@ void TextWidget::Draw(Graphics *g)
 	for (int i = aFirstLine; i <= aLastLine; i++)
 	{
 		int aYPos = 4 + (int)((i - (int)mPosition) * mFont->GetHeight()) + mFont->GetAscent();
-		PopString aString = mPhysicalLines[i];
 
 		int aHilitePos[2];
 		GetSelectedIndices(i, aHilitePos);
-		DrawColorStringHilited(&aClipG, aString, 4, aYPos, aHilitePos[0], aHilitePos[1]);
+		if (aHilitePos[1] > aHilitePos[0])
+		{
+			DrawColorStringHilited(&aClipG, mPhysicalLines[i], 4, aYPos, aHilitePos[0], aHilitePos[1]);
+			continue;
+		}
+
+		// nothing selected on this line, replay its runs
+		for (const TextRun &aRun : GetPhysicalRuns(i))
+		{
+			aClipG.SetColor(aRun.mColor);
+			aClipG.DrawString(aRun.mText, 4 + aRun.mX, aYPos);
+		}
 	}
 }
 
+const TextWidget::TextRunVector &TextWidget::GetPhysicalRuns(int theIdx)
+{
+	if ((int)mPhysicalRuns.size() < (int)mPhysicalLines.size())
+		mPhysicalRuns.resize(mPhysicalLines.size());
+
+	TextRunVector &aRuns = mPhysicalRuns[theIdx];
+	if (!aRuns.empty())
+		return aRuns;
+
+	// same splitting as DrawColorString
+	const PopString &aString = mPhysicalLines[theIdx];
+	TextRun aRun;
+	aRun.mX = 0;
+	aRun.mColor = Color(0, 0, 0);
+
+	for (int i = 0; i < (int)aString.length(); i++)
+	{
+		if (IsColorMarker(aString[i]))
+		{
+			int aRunWidth = mFont->StringWidth(aRun.mText);
+			if (aRun.mText.length() > 0)
+				aRuns.push_back(aRun);
+
+			aRun.mText.clear();
+			aRun.mX += aRunWidth;
+			aRun.mColor = Color((uchar)aString[i + 1], (uchar)aString[i + 2], (uchar)aString[i + 3]);
+			i += 3;
+		}
+		else
+			aRun.mText += aString[i];
+	}
+
+	if (aRun.mText.length() > 0)
+		aRuns.push_back(aRun);
+
+	return aRuns;
+}
+
 void TextWidget::ScrollPosition(int theId, double thePosition)
 {
 	mPosition = thePosition;
@@ -398,7 +477,7 @@ PopString TextWidget::GetSelection()
 		for (int aStrIdx = aSelIndices[0]; aStrIdx < aSelIndices[1]; aStrIdx++)
 		{
 			PopChar aChar = aString[aStrIdx];
-			if (aChar != 0x100)
+			if (!IsColorMarker(aChar))
 				aSelString += aChar;
 			else
 				aStrIdx += 3;
@@ -31,6 +31,26 @@ class TextWidget : public Widget, public ScrollListener
 	int mHiliteArea[2][2];
 	int mMaxLines;
 
+  protected:
+	struct TextRun
+	{
+		PopString mText;
+		int mX;
+		Color mColor;
+	};
+	typedef std::vector<TextRun> TextRunVector;
+
+	// colored runs of each physical line, made when the line is first drawn
+	std::vector<TextRunVector> mPhysicalRuns;
+	// width mPhysicalLines were wrapped at, -1 if they need to be wrapped again
+	int mLayoutWidth;
+	// font they were measured with and its mLayoutId then, a new mFont or new metrics wrap them again
+	// on the next Resize
+	Font *mLayoutFont;
+	int mLayoutFontId;
+
+	const TextRunVector &GetPhysicalRuns(int theIdx);
+
   public:
 	TextWidget();
 
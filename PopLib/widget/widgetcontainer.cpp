@@ -2,6 +2,7 @@
 #include "widgetmanager.hpp"
 #include "widget.hpp"
 #include "debug/debug.hpp"
+#include "debug/framestats.hpp"
 #include <algorithm>
 
 using namespace PopLib;
@@ -566,12 +567,16 @@ void WidgetContainer::DrawAll(ModalFlags *theFlags, Graphics *g)
 	if (mWidgets.size() == 0)
 	{
 		if (theFlags->GetFlags() & WIDGETFLAGS_DRAW)
+		{
+			FrameStats::Add(FRAMESTAT_WIDGETS_DRAWN);
 			Draw(g);
+		}
 		return;
 	}
 
 	if (theFlags->GetFlags() & WIDGETFLAGS_DRAW)
 	{
+		FrameStats::Add(FRAMESTAT_WIDGETS_DRAWN);
 		g->PushState();
 		Draw(g);
 		g->PopState();
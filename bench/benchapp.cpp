@@ -0,0 +1,330 @@
+#include "benchapp.hpp"
+#include "fixtures.hpp"
+#include "PopLib/graphics/graphics.hpp"
+#include "PopLib/graphics/memoryimage.hpp"
+#include "PopLib/graphics/imagefont.hpp"
+#include "PopLib/graphics/sdlinterface.hpp"
+#include "PopLib/paklib/pakinterface.hpp"
+#include "PopLib/readwrite/xmlparser.hpp"
+#include "PopLib/resources/resourcemanager.hpp"
+#include "PopLib/resources/resourcemanifest.hpp"
+#include "PopLib/math/mtrand.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+
+using namespace PopLib;
+
+static const int SPRITE_COUNT = 256;
+
+BenchApp::BenchApp()
+{
+	mProdName = "PopLib Bench";
+	mProductVersion = "1.0";
+	mTitle = mProdName + " - " + mProductVersion;
+	mRegKey = "PopCap/PopLib/Bench";
+
+	mWidth = 640;
+	mHeight = 480;
+
+	mOutFileName = "bench.json";
+	mFixtureDir = "bench_fixtures/";
+}
+
+BenchApp::~BenchApp()
+{
+}
+
+void BenchApp::Init()
+{
+	// numbers from a hardware renderer aren't comparable between machines
+	if (!mHeadless)
+		HandleCmdLineParam("-headless", "");
+
+	AppBase::Init();
+}
+
+void BenchApp::HandleCmdLineParam(const std::string &theParamName, const std::string &theParamValue)
+{
+	if (theParamName == "-out")
+		mOutFileName = theParamValue;
+	else if (theParamName == "-baseline")
+		mBaselineFileName = theParamValue;
+	else if (theParamName == "-filter")
+		mRunner.mFilter = theParamValue;
+	else if (theParamName == "-scale")
+		mRunner.mIterationScale = std::max(atof(theParamValue.c_str()), 0.0);
+	else if (theParamName == "-label")
+		mRunner.mLabel = theParamValue;
+	else
+		AppBase::HandleCmdLineParam(theParamName, theParamValue);
+}
+
+bool BenchApp::RunBenchmarks()
+{
+	MkDir(mFixtureDir);
+
+	BenchMemoryImage();
+	BenchImageFont();
+	BenchPak();
+	BenchXML();
+	BenchResources();
+	BenchScreen();
+
+	if (!mBaselineFileName.empty() && !mRunner.CompareJSON(mBaselineFileName))
+		SDL_Log("Unable to read baseline %s\r\n", mBaselineFileName.c_str());
+
+	if (!mRunner.WriteJSON(mOutFileName))
+	{
+		SDL_Log("Unable to write %s\r\n", mOutFileName.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+void BenchApp::BenchMemoryImage()
+{
+	std::unique_ptr<MemoryImage> aDest(Fixtures::CreateImage(mWidth, mHeight, false));
+	std::unique_ptr<MemoryImage> anAlphaSprite(Fixtures::CreateImage(64, 64, true));
+	std::unique_ptr<MemoryImage> anOpaqueSprite(Fixtures::CreateImage(64, 64, false, Fixtures::DEFAULT_SEED + 1));
+
+	MTRand aRand(Fixtures::DEFAULT_SEED);
+	std::vector<Point> aPositions(SPRITE_COUNT);
+	for (Point &aPos : aPositions)
+		aPos = Point((int)aRand.Next((ulong)mWidth) - 32, (int)aRand.Next((ulong)mHeight) - 32);
+
+	Graphics g(aDest.get());
+
+	mRunner.Run("memoryimage.normal_blt_alpha", 200, [&] {
+		for (const Point &aPos : aPositions)
+			g.DrawImage(anAlphaSprite.get(), aPos.mX, aPos.mY);
+	}, SPRITE_COUNT);
+
+	mRunner.Run("memoryimage.normal_blt_opaque", 200, [&] {
+		for (const Point &aPos : aPositions)
+			g.DrawImage(anOpaqueSprite.get(), aPos.mX, aPos.mY);
+	}, SPRITE_COUNT);
+
+	mRunner.Run("memoryimage.colorized_blt", 200, [&] {
+		g.SetColorizeImages(true);
+		g.SetColor(Color(255, 128, 64, 192));
+		for (const Point &aPos : aPositions)
+			g.DrawImage(anAlphaSprite.get(), aPos.mX, aPos.mY);
+		g.SetColorizeImages(false);
+	}, SPRITE_COUNT);
+
+	mRunner.Run("memoryimage.additive_blt", 200, [&] {
+		g.SetDrawMode(Graphics::DRAWMODE_ADDITIVE);
+		for (const Point &aPos : aPositions)
+			g.DrawImage(anAlphaSprite.get(), aPos.mX, aPos.mY);
+		g.SetDrawMode(Graphics::DRAWMODE_NORMAL);
+	}, SPRITE_COUNT);
+
+	mRunner.Run("memoryimage.stretch_blt", 50, [&] {
+		for (const Point &aPos : aPositions)
+			g.DrawImage(anAlphaSprite.get(), Rect(aPos.mX, aPos.mY, 96, 80), Rect(0, 0, 64, 64));
+	}, SPRITE_COUNT);
+
+	mRunner.Run("memoryimage.rotated_blt", 50, [&] {
+		for (int i = 0; i < SPRITE_COUNT; i++)
+			g.DrawImageRotated(anAlphaSprite.get(), aPositions[i].mX, aPositions[i].mY, i * 0.05);
+	}, SPRITE_COUNT);
+
+	mRunner.Run("memoryimage.fill_rect_alpha", 200, [&] {
+		g.SetColor(Color(32, 64, 255, 128));
+		for (const Point &aPos : aPositions)
+			g.FillRect(aPos.mX, aPos.mY, 64, 64);
+	}, SPRITE_COUNT);
+}
+
+void BenchApp::BenchImageFont()
+{
+	MemoryImage *aFontImage = nullptr;
+	std::unique_ptr<ImageFont> aFont(Fixtures::CreateFont(&aFontImage));
+	std::unique_ptr<MemoryImage> aFontImageDeleter(aFontImage);
+	std::unique_ptr<MemoryImage> aDest(Fixtures::CreateImage(mWidth, mHeight, false));
+
+	std::string aShortString = Fixtures::CreateText(48);
+	StringVector aLines;
+	std::string aText = Fixtures::CreateText(4096);
+	for (size_t aStart = 0; aStart < aText.length();)
+	{
+		size_t anEnd = aText.find('\n', aStart);
+		if (anEnd == std::string::npos)
+			anEnd = aText.length();
+		aLines.push_back(aText.substr(aStart, anEnd - aStart));
+		aStart = anEnd + 1;
+	}
+
+	Graphics g(aDest.get());
+	Rect aClipRect(0, 0, mWidth, mHeight);
+
+	mRunner.Run("imagefont.draw_string_ex_short", 2000, [&] {
+		aFont->DrawStringEx(&g, 10, 20, aShortString, Color::White, &aClipRect, nullptr, nullptr);
+	}, (int)aShortString.length());
+
+	mRunner.Run("imagefont.draw_string_ex_page", 100, [&] {
+		for (int i = 0; i < (int)aLines.size(); i++)
+			aFont->DrawStringEx(&g, 4, 16 + (i * 16) % mHeight, aLines[i], Color(255, 255, 0), &aClipRect, nullptr,
+								nullptr);
+	}, (int)aText.length());
+
+	mRunner.Run("imagefont.string_width", 2000, [&] {
+		for (const std::string &aLine : aLines)
+			aFont->StringWidth(aLine);
+	}, (int)aText.length());
+}
+
+void BenchApp::BenchPak()
+{
+	struct PakFixture
+	{
+		const char *mName;
+		int mFileCount;
+		int mFileSize;
+		int mIterations;
+	};
+
+	static const PakFixture aFixtures[] = {{"small", 512, 2048, 20}, {"large", 16, 256 * 1024, 20}};
+
+	for (const PakFixture &aFixture : aFixtures)
+	{
+		std::string aName = StrFormat("pak.add_pak_file_%s", aFixture.mName);
+		if (!mRunner.IsEnabled(aName) && !mRunner.IsEnabled(StrFormat("pak.read_%s", aFixture.mName)))
+			continue;
+
+		std::string aFileName = mFixtureDir + aFixture.mName + ".gpak";
+		if (!Fixtures::WritePak(aFileName, aFixture.mFileCount, aFixture.mFileSize))
+		{
+			SDL_Log("Unable to write %s\r\n", aFileName.c_str());
+			continue;
+		}
+
+		mRunner.Run(aName, aFixture.mIterations, [&] {
+			PakInterface aPakInterface;
+			aPakInterface.AddPakFile(aFileName);
+		}, aFixture.mFileCount);
+
+		PakInterface aPakInterface;
+		aPakInterface.AddPakFile(aFileName);
+		std::vector<char> aReadBuffer(aFixture.mFileSize);
+
+		mRunner.Run(StrFormat("pak.read_%s", aFixture.mName), aFixture.mIterations, [&] {
+			for (int i = 0; i < aFixture.mFileCount; i++)
+			{
+				PFILE *aFile = aPakInterface.FOpen(StrFormat("data/file%04d.txt", i).c_str(), "rb");
+				if (aFile == nullptr)
+					continue;
+				aPakInterface.FRead(aReadBuffer.data(), 1, aFixture.mFileSize, aFile);
+				aPakInterface.FClose(aFile);
+			}
+		}, aFixture.mFileCount);
+	}
+}
+
+void BenchApp::BenchXML()
+{
+	std::string aXML = Fixtures::CreateXML(2000);
+	std::string aFileName = mFixtureDir + "bench.xml";
+
+	FILE *aFile = fopen(aFileName.c_str(), "wb");
+	if (aFile != nullptr)
+	{
+		fwrite(aXML.data(), 1, aXML.size(), aFile);
+		fclose(aFile);
+	}
+
+	auto aParseAll = [](XMLParser &theParser) {
+		XMLElement anElement;
+		while (theParser.NextElement(&anElement))
+			;
+	};
+
+	mRunner.Run("xml.parse_buffer", 50, [&] {
+		XMLParser aParser;
+		aParser.OpenBuffer(aXML);
+		aParseAll(aParser);
+	}, (int)aXML.length());
+
+	mRunner.Run("xml.parse_file", 50, [&] {
+		XMLParser aParser;
+		if (aParser.OpenFile(aFileName))
+			aParseAll(aParser);
+	}, (int)aXML.length());
+}
+
+void BenchApp::BenchResources()
+{
+	static const int IMAGE_COUNT = 64;
+
+	if (!mRunner.IsEnabled("resources.parse_manifest") && !mRunner.IsEnabled("resources.parse_compiled_manifest") &&
+		!mRunner.IsEnabled("resources.load_group"))
+		return;
+
+	std::string aManifest = Fixtures::WriteResources(mFixtureDir, "Bench", IMAGE_COUNT, 128);
+	if (aManifest.empty())
+	{
+		SDL_Log("Unable to write the resource fixtures\r\n");
+		return;
+	}
+
+	mRunner.Run("resources.parse_manifest", 50, [&] {
+		ResourceManager aResourceManager(this);
+		aResourceManager.ParseResourcesFile(aManifest);
+	}, IMAGE_COUNT);
+
+	// the XML numbers above are only valid while there's no compiled manifest next to it
+	std::string aCompiledManifest = ResourceManifest::GetCompiledFileName(aManifest);
+	if (mRunner.IsEnabled("resources.parse_compiled_manifest") &&
+		ResourceManifest::Compile(aManifest, aCompiledManifest))
+	{
+		mRunner.Run("resources.parse_compiled_manifest", 50, [&] {
+			ResourceManager aResourceManager(this);
+			aResourceManager.ParseResourcesFile(aManifest);
+		}, IMAGE_COUNT);
+	}
+	std::remove(aCompiledManifest.c_str());
+
+	mRunner.Run("resources.load_group", 10, [&] {
+		ResourceManager aResourceManager(this);
+		if (aResourceManager.ParseResourcesFile(aManifest))
+			aResourceManager.LoadResources("Bench");
+	}, IMAGE_COUNT);
+}
+
+void BenchApp::BenchScreen()
+{
+	MemoryImage *aFontImage = nullptr;
+	std::unique_ptr<ImageFont> aFont(Fixtures::CreateFont(&aFontImage));
+	std::unique_ptr<MemoryImage> aFontImageDeleter(aFontImage);
+	std::unique_ptr<MemoryImage> aSprite(Fixtures::CreateImage(64, 64, true));
+	std::string aText = Fixtures::CreateText(48);
+
+	MTRand aRand(Fixtures::DEFAULT_SEED);
+	std::vector<Point> aPositions(SPRITE_COUNT);
+	for (Point &aPos : aPositions)
+		aPos = Point((int)aRand.Next((ulong)mWidth) - 32, (int)aRand.Next((ulong)mHeight) - 32);
+
+	mRunner.Run("screen.frame", 100, [&] {
+		Graphics g(mSDLInterface->GetScreenImage());
+		g.SetColor(Color::Black);
+		g.FillRect(0, 0, mWidth, mHeight);
+
+		for (int i = 0; i < SPRITE_COUNT; i++)
+		{
+			if (i % 4 == 0)
+				g.DrawImageRotated(aSprite.get(), aPositions[i].mX, aPositions[i].mY, i * 0.05);
+			else
+				g.DrawImage(aSprite.get(), aPositions[i].mX, aPositions[i].mY);
+		}
+
+		g.SetFont(aFont.get());
+		g.SetColor(Color::White);
+		for (int y = 20; y < mHeight; y += 20)
+			g.DrawString(aText, 8, y);
+
+		mSDLInterface->Redraw(nullptr);
+	}, SPRITE_COUNT);
+}
@@ -0,0 +1,62 @@
+#ifndef __BENCHAPP_HPP__
+#define __BENCHAPP_HPP__
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "PopLib/appbase.hpp"
+#include "benchmark.hpp"
+
+namespace PopLib
+{
+
+/**
+ * @brief runs the PopLib benchmark suite
+ *
+ * the app always runs headless on SDL's software renderer so results don't
+ * depend on the GPU or driver of the machine. besides the usual AppBase
+ * parameters it understands:
+ *
+ *   -out=file.json      write the results as JSON (default bench.json)
+ *   -baseline=file.json compare the results with an earlier run
+ *   -filter=name        only run benchmarks whose name contains this
+ *   -scale=x            multiply every iteration count by x
+ *   -label=text         stored in the JSON, e.g. the commit hash
+ */
+class BenchApp : public AppBase
+{
+  public:
+	BenchmarkRunner mRunner;
+	std::string mOutFileName;
+	std::string mBaselineFileName;
+	std::string mFixtureDir;
+
+  public:
+	BenchApp();
+	virtual ~BenchApp();
+
+	virtual void Init() override;
+	virtual void HandleCmdLineParam(const std::string &theParamName, const std::string &theParamValue) override;
+
+	/// @brief runs every enabled benchmark and writes the report
+	/// @return true if the report was written
+	bool RunBenchmarks();
+
+  protected:
+	/// @brief software blits into a MemoryImage
+	void BenchMemoryImage();
+	/// @brief ImageFont::DrawStringEx and StringWidth
+	void BenchImageFont();
+	/// @brief PakInterface::AddPakFile and reading records back
+	void BenchPak();
+	/// @brief XMLParser over a buffer and a file
+	void BenchXML();
+	/// @brief ResourceManager parsing a manifest and loading a group
+	void BenchResources();
+	/// @brief a whole frame drawn with the SDL renderer and presented
+	void BenchScreen();
+};
+
+} // namespace PopLib
+
+#endif
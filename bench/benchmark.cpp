@@ -0,0 +1,143 @@
+#include "benchmark.hpp"
+
+#include <SDL3/SDL.h>
+#include <json.hpp>
+
+#include <algorithm>
+#include <fstream>
+
+using namespace PopLib;
+
+static const int BENCHMARK_JSON_VERSION = 1;
+
+BenchmarkRunner::BenchmarkRunner()
+{
+	mIterationScale = 1.0;
+}
+
+BenchmarkRunner::~BenchmarkRunner()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool BenchmarkRunner::IsEnabled(const std::string &theName) const
+{
+	return mFilter.empty() || theName.find(mFilter) != std::string::npos;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+void BenchmarkRunner::Run(const std::string &theName, int theIterations, const std::function<void()> &theFunc,
+						  int theItemsPerIteration)
+{
+	if (!IsEnabled(theName))
+		return;
+
+	int anIterations = std::max((int)(theIterations * mIterationScale), 1);
+
+	// warm up caches, lazily created textures and the like
+	theFunc();
+
+	std::vector<double> aTimes(anIterations);
+	for (int i = 0; i < anIterations; i++)
+	{
+		uint64_t aStartNS = SDL_GetTicksNS();
+		theFunc();
+		aTimes[i] = (double)(SDL_GetTicksNS() - aStartNS);
+	}
+
+	BenchmarkResult aResult;
+	aResult.mName = theName;
+	aResult.mIterations = anIterations;
+	aResult.mItemsPerIteration = theItemsPerIteration;
+
+	double aTotal = 0;
+	for (double aTime : aTimes)
+		aTotal += aTime;
+	aResult.mMeanNS = aTotal / anIterations;
+
+	std::sort(aTimes.begin(), aTimes.end());
+	aResult.mMinNS = aTimes.front();
+	aResult.mMaxNS = aTimes.back();
+	aResult.mMedianNS = aTimes[anIterations / 2];
+
+	double anItemsPerSec = aResult.mMedianNS > 0 ? theItemsPerIteration * 1000000000.0 / aResult.mMedianNS : 0;
+	SDL_Log("%-36s %8d iters  median %12.0f ns  min %12.0f ns  %12.0f items/s\r\n", theName.c_str(), anIterations,
+			aResult.mMedianNS, aResult.mMinNS, anItemsPerSec);
+
+	mResults.push_back(aResult);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+std::string BenchmarkRunner::GetJSON() const
+{
+	nlohmann::json aBenchmarks = nlohmann::json::object();
+	for (const BenchmarkResult &aResult : mResults)
+	{
+		aBenchmarks[aResult.mName] = {{"iterations", aResult.mIterations},
+									  {"items", aResult.mItemsPerIteration},
+									  {"min_ns", aResult.mMinNS},
+									  {"median_ns", aResult.mMedianNS},
+									  {"mean_ns", aResult.mMeanNS},
+									  {"max_ns", aResult.mMaxNS}};
+	}
+
+	nlohmann::json aRoot;
+	aRoot["version"] = BENCHMARK_JSON_VERSION;
+	aRoot["label"] = mLabel;
+	aRoot["benchmarks"] = aBenchmarks;
+	return aRoot.dump(4);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool BenchmarkRunner::WriteJSON(const std::string &theFileName) const
+{
+	std::string aJSON = GetJSON();
+
+	FILE *aFile = fopen(theFileName.c_str(), "wb");
+	if (aFile == nullptr)
+		return false;
+
+	bool success = fwrite(aJSON.data(), 1, aJSON.size(), aFile) == aJSON.size();
+	fclose(aFile);
+	return success;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool BenchmarkRunner::CompareJSON(const std::string &theFileName) const
+{
+	std::ifstream aStream(theFileName);
+	if (!aStream)
+		return false;
+
+	nlohmann::json aBaseline = nlohmann::json::parse(aStream, nullptr, false);
+	if (aBaseline.is_discarded() || !aBaseline.contains("benchmarks"))
+		return false;
+
+	const nlohmann::json &aBaseBenchmarks = aBaseline["benchmarks"];
+	SDL_Log("Compared to %s (%s):\r\n", theFileName.c_str(), aBaseline.value("label", std::string()).c_str());
+
+	for (const BenchmarkResult &aResult : mResults)
+	{
+		if (!aBaseBenchmarks.contains(aResult.mName))
+		{
+			SDL_Log("%-36s        new\r\n", aResult.mName.c_str());
+			continue;
+		}
+
+		double aBaseMedian = aBaseBenchmarks[aResult.mName].value("median_ns", 0.0);
+		if (aBaseMedian <= 0)
+			continue;
+
+		// positive is slower than the baseline
+		double aDelta = (aResult.mMedianNS - aBaseMedian) * 100.0 / aBaseMedian;
+		SDL_Log("%-36s %+8.1f%%  (%12.0f -> %12.0f ns)\r\n", aResult.mName.c_str(), aDelta, aBaseMedian,
+				aResult.mMedianNS);
+	}
+
+	return true;
+}
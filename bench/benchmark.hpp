@@ -0,0 +1,80 @@
+#ifndef __BENCHMARK_HPP__
+#define __BENCHMARK_HPP__
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "PopLib/common.hpp"
+
+#include <functional>
+
+namespace PopLib
+{
+
+/**
+ * @brief timings of a single benchmark
+ */
+struct BenchmarkResult
+{
+	std::string mName;
+	int mIterations;
+	int mItemsPerIteration;
+	double mMinNS;
+	double mMedianNS;
+	double mMeanNS;
+	double mMaxNS;
+};
+
+typedef std::vector<BenchmarkResult> BenchmarkResultVector;
+
+/**
+ * @brief runs named benchmarks and reports their timings
+ *
+ * every benchmark is warmed up once and then timed per iteration with
+ * SDL_GetTicksNS. results are written as JSON keyed by name, so the output
+ * of two commits can be compared with CompareJSON.
+ */
+class BenchmarkRunner
+{
+  public:
+	/// @brief only benchmarks whose name contains this are run
+	std::string mFilter;
+	/// @brief multiplies every iteration count, for quick or long runs
+	double mIterationScale;
+	/// @brief free-form label stored in the JSON, e.g. a commit hash
+	std::string mLabel;
+	BenchmarkResultVector mResults;
+
+  public:
+	BenchmarkRunner();
+	virtual ~BenchmarkRunner();
+
+	/// @brief should this benchmark run?
+	/// @param theName
+	/// @return true if it passes the filter
+	bool IsEnabled(const std::string &theName) const;
+
+	/// @brief times a benchmark and stores the result
+	/// @param theName dotted name, e.g. "memoryimage.normal_blt"
+	/// @param theIterations iterations before mIterationScale
+	/// @param theFunc the code to time, called once per iteration
+	/// @param theItemsPerIteration work items per call, for the items/s column
+	void Run(const std::string &theName, int theIterations, const std::function<void()> &theFunc,
+			 int theItemsPerIteration = 1);
+
+	/// @brief gets the results as JSON
+	/// @return string
+	std::string GetJSON() const;
+	/// @brief writes GetJSON to a file
+	/// @param theFileName
+	/// @return true if success
+	bool WriteJSON(const std::string &theFileName) const;
+	/// @brief logs the median of every result against a previous GetJSON output
+	/// @param theFileName
+	/// @return false if the baseline couldn't be read
+	bool CompareJSON(const std::string &theFileName) const;
+};
+
+} // namespace PopLib
+
+#endif
@@ -0,0 +1,239 @@
+#include "fixtures.hpp"
+#include "PopLib/graphics/memoryimage.hpp"
+#include "PopLib/graphics/imagefont.hpp"
+#include "PopLib/imagelib/imagelib.hpp"
+#include "PopLib/paklib/gpak.hpp"
+#include "PopLib/math/mtrand.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <zlib.h>
+extern "C"
+{
+#include <aes.h>
+}
+
+using namespace PopLib;
+
+extern std::string gDecryptPassword;
+
+static const int FONT_CELL_WIDTH = 12;
+static const int FONT_CELL_HEIGHT = 16;
+static const int FONT_COLUMNS = 16;
+static const int FONT_FIRST_CHAR = 32;
+static const int FONT_CHAR_COUNT = 96;
+
+static const char *gFixtureWords[] = {"pop",	"cap",	 "bejeweled", "zuma",	 "peggle", "plants",
+									   "zombies", "sexy",	 "framework", "widget", "image",  "font",
+									   "sound",	"music", "resource",  "layer",	 "blit",   "alpha"};
+
+MemoryImage *Fixtures::CreateImage(int theWidth, int theHeight, bool hasAlpha, ulong theSeed)
+{
+	MTRand aRand(theSeed);
+
+	MemoryImage *anImage = new MemoryImage();
+	anImage->Create(theWidth, theHeight);
+
+	ulong *aBits = anImage->GetBits();
+	for (int i = 0; i < theWidth * theHeight; i++)
+	{
+		ulong anAlpha = hasAlpha ? aRand.Next((ulong)256) : 255;
+		aBits[i] = (anAlpha << 24) | (aRand.Next() & 0xFFFFFF);
+	}
+	anImage->BitsChanged();
+
+	return anImage;
+}
+
+ImageFont *Fixtures::CreateFont(MemoryImage **theFontImage)
+{
+	MTRand aRand(DEFAULT_SEED);
+
+	int aRows = (FONT_CHAR_COUNT + FONT_COLUMNS - 1) / FONT_COLUMNS;
+	MemoryImage *anImage = new MemoryImage();
+	anImage->Create(FONT_COLUMNS * FONT_CELL_WIDTH, aRows * FONT_CELL_HEIGHT);
+
+	// white glyphs with a noisy alpha, like an antialiased font sheet
+	ulong *aBits = anImage->GetBits();
+	for (int i = 0; i < anImage->mWidth * anImage->mHeight; i++)
+		aBits[i] = (aRand.Next((ulong)3) == 0 ? 0 : aRand.Next((ulong)256) << 24) | 0xFFFFFF;
+	anImage->BitsChanged();
+
+	ImageFont *aFont = new ImageFont(anImage);
+
+	FontLayer *aLayer = &aFont->mFontData->mFontLayerList.back();
+	aLayer->mAscent = FONT_CELL_HEIGHT - 3;
+	aLayer->mHeight = FONT_CELL_HEIGHT;
+	aLayer->mDefaultHeight = FONT_CELL_HEIGHT;
+
+	for (int i = 0; i < FONT_CHAR_COUNT; i++)
+	{
+		CharData *aCharData = aLayer->GetCharData((PopChar)(FONT_FIRST_CHAR + i));
+		aCharData->mImageRect = Rect((i % FONT_COLUMNS) * FONT_CELL_WIDTH, (i / FONT_COLUMNS) * FONT_CELL_HEIGHT,
+									 FONT_CELL_WIDTH, FONT_CELL_HEIGHT);
+		aCharData->mWidth = FONT_CELL_WIDTH - 1;
+	}
+
+	*theFontImage = anImage;
+	return aFont;
+}
+
+std::string Fixtures::CreateText(int theLength, ulong theSeed)
+{
+	MTRand aRand(theSeed);
+	const int aWordCount = sizeof(gFixtureWords) / sizeof(gFixtureWords[0]);
+
+	std::string aText;
+	int aLineLength = 0;
+	while ((int)aText.length() < theLength)
+	{
+		std::string aWord = gFixtureWords[aRand.Next((ulong)aWordCount)];
+		if (aRand.Next((ulong)4) == 0)
+			aWord[0] = (char)toupper(aWord[0]);
+
+		if (aLineLength + aWord.length() > 60)
+		{
+			aText += "\n";
+			aLineLength = 0;
+		}
+		else if (aLineLength > 0)
+		{
+			aText += " ";
+			aLineLength++;
+		}
+
+		aText += aWord;
+		aLineLength += (int)aWord.length();
+	}
+
+	aText.resize(theLength);
+	return aText;
+}
+
+std::string Fixtures::CreateXML(int theElementCount, ulong theSeed)
+{
+	MTRand aRand(theSeed);
+	const int aWordCount = sizeof(gFixtureWords) / sizeof(gFixtureWords[0]);
+
+	std::string aXML = "<?xml version=\"1.0\"?>\n<Root>\n";
+	for (int i = 0; i < theElementCount; i++)
+	{
+		const char *aName = gFixtureWords[aRand.Next((ulong)aWordCount)];
+		aXML += StrFormat("\t<Group id=\"G%d\" name=\"%s\">\n", i, aName);
+		// drawn one by one, arguments are evaluated in no particular order
+		int aX = (int)aRand.Next((ulong)1024);
+		int aY = (int)aRand.Next((ulong)768);
+		int aWidth = (int)aRand.Next((ulong)256);
+		int aHeight = (int)aRand.Next((ulong)256);
+		aXML += StrFormat("\t\t<Item x=\"%d\" y=\"%d\" w=\"%d\" h=\"%d\"/>\n", aX, aY, aWidth, aHeight);
+		aXML += StrFormat("\t\t<Text lang=\"en\">%s</Text>\n", CreateText(48, aRand.Next()).c_str());
+		aXML += "\t</Group>\n";
+	}
+	aXML += "</Root>\n";
+
+	return aXML;
+}
+
+bool Fixtures::WritePak(const std::string &theFileName, int theFileCount, int theFileSize, ulong theSeed)
+{
+	MTRand aRand(theSeed);
+
+	AES_ctx aContext;
+	uint8_t aKey[32] = {};
+	std::memcpy(aKey, gDecryptPassword.data(), std::min(gDecryptPassword.size(), sizeof(aKey)));
+	AES_init_ctx(&aContext, aKey);
+
+	GPAKHeader aHeader = {};
+	std::memcpy(aHeader.magic, "GPAK", 5);
+	aHeader.version = 1;
+	aHeader.fileCount = theFileCount;
+
+	std::vector<uint8_t> aData;
+	std::vector<GPAKFileEntry> anEntries(theFileCount);
+	for (int i = 0; i < theFileCount; i++)
+	{
+		// text compresses like real data files do, random bytes wouldn't
+		std::string aContents = CreateText(theFileSize, aRand.Next());
+
+		uLongf aCompressedSize = compressBound(theFileSize);
+		std::vector<uint8_t> aCompressed(aCompressedSize);
+		if (compress(aCompressed.data(), &aCompressedSize, (const Bytef *)aContents.data(), theFileSize) != Z_OK)
+			return false;
+		aCompressed.resize(aCompressedSize);
+
+		if (!gDecryptPassword.empty())
+		{
+			// PKCS#7 padding, as expected by AESDecrypt
+			uint8_t aPad = (uint8_t)(16 - aCompressed.size() % 16);
+			aCompressed.insert(aCompressed.end(), aPad, aPad);
+			for (size_t anOffset = 0; anOffset < aCompressed.size(); anOffset += 16)
+				AES_ECB_encrypt(&aContext, aCompressed.data() + anOffset);
+		}
+
+		GPAKFileEntry &anEntry = anEntries[i];
+		std::memset(&anEntry, 0, sizeof(anEntry));
+		snprintf(anEntry.path, sizeof(anEntry.path), "data/file%04d.txt", i);
+		anEntry.dataOffset = sizeof(GPAKHeader) + aData.size();
+		anEntry.compressedSize = (uint32_t)aCompressed.size();
+		anEntry.originalSize = theFileSize;
+
+		aData.insert(aData.end(), aCompressed.begin(), aCompressed.end());
+	}
+	aHeader.fileTableOffset = sizeof(GPAKHeader) + aData.size();
+
+	FILE *aFile = fopen(theFileName.c_str(), "wb");
+	if (aFile == nullptr)
+		return false;
+
+	bool success = fwrite(&aHeader, sizeof(aHeader), 1, aFile) == 1;
+	success = success && fwrite(aData.data(), 1, aData.size(), aFile) == aData.size();
+	success = success && fwrite(anEntries.data(), sizeof(GPAKFileEntry), anEntries.size(), aFile) == anEntries.size();
+	fclose(aFile);
+
+	return success;
+}
+
+std::string Fixtures::WriteResources(const std::string &theDir, const std::string &theGroup, int theImageCount,
+									 int theImageSize)
+{
+	MkDir(theDir + "images");
+
+	std::string aManifest = "<?xml version=\"1.0\"?>\n<ResourceManifest>\n";
+	aManifest += StrFormat("\t<Resources id=\"%s\">\n", theGroup.c_str());
+	aManifest += StrFormat("\t\t<SetDefaults path=\"%simages\" idprefix=\"IMAGE_\"/>\n", theDir.c_str());
+
+	for (int i = 0; i < theImageCount; i++)
+	{
+		MemoryImage *anImage = CreateImage(theImageSize, theImageSize, true, DEFAULT_SEED + i);
+
+		// ImageLib wants RGBA bytes, MemoryImage holds ARGB words
+		std::vector<uint8_t> aPixels(theImageSize * theImageSize * 4);
+		ulong *aBits = anImage->GetBits();
+		for (int j = 0; j < theImageSize * theImageSize; j++)
+		{
+			aPixels[j * 4 + 0] = (uint8_t)(aBits[j] >> 16);
+			aPixels[j * 4 + 1] = (uint8_t)(aBits[j] >> 8);
+			aPixels[j * 4 + 2] = (uint8_t)aBits[j];
+			aPixels[j * 4 + 3] = (uint8_t)(aBits[j] >> 24);
+		}
+		delete anImage;
+
+		std::string aName = StrFormat("image%03d", i);
+		if (!ImageLib::WriteImageRaw(theDir + "images/" + aName, ".png", aPixels.data(), theImageSize, theImageSize))
+			return "";
+
+		aManifest += StrFormat("\t\t<Image id=\"%d\" path=\"%s\"/>\n", i, aName.c_str());
+	}
+
+	aManifest += "\t</Resources>\n</ResourceManifest>\n";
+
+	std::string aFileName = theDir + "resources.xml";
+	FILE *aFile = fopen(aFileName.c_str(), "wb");
+	if (aFile == nullptr)
+		return "";
+
+	bool success = fwrite(aManifest.data(), 1, aManifest.size(), aFile) == aManifest.size();
+	fclose(aFile);
+
+	return success ? aFileName : "";
+}
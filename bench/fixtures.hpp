@@ -0,0 +1,73 @@
+#ifndef __FIXTURES_HPP__
+#define __FIXTURES_HPP__
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "PopLib/common.hpp"
+
+namespace PopLib
+{
+
+class MemoryImage;
+class ImageFont;
+
+/**
+ * @brief synthetic benchmark data
+ *
+ * everything is generated from a fixed MTRand seed so two runs, and two
+ * commits, measure exactly the same work. files are rewritten on every run.
+ */
+namespace Fixtures
+{
+
+/// @brief seed used by all fixtures unless told otherwise
+const ulong DEFAULT_SEED = 5489UL;
+
+/// @brief creates an image of random pixels
+/// @param theWidth
+/// @param theHeight
+/// @param hasAlpha if false every pixel is opaque
+/// @param theSeed
+/// @return the image, owned by the caller
+MemoryImage *CreateImage(int theWidth, int theHeight, bool hasAlpha, ulong theSeed = DEFAULT_SEED);
+
+/// @brief creates a fixed-width ImageFont covering printable ASCII
+/// @param theFontImage receives the glyph sheet, which the font doesn't own
+/// @return the font, owned by the caller
+ImageFont *CreateFont(MemoryImage **theFontImage);
+
+/// @brief creates printable ASCII text broken into words and lines
+/// @param theLength
+/// @param theSeed
+/// @return string
+std::string CreateText(int theLength, ulong theSeed = DEFAULT_SEED);
+
+/// @brief creates a nested XML document with attributes and text
+/// @param theElementCount
+/// @param theSeed
+/// @return string
+std::string CreateXML(int theElementCount, ulong theSeed = DEFAULT_SEED);
+
+/// @brief writes a GPAK that PakInterface::AddPakFile can load
+/// @param theFileName
+/// @param theFileCount
+/// @param theFileSize uncompressed size of every entry
+/// @param theSeed
+/// @return true if success
+bool WritePak(const std::string &theFileName, int theFileCount, int theFileSize, ulong theSeed = DEFAULT_SEED);
+
+/// @brief writes PNG images and a resource manifest listing them in one group
+/// @param theDir directory to write to, ending with a slash
+/// @param theGroup name of the resource group
+/// @param theImageCount
+/// @param theImageSize width and height of every image
+/// @return path of the manifest, empty if failed
+std::string WriteResources(const std::string &theDir, const std::string &theGroup, int theImageCount,
+						   int theImageSize);
+
+} // namespace Fixtures
+
+} // namespace PopLib
+
+#endif
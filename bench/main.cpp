@@ -0,0 +1,29 @@
+//////////////////////////////////////////////////////////////////////////
+//						main.cpp
+//
+//	Entry point of poplib_bench. The app is initialized headless, runs the
+//	benchmark suite once and exits with a non-zero code if the report
+//	couldn't be written.
+//
+//	Typical use, comparing a change against the previous commit:
+//	  poplib_bench -out=before.json -label=HEAD~1
+//	  poplib_bench -out=after.json -label=HEAD -baseline=before.json
+//////////////////////////////////////////////////////////////////////////
+
+#include "benchapp.hpp"
+
+using namespace PopLib;
+
+int main(int argc, char *argv[])
+{
+	BenchApp *anApp = new BenchApp();
+	anApp->ParseCmdLine(argc, argv);
+	anApp->Init();
+
+	bool success = anApp->RunBenchmarks();
+
+	anApp->Shutdown();
+	delete anApp;
+
+	return success ? 0 : 1;
+}
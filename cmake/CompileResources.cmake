@@ -0,0 +1,18 @@
+# compiles a resources.xml into resources.xml.bin whenever it changes,
+# ResourceManager picks the compiled file up and falls back to the XML if it's stale
+# the .bin has to sit beside the XML for ResourceManager to find it, so it is gitignored
+function(compile_resources TARGET XML_PATH)
+    if (NOT TARGET rescompiler)
+        message(WARNING "rescompiler isn't built, ${XML_PATH} stays uncompiled")
+        return()
+    endif()
+
+    add_custom_command(
+        OUTPUT "${XML_PATH}.bin"
+        COMMAND rescompiler "${XML_PATH}" "${XML_PATH}.bin"
+        DEPENDS "${XML_PATH}" rescompiler
+        COMMENT "Compiling resource manifest ${XML_PATH}"
+    )
+    add_custom_target(${TARGET}_resources DEPENDS "${XML_PATH}.bin")
+    add_dependencies(${TARGET} ${TARGET}_resources)
+endfunction()
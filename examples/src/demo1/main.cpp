@@ -35,8 +35,11 @@ int main(int argc, char *argv[])
 	ShowWindow(GetConsoleWindow(), SW_HIDE);
 #endif
 #endif
-	// Create and initialize our game application.
+	// Create and initialize our game application. The command line is parsed
+	// before Init so that parameters like -headless, -record, -play and
+	// -benchmark can take effect before the window is created.
 	GameApp *anApp = new GameApp();
+	anApp->ParseCmdLine(argc, argv);
 	anApp->Init();
 
 	// Starts the entire application: sets up the resource loading thread and
@@ -388,4 +388,19 @@ void GameApp::HandleCmdLineParam(const std::string &theParamName, const std::str
 	SDL_Log(
 		StrFormat("theParamName = \"%s\", theParamValue = \"%s\"", theParamName.c_str(), theParamValue.c_str())
 			.c_str());
+
+	// Let AppBase handle its own parameters too, like -record, -play and -headless.
+	// It exits on any parameter it doesn't know about, so only pass those along
+	// and quietly ignore the rest.
+	static const char *aBaseParams[] = {"-crash",	  "-screensaver", "-changedir", "-record",
+										"-play",	  "-demofile",	  "-benchmark", "-texturebudget",
+										"-hotreload", "-software",	  "-headless"};
+	for (const char *aBaseParam : aBaseParams)
+	{
+		if (theParamName == aBaseParam)
+		{
+			AppBase::HandleCmdLineParam(theParamName, theParamValue);
+			break;
+		}
+	}
 }
\ No newline at end of file
@@ -41,6 +41,7 @@ int main(int argc, char *argv[])
 #endif
 	// Create and initialize our game application.
 	GameApp *anApp = new GameApp();
+	anApp->ParseCmdLine(argc, argv);
 	anApp->Init();
 
 	// Starts the entire application: sets up the resource loading thread and
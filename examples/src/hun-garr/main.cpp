@@ -38,6 +38,7 @@ int main(int argc, char *argv[])
 #endif
 #endif
 	GameApp *anApp = new GameApp();
+	anApp->ParseCmdLine(argc, argv);
 	anApp->Init();
 	anApp->Start();
 
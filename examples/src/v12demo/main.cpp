@@ -66,6 +66,7 @@ int main(int argc, char *argv[])
 #endif
 #endif
 	V12DemoApp *anApp = new V12DemoApp();
+	anApp->ParseCmdLine(argc, argv);
 	anApp->Init();
 	anApp->Start();
 	delete anApp;
@@ -67,6 +67,7 @@ int main(int argc, char* argv[])
 #endif
 
 	V14DemoApp* anApp = new V14DemoApp();
+	anApp->ParseCmdLine(argc, argv);
 	anApp->Init();
 	anApp->Start();
 
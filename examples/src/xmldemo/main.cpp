@@ -35,6 +35,7 @@ int main(int argc, char *argv[])
 #endif
 #endif
 	XMLDemoApp *anApp = new XMLDemoApp();
+	anApp->ParseCmdLine(argc, argv);
 	anApp->Init();
 	anApp->Start();
 	delete anApp;
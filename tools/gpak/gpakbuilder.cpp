@@ -0,0 +1,489 @@
+#include "gpakbuilder.hpp"
+#include "PopLib/paklib/gpak.hpp"
+#include "PopLib/resources/resourcemanifest.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <zlib.h>
+extern "C"
+{
+#include <aes.h>
+}
+
+using namespace PopLib;
+
+static std::string ToLower(std::string theString)
+{
+	for (char &aChar : theString)
+		aChar = (char)tolower((unsigned char)aChar);
+	return theString;
+}
+
+// the name a file is grouped under: lower case, no extension, and alpha images
+// (_name and name_) next to the image they belong to
+static std::string GetGroupKey(const std::string &thePath)
+{
+	std::string aKey = ToLower(thePath);
+	std::replace(aKey.begin(), aKey.end(), '\\', '/');
+	if (aKey.compare(0, 2, "./") == 0)
+		aKey.erase(0, 2);
+
+	size_t aSlashPos = aKey.rfind('/');
+	size_t aNameStart = aSlashPos == std::string::npos ? 0 : aSlashPos + 1;
+
+	size_t aDotPos = aKey.rfind('.');
+	if (aDotPos != std::string::npos && aDotPos > aNameStart)
+		aKey.erase(aDotPos);
+
+	if (aKey.size() > aNameStart && aKey.back() == '_')
+		aKey.pop_back();
+	else if (aKey.size() > aNameStart && aKey[aNameStart] == '_')
+		aKey.erase(aNameStart, 1);
+
+	return aKey;
+}
+
+GPakBuilder::GPakBuilder()
+{
+	mCompressionLevel = Z_BEST_COMPRESSION;
+	mNumThreads = std::max((int)std::thread::hardware_concurrency(), 1);
+	mIncremental = true;
+	mNumPacked = 0;
+	mNumReused = 0;
+	mSourceBytes = 0;
+	mPakBytes = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool GPakBuilder::CollectFiles(std::string *theError)
+{
+	std::error_code anError;
+	std::filesystem::path aSourceDir(mSourceDir);
+	std::filesystem::path aPakPath = std::filesystem::absolute(mPakFileName, anError);
+
+	for (std::filesystem::recursive_directory_iterator anItr(aSourceDir, anError), anEnd; anItr != anEnd;
+		 anItr.increment(anError))
+	{
+		if (anError)
+			break;
+
+		if (!anItr->is_regular_file(anError))
+			continue;
+
+		// don't pack the pak into itself
+		std::filesystem::path anAbsPath = std::filesystem::absolute(anItr->path(), anError);
+		if (anAbsPath == aPakPath || anAbsPath.string().compare(0, aPakPath.string().size(), aPakPath.string()) == 0)
+			continue;
+
+		Entry anEntry;
+		anEntry.mSourcePath = anItr->path().string();
+		anEntry.mPath = anItr->path().lexically_relative(aSourceDir).generic_string();
+		anEntry.mSize = anItr->file_size(anError);
+		anEntry.mTime = (int64_t)anItr->last_write_time(anError).time_since_epoch().count();
+		anEntry.mRank = INT_MAX;
+		anEntry.mOldOffset = -1;
+		anEntry.mOldSize = 0;
+
+		if (anEntry.mPath.size() >= sizeof(GPAKFileEntry::path))
+		{
+			*theError = anEntry.mPath + ": path too long";
+			return false;
+		}
+
+		if (anEntry.mSize > UINT32_MAX)
+		{
+			*theError = anEntry.mPath + ": file too large";
+			return false;
+		}
+
+		mEntries.push_back(anEntry);
+	}
+
+	if (anError)
+	{
+		*theError = mSourceDir + ": " + anError.message();
+		return false;
+	}
+
+	return true;
+}
+
+bool GPakBuilder::OrderByResources(std::string *theError)
+{
+	std::string aManifestFileName = mPakFileName + ".res.tmp";
+	if (!ResourceManifest::Compile(mResourcesFileName, aManifestFileName, theError))
+		return false;
+
+	// every path the manifest mentions, numbered in load order
+	std::unordered_map<std::string, int> aRanks;
+	{
+		ResourceManifest aManifest;
+		if (!aManifest.Open(aManifestFileName))
+		{
+			std::filesystem::remove(aManifestFileName);
+			*theError = mResourcesFileName + ": compiled manifest doesn't load";
+			return false;
+		}
+
+		int aRank = 0;
+		for (int aGroupNum = 0; aGroupNum < aManifest.GetNumGroups(); aGroupNum++)
+		{
+			const ResourceManifest::Group &aGroup = aManifest.GetGroup(aGroupNum);
+			std::string aDefaultPath;
+
+			for (uint32_t i = 0; i < aGroup.mNumRecords; i++)
+			{
+				const ResourceManifest::Record &aRecord = aManifest.GetRecord(aGroup.mFirstRecord + i);
+				bool isSetDefaults = aManifest.GetString(aRecord.mName) == "SetDefaults";
+
+				for (uint32_t j = 0; j < aRecord.mNumAttributes; j++)
+				{
+					const ResourceManifest::Attribute &anAttribute = aManifest.GetAttribute(aRecord.mFirstAttribute + j);
+					std::string_view aKey = aManifest.GetString(anAttribute.mKey);
+					std::string aValue(aManifest.GetString(anAttribute.mValue));
+
+					if (isSetDefaults)
+					{
+						// same as ResourceManager::ParseSetDefaults
+						if (aKey == "path")
+						{
+							while (!aValue.empty() && (aValue.back() == '/' || aValue.back() == '\\'))
+								aValue.pop_back();
+							aDefaultPath = aValue + '/';
+						}
+					}
+					else if (aKey == "path" || aKey == "alphaimage" || aKey == "alphagrid")
+						aRanks.emplace(GetGroupKey(aDefaultPath + aValue), aRank++);
+				}
+			}
+		}
+	}
+
+	std::filesystem::remove(aManifestFileName);
+
+	for (Entry &anEntry : mEntries)
+	{
+		auto anItr = aRanks.find(GetGroupKey(anEntry.mPath));
+		if (anItr != aRanks.end())
+			anEntry.mRank = anItr->second;
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+std::string GPakBuilder::GetCacheFileName() const
+{
+	return mPakFileName + ".cache";
+}
+
+uint64_t GPakBuilder::GetSettingsHash() const
+{
+	// packed data can only be reused if it was packed the same way
+	std::string aSettings = mPassword + '\n' + std::to_string(mCompressionLevel);
+
+	uint64_t aHash = 0xCBF29CE484222325ULL;
+	for (char aChar : aSettings)
+		aHash = (aHash ^ (uint8_t)aChar) * 0x100000001B3ULL;
+	return aHash;
+}
+
+void GPakBuilder::LoadCache()
+{
+	std::ifstream aCacheFile(GetCacheFileName());
+	if (!aCacheFile)
+		return;
+
+	std::string aMagic;
+	int aVersion = 0;
+	uint64_t aSettingsHash = 0;
+	aCacheFile >> aMagic >> aVersion >> aSettingsHash;
+	if (aMagic != "GPAKCACHE" || aVersion != 1 || aSettingsHash != GetSettingsHash())
+		return;
+
+	std::unordered_map<std::string, std::pair<uint64_t, int64_t>> aStamps;
+	uint64_t aSize;
+	int64_t aTime;
+	std::string aPath;
+	while (aCacheFile >> aSize >> aTime && std::getline(aCacheFile >> std::ws, aPath))
+		aStamps[aPath] = {aSize, aTime};
+
+	// the cache only says what's unchanged, the data itself comes from the old pak
+	std::ifstream aPakFile(mPakFileName, std::ios::binary);
+	GPAKHeader aHeader;
+	if (!aPakFile.read((char *)&aHeader, sizeof(aHeader)) || memcmp(aHeader.magic, "GPAK", 4) != 0 ||
+		aHeader.version != 1)
+		return;
+
+	std::vector<GPAKFileEntry> aTable(aHeader.fileCount);
+	aPakFile.seekg(aHeader.fileTableOffset);
+	if (!aPakFile.read((char *)aTable.data(), aTable.size() * sizeof(GPAKFileEntry)))
+		return;
+
+	std::unordered_map<std::string, const GPAKFileEntry *> anOldEntries;
+	for (const GPAKFileEntry &anOldEntry : aTable)
+		anOldEntries[std::string(anOldEntry.path, strnlen(anOldEntry.path, sizeof(anOldEntry.path)))] = &anOldEntry;
+
+	for (Entry &anEntry : mEntries)
+	{
+		auto aStampItr = aStamps.find(anEntry.mPath);
+		auto anOldItr = anOldEntries.find(anEntry.mPath);
+		if (aStampItr == aStamps.end() || anOldItr == anOldEntries.end())
+			continue;
+
+		if (aStampItr->second.first == anEntry.mSize && aStampItr->second.second == anEntry.mTime &&
+			anOldItr->second->originalSize == anEntry.mSize)
+		{
+			anEntry.mOldOffset = (int64_t)anOldItr->second->dataOffset;
+			anEntry.mOldSize = anOldItr->second->compressedSize;
+		}
+	}
+}
+
+bool GPakBuilder::WriteCache()
+{
+	std::ofstream aCacheFile(GetCacheFileName(), std::ios::trunc);
+	if (!aCacheFile)
+		return false;
+
+	aCacheFile << "GPAKCACHE 1 " << GetSettingsHash() << "\n";
+	for (const Entry &anEntry : mEntries)
+		aCacheFile << anEntry.mSize << " " << anEntry.mTime << " " << anEntry.mPath << "\n";
+
+	return (bool)aCacheFile;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool GPakBuilder::PackEntry(const Entry &theEntry, std::vector<uint8_t> *theData) const
+{
+	std::vector<uint8_t> aSource(theEntry.mSize);
+	std::ifstream aFile(theEntry.mSourcePath, std::ios::binary);
+	if (!aFile || !aFile.read((char *)aSource.data(), aSource.size()))
+		return false;
+
+	uLongf aPackedSize = compressBound((uLong)aSource.size());
+	theData->resize(aPackedSize);
+	if (compress2(theData->data(), &aPackedSize, aSource.data(), (uLong)aSource.size(), mCompressionLevel) != Z_OK)
+		return false;
+	theData->resize(aPackedSize);
+
+	if (!mPassword.empty())
+	{
+		// PKCS#7 padding and ECB, the reverse of AESDecrypt in pakinterface.cpp
+		uint8_t aPad = (uint8_t)(AES_BLOCKLEN - theData->size() % AES_BLOCKLEN);
+		theData->insert(theData->end(), aPad, aPad);
+
+		uint8_t aKey[32] = {};
+		memcpy(aKey, mPassword.data(), std::min(mPassword.size(), sizeof(aKey)));
+
+		AES_ctx aContext;
+		AES_init_ctx(&aContext, aKey);
+		for (size_t i = 0; i < theData->size(); i += AES_BLOCKLEN)
+			AES_ECB_encrypt(&aContext, theData->data() + i);
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+bool GPakBuilder::Build(std::string *theError)
+{
+	mEntries.clear();
+	mNumPacked = 0;
+	mNumReused = 0;
+	mSourceBytes = 0;
+	mPakBytes = 0;
+
+	if (!CollectFiles(theError))
+		return false;
+
+	if (!mResourcesFileName.empty() && !OrderByResources(theError))
+		return false;
+
+	std::stable_sort(mEntries.begin(), mEntries.end(), [](const Entry &theLeft, const Entry &theRight) {
+		if (theLeft.mRank != theRight.mRank)
+			return theLeft.mRank < theRight.mRank;
+		return theLeft.mPath < theRight.mPath;
+	});
+
+	if (mIncremental)
+		LoadCache();
+
+	FILE *anOldPak = nullptr;
+	for (const Entry &anEntry : mEntries)
+	{
+		if (anEntry.mOldOffset >= 0)
+		{
+			anOldPak = fopen(mPakFileName.c_str(), "rb");
+			break;
+		}
+	}
+
+	// written next to the old pak and renamed over it at the end, the old one is read meanwhile
+	std::string aTempFileName = mPakFileName + ".tmp";
+	FILE *aPak = fopen(aTempFileName.c_str(), "wb");
+	if (aPak == nullptr)
+	{
+		if (anOldPak != nullptr)
+			fclose(anOldPak);
+		*theError = aTempFileName + ": can't write";
+		return false;
+	}
+
+	GPAKHeader aHeader;
+	memset(&aHeader, 0, sizeof(aHeader));
+	fwrite(&aHeader, sizeof(aHeader), 1, aPak);
+	uint64_t aPos = sizeof(aHeader);
+
+	int aNumEntries = (int)mEntries.size();
+	std::vector<GPAKFileEntry> aTable(aNumEntries);
+	memset(aTable.data(), 0, aTable.size() * sizeof(GPAKFileEntry));
+
+	// workers pack entries a limited distance ahead of the one being written
+	std::mutex aMutex;
+	std::condition_variable aCondition;
+	std::vector<std::vector<uint8_t>> aPacked(aNumEntries);
+	std::vector<char> aDone(aNumEntries, 0);
+	int aNextEntry = 0;
+	int aNumWritten = 0;
+	bool hasFailed = false;
+	std::string aFailedPath;
+	int aWindow = mNumThreads * 4;
+
+	auto aWorker = [&]() {
+		while (true)
+		{
+			int anIndex;
+			{
+				std::unique_lock<std::mutex> aLock(aMutex);
+				aCondition.wait(aLock, [&]() {
+					return hasFailed || aNextEntry >= aNumEntries || aNextEntry < aNumWritten + aWindow;
+				});
+				if (hasFailed || aNextEntry >= aNumEntries)
+					return;
+				anIndex = aNextEntry++;
+			}
+
+			std::vector<uint8_t> aData;
+			bool aSuccess = mEntries[anIndex].mOldOffset >= 0 || PackEntry(mEntries[anIndex], &aData);
+
+			std::lock_guard<std::mutex> aLock(aMutex);
+			if (!aSuccess && !hasFailed)
+			{
+				hasFailed = true;
+				aFailedPath = mEntries[anIndex].mSourcePath;
+			}
+			aPacked[anIndex] = std::move(aData);
+			aDone[anIndex] = 1;
+			aCondition.notify_all();
+		}
+	};
+
+	std::vector<std::thread> aThreads;
+	for (int i = 0; i < mNumThreads; i++)
+		aThreads.emplace_back(aWorker);
+
+	std::vector<uint8_t> aCopyBuffer;
+	for (int i = 0; i < aNumEntries; i++)
+	{
+		std::vector<uint8_t> aData;
+		{
+			std::unique_lock<std::mutex> aLock(aMutex);
+			aCondition.wait(aLock, [&]() { return hasFailed || aDone[i]; });
+			if (hasFailed)
+				break;
+
+			aData = std::move(aPacked[i]);
+			aNumWritten = i + 1;
+			aCondition.notify_all();
+		}
+
+		const Entry &anEntry = mEntries[i];
+		if (anEntry.mOldOffset >= 0)
+		{
+			aCopyBuffer.resize(anEntry.mOldSize);
+			if (fseek(anOldPak, (long)anEntry.mOldOffset, SEEK_SET) != 0 ||
+				fread(aCopyBuffer.data(), 1, aCopyBuffer.size(), anOldPak) != aCopyBuffer.size())
+			{
+				std::lock_guard<std::mutex> aLock(aMutex);
+				hasFailed = true;
+				aFailedPath = mPakFileName;
+				aCondition.notify_all();
+				break;
+			}
+
+			aData.swap(aCopyBuffer);
+			mNumReused++;
+		}
+		else
+			mNumPacked++;
+
+		GPAKFileEntry &aTableEntry = aTable[i];
+		strncpy(aTableEntry.path, anEntry.mPath.c_str(), sizeof(aTableEntry.path) - 1);
+		aTableEntry.dataOffset = aPos;
+		aTableEntry.compressedSize = (uint32_t)aData.size();
+		aTableEntry.originalSize = (uint32_t)anEntry.mSize;
+
+		fwrite(aData.data(), 1, aData.size(), aPak);
+		aPos += aData.size();
+		mSourceBytes += anEntry.mSize;
+
+		if (anEntry.mOldOffset >= 0)
+			aData.swap(aCopyBuffer);
+	}
+
+	for (std::thread &aThread : aThreads)
+		aThread.join();
+
+	if (anOldPak != nullptr)
+		fclose(anOldPak);
+
+	if (hasFailed)
+	{
+		fclose(aPak);
+		std::filesystem::remove(aTempFileName);
+		*theError = aFailedPath + ": can't read";
+		return false;
+	}
+
+	memcpy(aHeader.magic, "GPAK", 5);
+	aHeader.version = 1;
+	aHeader.fileCount = (uint32_t)aNumEntries;
+	aHeader.fileTableOffset = aPos;
+
+	fwrite(aTable.data(), sizeof(GPAKFileEntry), aTable.size(), aPak);
+	fseek(aPak, 0, SEEK_SET);
+	fwrite(&aHeader, sizeof(aHeader), 1, aPak);
+
+	bool aWriteFailed = ferror(aPak) != 0;
+	aWriteFailed |= fclose(aPak) != 0;
+	mPakBytes = aPos + aTable.size() * sizeof(GPAKFileEntry);
+
+	std::error_code anError;
+	if (!aWriteFailed)
+		std::filesystem::rename(aTempFileName, mPakFileName, anError);
+
+	if (aWriteFailed || anError)
+	{
+		std::filesystem::remove(aTempFileName, anError);
+		*theError = mPakFileName + ": write failed";
+		return false;
+	}
+
+	if (!WriteCache())
+		std::filesystem::remove(GetCacheFileName(), anError);
+
+	return true;
+}
@@ -0,0 +1,71 @@
+#ifndef __GPAKBUILDER_HPP__
+#define __GPAKBUILDER_HPP__
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief writes a folder into a GPAK file PakInterface::AddPakFile can mount
+ *
+ * entries are compressed and encrypted on a pool of threads and written in
+ * order as they finish, with only a few of them held in memory at a time.
+ * a cache file next to the pak remembers the size and time of every source
+ * file, so a rebuild copies the packed data of unchanged files from the old
+ * pak instead of packing them again.
+ */
+class GPakBuilder
+{
+  public:
+	std::string mSourceDir;
+	std::string mPakFileName;
+	/// @brief entries are ordered by the groups of this manifest, by path if empty
+	std::string mResourcesFileName;
+	/// @brief must match gDecryptPassword in the game, empty to leave the data unencrypted
+	std::string mPassword;
+	int mCompressionLevel;
+	int mNumThreads;
+	/// @brief reuse packed data from the last build
+	bool mIncremental;
+
+	// filled in by Build
+	int mNumPacked;
+	int mNumReused;
+	uint64_t mSourceBytes;
+	uint64_t mPakBytes;
+
+  public:
+	GPakBuilder();
+
+	/// @brief builds the pak
+	/// @param theError receives the reason on failure
+	/// @return true if success
+	bool Build(std::string *theError);
+
+  protected:
+	struct Entry
+	{
+		std::string mPath; ///< relative, with forward slashes
+		std::string mSourcePath;
+		uint64_t mSize;
+		int64_t mTime;
+		int mRank; ///< position of its resource group
+		int64_t mOldOffset; ///< packed data in the old pak, -1 if it has to be packed
+		uint32_t mOldSize;
+	};
+
+	std::vector<Entry> mEntries;
+
+	bool CollectFiles(std::string *theError);
+	bool OrderByResources(std::string *theError);
+	void LoadCache();
+	bool WriteCache();
+	std::string GetCacheFileName() const;
+	uint64_t GetSettingsHash() const;
+	bool PackEntry(const Entry &theEntry, std::vector<uint8_t> *theData) const;
+};
+
+#endif
@@ -0,0 +1,124 @@
+// gpak - packs a folder into a GPAK file the game mounts with PakInterface::AddPakFile
+//
+// usage: gpak [options] <folder> <output.gpak>
+
+#include "gpakbuilder.hpp"
+#include "PopLib/paklib/pakinterface.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// the password PakInterface decrypts with, defined in pakinterface.cpp
+extern std::string gDecryptPassword;
+
+static void PrintUsage(const char *theExeName)
+{
+	fprintf(stderr,
+			"usage: %s [options] <folder> <output.gpak>\n"
+			"  -r <resources.xml>  order entries by the groups of this manifest\n"
+			"  -j <threads>        threads to pack with, all cores by default\n"
+			"  -l <level>          zlib level 0-9, 9 by default\n"
+			"  -p <password>       encryption password, the game's by default\n"
+			"  -n                  don't encrypt, only for games with an empty gDecryptPassword\n"
+			"  -f                  pack every file again instead of reusing the last build\n"
+			"  -b <count>          mount the pak this many times afterwards and report the time\n",
+			theExeName);
+}
+
+static double GetElapsedMS(std::chrono::steady_clock::time_point theStart)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - theStart).count();
+}
+
+int main(int argc, char *argv[])
+{
+	GPakBuilder aBuilder;
+	aBuilder.mPassword = gDecryptPassword;
+	int aBenchmarkCount = 0;
+
+	std::vector<std::string> aFileArgs;
+	for (int i = 1; i < argc; i++)
+	{
+		const char *anArg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (strcmp(anArg, "-r") == 0 && hasValue)
+			aBuilder.mResourcesFileName = argv[++i];
+		else if (strcmp(anArg, "-j") == 0 && hasValue)
+			aBuilder.mNumThreads = std::max(atoi(argv[++i]), 1);
+		else if (strcmp(anArg, "-l") == 0 && hasValue)
+			aBuilder.mCompressionLevel = std::min(std::max(atoi(argv[++i]), 0), 9);
+		else if (strcmp(anArg, "-p") == 0 && hasValue)
+			aBuilder.mPassword = argv[++i];
+		else if (strcmp(anArg, "-n") == 0)
+			aBuilder.mPassword.clear();
+		else if (strcmp(anArg, "-f") == 0)
+			aBuilder.mIncremental = false;
+		else if (strcmp(anArg, "-b") == 0 && hasValue)
+			aBenchmarkCount = std::max(atoi(argv[++i]), 0);
+		else if (anArg[0] == '-')
+		{
+			PrintUsage(argv[0]);
+			return 1;
+		}
+		else
+			aFileArgs.push_back(anArg);
+	}
+
+	if (aFileArgs.size() != 2)
+	{
+		PrintUsage(argv[0]);
+		return 1;
+	}
+
+	aBuilder.mSourceDir = aFileArgs[0];
+	aBuilder.mPakFileName = aFileArgs[1];
+
+	auto aStart = std::chrono::steady_clock::now();
+
+	std::string anError;
+	if (!aBuilder.Build(&anError))
+	{
+		fprintf(stderr, "%s\n", anError.c_str());
+		return 1;
+	}
+
+	printf("%s: %d files packed, %d reused, %llu -> %llu bytes in %.0f ms on %d threads\n",
+		   aBuilder.mPakFileName.c_str(), aBuilder.mNumPacked, aBuilder.mNumReused,
+		   (unsigned long long)aBuilder.mSourceBytes, (unsigned long long)aBuilder.mPakBytes, GetElapsedMS(aStart),
+		   aBuilder.mNumThreads);
+
+	if (aBenchmarkCount > 0)
+	{
+		// mounts the way the game does, so the password has to be the one the pak was built with
+		gDecryptPassword = aBuilder.mPassword;
+
+		double aTotalMS = 0;
+		double aMinMS = 0;
+		for (int i = 0; i < aBenchmarkCount; i++)
+		{
+			PakInterface aPakInterface;
+
+			auto aMountStart = std::chrono::steady_clock::now();
+			if (!aPakInterface.AddPakFile(aBuilder.mPakFileName))
+			{
+				fprintf(stderr, "%s: doesn't mount\n", aBuilder.mPakFileName.c_str());
+				return 1;
+			}
+
+			double aMS = GetElapsedMS(aMountStart);
+			aTotalMS += aMS;
+			if (i == 0 || aMS < aMinMS)
+				aMinMS = aMS;
+		}
+
+		double anAverageMS = aTotalMS / aBenchmarkCount;
+		printf("mount: %.2f ms average, %.2f ms best over %d runs, %.1f MB/s\n", anAverageMS, aMinMS, aBenchmarkCount,
+			   anAverageMS > 0 ? aBuilder.mSourceBytes / (anAverageMS * 1000.0) : 0.0);
+	}
+
+	return 0;
+}
@@ -0,0 +1,42 @@
+// rescompiler - compiles a resource manifest into the binary form ResourceManager loads
+//
+// usage: rescompiler resources.xml [resources.xml.bin]
+
+#include "PopLib/resources/resourcemanifest.hpp"
+
+#include <cstdio>
+
+using namespace PopLib;
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2 || argc > 3)
+	{
+		fprintf(stderr, "usage: %s resources.xml [output]\n", argv[0]);
+		return 1;
+	}
+
+	std::string anXMLFileName = argv[1];
+	std::string anOutFileName = argc > 2 ? argv[2] : ResourceManifest::GetCompiledFileName(anXMLFileName);
+
+	std::string anError;
+	if (!ResourceManifest::Compile(anXMLFileName, anOutFileName, &anError))
+	{
+		fprintf(stderr, "%s: %s\n", anXMLFileName.c_str(), anError.c_str());
+		return 1;
+	}
+
+	ResourceManifest aManifest;
+	if (!aManifest.Open(anOutFileName))
+	{
+		fprintf(stderr, "%s: written file doesn't load back\n", anOutFileName.c_str());
+		return 1;
+	}
+
+	int aNumResources = 0;
+	for (int i = 0; i < aManifest.GetNumGroups(); i++)
+		aNumResources += aManifest.GetGroup(i).mNumRecords;
+
+	printf("%s: %d groups, %d entries\n", anOutFileName.c_str(), aManifest.GetNumGroups(), aNumResources);
+	return 0;
+}